@@ -41,8 +41,10 @@
         .cmd_file_path = "/var/run/iccpd/iccpd.vty", \
         .config_file_path = "/etc/iccpd/iccpd.conf", \
         .mclagdctl_file_path = "/var/run/iccpd/mclagdctl.sock", \
+        .warm_snapshot_path = "/var/run/iccpd/iccpd.snapshot", \
         .console_log = 0, \
         .telnet_port = 2015, \
+        .netlink_rcvbuf = 0, \
         .init = cmd_option_parser_init, \
         .finalize = cmd_option_parser_finalize, \
         .dump_usage = cmd_option_parser_dump_usage, \
@@ -64,8 +66,10 @@ struct CmdOptionParser
     char* cmd_file_path;
     char* config_file_path;
     char *mclagdctl_file_path;
+    char *warm_snapshot_path;
     uint8_t console_log;
     uint16_t telnet_port;
+    int netlink_rcvbuf;
     LIST_HEAD(option_list, CmdOption) option_list;
     int (*parse)(struct CmdOptionParser*, int, char*[]);
     void (*init)(struct CmdOptionParser*);
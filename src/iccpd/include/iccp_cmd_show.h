@@ -30,9 +30,14 @@
 extern int iccp_mclag_config_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_arp_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_ndisc_dump(char * *buf, int *num, int mclag_id);
-extern int iccp_mac_dump(char * *buf, int *num, int mclag_id);
+struct mclagdctl_req_hdr;
+struct mclagd_dump_cursor;
+
+extern int iccp_mac_dump(char * *buf, int *num, struct mclagdctl_req_hdr *req,
+                         int *more, struct mclagd_dump_cursor *next_cursor);
 extern int iccp_local_if_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_peer_if_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_cmd_dbg_counter_dump(char * *buf, int *data_len, int mclag_id);
+extern int iccp_cmd_latency_dump(char * *buf, int *data_len);
 extern int iccp_unique_ip_if_dump(char * *buf, int *num, int mclag_id);
 #endif
@@ -37,7 +37,13 @@ enum Reason_ID
 
 extern const char *reasons[];
 
+struct LocalInterface;
+
+/* Results are cached per port-channel, a check is only re-run after the
+ * local or peer attributes it compares changed */
 enum Reason_ID iccp_consistency_check(char* ifname);
+enum Reason_ID iccp_consistency_check_if(struct LocalInterface* local_if);
+const char *iccp_consistency_reason_name(struct LocalInterface* local_if);
 
 
 #endif
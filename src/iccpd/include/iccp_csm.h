@@ -36,6 +36,7 @@
 #include "../include/app_csm.h"
 #include "../include/msg_format.h"
 #include "../include/port.h"
+#include "../include/iccp_timer.h"
 
 #define CSM_BUFFER_SIZE 65536
 
@@ -77,8 +78,49 @@ struct Msg
     char* buf;
     size_t len;
     TAILQ_ENTRY(Msg) tail;
+    LIST_ENTRY(Msg) hash_next;  /* neighbor (ARP/ND) table index */
+    uint32_t sync_gen;          /* last neighbor resync that saw the entry */
+    uint8_t warm_restored;      /* neighbor from the warm reboot snapshot, unchanged */
+    uint64_t lat_stamp;         /* event or receive time, see system_latency_record() */
+    uint64_t sync_seq;          /* neighbor: sync log seq when last sent to the peer */
+    uint32_t sync_hash;         /* neighbor: hash of the content sent with sync_seq */
 };
 
+/* Small payloads are stored inline, right behind the pooled Msg */
+#define MSG_INLINE_BUF(msg) ((char*)((struct Msg*)(msg) + 1))
+
+/* Peer output queue, holds what the socket did not take yet */
+#define CSM_TX_QUEUE_SIZE           (4 * 1024 * 1024)
+#define CSM_TX_QUEUE_HIGH_WATERMARK ((CSM_TX_QUEUE_SIZE / 4) * 3)
+#define CSM_TX_QUEUE_LOW_WATERMARK  (CSM_TX_QUEUE_SIZE / 4)
+/* Kept free of MAC/ARP/ND info so control messages always fit */
+#define CSM_TX_QUEUE_CTRL_RESERVE   (8 * CSM_BUFFER_SIZE)
+
+struct CsmTxQueue
+{
+    char* buf;          /* ring buffer, allocated when the socket first backs up */
+    size_t head;        /* first byte not sent yet */
+    size_t len;         /* bytes queued */
+    uint8_t paused;     /* above high watermark, MAC/ARP/ND sync holds off */
+};
+
+/* Peer input buffer, holds at least one whole message plus the next one's start */
+#define CSM_RX_BUF_SIZE             (4 * CSM_BUFFER_SIZE)
+
+struct CsmRxBuf
+{
+    char* buf;          /* allocated on the first read */
+    size_t len;         /* bytes received, not yet parsed into a Msg */
+};
+
+/* MAC/ARP/ND sync should not add to the output queue */
+#define ICCP_CSM_TX_PAUSED(csm) ((csm)->tx_queue.paused)
+
+/* Sync data the peer gets again on the next resync, it may be dropped */
+#define ICCP_CSM_TLV_IS_SYNC_DATA(tlv_type) \
+    ((tlv_type) == TLV_T_MLACP_MAC_INFO || (tlv_type) == TLV_T_MLACP_ARP_INFO \
+     || (tlv_type) == TLV_T_MLACP_NDISC_INFO)
+
 /* Connection state */
 enum ICCP_CONNECTION_STATE
 {
@@ -106,12 +148,18 @@ struct CSM
 
     /* Socket info */
     int sock_fd;
+    int conn_fd;                        /* non-blocking connect in progress, -1 if none */
+    uint32_t conn_backoff_msec;         /* current reconnect backoff, 0 after success */
     pthread_mutex_t conn_mutex;
-    time_t connTimePrev;
-    time_t heartbeat_send_time;
-    time_t heartbeat_update_time;
+    struct iccp_timer conn_timer;       /* no new connect attempt while pending */
+    struct iccp_timer heartbeat_timer;  /* next heartbeat to send, keepalive_time */
+    struct iccp_timer session_timer;    /* session_timeout since heartbeat_update_msec */
+    uint64_t heartbeat_update_msec;
+    uint64_t heartbeat_rx_usec;         /* last peer heartbeat, for the interval histogram */
     time_t peer_warm_reboot_time;
     time_t warm_reboot_disconn_time;
+    time_t warm_snapshot_time;          /* tables restored from a snapshot saved then, 0 if not */
+    uint8_t warm_peer_stale;            /* restored peer MACs wait for the peer's resync */
     char peer_itf_name[IFNAMSIZ];
     time_t peer_link_learning_retry_time;
     char peer_ip[INET_ADDRSTRLEN];
@@ -125,6 +173,10 @@ struct CSM
     /* Msg queue */
     TAILQ_HEAD(msg_list, Msg) msg_list;
 
+    /* Output queue and input buffer */
+    struct CsmTxQueue tx_queue;
+    struct CsmRxBuf rx_buf;
+
     /* STP role */
     stp_role_type_et role_type;
 
@@ -147,7 +199,12 @@ struct CSM
     LIST_HEAD(csm_if_list, If_info) if_bind_list;
 };
 int iccp_csm_send(struct CSM*, char*, int);
+int iccp_csm_send_more(struct CSM*, char*, int);
+int iccp_csm_tx_queue_flush(struct CSM*);
+void iccp_csm_tx_queue_free(struct CSM*);
+void iccp_csm_rx_buf_free(struct CSM*);
 int iccp_csm_init_msg(struct Msg**, char*, int);
+void iccp_csm_free_msg(struct Msg*);
 int iccp_csm_prepare_nak_msg(struct CSM*, char*, size_t);
 int iccp_csm_prepare_iccp_msg(struct CSM*, char*, size_t);
 int iccp_csm_prepare_capability_msg(struct CSM*, char*, size_t);
@@ -170,4 +227,5 @@ void iccp_csm_correspond_from_rg_disconnect_msg(struct CSM*, struct Msg*);
 
 int mlacp_bind_port_channel_to_csm(struct CSM* csm, const char *ifname);
 int iccp_csm_init_mac_msg(struct MACMsg **mac_msg, char* data, int len);
+void iccp_csm_free_mac_msg(struct MACMsg *mac_msg);
 #endif /* ICCP_CSM_H_ */
@@ -30,10 +30,28 @@ int iccp_sys_local_if_list_get_init();
 
 int iccp_neigh_get_init();
 
+int iccp_sys_local_if_list_resync();
+int iccp_neigh_resync();
+
 void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, uint8_t mac_addr[ETHER_ADDR_LEN]);
 void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, uint8_t mac_addr[ETHER_ADDR_LEN]);
 
+/* Neighbor event reduced to what ARP/ND learning uses */
+struct iccp_neigh_rec
+{
+    int ifindex;
+    uint16_t msgtype;       /* RTM_NEWNEIGH or RTM_DELNEIGH */
+    uint16_t state;         /* NUD_* */
+    uint8_t family;         /* AF_INET or AF_INET6 */
+    uint8_t is_del;
+    uint8_t has_lladdr;
+    uint8_t dst[16];
+    uint8_t lladdr[ETHER_ADDR_LEN];
+};
+
 int do_one_neigh_request(struct nlmsghdr *n);
+int iccp_neigh_parse(struct nlmsghdr *n, struct iccp_neigh_rec *rec);
+void do_one_neigh_rec(struct iccp_neigh_rec *rec);
 
 void iccp_from_netlink_port_state_handler( char * ifname, int state);
 
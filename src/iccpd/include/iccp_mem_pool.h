@@ -0,0 +1,87 @@
+/*
+ * iccp_mem_pool.h
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef ICCP_MEM_POOL_H_
+#define ICCP_MEM_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/queue.h>
+
+/* Payload bytes stored inline behind a pooled struct Msg. Large enough for
+ * ARPMsg/NDISCMsg/MACMsg and the small ICCP control messages; anything
+ * bigger falls back to a separate heap buffer.
+ */
+#define MSG_INLINE_BUF_SIZE         256
+
+/* Number of objects carved out of one slab */
+#define MEM_POOL_SLAB_OBJ_NUM       256
+
+enum MEM_POOL_TYPE
+{
+    MEM_POOL_MSG = 0,       /* struct Msg + inline payload */
+    MEM_POOL_MAC_MSG,       /* struct MACMsg */
+    MEM_POOL_MAX
+};
+
+struct mem_pool_slab;
+
+/* Per object header, kept in front of every object handed out */
+struct mem_pool_obj
+{
+    struct mem_pool_slab* slab;
+    SLIST_ENTRY(mem_pool_obj) next;
+};
+
+struct mem_pool_slab
+{
+    LIST_ENTRY(mem_pool_slab) next;
+    SLIST_HEAD(slab_free_list, mem_pool_obj) free_list;
+    uint32_t in_use;
+};
+
+struct mem_pool
+{
+    const char* name;
+    size_t obj_size;
+    uint32_t objs_per_slab;
+
+    /* Slabs with at least one free object, and slabs fully in use */
+    LIST_HEAD(slab_partial_list, mem_pool_slab) partial_list;
+    LIST_HEAD(slab_full_list, mem_pool_slab) full_list;
+
+    uint32_t slab_count;
+    uint32_t empty_slab_count;
+    uint32_t in_use;
+    uint32_t in_use_max;
+};
+
+void mem_pool_init(struct mem_pool* pool, const char* name, size_t obj_size, uint32_t objs_per_slab);
+void mem_pool_destroy(struct mem_pool* pool);
+void* mem_pool_alloc(struct mem_pool* pool);
+void mem_pool_free(struct mem_pool* pool, void* obj);
+
+struct mem_pool* mem_pool_get(enum MEM_POOL_TYPE type);
+void mem_pool_finalize(void);
+
+#endif /* ICCP_MEM_POOL_H_ */
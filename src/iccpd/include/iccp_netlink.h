@@ -50,13 +50,19 @@ struct in6_pktinfo
     unsigned int ipi6_ifindex;  /* send/recv interface index */
 };
 
+/* Use the same socket buffer size as in SwSS common */
+#define NETLINK_SOCKET_BUFFER_SIZE      16777216
+
 int iccp_get_port_member_list(struct LocalInterface *lif);
 void iccp_event_handler_obj_input_newlink(struct nl_object *obj, void *arg);
 void iccp_event_handler_obj_input_dellink(struct nl_object *obj, void *arg);
 int iccp_system_init_netlink_socket();
+int iccp_netlink_event_sock_set_rcvbuf(struct System *sys);
 void iccp_system_dinit_netlink_socket();
 int iccp_init_netlink_event_fd(struct System *sys);
-int iccp_handle_events(struct System *sys);
+int iccp_route_event_input(struct nlmsghdr *nlh);
+void iccp_netlink_sync_again();
+int iccp_handle_events(struct System *sys, int timeout_msec);
 void update_if_ipmac_on_standby(struct LocalInterface *lif_po, int dir);
 int iccp_sys_local_if_list_get_addr();
 int iccp_netlink_neighbor_request(int family, uint8_t *addr, int add, uint8_t *mac, char *portname, int permanent, int dir);
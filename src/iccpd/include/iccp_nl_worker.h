@@ -0,0 +1,90 @@
+/*
+ * iccp_nl_worker.h
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef ICCP_NL_WORKER_H_
+#define ICCP_NL_WORKER_H_
+
+#include <stdint.h>
+
+/* Single producer (worker thread), single consumer (main loop) ring,
+ * must be a power of two.
+ */
+#define NL_WORKER_RING_SIZE         (4 * 1024 * 1024)
+#define NL_WORKER_RECV_BUF_SIZE     (64 * 1024)
+/* Socket reads per poll wakeup */
+#define NL_WORKER_RECV_MAX          16
+/* Records applied per main loop wakeup, ICCP sockets are served in between */
+#define NL_WORKER_DRAIN_MAX         256
+#define NL_WORKER_POLL_MSEC         200
+
+enum NL_WORKER_REC_TYPE
+{
+    NL_WORKER_REC_PAD = 0,      /* filler up to the end of the ring */
+    NL_WORKER_REC_NEIGH,        /* struct iccp_neigh_rec */
+    NL_WORKER_REC_NLMSG,        /* raw link/addr netlink message */
+    NL_WORKER_REC_RESYNC,       /* socket overrun, uint32_t NL_WORKER_SOCK_* payload */
+    NL_WORKER_REC_COUNTERS,     /* struct nl_worker_counters */
+};
+
+/* Event sockets read by the worker, one per resync family */
+enum NL_WORKER_SOCK
+{
+    NL_WORKER_SOCK_LINK = 0,    /* link and address events */
+    NL_WORKER_SOCK_NEIGH,       /* neighbor events */
+    NL_WORKER_SOCK_NUM
+};
+
+struct nl_worker_rec_hdr
+{
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t len;   /* payload bytes following the header */
+};
+
+/* Counted by the worker, which must not touch the system counters, and
+ * handed to the main thread through the ring as deltas
+ */
+struct nl_worker_counters
+{
+    uint32_t newlink_count;
+    uint32_t dellink_count;
+    uint32_t newnbr_count;
+    uint32_t newmac_count;
+    uint32_t delnbr_count;
+    uint32_t delmac_count;
+    uint32_t newaddr_count;
+    uint32_t deladdr_count;
+    uint32_t unknown_type_count;
+    uint32_t ring_full_count;
+    uint16_t unknown_type;      /* last one seen */
+};
+
+struct System;
+
+int iccp_nl_worker_init(struct System* sys);
+int iccp_nl_worker_start(struct System* sys);
+void iccp_nl_worker_stop(struct System* sys);
+int iccp_get_nl_worker_event_fd(struct System* sys);
+int iccp_nl_worker_event_handler(struct System* sys);
+
+#endif /* ICCP_NL_WORKER_H_ */
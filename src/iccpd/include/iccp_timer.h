@@ -0,0 +1,71 @@
+/*
+ * iccp_timer.h
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef ICCP_TIMER_H_
+#define ICCP_TIMER_H_
+
+#include <stdint.h>
+#include <sys/queue.h>
+
+/* Resolution of the timer wheel */
+#define ICCP_TIMER_TICK_MSEC        10
+
+/* Wheel layout: one 256 slot level in ticks, three 64 slot levels above it.
+ * Covers 2^26 ticks (about 7.7 days), longer timers are clamped.
+ */
+#define ICCP_TIMER_ROOT_BITS        8
+#define ICCP_TIMER_LEVEL_BITS       6
+#define ICCP_TIMER_ROOT_SIZE        (1 << ICCP_TIMER_ROOT_BITS)
+#define ICCP_TIMER_LEVEL_SIZE       (1 << ICCP_TIMER_LEVEL_BITS)
+#define ICCP_TIMER_ROOT_MASK        (ICCP_TIMER_ROOT_SIZE - 1)
+#define ICCP_TIMER_LEVEL_MASK       (ICCP_TIMER_LEVEL_SIZE - 1)
+#define ICCP_TIMER_LEVEL_NUM        3
+
+struct System;
+
+typedef void (*iccp_timer_handler_t)(void* arg);
+
+struct iccp_timer
+{
+    LIST_ENTRY(iccp_timer) next;
+    uint64_t expire;                /* wheel tick the timer fires at */
+    iccp_timer_handler_t handler;   /* may be NULL, expiry then only wakes the scheduler */
+    void* arg;
+};
+
+LIST_HEAD(iccp_timer_list, iccp_timer);
+
+#define ICCP_TIMER_PENDING(timer) ((timer)->next.le_prev != NULL)
+
+void iccp_timer_init(struct iccp_timer* timer, iccp_timer_handler_t handler, void* arg);
+void iccp_timer_start(struct iccp_timer* timer, uint64_t msec);
+void iccp_timer_stop(struct iccp_timer* timer);
+uint64_t iccp_timer_now_msec(void);
+uint64_t iccp_timer_now_usec(void);
+
+int iccp_timer_wheel_init(struct System* sys);
+void iccp_timer_wheel_finalize(struct System* sys);
+int iccp_get_timer_fd(struct System* sys);
+int iccp_timer_wheel_handler(struct System* sys);
+
+#endif /* ICCP_TIMER_H_ */
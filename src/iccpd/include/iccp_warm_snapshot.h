@@ -0,0 +1,103 @@
+/*
+ * iccp_warm_snapshot.h
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef ICCP_WARM_SNAPSHOT_H_
+#define ICCP_WARM_SNAPSHOT_H_
+
+#include <stdint.h>
+
+#include "../include/iccp_csm.h"
+
+#define ICCP_WARM_SNAPSHOT_FILE     "/var/run/iccpd/iccpd.snapshot"
+#define ICCP_WARM_SNAPSHOT_MAGIC    0x49435753  /* "ICWS" */
+/* Bump on any change of the header, section or record layout */
+#define ICCP_WARM_SNAPSHOT_VERSION  2
+
+/* mclagsyncd replays the FDB and the kernel its neighbors within this
+ * time after restart, restored entries not seen by then are stale.
+ */
+#define ICCP_WARM_RECONCILE_MSEC    (60 * 1000)
+
+enum ICCP_WARM_SECTION_TYPE
+{
+    ICCP_WARM_SECTION_DOMAIN = 1,   /* one struct iccp_warm_domain_rec */
+    ICCP_WARM_SECTION_MAC,          /* struct iccp_warm_mac_rec */
+    ICCP_WARM_SECTION_ARP,          /* struct ARPMsg */
+    ICCP_WARM_SECTION_NDISC,        /* struct NDISCMsg */
+};
+
+/* Host byte order, the snapshot is only read back by the same build */
+struct iccp_warm_snapshot_hdr
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_len;
+    uint32_t len;           /* whole file */
+    uint32_t checksum;      /* FNV-1a of everything behind the header */
+    int64_t save_time;      /* time() when iccpd went down */
+    uint32_t section_num;
+    uint32_t reserved;
+};
+
+struct iccp_warm_section_hdr
+{
+    uint16_t type;
+    uint16_t rec_len;       /* size of one record */
+    int32_t mlag_id;
+    uint32_t rec_num;
+    uint32_t reserved;
+};
+
+struct iccp_warm_domain_rec
+{
+    char sender_ip[INET_ADDRSTRLEN];
+    char peer_ip[INET_ADDRSTRLEN];
+    char peer_itf_name[IFNAMSIZ];
+    uint8_t remote_system_id[ETHER_ADDR_LEN];
+    uint16_t remote_system_priority;
+    uint32_t peer_sync_epoch;   /* peer entries held, see mlacp_sync_log.c */
+    uint64_t peer_sync_seq;
+};
+
+struct iccp_warm_mac_rec
+{
+    uint16_t vid;
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+    uint8_t fdb_type;
+    uint8_t age_flag;
+    uint8_t pending_local_del;
+    uint8_t add_to_syncd;
+    char ifname[MAX_L_PORT_NAME];
+    char origin_ifname[MAX_L_PORT_NAME];
+};
+
+struct System;
+
+int iccp_warm_snapshot_save(struct System* sys);
+int iccp_warm_snapshot_load(struct System* sys);
+void iccp_warm_snapshot_restore(struct CSM* csm);
+int iccp_warm_snapshot_peer_synced(struct CSM* csm);
+void iccp_warm_snapshot_syncd_connected(struct System* sys);
+void iccp_warm_snapshot_peer_reconcile(struct CSM* csm);
+
+#endif /* ICCP_WARM_SNAPSHOT_H_ */
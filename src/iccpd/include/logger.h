@@ -43,12 +43,25 @@ typedef enum _iccpd_log_level_t
 #define LOGBUF_SIZE 1024
 #define ICCPD_UTILS_SYSLOG    (syslog)
 
-#define ICCPD_LOG_CRITICAL(tag, format, args ...) write_log(CRITICAL_LOG_LEVEL, tag, format, ## args)
-#define ICCPD_LOG_ERR(tag, format, args ...) write_log(ERR_LOG_LEVEL, tag, format, ## args)
-#define ICCPD_LOG_WARN(tag, format, args ...) write_log(WARN_LOG_LEVEL, tag, format, ## args)
-#define ICCPD_LOG_NOTICE(tag, format, args ...) write_log(NOTICE_LOG_LEVEL, tag, format, ## args)
-#define ICCPD_LOG_INFO(tag, format, args ...) write_log(INFO_LOG_LEVEL, tag, format, ## args)
-#define ICCPD_LOG_DEBUG(tag, format, args ...) write_log(DEBUG_LOG_LEVEL, tag, format, ## args)
+/* Messages handed to the syslog writer thread, must be a power of 2 */
+#define LOG_RING_SIZE 2048
+
+/* Check the level before the arguments are evaluated, disabled messages
+ * cost a load and a compare.
+ */
+#define ICCPD_LOG_ENABLED(level) ((level) <= g_logger_config.log_level)
+#define ICCPD_LOG(level, tag, format, args ...) \
+    do { \
+        if (ICCPD_LOG_ENABLED(level)) \
+            write_log(level, tag, format, ## args); \
+    } while (0)
+
+#define ICCPD_LOG_CRITICAL(tag, format, args ...) ICCPD_LOG(CRITICAL_LOG_LEVEL, tag, format, ## args)
+#define ICCPD_LOG_ERR(tag, format, args ...) ICCPD_LOG(ERR_LOG_LEVEL, tag, format, ## args)
+#define ICCPD_LOG_WARN(tag, format, args ...) ICCPD_LOG(WARN_LOG_LEVEL, tag, format, ## args)
+#define ICCPD_LOG_NOTICE(tag, format, args ...) ICCPD_LOG(NOTICE_LOG_LEVEL, tag, format, ## args)
+#define ICCPD_LOG_INFO(tag, format, args ...) ICCPD_LOG(INFO_LOG_LEVEL, tag, format, ## args)
+#define ICCPD_LOG_DEBUG(tag, format, args ...) ICCPD_LOG(DEBUG_LOG_LEVEL, tag, format, ## args)
 
 struct LoggerConfig
 {
@@ -57,6 +70,8 @@ struct LoggerConfig
     uint8_t init;
 };
 
+extern struct LoggerConfig g_logger_config;
+
 struct LoggerConfig* logger_get_configuration();
 void logger_set_configuration(int log_level);
 char* log_level_to_string(int level);
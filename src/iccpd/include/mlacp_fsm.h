@@ -28,13 +28,36 @@
 #include "../include/port.h"
 #include "../include/mlacp_tlv.h"
 
+#define NEIGH_HASH_SIZE     4096
+#define NEIGH_HASH_IPV4(ip) \
+    IF_HASH_BUCKET(((uint32_t)(ip) * 2654435761u) >> 16, NEIGH_HASH_SIZE)
+#define NEIGH_HASH_IPV6(ip) \
+    NEIGH_HASH_IPV4((ip)[0] ^ (ip)[1] ^ (ip)[2] ^ (ip)[3])
+
+#define ARP_HASH_HEAD(csm, ip)      (&(MLACP(csm).arp_hash[NEIGH_HASH_IPV4(ip)]))
+#define NDISC_HASH_HEAD(csm, ip)    (&(MLACP(csm).ndisc_hash[NEIGH_HASH_IPV6(ip)]))
+
+#define MAC_IF_HASH_SIZE    256
+#define MAC_ORIGIN_HASH_HEAD(csm, name) \
+    (&(MLACP(csm).mac_origin_hash[IF_HASH_BUCKET(if_name_hash(name), MAC_IF_HASH_SIZE)]))
+#define MAC_IFNAME_HASH_HEAD(csm, name) \
+    (&(MLACP(csm).mac_ifname_hash[IF_HASH_BUCKET(if_name_hash(name), MAC_IF_HASH_SIZE)]))
+
 #define MLCAP_SYNC_PHY_DEV_SEC     1     /*every 1 sec*/
 
 #define MLACP_LOCAL_IF_DOWN_TIMER 600  // 600 seconds.
 
+/* Peer messages one domain handles per scheduler loop, the rest wait
+ * for the next loop so that other domains are not starved */
+#define MLACP_RX_MSG_BUDGET       256
+
+/* Peer waits this long for a warm rebooting node to reconnect */
+#define WARM_REBOOT_TIMEOUT 90
+
 #define MLACP(csm_ptr)  (csm_ptr->app_csm.mlacp)
 
 struct CSM;
+struct mlacp_sync_tombstone;
 
 enum MLACP_APP_STATE
 {
@@ -121,6 +144,7 @@ enum ICCP_DBG_CNTR_MSG
     ICCP_DBG_CNTR_MSG_STP_PO_PORT_MAP  = 26,
     ICCP_DBG_CNTR_MSG_STP_AGE_OUT      = 27,
     ICCP_DBG_CNTR_MSG_STP_COMMON_MSG   = 28,
+    ICCP_DBG_CNTR_MSG_SYNC_RESUME      = 29,
     ICCP_DBG_CNTR_MSG_MAX
 };
 typedef enum ICCP_DBG_CNTR_MSG ICCP_DBG_CNTR_MSG_e;
@@ -146,6 +170,16 @@ do{\
 typedef struct mlacp_dbg_counter_info
 {
     uint64_t iccp_counters[ICCP_DBG_CNTR_MSG_MAX][ICCP_DBG_CNTR_DIR_MAX][ICCP_DBG_CNTR_STS_MAX];
+
+    /* Output queue to MCLAG peer */
+    uint32_t tx_queue_depth;        /* bytes currently queued */
+    uint32_t tx_queue_max_depth;
+    uint32_t tx_queue_pause_count;  /* high watermark reached */
+    uint32_t tx_queue_drop_count;   /* messages dropped, queue full */
+
+    /* Resync replies sent to the peer */
+    uint32_t resync_full_count;
+    uint32_t resync_delta_count;
 }mlacp_dbg_counter_info_t;
 
 struct mLACP
@@ -154,6 +188,7 @@ struct mLACP
     int sync_req_num;
 
     MLACP_APP_STATE_E current_state;
+    MLACP_APP_STATE_E prev_state;   /* state seen by the last transit */
     MLACP_SYNC_STATE_E sync_state;
 
     uint8_t wait_for_sync_data;
@@ -170,13 +205,42 @@ struct mLACP
     TAILQ_HEAD(arp_info_list, Msg) arp_list;
     TAILQ_HEAD(ndisc_msg_list, Msg) ndisc_msg_list;
     TAILQ_HEAD(ndisc_info_list, Msg) ndisc_list;
+    /* Hash index over arp_list/ndisc_list keyed by IP address, the lists
+     * keep insertion order for dumps and resync*/
+    LIST_HEAD(arp_hash_list, Msg) arp_hash[NEIGH_HASH_SIZE];
+    LIST_HEAD(ndisc_hash_list, Msg) ndisc_hash[NEIGH_HASH_SIZE];
     TAILQ_HEAD(mac_msg_list, MACMsg) mac_msg_list;
 
     struct mac_rb_tree mac_rb;
+    /* Index over mac_rb by origin_ifname and by ifname, interface events
+     * only walk the entries on that interface */
+    LIST_HEAD(mac_origin_hash_list, MACMsg) mac_origin_hash[MAC_IF_HASH_SIZE];
+    LIST_HEAD(mac_ifname_hash_list, MACMsg) mac_ifname_hash[MAC_IF_HASH_SIZE];
 
     LIST_HEAD(lif_list, LocalInterface) lif_list;
     LIST_HEAD(lif_purge_list, LocalInterface) lif_purge_list;
+    /* lif_list entries with changed/port_config_sync set, the exchange
+     * stage only walks these */
+    LIST_HEAD(lif_dirty_list, LocalInterface) lif_dirty_list;
+    /* Earliest po_down_time expiry on lif_list, 0 if none pending */
+    time_t po_down_expire_time;
     LIST_HEAD(pif_list, PeerInterface) pif_list;
+    LIST_HEAD(pif_name_hash_list, PeerInterface) pif_name_hash[PIF_HASH_SIZE];
+
+    /* Incremental resync, see mlacp_sync_log.c */
+    uint32_t sync_epoch;            /* new on every start, seqs of other epochs are void */
+    uint64_t sync_seq;              /* last seq handed out */
+    uint64_t sync_mark_seq;         /* last seq the peer was told it has */
+    uint8_t sync_mark_void;         /* a message to the peer was dropped this session */
+    struct mlacp_sync_tombstone* sync_log;  /* ring of removed entries */
+    uint32_t sync_log_head;
+    uint32_t sync_log_num;
+    uint64_t sync_log_lost_seq;     /* newest seq overwritten in the ring */
+    uint32_t peer_sync_epoch;       /* peer entries held up to peer_sync_seq */
+    uint64_t peer_sync_seq;
+    uint8_t peer_resume_capable;    /* the peer sent a resume request this session */
+    uint8_t resync_delta;           /* only entries changed after resync_since are sent */
+    uint64_t resync_since;
 
     /* ICCP message tx/rx debug counters */
     mlacp_dbg_counter_info_t  dbg_counters;
@@ -185,6 +249,7 @@ struct mLACP
 void mlacp_init(struct CSM* csm, int all);
 void mlacp_finalize(struct CSM* csm);
 void mlacp_fsm_transit(struct CSM* csm);
+void mlacp_heartbeat_timer_handler(void* arg);
 void mlacp_enqueue_msg(struct CSM*, struct Msg*);
 struct Msg* mlacp_dequeue_msg(struct CSM*);
 char* mlacp_state(struct CSM* csm);
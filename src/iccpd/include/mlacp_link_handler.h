@@ -51,16 +51,30 @@ void peerlink_port_isolate_cleanup(struct CSM* csm);
 void update_peerlink_isolate_from_all_csm_lif(struct CSM* csm);
 
 ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t send_len);
+size_t iccp_mclagsyncd_tx_flush(struct System *sys);
 
 void del_mac_from_chip(struct MACMsg* mac_msg);
 void add_mac_to_chip(struct MACMsg* mac_msg, uint8_t mac_type);
 uint8_t set_mac_local_age_flag(struct CSM *csm, struct MACMsg* mac_msg, uint8_t set, uint8_t update_peer);
+void mlacp_mac_index_init(struct CSM* csm);
+void mlacp_mac_index_add(struct CSM* csm, struct MACMsg* mac_msg);
+void mlacp_mac_set_ifname(struct CSM* csm, struct MACMsg* mac_msg, const char* ifname);
+void mlacp_mac_set_origin_ifname(struct CSM* csm, struct MACMsg* mac_msg, const char* ifname);
+void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, char *ifname, uint8_t fdb_type, uint8_t op_type);
 
 extern int mclagd_ctl_sock_create();
-extern int mclagd_ctl_sock_accept(int fd);
-extern int mclagd_ctl_interactive_process(int client_fd);
+extern void mclagd_ctl_sock_accept(int fd);
+extern int mclagd_ctl_client_event(int fd, uint32_t events);
+/* Change records for mclagdctl watch, op is an enum mclagd_watch_op */
+void mclagd_ctl_watch_mac(struct CSM *csm, struct MACMsg *mac_msg, int op);
+void mclagd_ctl_watch_arp(struct CSM *csm, struct ARPMsg *arp_msg, int op);
+void mclagd_ctl_watch_ndisc(struct CSM *csm, struct NDISCMsg *ndisc_msg, int op);
+void mclagd_ctl_watch_po(struct CSM *csm, char *ifname, int is_peer, int up);
+void mclagd_ctl_watch_session(struct CSM *csm, int up);
 extern int parseMacString(const char *str_mac, uint8_t *bin_mac);
 
+char *show_ip_str_r(uint32_t ipv4_addr, char buf[INET_ADDRSTRLEN]);
+char *show_ipv6_str_r(char *ipv6_addr, char buf[INET6_ADDRSTRLEN]);
 char *show_ip_str(uint32_t ipv4_addr);
 char *show_ipv6_str(char *ipv6_addr);
 
@@ -81,6 +95,7 @@ void mlacp_mlag_intf_detach_handler(struct CSM* csm, struct LocalInterface* loca
 void mlacp_peer_mlag_intf_delete_handler(struct CSM* csm, char *mlag_if_name);
 
 int iccp_mclagsyncd_msg_handler(struct System *sys);
+void iccp_send_fdb_batch_to_syncd();
 int syn_local_neigh_mac_info_to_peer(struct LocalInterface *local_if, int sync_add,
         int is_v4, int is_v6, int sync_mac, int ack, int is_ipv6_ll, int dir);
 int syn_local_mac_info_to_peer(struct CSM* csm, struct LocalInterface *local_if, int sync_add, int is_sag);
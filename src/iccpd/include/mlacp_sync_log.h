@@ -0,0 +1,79 @@
+/*
+ * mlacp_sync_log.h
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#ifndef MLACP_SYNC_LOG_H_
+#define MLACP_SYNC_LOG_H_
+
+#include <stdint.h>
+
+#include "../include/iccp_csm.h"
+#include "../include/mlacp_tlv.h"
+
+/* Removed entries remembered for a delta resync, older ones force a full one */
+#define MLACP_SYNC_LOG_SIZE     4096
+
+enum MLACP_SYNC_LOG_TYPE
+{
+    MLACP_SYNC_LOG_MAC = 1,
+    MLACP_SYNC_LOG_ARP,
+    MLACP_SYNC_LOG_NDISC,
+};
+
+struct mlacp_sync_tombstone
+{
+    uint64_t seq;
+    uint8_t type;
+    union
+    {
+        struct
+        {
+            uint16_t vid;
+            uint8_t mac_addr[ETHER_ADDR_LEN];
+            uint8_t fdb_type;
+            char origin_ifname[MAX_L_PORT_NAME];
+        } mac;
+        struct ARPMsg arp;
+        struct NDISCMsg ndisc;
+    } u;
+};
+
+void mlacp_sync_log_init(struct CSM* csm, int all);
+void mlacp_sync_log_finalize(struct CSM* csm);
+
+void mlacp_sync_log_mac_sent(struct CSM* csm, struct MACMsg* mac_msg);
+void mlacp_sync_log_arp_sent(struct CSM* csm, struct ARPMsg* arp_msg);
+void mlacp_sync_log_ndisc_sent(struct CSM* csm, struct NDISCMsg* ndisc_msg);
+
+void mlacp_sync_log_mac_del(struct CSM* csm, struct MACMsg* mac_msg);
+void mlacp_sync_log_arp_del(struct CSM* csm, struct Msg* msg);
+void mlacp_sync_log_ndisc_del(struct CSM* csm, struct Msg* msg);
+
+int mlacp_sync_log_mac_changed(struct CSM* csm, struct MACMsg* mac_msg);
+int mlacp_sync_log_neigh_changed(struct CSM* csm, struct Msg* msg, int is_arp);
+
+void mlacp_sync_log_send_request(struct CSM* csm);
+void mlacp_sync_log_recv_resume(struct CSM* csm, struct mLACPSyncResumeTLV* tlv);
+void mlacp_sync_log_resync_start(struct CSM* csm);
+void mlacp_sync_log_send_mark(struct CSM* csm);
+
+#endif /* MLACP_SYNC_LOG_H_ */
@@ -44,8 +44,12 @@ int mlacp_fsm_update_warmboot(struct CSM* csm, struct mLACPWarmbootTLV* tlv);
 
 void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg);
 void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg);
+void mlacp_dequeue_arp(struct CSM* csm, struct Msg* msg);
+void mlacp_dequeue_ndisc(struct CSM *csm, struct Msg *msg);
+void mlacp_neigh_hash_init(struct CSM *csm);
 int mlacp_fsm_update_Agg_conf(struct CSM* csm, mLACPAggConfigTLV* portconf);
 int mlacp_fsm_update_port_channel_info(struct CSM* csm, struct mLACPPortChannelInfoTLV* tlv);
 int mlacp_fsm_update_peerlink_info(struct CSM* csm, struct mLACPPeerLinkInfoTLV* tlv);
 int mlacp_fsm_update_mac_info_from_peer(struct CSM* csm, struct mLACPMACInfoTLV* tlv);
+int mlacp_fsm_update_mac_entry_from_peer(struct CSM* csm, struct mLACPMACData *MacData);
 #endif
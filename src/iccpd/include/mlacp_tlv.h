@@ -469,6 +469,24 @@ struct mLACPIfUpAckTLV {
     uint16_t        if_id;                   /* LAG: agg_id */
 }__attribute__ ((packed));
 
+typedef uint8_t SYNC_RESUME_TYPE_e;
+enum SYNC_RESUME_TYPE_e
+{
+    SYNC_RESUME_TYPE_REQUEST = 1,   /* holding the peer's entries up to seq of epoch */
+    SYNC_RESUME_TYPE_FULL = 2,      /* reply: all entries follow */
+    SYNC_RESUME_TYPE_DELTA = 3,     /* reply: entries changed after the requested seq follow */
+    SYNC_RESUME_TYPE_MARK = 4       /* all entries up to seq were sent */
+};
+
+/* Sent before the sync request, a peer not knowing the TLV resyncs all */
+struct mLACPSyncResumeTLV {
+    ICCParameter    icc_parameter;
+    uint8_t         type;
+    uint8_t         reserved[3];
+    uint32_t        epoch;
+    uint64_t        seq;
+}__attribute__ ((packed));
+
 enum NEIGH_OP_TYPE
 {
     NEIGH_SYNC_LIF = 0,
@@ -495,6 +513,12 @@ enum MAC_AGE_TYPE
     MAC_AGE_PEER    = 2,    /*MAC in peer switch is ageout*/
 };
 
+enum MAC_WARM_STATE
+{
+    MAC_WARM_RESTORED   = 1,    /*From the warm reboot snapshot and unchanged, peer has it*/
+    MAC_WARM_STALE      = 2,    /*From the warm reboot snapshot, not replayed yet*/
+};
+
 enum MAC_OP_TYPE
 {
     MAC_SYNC_ADD    = 1,
@@ -525,8 +549,14 @@ struct MACMsg
     uint8_t age_flag;/*local or peer is age?*/
     uint8_t pending_local_del;
     uint8_t add_to_syncd;
+    uint8_t warm_state;     /*MAC_WARM_* flags*/
+    uint64_t peer_tx_stamp; /*local event time while queued for the peer*/
+    uint64_t sync_seq;      /*sync log seq when last sent to the peer, 0 if never*/
+    uint32_t sync_hash;     /*hash of the content sent with sync_seq*/
 
     TAILQ_ENTRY(MACMsg) tail;     // entry into mac_msg_list
+    LIST_ENTRY(MACMsg) origin_hash_next;  // entry into mac_origin_hash
+    LIST_ENTRY(MACMsg) ifname_hash_next;  // entry into mac_ifname_hash
 };
 
 RB_HEAD(mac_rb_tree, MACMsg);
@@ -105,6 +105,7 @@
 #define TLV_T_MLACP_WARMBOOT_FLAG       0x1039
 #define TLV_T_MLACP_NDISC_INFO          0x103A
 #define TLV_T_MLACP_IF_UP_ACK           0x103B
+#define TLV_T_MLACP_SYNC_RESUME         0x103C
 #define TLV_T_MLACP_LIST_END            0x104a //list end
 
 /* Debug */
@@ -187,6 +188,9 @@ static char* get_tlv_type_string(int type)
 
         case TLV_T_MLACP_IF_UP_ACK:
             return "TLV_T_MLACP_IF_UP_ACK";
+
+        case TLV_T_MLACP_SYNC_RESUME:
+            return "TLV_T_MLACP_SYNC_RESUME";
     }
 
     return "UNKNOWN";
@@ -440,9 +444,13 @@ typedef enum mclag_syncd_msg_type_e_
     MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_DOMAIN       = 2,
     MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_IFACE        = 3,
     MCLAG_SYNCD_MSG_TYPE_VLAN_MBR_UPDATES       = 4,
-    MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_UNIQUE_IP    = 5
+    MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_UNIQUE_IP    = 5,
+    MCLAG_SYNCD_MSG_TYPE_CAPABILITY             = 6
 }mclag_syncd_msg_type_e;
 
+/* Capability flags mclagsyncd advertises after it connects */
+#define MCLAG_SYNCD_CAP_FDB_BATCH   0x1  /* takes multiple entries in one SET_FDB msg */
+
 typedef enum mclag_msg_type_e_
 {
     MCLAG_MSG_TYPE_NONE                 = 0,
@@ -528,6 +536,11 @@ struct mclag_fdb_info
     short op_type; /*add or del*/
 };
 
+struct mclag_syncd_capability_info
+{
+    uint32_t flags;  /* MCLAG_SYNCD_CAP_* */
+};
+
 struct mclag_domain_cfg_info
 {
     int op_type;/*add/del domain; add/del mclag domain */
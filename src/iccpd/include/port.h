@@ -27,6 +27,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
+#include <string.h>
 #include <sys/queue.h>
 
 #include "../include/openbsd_tree.h"
@@ -77,31 +78,35 @@ struct Unq_ip_If_info
     LIST_ENTRY(Unq_ip_If_info) if_next;
 };
 
-struct VLAN_ID
+#define VLAN_ID_MAX         4096
+#define VLAN_BITMAP_WORDS   (VLAN_ID_MAX / 64)
+
+/* VLAN membership of an interface, bit vid is set for a member of VLAN vid.
+ * The VLAN interface of a vid is per system, see local_if_find_vlan_itf().
+ */
+struct VlanBitmap
 {
-    uint16_t vid;
-    uint16_t vlan_removed;
-    struct LocalInterface* vlan_itf; /* loacl vlan interface */
-    RB_ENTRY(VLAN_ID) vlan_entry;
+    uint64_t word[VLAN_BITMAP_WORDS];
 };
 
-RB_HEAD(vlan_rb_tree, VLAN_ID);
-RB_PROTOTYPE(vlan_rb_tree, VLAN_ID, vlan_rb_tree, vlan_node_compare);
+#define VLAN_BITMAP_WORD(vid)       ((vid) / 64)
+#define VLAN_BITMAP_BIT(vid)        (1ULL << ((vid) % 64))
+#define VLAN_BITMAP_TEST(bm, vid)   (((bm)->word[VLAN_BITMAP_WORD(vid)] & VLAN_BITMAP_BIT(vid)) != 0)
+#define VLAN_BITMAP_SET(bm, vid)    ((bm)->word[VLAN_BITMAP_WORD(vid)] |= VLAN_BITMAP_BIT(vid))
+#define VLAN_BITMAP_CLR(bm, vid)    ((bm)->word[VLAN_BITMAP_WORD(vid)] &= ~VLAN_BITMAP_BIT(vid))
+#define VLAN_BITMAP_ZERO(bm)        memset((bm), 0, sizeof(struct VlanBitmap))
+
+/* Clearing the current vid inside the loop is safe */
+#define VLAN_BITMAP_FOREACH(vid, bm) \
+    for ((vid) = vlan_bitmap_next((bm), 0); (vid) < VLAN_ID_MAX; (vid) = vlan_bitmap_next((bm), (vid) + 1))
 
 struct PendingVlanMbrIf
 {
     char name[MAX_L_PORT_NAME];
-    struct vlan_rb_tree vlan_tree;
+    struct VlanBitmap vlan_bitmap;
     LIST_ENTRY(PendingVlanMbrIf) if_next;
 };
 
-#define VLAN_RB_REMOVE(name, head, elm) do {  \
-    RB_REMOVE(name, head, elm);              \
-    (elm)->vlan_entry.rbt_parent = NULL;   \
-    (elm)->vlan_entry.rbt_left = NULL;     \
-    (elm)->vlan_entry.rbt_right = NULL;    \
-} while (0)
-
 
 struct PeerInterface
 {
@@ -121,7 +126,26 @@ struct PeerInterface
     struct CSM* csm;
 
     LIST_ENTRY(PeerInterface) mlacp_next;
-    struct vlan_rb_tree vlan_tree;
+    LIST_ENTRY(PeerInterface) name_hash_next;
+    struct VlanBitmap vlan_bitmap;
+    struct VlanBitmap vlan_removed;     /* not in the last peer sync yet */
+    uint32_t vlan_gen;                  /* see LocalInterface vlan_gen */
+};
+
+/* Last consistency check of a port-channel and the local and peer
+ * attributes it was computed from, see iccp_consistency_check.c */
+struct IfConsistency
+{
+    uint8_t valid;
+    uint8_t reason;             /* enum Reason_ID */
+    time_t change_time;         /* when reason last changed */
+    struct PeerInterface* peer_if;
+    uint32_t vlan_gen;
+    uint32_t peer_vlan_gen;
+    uint32_t ipv4_addr;
+    uint32_t peer_ipv4_addr;
+    uint8_t l3_mode;
+    uint8_t peer_l3_mode;
 };
 
 struct LocalInterface
@@ -155,27 +179,47 @@ struct LocalInterface
     struct CSM* csm;
 
     uint8_t changed;
+    uint64_t changed_stamp;     /* first unsent state change, for the latency histogram */
     uint8_t port_config_sync;
     bool is_traffic_disable;   /* Disable traffic tx/rx  */
     bool is_l3_proto_enabled;  /* Enable L3 Protocol support */
     uint32_t vlan_count;
     uint32_t master_ifindex;   /* VRF ifindex*/
+    uint32_t sync_gen;         /* last link resync that saw the interface */
 
-    struct vlan_rb_tree vlan_tree;
+    struct VlanBitmap vlan_bitmap;
+    uint32_t vlan_gen;          /* new value on every vlan_bitmap change, unique across interfaces */
+    struct IfConsistency consistency;
 
     LIST_ENTRY(LocalInterface) system_next;
     LIST_ENTRY(LocalInterface) system_purge_next;
     LIST_ENTRY(LocalInterface) mlacp_next;
     LIST_ENTRY(LocalInterface) mlacp_purge_next;
+    LIST_ENTRY(LocalInterface) mlacp_dirty_next;   /* changed/port_config_sync pending */
+    LIST_ENTRY(LocalInterface) name_hash_next;
+    LIST_ENTRY(LocalInterface) ifindex_hash_next;
+    LIST_ENTRY(LocalInterface) po_id_hash_next;
 };
 
+/* Interface lookup hash, bucket count must be a power of 2 */
+#define LIF_HASH_SIZE       256
+#define PIF_HASH_SIZE       64
+#define IF_HASH_BUCKET(key, size)   ((key) & ((size) - 1))
+
+#define IF_IN_HASH(elm, field)  ((elm)->field.le_prev != NULL)
+#define LIF_IN_DIRTY_LIST(lif)  ((lif)->mlacp_dirty_next.le_prev != NULL)
+
 struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint8_t state);
 struct LocalInterface* local_if_find_by_name(const char* ifname);
 struct LocalInterface* local_if_find_by_ifindex(int ifindex);
 struct LocalInterface* local_if_find_by_po_id(int po_id);
+void local_if_set_ifindex(struct LocalInterface* local_if, int ifindex);
+uint32_t if_name_hash(const char* ifname);
 
 void local_if_destroy(char *ifname);
 void local_if_change_flag_clear(void);
+void local_if_set_dirty(struct LocalInterface* local_if);
+void local_if_clear_dirty(struct LocalInterface* local_if);
 void local_if_purge_clear(void);
 int local_if_is_l3_mode(struct LocalInterface* local_if);
 
@@ -184,14 +228,26 @@ void local_if_finalize(struct LocalInterface*);
 
 struct PeerInterface* peer_if_create(struct CSM* csm, int peer_if_number, int type);
 struct PeerInterface* peer_if_find_by_name(struct CSM* csm, char* name);
+void peer_if_set_name(struct PeerInterface* pif, const char* name, size_t len);
+void peer_if_hash_init(struct CSM* csm);
 
 void peer_if_destroy(struct PeerInterface* pif);
 int peer_if_add_vlan(struct PeerInterface* peer_if, uint16_t vlan_id);
+void peer_if_mark_all_vlan_removed(struct PeerInterface* peer_if);
 int peer_if_clean_unused_vlan(struct PeerInterface* peer_if);
 /* VLAN manipulation */
 int local_if_add_vlan(struct LocalInterface* local_if, uint16_t vid);
 void local_if_del_vlan(struct LocalInterface* local_if, uint16_t vid);
 void local_if_del_all_vlan(struct LocalInterface* lif);
+int local_if_is_vlan_member(struct LocalInterface* lif, uint16_t vid);
+struct LocalInterface* local_if_find_vlan_itf(uint16_t vid);
+
+/* VLAN bitmap */
+int vlan_bitmap_next(const struct VlanBitmap* bm, int vid);
+int vlan_bitmap_count(const struct VlanBitmap* bm);
+int vlan_bitmap_is_empty(const struct VlanBitmap* bm);
+int vlan_bitmap_is_subset(const struct VlanBitmap* a, const struct VlanBitmap* b);
+void vlan_bitmap_diff(struct VlanBitmap* res, const struct VlanBitmap* a, const struct VlanBitmap* b);
 
 /* ARP manipulation */
 int set_sys_arp_accept_flag(char* ifname, int flag);
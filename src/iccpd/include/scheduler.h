@@ -38,7 +38,8 @@ struct CSM;
 struct System;
 
 #define CONNECT_INTERVAL_SEC        1
-#define CONNECT_TIMEOUT_MSEC        100
+#define CONNECT_TIMEOUT_MSEC        1000
+#define CONNECT_BACKOFF_MAX_SEC     16
 #define HEARTBEAT_TIMEOUT_SEC       15
 #define TRANSIT_INTERVAL_SEC        1
 #define EPOLL_TIMEOUT_MSEC          100
@@ -47,9 +48,15 @@ int scheduler_prepare_session(struct CSM*);
 int scheduler_check_csm_config(struct CSM*);
 int scheduler_unregister_sock_read_event_callback(struct CSM*);
 void scheduler_session_disconnect_handler(struct CSM*);
+void scheduler_session_timer_handler(void* arg);
+void scheduler_conn_timer_handler(void* arg);
+void session_client_conn_handler(struct CSM *csm);
+void session_client_conn_complete(struct CSM *csm);
+void session_client_conn_abort(struct CSM *csm);
 void scheduler_init();
 void scheduler_finalize();
 void scheduler_loop();
+void scheduler_loop_once(struct System* sys, int max_wait_msec);
 void scheduler_start();
 void scheduler_server_sock_init();
 int scheduler_csm_read_callback(struct CSM* csm);
@@ -37,6 +37,7 @@
 #include <linux/netlink.h>
 
 #include "../include/port.h"
+#include "../include/iccp_timer.h"
 
 #define FRONT_PANEL_PORT_PREFIX "Ethernet"
 #define PORTCHANNEL_PREFIX      "PortChannel"
@@ -53,7 +54,10 @@ struct CSM;
     #define MAX_BUFSIZE 4096
 #endif
 
-extern char mac_print_str[ETHER_ADDR_STR_LEN];
+/* Buffers rotated by mac_addr_to_str() and friends, enough for the
+ * addresses printed in one log message
+ */
+#define ADDR_STR_RING_SIZE 4
 
 #define MAC_IN_MSG_LIST(head, elm, field)   \
     (((elm)->field.tqe_next != NULL) ||     \
@@ -74,8 +78,22 @@ extern char mac_print_str[ETHER_ADDR_STR_LEN];
     (elm)->mac_entry_rb.rbt_parent = NULL;   \
     (elm)->mac_entry_rb.rbt_left = NULL;     \
     (elm)->mac_entry_rb.rbt_right = NULL;    \
+    if ((elm)->origin_hash_next.le_prev != NULL) {  \
+        LIST_REMOVE(elm, origin_hash_next);         \
+        (elm)->origin_hash_next.le_prev = NULL;     \
+    }                                               \
+    if ((elm)->ifname_hash_next.le_prev != NULL) {  \
+        LIST_REMOVE(elm, ifname_hash_next);         \
+        (elm)->ifname_hash_next.le_prev = NULL;     \
+    }                                               \
 } while (/*CONSTCOND*/0)
 
+/* Walk a MAC index bucket while the current entry may be removed */
+#define MAC_LIST_FOREACH_SAFE(var, head, field, tvar)   \
+    for ((var) = LIST_FIRST(head);                      \
+         (var) && ((tvar) = LIST_NEXT(var, field), 1);  \
+         (var) = (tvar))
+
 /* Debug counters */
 /* Debug counters to track messages ICCPd sent to MclagSyncd */
 typedef uint8_t SYNCD_DBG_CNTR_STS_e;
@@ -115,6 +133,7 @@ enum SYNCD_RX_DBG_CNTR_MSG_e
     SYNCD_RX_DBG_CNTR_MSG_CFG_MCLAG_IFACE  = 2,
     SYNCD_RX_DBG_CNTR_MSG_CFG_MCLAG_UNIQUE_IP = 3,
     SYNCD_RX_DBG_CNTR_MSG_VLAN_MBR_UPDATES = 4,
+    SYNCD_RX_DBG_CNTR_MSG_CAPABILITY = 5,
     SYNCD_RX_DBG_CNTR_MSG_MAX
 };
 
@@ -202,6 +221,75 @@ do{\
     if (sys)\
         ++sys->dbg_counters.mac_entry_free_counter;
 
+#define SYSTEM_INCR_MSG_ENTRY_ALLOC_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.msg_entry_alloc_counter;
+
+#define SYSTEM_INCR_MSG_ENTRY_FREE_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.msg_entry_free_counter;
+
+#define SYSTEM_INCR_MSG_BUF_OVERFLOW_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.msg_buf_overflow_counter;
+
+#define SYSTEM_INCR_MEM_POOL_SLAB_ALLOC_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.mem_pool_slab_alloc_counter;
+
+#define SYSTEM_INCR_MEM_POOL_SLAB_FREE_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.mem_pool_slab_free_counter;
+
+#define SYSTEM_INCR_MEM_POOL_ALLOC_FAIL_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.mem_pool_alloc_fail_counter;
+
+#define SYSTEM_INCR_TIMER_WAKEUP_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.timer_wakeup_counter;
+
+#define SYSTEM_INCR_TIMER_EXPIRE_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.timer_expire_counter;
+
+#define SYSTEM_INCR_NETLINK_RING_REC_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.netlink_ring_rec_counter;
+
+#define SYSTEM_INCR_NETLINK_RING_FULL_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.netlink_ring_full_counter;
+
+#define SYSTEM_INCR_NETLINK_LINK_OVERRUN_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.netlink_link_overrun_counter;
+
+#define SYSTEM_INCR_NETLINK_NEIGH_OVERRUN_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.netlink_neigh_overrun_counter;
+
+#define SYSTEM_INCR_NETLINK_LINK_RESYNC_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.netlink_link_resync_counter;
+
+#define SYSTEM_INCR_NETLINK_NEIGH_RESYNC_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.netlink_neigh_resync_counter;
+
+#define SYSTEM_INCR_NETLINK_RESYNC_STALE_COUNTER(sys)\
+    if (sys)\
+        ++sys->dbg_counters.netlink_resync_stale_counter;
+
+#define SYSTEM_ADD_SYNCD_FDB_ENTRY_COUNTER(sys, num, ok)\
+    if (sys)\
+    {\
+        if (ok)\
+            sys->dbg_counters.syncd_fdb_entry_ok_counter += num;\
+        else\
+            sys->dbg_counters.syncd_fdb_entry_err_counter += num;\
+    }
+
 #define SYSTEM_INCR_RX_READ_SOCK_ZERO_COUNTER(sys)\
     if (sys)\
         ++sys->dbg_counters.rx_read_sock_zero_len_counter;
@@ -287,11 +375,63 @@ typedef struct system_dbg_counter_info
 
     uint32_t mac_entry_alloc_counter;
     uint32_t mac_entry_free_counter;
+    uint32_t msg_entry_alloc_counter;
+    uint32_t msg_entry_free_counter;
+    uint32_t msg_buf_overflow_counter; //msg payload too big for inline buffer
+    uint32_t mem_pool_slab_alloc_counter;
+    uint32_t mem_pool_slab_free_counter;
+    uint32_t mem_pool_alloc_fail_counter;
+    uint32_t msg_pool_in_use; //pooled Msg objects held, filled on dump
+    uint32_t msg_pool_in_use_max;
+    uint32_t mac_msg_pool_in_use; //pooled MACMsg objects held, filled on dump
+    uint32_t mac_msg_pool_in_use_max;
+    uint32_t syncd_fdb_batch_msg_counter; //batched SET_FDB msgs sent to syncd
+    uint32_t syncd_fdb_entry_ok_counter; //FDB entries sent to syncd
+    uint32_t syncd_fdb_entry_err_counter; //FDB entries failed to send to syncd
+    uint32_t syncd_fdb_coalesce_counter; //FDB ops replaced by a later op on the same MAC in a batch
+    uint32_t timer_wakeup_counter; //timerfd wakeups
+    uint32_t timer_expire_counter; //timers run from the timer wheel
+    uint32_t netlink_ring_rec_counter; //records handed over by the netlink worker
+    uint32_t netlink_ring_full_counter; //netlink worker waited for ring space
+    uint32_t netlink_link_overrun_counter; //ENOBUFS on the link event socket
+    uint32_t netlink_neigh_overrun_counter; //ENOBUFS on the neighbor event socket
+    uint32_t netlink_link_resync_counter; //link dumps after an overrun
+    uint32_t netlink_neigh_resync_counter; //neighbor dumps after an overrun
+    uint32_t netlink_resync_stale_counter; //entries a resync found deleted
 
     uint64_t syncd_tx_counters[SYNCD_TX_DBG_CNTR_MSG_MAX][SYNCD_DBG_CNTR_STS_MAX];
     uint64_t syncd_rx_counters[SYNCD_RX_DBG_CNTR_MSG_MAX][SYNCD_DBG_CNTR_STS_MAX];
 }system_dbg_counter_info_t;
 
+/* Latency histograms, bucket 0 counts samples below 1us and bucket n
+ * samples in [2^(n-1), 2^n) us. The last bucket takes everything above.
+ */
+#define LATENCY_HIST_BUCKET_NUM 32
+
+typedef enum system_latency_type
+{
+    LATENCY_MAC_TO_PEER = 0,    /* local FDB event to peer send */
+    LATENCY_MAC_TO_SYNCD,       /* peer MAC info receive to mclagsyncd send */
+    LATENCY_ARP_TO_PEER,        /* kernel ARP event to peer send */
+    LATENCY_ND_TO_PEER,         /* kernel ND event to peer send */
+    LATENCY_PO_STATE_TO_PEER,   /* port-channel state change to peer send */
+    LATENCY_HEARTBEAT_INTERVAL, /* between two heartbeats from the peer */
+    LATENCY_TYPE_MAX,
+}SYSTEM_LATENCY_TYPE_e;
+
+typedef struct system_latency_hist
+{
+    uint64_t count;
+    uint64_t sum_usec;
+    uint64_t max_usec;
+    uint64_t buckets[LATENCY_HIST_BUCKET_NUM];
+}system_latency_hist_t;
+
+typedef struct system_latency_info
+{
+    system_latency_hist_t hist[LATENCY_TYPE_MAX];
+}system_latency_info_t;
+
 struct System
 {
     int server_fd;/* Peer-Link Socket*/
@@ -300,6 +440,7 @@ struct System
     int arp_receive_fd;
     int ndisc_receive_fd;
     int epoll_fd;
+    int timer_fd;
 
     struct nl_sock * genric_sock;
     int genric_sock_seq;
@@ -307,7 +448,8 @@ struct System
     struct nl_sock * route_sock;
     int route_sock_seq;
     struct nl_sock * genric_event_sock;
-    struct nl_sock * route_event_sock;
+    struct nl_sock * route_event_sock;   /* link and address events */
+    struct nl_sock * neigh_event_sock;   /* neighbor events */
 
     int sig_pipe_r;
     int sig_pipe_w;
@@ -321,27 +463,49 @@ struct System
     LIST_HEAD(unq_ip_all_if_list, Unq_ip_If_info) unq_ip_if_list;
     LIST_HEAD(pending_vlan_mbr_if_list, PendingVlanMbrIf) pending_vlan_mbr_if_list;
 
+    /* Hash index over lif_list, by name, ifindex and portchannel id */
+    LIST_HEAD(lif_name_hash_list, LocalInterface) lif_name_hash[LIF_HASH_SIZE];
+    LIST_HEAD(lif_ifindex_hash_list, LocalInterface) lif_ifindex_hash[LIF_HASH_SIZE];
+    LIST_HEAD(lif_po_id_hash_list, LocalInterface) lif_po_id_hash[LIF_HASH_SIZE];
+    /* VLAN interface (VlanN) by vid, shared by all members of the VLAN */
+    struct LocalInterface* vlan_itf[VLAN_ID_MAX];
+
     /* Settings */
     char* log_file_path;
     char* cmd_file_path;
     char* config_file_path;
     char* mclagdctl_file_path;
+    char* warm_snapshot_path;
     int pid_file_fd;
     int telnet_port;
+    int netlink_rcvbuf_size; /* event socket receive buffer */
     fd_set readfd; /*record socket need to listen*/
     int readfd_count;
+    struct CSM* fd_csm[FD_SETSIZE]; /*CSM owning each peer socket or connecting fd*/
     time_t csm_trans_time;
     int need_sync_team_again;
     int need_sync_netlink_again;
+    int need_sync_neigh_again;
+    uint32_t lif_sync_gen;
+    uint32_t neigh_sync_gen;
+    uint32_t syncd_capability; /* MCLAG_SYNCD_CAP_* from mclagsyncd */
+    struct iccp_timer housekeeping_timer;
 
     /* ICCDd/MclagSyncd debug counters */
     system_dbg_counter_info_t dbg_counters;
+    system_latency_info_t latency;
+    /* Receive time of the peer message being applied, FDB updates sent
+     * to mclagsyncd meanwhile are accounted to it*/
+    uint64_t peer_rx_usec;
 };
 
 struct CSM* system_create_csm();
 struct CSM* system_get_csm_by_peer_ip(const char*);
 struct CSM* system_get_csm_by_peer_ifname(char *ifname);
 struct CSM* system_get_csm_by_mlacp_id(int id);
+struct CSM* system_get_csm_by_fd(int fd);
+void system_set_csm_fd(struct CSM* csm, int fd);
+void system_clear_csm_fd(int fd);
 struct CSM* system_get_first_csm();
 struct System* system_get_instance();
 void system_finalize();
@@ -349,7 +513,9 @@ void system_init(struct System*);
 SYNCD_TX_DBG_CNTR_MSG_e system_syncdtx_to_dbg_msg_type(uint32_t msg_type);
 SYNCD_RX_DBG_CNTR_MSG_e system_syncdrx_to_dbg_msg_type(uint32_t msg_type);
 
+char *mac_addr_to_str_r(uint8_t mac_addr[ETHER_ADDR_LEN], char buf[ETHER_ADDR_STR_LEN]);
 char *mac_addr_to_str(uint8_t mac_addr[ETHER_ADDR_LEN]);
-void system_update_netlink_counters(uint16_t netlink_msg_type, struct nlmsghdr *nlh);
+void system_latency_add(SYSTEM_LATENCY_TYPE_e type, uint64_t usec);
+void system_latency_record(SYSTEM_LATENCY_TYPE_e type, uint64_t* stamp);
 
 #endif /* SYSTEM_H_ */
@@ -40,8 +40,7 @@
         while (!TAILQ_EMPTY(&(list))) { \
             msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), msg, tail); \
-            free(msg->buf); \
-            free(msg); \
+            iccp_csm_free_msg(msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
@@ -109,13 +108,20 @@ void app_csm_enqueue_msg(struct CSM* csm, struct Msg* msg)
     if (csm == NULL )
     {
         if (msg != NULL )
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
     if (msg == NULL )
         return;
 
     icc_hdr = (ICCHdr*)msg->buf;
+    if (msg->len < sizeof(ICCHdr) + sizeof(ICCParameter))
+    {
+        ICCPD_LOG_WARN("ICCP_FSM", "Drop app msg without TLV from peer, len %d", msg->len);
+        SYSTEM_INCR_INVALID_PEER_MSG_COUNTER(system_get_instance());
+        iccp_csm_free_msg(msg);
+        return;
+    }
     param = (ICCParameter*)&msg->buf[sizeof(struct ICCHdr)];
     *(uint16_t *)param = ntohs(*(uint16_t *)param);
 
@@ -227,7 +233,10 @@ int mlacp_bind_local_if(struct CSM* csm, struct LocalInterface* lif)
     LIST_INSERT_HEAD(&(MLACP(csm).lif_list), lif, mlacp_next);
     lif->csm = csm;
     if (lif->type == IF_T_PORT_CHANNEL)
+    {
         lif->port_config_sync = 1;
+        local_if_set_dirty(lif);
+    }
 
     ICCPD_LOG_INFO(__FUNCTION__, "%s: MLACP bind on csm %p", lif->name, csm);
     if (lif->type == IF_T_PORT_CHANNEL)
@@ -256,6 +265,7 @@ int mlacp_bind_local_if(struct CSM* csm, struct LocalInterface* lif)
         lif_po->csm = csm;
         LIST_INSERT_HEAD(&(MLACP(csm).lif_list), lif_po, mlacp_next);
         lif_po->port_config_sync = 1;
+        local_if_set_dirty(lif_po);
         ICCPD_LOG_INFO(__FUNCTION__, "Add port_channel %d into local_if_list in CSM %p.", lif->po_id, csm);
     }
 
@@ -272,6 +282,7 @@ int mlacp_unbind_local_if(struct LocalInterface* lif)
 
     ICCPD_LOG_INFO(__FUNCTION__, "%s: MLACP un-bind from csm %p", lif->name, lif->csm);
     LIST_REMOVE(lif, mlacp_next);
+    local_if_clear_dirty(lif);
 
     if (MLACP(lif->csm).current_state  == MLACP_STATE_EXCHANGE && lif->type == IF_T_PORT_CHANNEL)
         LIST_INSERT_HEAD(&(MLACP(lif->csm).lif_purge_list), lif, mlacp_purge_next);
@@ -132,6 +132,8 @@ void cmd_option_parser_init(struct CmdOptionParser* parser)
     LIST_INIT(&parser->option_list);
     cmd_option_register(parser, "-l <LOG_FILE_PATH>", "Set log file path.\n(Default: /var/log/iccpd.log)");
     cmd_option_register(parser, "-p <TCP_PORT>", "Set the port used for telnet listening port.\n(Default: 2015)");
+    cmd_option_register(parser, "-b <NETLINK_RCVBUF>", "Set the receive buffer size of the netlink event sockets in bytes.\n(Default: 16777216)");
+    cmd_option_register(parser, "-w <SNAPSHOT_FILE>", "Set the warm reboot snapshot file path.\n(Default: /var/run/iccpd/iccpd.snapshot)");
     cmd_option_register(parser, "-c", "Dump log message to console. (Default: No)");
     cmd_option_register(parser, "-h", "Show the usage.");
 }
@@ -254,6 +256,14 @@ int cmd_option_parser_parse(struct CmdOptionParser* parser, int argc, char* argv
             if (num > 0 && num < 65535)
                 parser->telnet_port = num;
         }
+        else if (strncmp(opt_name, "-b", 2) == 0)
+        {
+            num = atoi(val);
+            if (num > 0)
+                parser->netlink_rcvbuf = num;
+        }
+        else if (strncmp(opt_name, "-w", 2) == 0)
+            parser->warm_snapshot_path = val;
         else if (strncmp(opt_name, "-c", 2) == 0)
             parser->console_log = 1;
         else
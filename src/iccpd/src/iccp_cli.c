@@ -303,8 +303,8 @@ int set_keepalive_time(int mid, int keepalive_time)
     if (csm->keepalive_time != keepalive_time)
     {
         csm->keepalive_time = keepalive_time;
-        //reset heartbeat send time to send keepalive immediately
-        csm->heartbeat_send_time = 0;
+        //stop heartbeat timer to send keepalive immediately
+        iccp_timer_stop(&csm->heartbeat_timer);
     }
     return 0;
 }
@@ -320,7 +320,12 @@ int set_session_timeout(int mid, int session_timeout_val)
 
     ICCPD_LOG_DEBUG(__FUNCTION__, "Set session timeout : %d", session_timeout_val);
 
-    csm->session_timeout = session_timeout_val;
+    if (csm->session_timeout != session_timeout_val)
+    {
+        csm->session_timeout = session_timeout_val;
+        //re-arm session timer with the new timeout on next transit
+        iccp_timer_stop(&csm->session_timer);
+    }
     return 0;
 }
 
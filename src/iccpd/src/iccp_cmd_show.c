@@ -33,6 +33,8 @@
 #include "mclagdctl/mclagdctl.h"
 #include "../include/iccp_cmd_show.h"
 #include "../include/mlacp_link_handler.h"
+#include "../include/iccp_consistency_check.h"
+#include "../include/iccp_mem_pool.h"
 
 extern int local_if_l3_proto_enabled(const char* ifname);
 
@@ -160,13 +162,23 @@ int iccp_arp_dump(char * *buf, int *num, int mclag_id)
     int arp_num = 0;
     int id_exist = 0;
     char * arp_buf = NULL;
-    int arp_buf_size = MCLAGDCTL_CMD_SIZE;
+    int arp_buf_size = MCLAGD_REPLY_INFO_HDR;
 
     if (!(sys = system_get_instance()))
     {
         return EXEC_TYPE_NO_EXIST_SYS;
     }
 
+    /* Size the reply from the entry count, it is filled in one go */
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (mclag_id > 0 && csm->mlag_id != mclag_id)
+            continue;
+
+        TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+            arp_buf_size += sizeof(struct mclagd_arp_msg);
+    }
+
     arp_buf = (char*)malloc(arp_buf_size);
     if (!arp_buf)
         return EXEC_TYPE_FAILED;
@@ -196,14 +208,6 @@ int iccp_arp_dump(char * *buf, int *num, int mclag_id)
                    &mclagd_arp, sizeof(struct mclagd_arp_msg));
 
             arp_num++;
-
-            if ((arp_num + 1) * sizeof(struct mclagd_arp_msg) > (arp_buf_size - MCLAGD_REPLY_INFO_HDR))
-            {
-                arp_buf_size += MCLAGDCTL_CMD_SIZE;
-                arp_buf = (char*)realloc(arp_buf, arp_buf_size);
-                if (!arp_buf)
-                    return EXEC_TYPE_FAILED;
-            }
         }
     }
 
@@ -226,13 +230,23 @@ int iccp_ndisc_dump(char * *buf, int *num, int mclag_id)
     int ndisc_num = 0;
     int id_exist = 0;
     char *ndisc_buf = NULL;
-    int ndisc_buf_size = MCLAGDCTL_CMD_SIZE;
+    int ndisc_buf_size = MCLAGD_REPLY_INFO_HDR;
 
     if (!(sys = system_get_instance()))
     {
         return EXEC_TYPE_NO_EXIST_SYS;
     }
 
+    /* Size the reply from the entry count, it is filled in one go */
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (mclag_id > 0 && csm->mlag_id != mclag_id)
+            continue;
+
+        TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+            ndisc_buf_size += sizeof(struct mclagd_ndisc_msg);
+    }
+
     ndisc_buf = (char *)malloc(ndisc_buf_size);
     if (!ndisc_buf)
         return EXEC_TYPE_FAILED;
@@ -261,14 +275,6 @@ int iccp_ndisc_dump(char * *buf, int *num, int mclag_id)
             memcpy(ndisc_buf + MCLAGD_REPLY_INFO_HDR + ndisc_num * sizeof(struct mclagd_ndisc_msg), &mclagd_ndisc, sizeof(struct mclagd_ndisc_msg));
 
             ndisc_num++;
-
-            if ((ndisc_num + 1) * sizeof(struct mclagd_ndisc_msg) > (ndisc_buf_size - MCLAGD_REPLY_INFO_HDR))
-            {
-                ndisc_buf_size += MCLAGDCTL_CMD_SIZE;
-                ndisc_buf = (char *)realloc(ndisc_buf, ndisc_buf_size);
-                if (!ndisc_buf)
-                    return EXEC_TYPE_FAILED;
-            }
         }
     }
 
@@ -281,63 +287,154 @@ int iccp_ndisc_dump(char * *buf, int *num, int mclag_id)
     return EXEC_TYPE_SUCCESS;
 }
 
-int iccp_mac_dump(char * *buf, int *num, int mclag_id)
+static int iccp_mac_dump_match(struct MACMsg *mac, struct mclagdctl_req_hdr *req)
+{
+    if (req->filter_vid > 0 && mac->vid != req->filter_vid)
+        return 0;
+
+    if (req->filter_ifname[0] != '\0'
+        && strcmp(mac->ifname, req->filter_ifname) != 0
+        && strcmp(mac->origin_ifname, req->filter_ifname) != 0)
+        return 0;
+
+    switch (req->filter_age)
+    {
+        case MCLAGD_DUMP_AGE_LOCAL:
+            return (mac->age_flag & MAC_AGE_LOCAL) ? 1 : 0;
+
+        case MCLAGD_DUMP_AGE_PEER:
+            return (mac->age_flag & MAC_AGE_PEER) ? 1 : 0;
+
+        case MCLAGD_DUMP_AGE_NONE:
+            return (mac->age_flag == 0) ? 1 : 0;
+
+        default:
+            break;
+    }
+
+    return 1;
+}
+
+/* The tree is ordered by vid then mac, a page resumes at the cursor key
+ * and a vlan filter starts at the first entry of that vlan
+ */
+static struct MACMsg* iccp_mac_dump_first(struct CSM *csm, struct mclagdctl_req_hdr *req, int resume)
+{
+    struct MACMsg key;
+
+    memset(&key, 0, sizeof(struct MACMsg));
+    if (resume)
+    {
+        key.vid = req->cursor.vid;
+        memcpy(key.mac_addr, req->cursor.mac_addr, ETHER_ADDR_LEN);
+    }
+    else if (req->filter_vid > 0)
+    {
+        key.vid = req->filter_vid;
+    }
+    else
+    {
+        return RB_MIN(mac_rb_tree, &MLACP(csm).mac_rb);
+    }
+
+    return RB_NFIND(mac_rb_tree, &MLACP(csm).mac_rb, &key);
+}
+
+/* One page of the MAC table. The cursor is the key of the first entry of
+ * the next page, not a position, so MACs learned or aged between two pages
+ * do not make the dump skip or repeat the others. The page is counted
+ * first, the reply buffer is then allocated once.
+ */
+int iccp_mac_dump(char * *buf, int *num, struct mclagdctl_req_hdr *req,
+                  int *more, struct mclagd_dump_cursor *next_cursor)
 {
     struct System *sys = NULL;
     struct CSM *csm = NULL;
-    struct Msg *msg = NULL;
     struct MACMsg *iccpd_mac = NULL;
-    struct mclagd_mac_msg mclagd_mac;
+    struct mclagd_mac_msg *mclagd_mac = NULL;
+    int mclag_id = req->mclag_id;
+    int page_size = req->page_size;
     int mac_num = 0;
     int id_exist = 0;
+    int resume;
+    int pass;
     char * mac_buf = NULL;
-    int mac_buf_size = MCLAGDCTL_CMD_SIZE;
 
     if (!(sys = system_get_instance()))
     {
         return EXEC_TYPE_NO_EXIST_SYS;
     }
 
-    mac_buf = (char*)malloc(mac_buf_size);
-    if (!mac_buf)
-        return EXEC_TYPE_FAILED;
+    if (page_size <= 0)
+        page_size = MCLAGD_DUMP_PAGE_SIZE;
+    else if (page_size > MCLAGD_DUMP_PAGE_MAX)
+        page_size = MCLAGD_DUMP_PAGE_MAX;
 
-    LIST_FOREACH(csm, &(sys->csm_list), next)
+    for (pass = 0; pass < 2; ++pass)
     {
-        if (mclag_id > 0)
+        mac_num = 0;
+        *more = 0;
+        memset(next_cursor, 0, sizeof(struct mclagd_dump_cursor));
+        resume = (req->cursor.mclag_id > 0);
+
+        LIST_FOREACH(csm, &(sys->csm_list), next)
         {
-            if (csm->mlag_id == mclag_id)
-                id_exist = 1;
-            else
+            if (mclag_id > 0)
+            {
+                if (csm->mlag_id == mclag_id)
+                    id_exist = 1;
+                else
+                    continue;
+            }
+
+            /* Skip the mclags the previous pages covered */
+            if (resume && csm->mlag_id != req->cursor.mclag_id)
                 continue;
-        }
 
-        RB_FOREACH (iccpd_mac, mac_rb_tree, &MLACP(csm).mac_rb)
-        {
-            memset(&mclagd_mac, 0, sizeof(struct mclagd_mac_msg));
+            for (iccpd_mac = iccp_mac_dump_first(csm, req, resume); iccpd_mac;
+                 iccpd_mac = RB_NEXT(mac_rb_tree, iccpd_mac))
+            {
+                if (req->filter_vid > 0 && iccpd_mac->vid > req->filter_vid)
+                    break;
 
-            mclagd_mac.op_type = iccpd_mac->op_type;
-            mclagd_mac.fdb_type = iccpd_mac->fdb_type;
-            memcpy(mclagd_mac.mac_addr, iccpd_mac->mac_addr, ETHER_ADDR_LEN);
-            mclagd_mac.vid = iccpd_mac->vid;
-            memcpy(mclagd_mac.ifname, iccpd_mac->ifname, strlen(iccpd_mac->ifname));
-            memcpy(mclagd_mac.origin_ifname, iccpd_mac->origin_ifname, strlen(iccpd_mac->origin_ifname));
-            mclagd_mac.age_flag = iccpd_mac->age_flag;
+                if (!iccp_mac_dump_match(iccpd_mac, req))
+                    continue;
 
-            memcpy(mac_buf + MCLAGD_REPLY_INFO_HDR + mac_num * sizeof(struct mclagd_mac_msg),
-                   &mclagd_mac, sizeof(struct mclagd_mac_msg));
+                if (mac_num == page_size)
+                {
+                    *more = 1;
+                    next_cursor->mclag_id = csm->mlag_id;
+                    next_cursor->vid = iccpd_mac->vid;
+                    memcpy(next_cursor->mac_addr, iccpd_mac->mac_addr, ETHER_ADDR_LEN);
+                    goto page_done;
+                }
 
-            mac_num++;
+                if (pass == 1)
+                {
+                    mclagd_mac = (struct mclagd_mac_msg *)(mac_buf + MCLAGD_REPLY_INFO_HDR) + mac_num;
+                    mclagd_mac->op_type = iccpd_mac->op_type;
+                    mclagd_mac->fdb_type = iccpd_mac->fdb_type;
+                    memcpy(mclagd_mac->mac_addr, iccpd_mac->mac_addr, ETHER_ADDR_LEN);
+                    mclagd_mac->vid = iccpd_mac->vid;
+                    memcpy(mclagd_mac->ifname, iccpd_mac->ifname, strlen(iccpd_mac->ifname));
+                    memcpy(mclagd_mac->origin_ifname, iccpd_mac->origin_ifname, strlen(iccpd_mac->origin_ifname));
+                    mclagd_mac->age_flag = iccpd_mac->age_flag;
+                }
 
-            if ((mac_num + 1) * sizeof(struct mclagd_mac_msg) > (mac_buf_size - MCLAGD_REPLY_INFO_HDR))
-            {
-                mac_buf_size += MCLAGDCTL_CMD_SIZE;
-                mac_buf = (char*)realloc(mac_buf, mac_buf_size);
-                if (!mac_buf)
-                    return EXEC_TYPE_FAILED;
+                mac_num++;
             }
+
+            resume = 0;
         }
+
+ page_done:
+        if (pass == 0)
+        {
+            mac_buf = (char*)calloc(1, MCLAGD_REPLY_INFO_HDR + mac_num * sizeof(struct mclagd_mac_msg));
+            if (!mac_buf)
+                return EXEC_TYPE_FAILED;
         }
+    }
 
     *buf = mac_buf;
     *num = mac_num;
@@ -355,7 +452,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
     struct LocalInterface *lif_po = NULL;
     struct LocalInterface *lif_peer = NULL;
     struct mclagd_local_if mclagd_lif;
-    struct VLAN_ID* vlan_id = NULL;
+    int vid;
     char * str_buf = NULL;
     int str_size = MCLAGDCTL_PARA3_LEN - 1;
     int len = 0;
@@ -434,6 +531,13 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
             mclagd_lif.isolate_to_peer_link = lif_po->isolate_to_peer_link;
             mclagd_lif.is_traffic_disable = lif_po->is_traffic_disable;
 
+            /* Cached, only re-evaluated if an input changed */
+            if (lif_po->type == IF_T_PORT_CHANNEL)
+                iccp_consistency_check_if(lif_po);
+            snprintf(mclagd_lif.consistency, sizeof(mclagd_lif.consistency), "%s",
+                iccp_consistency_reason_name(lif_po));
+            mclagd_lif.consistency_time = lif_po->consistency.valid ? lif_po->consistency.change_time : 0;
+
             str_buf = mclagd_lif.vlanlist;
 
             len = 0;
@@ -441,11 +545,11 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
             int range = 0;
             int to_be_printed = 0;
 
-            RB_FOREACH (vlan_id, vlan_rb_tree, &(lif_po->vlan_tree))
+            VLAN_BITMAP_FOREACH(vid, &lif_po->vlan_bitmap)
             {
                 if (str_size - len < 4)
                     break;
-                if (!prev_vlan_id || vlan_id->vid != prev_vlan_id + 1)
+                if (!prev_vlan_id || vid != prev_vlan_id + 1)
                 {
                     if (range)
                     {
@@ -455,7 +559,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
                         }
                         len += snprintf(str_buf + len, str_size - len, "- %d ", prev_vlan_id);
                     }
-                    len += snprintf(str_buf + len, str_size - len, "%d ", vlan_id->vid);
+                    len += snprintf(str_buf + len, str_size - len, "%d ", vid);
                     range = 0;
                     to_be_printed = 0;
                 }
@@ -464,7 +568,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
                     range = 1;
                     to_be_printed = 1;
                 }
-                prev_vlan_id = vlan_id->vid;
+                prev_vlan_id = vid;
             }
 
             if (to_be_printed && (str_size - len > (4 + ((range)?8:0))))
@@ -550,11 +654,11 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
             int range = 0;
             int to_be_printed = 0;
 
-            RB_FOREACH (vlan_id, vlan_rb_tree, &(lif_peer->vlan_tree))
+            VLAN_BITMAP_FOREACH(vid, &lif_peer->vlan_bitmap)
             {
                 if (str_size - len < 4)
                     break;
-                if (!prev_vlan_id || vlan_id->vid != prev_vlan_id + 1)
+                if (!prev_vlan_id || vid != prev_vlan_id + 1)
                 {
                     if (range)
                     {
@@ -564,7 +668,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
                         }
                         len += snprintf(str_buf + len, str_size - len, "- %d ", prev_vlan_id);
                     }
-                    len += snprintf(str_buf + len, str_size - len, "%d ", vlan_id->vid);
+                    len += snprintf(str_buf + len, str_size - len, "%d ", vid);
                     range = 0;
                     to_be_printed = 0;
                 }
@@ -573,7 +677,7 @@ int iccp_local_if_dump(char * *buf,  int *num, int mclag_id)
                     range = 1;
                     to_be_printed = 1;
                 }
-                prev_vlan_id = vlan_id->vid;
+                prev_vlan_id = vid;
             }
 
             if (to_be_printed && (str_size - len > (4 + ((range)?8:0))))
@@ -703,6 +807,7 @@ int iccp_cmd_dbg_counter_dump(char **buf, int *data_len, int mclag_id)
     struct CSM *csm = NULL;
     char *temp_ptr, *counter_buf = NULL;
     mclagd_dbg_counter_info_t *counter_ptr;
+    struct mem_pool *pool = NULL;
     int buf_size = 0;
     int id_exist = 0;
     int num_csm = 0;
@@ -732,6 +837,12 @@ int iccp_cmd_dbg_counter_dump(char **buf, int *data_len, int mclag_id)
     counter_ptr =
         (mclagd_dbg_counter_info_t *)(counter_buf + MCLAGD_REPLY_INFO_HDR);
     memcpy(&counter_ptr->system_dbg, &sys->dbg_counters, sizeof(sys->dbg_counters));
+    pool = mem_pool_get(MEM_POOL_MSG);
+    counter_ptr->system_dbg.msg_pool_in_use = pool->in_use;
+    counter_ptr->system_dbg.msg_pool_in_use_max = pool->in_use_max;
+    pool = mem_pool_get(MEM_POOL_MAC_MSG);
+    counter_ptr->system_dbg.mac_msg_pool_in_use = pool->in_use;
+    counter_ptr->system_dbg.mac_msg_pool_in_use_max = pool->in_use_max;
     counter_ptr->num_iccp_counter_blocks = num_csm;
     temp_ptr = counter_ptr->iccp_dbg_counters;
     is_first_csm = true;
@@ -765,6 +876,35 @@ int iccp_cmd_dbg_counter_dump(char **buf, int *data_len, int mclag_id)
     return EXEC_TYPE_SUCCESS;
 }
 
+/* Allocate a buffer to return the latency histograms, they are kept
+ * per system and not per mclag domain.
+ * The allocated buffer should include MCLAGD_REPLY_INFO_HDR byte header
+ */
+int iccp_cmd_latency_dump(char **buf, int *data_len)
+{
+    struct System *sys = NULL;
+    char *latency_buf = NULL;
+    int buf_size = 0;
+
+    if (!(sys = system_get_instance()))
+    {
+        ICCPD_LOG_INFO(__FUNCTION__, "cannot find sys!\n");
+        return EXEC_TYPE_NO_EXIST_SYS;
+    }
+
+    buf_size = MCLAGD_REPLY_INFO_HDR + sizeof(system_latency_info_t);
+    latency_buf = (char*)malloc(buf_size);
+    if (!latency_buf)
+        return EXEC_TYPE_FAILED;
+
+    memset(latency_buf, 0, buf_size);
+    memcpy(latency_buf + MCLAGD_REPLY_INFO_HDR, &sys->latency, sizeof(sys->latency));
+
+    *buf = latency_buf;
+    *data_len = buf_size - MCLAGD_REPLY_INFO_HDR;
+    return EXEC_TYPE_SUCCESS;
+}
+
 int iccp_unique_ip_if_dump(char **buf, int *num, int mclag_id)
 {
     struct System *sys = NULL;
@@ -27,8 +27,8 @@
 #include "../include/port.h"
 #include "../include/logger.h"
 
-/* Return 0 if the checking procedure is failed; otherwise, 1 (non-zero) will be returned. */
-typedef int (*ConsistencyCheckFunc)(char* ifname);
+/* Return 1 if the local and peer interface agree; otherwise, a negative value. */
+typedef int (*ConsistencyCheckFunc)(struct LocalInterface* local_if, struct PeerInterface* peer_if);
 
 const char *reasons[] = {
     /* REASON_NONE */
@@ -43,94 +43,39 @@ const char *reasons[] = {
     NULL
 };
 
+/* Short form for mclagdctl */
+static const char *reason_names[] = {
+    "OK",
+    "Mode mismatch",
+    "IP mismatch",
+    "VLAN mismatch",
+    NULL
+};
+
 /* Consistency Checking functions */
-static int iccp_check_interface_mode( char* ifname)
+static int iccp_check_interface_mode(struct LocalInterface* local_if, struct PeerInterface* peer_if)
 {
-    struct CSM* csm = NULL;
-    struct LocalInterface* local_if = NULL;
-    struct PeerInterface* peer_if = NULL;
-
-    local_if = local_if_find_by_name(ifname);
-    if (local_if == NULL)
-        return -2;
-
-    csm = local_if->csm;
-    if (csm == NULL)
-        return -3;
-
-    peer_if = peer_if_find_by_name(csm, ifname);
-    if (peer_if == NULL)
-        return -4;
-
     if (peer_if->l3_mode != local_if->l3_mode)
         return -5;
 
     return 1;
 }
 
-static int iccp_check_interface_layer3_addr(char* ifname)
+static int iccp_check_interface_layer3_addr(struct LocalInterface* local_if, struct PeerInterface* peer_if)
 {
-    struct CSM* csm = NULL;
-    struct LocalInterface* local_if = NULL;
-    struct PeerInterface* peer_if = NULL;
-
-    local_if = local_if_find_by_name(ifname);
-    if (local_if == NULL)
-        return -2;
-
-    csm = local_if->csm;
-    if (csm == NULL)
-        return -3;
-
-    peer_if = peer_if_find_by_name(csm, ifname);
-    if (peer_if == NULL)
-        return -4;
-
     if (peer_if->ipv4_addr != local_if->ipv4_addr)
         return -5;
 
     return 1;
 }
 
-static int iccp_check_interface_vlan(char* ifname)
+static int iccp_check_interface_vlan(struct LocalInterface* local_if, struct PeerInterface* peer_if)
 {
-    struct CSM* csm = NULL;
-    struct PeerInterface* peer_if = NULL;
-    struct VLAN_ID* local_vlan = NULL;
-    struct VLAN_ID* peer_vlan = NULL;
-    struct LocalInterface* local_if = NULL;
-
-    local_if = local_if_find_by_name(ifname);
-    if (local_if == NULL)
-        return -2;
-
-    csm = local_if->csm;
-    if (csm == NULL)
-        return -3;
-
-    peer_if = peer_if_find_by_name(csm, ifname);
-    if (peer_if == NULL)
-        return -4;
-
-    RB_FOREACH (local_vlan, vlan_rb_tree, &(local_if->vlan_tree))
-    {
-        peer_vlan = RB_FIND(vlan_rb_tree, &(peer_if->vlan_tree), local_vlan);
-
-        if (peer_vlan == NULL)
-        {
-            return -5;
-        }
-    }
-
-    RB_FOREACH (peer_vlan, vlan_rb_tree, &(peer_if->vlan_tree))
-    {
-        local_vlan = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), peer_vlan);
+    if (!vlan_bitmap_is_subset(&local_if->vlan_bitmap, &peer_if->vlan_bitmap))
+        return -5;
 
-        if (local_vlan == NULL)
-        {
-            return -6;
-        }
-    }
+    if (!vlan_bitmap_is_subset(&peer_if->vlan_bitmap, &local_if->vlan_bitmap))
+        return -6;
 
     return 1;
 }
@@ -144,23 +89,88 @@ static const ConsistencyCheckFunc check_func[] = {
 };
 #define ARRAY_SIZE(array_name) (sizeof(array_name) / sizeof(array_name[0]))
 
-enum Reason_ID iccp_consistency_check(char* ifname)
+/* The cached result holds while none of the attributes it was computed
+ * from changed, VLAN membership is tracked by its generation */
+static int iccp_consistency_cache_valid(struct LocalInterface* local_if, struct PeerInterface* peer_if)
+{
+    struct IfConsistency* cc = &local_if->consistency;
+
+    return cc->valid
+           && cc->peer_if == peer_if
+           && cc->vlan_gen == local_if->vlan_gen
+           && cc->peer_vlan_gen == peer_if->vlan_gen
+           && cc->ipv4_addr == local_if->ipv4_addr
+           && cc->peer_ipv4_addr == peer_if->ipv4_addr
+           && cc->l3_mode == local_if->l3_mode
+           && cc->peer_l3_mode == peer_if->l3_mode;
+}
+
+enum Reason_ID iccp_consistency_check_if(struct LocalInterface* local_if)
 {
+    struct IfConsistency* cc = NULL;
+    struct PeerInterface* peer_if = NULL;
     int i = 0;
-    int ret = 0;
+    int ret = 1;
+
+    if (local_if == NULL || local_if->csm == NULL)
+        return REASON_INTERRFACE_MODE_IS_ASYNC;
+
+    peer_if = peer_if_find_by_name(local_if->csm, local_if->name);
+    if (peer_if == NULL)
+        return REASON_INTERRFACE_MODE_IS_ASYNC;
+
+    cc = &local_if->consistency;
+    if (iccp_consistency_cache_valid(local_if, peer_if))
+        return cc->reason;
 
     for (i = REASON_INTERRFACE_MODE_IS_ASYNC; i < REASON_MAX_ARRAY_SIZE; ++i)
     {
         if (check_func[i] == NULL)
             continue;
-        ret = check_func[i](ifname);
+        ret = check_func[i](local_if, peer_if);
         if (ret != 1)
+            break;
+    }
+    if (ret == 1)
+        i = REASON_NONE;
+
+    /* Report transitions only, repeated peer updates are the common case */
+    if (!cc->valid || cc->reason != i)
+    {
+        if (i != REASON_NONE)
         {
-            ICCPD_LOG_WARN(__FUNCTION__, "%s ret = %d", reasons[i], ret);
+            ICCPD_LOG_WARN(__FUNCTION__, "%s: %s ret = %d", local_if->name, reasons[i], ret);
             fprintf(stdout, "%s \n", reasons[i]);
-            return i;
         }
+        else if (cc->valid)
+        {
+            ICCPD_LOG_NOTICE(__FUNCTION__, "%s: consistent with peer again", local_if->name);
+        }
+        cc->change_time = time(NULL);
     }
 
-    return REASON_NONE;
+    cc->valid = 1;
+    cc->reason = i;
+    cc->peer_if = peer_if;
+    cc->vlan_gen = local_if->vlan_gen;
+    cc->peer_vlan_gen = peer_if->vlan_gen;
+    cc->ipv4_addr = local_if->ipv4_addr;
+    cc->peer_ipv4_addr = peer_if->ipv4_addr;
+    cc->l3_mode = local_if->l3_mode;
+    cc->peer_l3_mode = peer_if->l3_mode;
+
+    return i;
+}
+
+enum Reason_ID iccp_consistency_check(char* ifname)
+{
+    return iccp_consistency_check_if(local_if_find_by_name(ifname));
+}
+
+const char *iccp_consistency_reason_name(struct LocalInterface* local_if)
+{
+    if (!local_if->consistency.valid)
+        return "Unchecked";
+
+    return reason_names[local_if->consistency.reason];
 }
@@ -23,6 +23,7 @@
 #include <pthread.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/epoll.h>
 
 #include "../include/logger.h"
 #include "../include/system.h"
@@ -31,6 +32,7 @@
 #include "../include/iccp_csm.h"
 #include "../include/iccp_cli.h"
 #include "../include/mlacp_link_handler.h"
+#include "../include/iccp_mem_pool.h"
 /*****************************************
 * Define
 *
@@ -41,8 +43,7 @@
         while (!TAILQ_EMPTY(&(list))) { \
             msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), msg, tail); \
-            free(msg->buf); \
-            free(msg); \
+            iccp_csm_free_msg(msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
@@ -124,6 +125,10 @@ void iccp_csm_init(struct CSM* csm)
     csm->iccp_info.icc_rg_id = 0x0;
     csm->keepalive_time      = CONNECT_INTERVAL_SEC;
     csm->session_timeout     = HEARTBEAT_TIMEOUT_SEC;
+    csm->conn_fd = -1;
+    iccp_timer_init(&csm->conn_timer, scheduler_conn_timer_handler, csm);
+    iccp_timer_init(&csm->heartbeat_timer, mlacp_heartbeat_timer_handler, csm);
+    iccp_timer_init(&csm->session_timer, scheduler_session_timer_handler, csm);
 }
 
 /* Connection State Machine instance status reset */
@@ -139,9 +144,10 @@ void iccp_csm_status_reset(struct CSM* csm, int all)
 
     csm->sock_fd = -1;
     pthread_mutex_init(&csm->conn_mutex, NULL);
-    csm->connTimePrev = 0;
-    csm->heartbeat_send_time = 0;
-    csm->heartbeat_update_time = 0;
+    iccp_timer_stop(&csm->heartbeat_timer);
+    iccp_timer_stop(&csm->session_timer);
+    csm->heartbeat_update_msec = 0;
+    csm->heartbeat_rx_usec = 0;
     csm->peer_warm_reboot_time = 0;
     csm->warm_reboot_disconn_time = 0;
     csm->peer_link_learning_retry_time = 0;
@@ -219,6 +225,9 @@ void iccp_csm_finalize(struct CSM* csm)
     }
 
     /* Release iccp_csm */
+    iccp_timer_stop(&csm->conn_timer);
+    iccp_timer_stop(&csm->heartbeat_timer);
+    iccp_timer_stop(&csm->session_timer);
     pthread_mutex_destroy(&(csm->conn_mutex));
     iccp_csm_msg_list_finalize(csm);
     LIST_REMOVE(csm, next);
@@ -237,16 +246,180 @@ void iccp_csm_msg_list_finalize(struct CSM* csm)
     {
         msg = TAILQ_FIRST(&(csm->msg_list));
         TAILQ_REMOVE(&(csm->msg_list), msg, tail);
-        free(msg);
+        iccp_csm_free_msg(msg);
     }
 }
 
-/* Send message to peer */
-int iccp_csm_send(struct CSM* csm, char* buf, int msg_len)
+/* Watch for EPOLLOUT only while there is something queued */
+static void iccp_csm_tx_queue_set_pollout(struct CSM* csm, int enable)
+{
+    struct System* sys = NULL;
+    struct epoll_event event;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    event.data.fd = csm->sock_fd;
+    event.events = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, csm->sock_fd, &event) != 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "CSM socket %d epoll mod error %d",
+            csm->sock_fd, errno);
+    }
+}
+
+static void iccp_csm_tx_queue_update(struct CSM* csm)
+{
+    struct CsmTxQueue* txq = &csm->tx_queue;
+
+    MLACP(csm).dbg_counters.tx_queue_depth = txq->len;
+    if (txq->len > MLACP(csm).dbg_counters.tx_queue_max_depth)
+        MLACP(csm).dbg_counters.tx_queue_max_depth = txq->len;
+
+    if (!txq->paused && txq->len >= CSM_TX_QUEUE_HIGH_WATERMARK)
+    {
+        txq->paused = 1;
+        ++MLACP(csm).dbg_counters.tx_queue_pause_count;
+        ICCPD_LOG_NOTICE(__FUNCTION__, "Peer %s output queue %zu bytes, pause MAC/ARP/ND sync",
+            csm->peer_ip, txq->len);
+    }
+    else if (txq->paused && txq->len <= CSM_TX_QUEUE_LOW_WATERMARK)
+    {
+        txq->paused = 0;
+        ICCPD_LOG_NOTICE(__FUNCTION__, "Peer %s output queue %zu bytes, resume MAC/ARP/ND sync",
+            csm->peer_ip, txq->len);
+    }
+}
+
+/* Append to the output queue. A message is queued whole or not at all.
+ * MAC/ARP/ND info stops short of the reserve left for control messages.
+ */
+static int iccp_csm_tx_queue_put(struct CSM* csm, char* buf, size_t len, uint16_t tlv_type)
+{
+    struct CsmTxQueue* txq = &csm->tx_queue;
+    size_t limit = CSM_TX_QUEUE_SIZE;
+    size_t tail;
+    size_t chunk;
+
+    if (txq->buf == NULL)
+    {
+        txq->buf = (char*)malloc(CSM_TX_QUEUE_SIZE);
+        if (txq->buf == NULL)
+        {
+            ICCPD_LOG_ERR(__FUNCTION__, "Failed to allocate output queue for peer %s", csm->peer_ip);
+            return MCLAG_ERROR;
+        }
+        txq->head = 0;
+        txq->len = 0;
+    }
+
+    if (ICCP_CSM_TLV_IS_SYNC_DATA(tlv_type))
+        limit -= CSM_TX_QUEUE_CTRL_RESERVE;
+
+    if (txq->len + len > limit)
+    {
+        ++MLACP(csm).dbg_counters.tx_queue_drop_count;
+        if (!MLACP(csm).sync_mark_void)
+            MLACP(csm).sync_mark_void = 1;
+        return MCLAG_ERROR;
+    }
+
+    tail = (txq->head + txq->len) % CSM_TX_QUEUE_SIZE;
+    chunk = CSM_TX_QUEUE_SIZE - tail;
+    if (chunk > len)
+        chunk = len;
+    memcpy(txq->buf + tail, buf, chunk);
+    memcpy(txq->buf, buf + chunk, len - chunk);
+
+    if (txq->len == 0)
+        iccp_csm_tx_queue_set_pollout(csm, 1);
+    txq->len += len;
+    iccp_csm_tx_queue_update(csm);
+
+    return 0;
+}
+
+/* Push queued bytes to the socket, returns the number of bytes still queued */
+int iccp_csm_tx_queue_flush(struct CSM* csm)
+{
+    struct CsmTxQueue* txq = NULL;
+    size_t chunk;
+    ssize_t rc;
+
+    if (csm == NULL || csm->sock_fd <= 0)
+        return 0;
+
+    txq = &csm->tx_queue;
+    if (txq->len == 0)
+        return 0;
+
+    while (txq->len > 0)
+    {
+        chunk = CSM_TX_QUEUE_SIZE - txq->head;
+        if (chunk > txq->len)
+            chunk = txq->len;
+
+        rc = send(csm->sock_fd, txq->buf + txq->head, chunk, MSG_DONTWAIT);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            /* Session is going down, the read path cleans it up */
+            ICCPD_LOG_ERR(__FUNCTION__, "Peer %s flush %zu bytes failed, Error:%s",
+                csm->peer_ip, txq->len, strerror(errno));
+            txq->len = 0;
+            break;
+        }
+
+        txq->head = (txq->head + rc) % CSM_TX_QUEUE_SIZE;
+        txq->len -= rc;
+    }
+
+    if (txq->len == 0)
+    {
+        txq->head = 0;
+        iccp_csm_tx_queue_set_pollout(csm, 0);
+    }
+    iccp_csm_tx_queue_update(csm);
+
+    return txq->len;
+}
+
+/* Drop the output queue, the socket is closed */
+void iccp_csm_tx_queue_free(struct CSM* csm)
+{
+    if (csm == NULL)
+        return;
+
+    if (csm->tx_queue.buf)
+        free(csm->tx_queue.buf);
+    memset(&csm->tx_queue, 0, sizeof(struct CsmTxQueue));
+    MLACP(csm).dbg_counters.tx_queue_depth = 0;
+}
+
+/* Drop partially received data, the socket is closed */
+void iccp_csm_rx_buf_free(struct CSM* csm)
+{
+    if (csm == NULL)
+        return;
+
+    if (csm->rx_buf.buf)
+        free(csm->rx_buf.buf);
+    memset(&csm->rx_buf, 0, sizeof(struct CsmRxBuf));
+}
+
+/* Send message to peer, flags are passed to send(). The socket is never
+ * waited on, whatever it does not take goes to the output queue and is
+ * flushed on EPOLLOUT.
+ */
+static int iccp_csm_send_msg(struct CSM* csm, char* buf, int msg_len, int flags)
 {
     LDPHdr* ldp_hdr = (LDPHdr*)buf;
     ICCParameter* param = NULL;
-    ssize_t rc;
+    ssize_t rc = 0;
     uint16_t tlv_type;
 
     if (csm == NULL || buf == NULL || csm->sock_fd <= 0 || msg_len <= 0)
@@ -266,8 +439,39 @@ int iccp_csm_send(struct CSM* csm, char* buf, int msg_len)
         csm->msg_log.end_index = 0;
 
     tlv_type = ntohs(param->type);
-    rc = write(csm->sock_fd, buf, msg_len);
-    if ((rc <= 0) || (rc != msg_len))
+
+    /* Keep the stream in order, only write directly when nothing is queued */
+    if (iccp_csm_tx_queue_flush(csm) == 0)
+    {
+        rc = send(csm->sock_fd, buf, msg_len, flags | MSG_DONTWAIT);
+        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            rc = 0;
+    }
+
+    if (rc >= 0 && rc < msg_len)
+    {
+        if (iccp_csm_tx_queue_put(csm, buf + rc, msg_len - rc, tlv_type) == 0)
+        {
+            rc = msg_len;
+        }
+        else if (rc > 0 || !ICCP_CSM_TLV_IS_SYNC_DATA(tlv_type))
+        {
+            /* Part of the message is on the wire, or a control message
+             * is lost. Neither can be recovered, shut the stream down so
+             * the read path resets the session.
+             */
+            ICCPD_LOG_ERR(__FUNCTION__, "Peer %s output queue full on %s, reset session",
+                csm->peer_ip, get_tlv_type_string(tlv_type));
+            shutdown(csm->sock_fd, SHUT_RDWR);
+            rc = MCLAG_ERROR;
+        }
+        else
+        {
+            rc = MCLAG_ERROR;
+        }
+    }
+
+    if (rc != msg_len)
     {
         MLACP_SET_ICCP_TX_DBG_COUNTER(
             csm, tlv_type, ICCP_DBG_CNTR_STS_ERR);
@@ -281,6 +485,19 @@ int iccp_csm_send(struct CSM* csm, char* buf, int msg_len)
     return (rc);
 }
 
+int iccp_csm_send(struct CSM* csm, char* buf, int msg_len)
+{
+    return iccp_csm_send_msg(csm, buf, msg_len, 0);
+}
+
+/* Send message to peer, more messages follow right away. The last
+ * message of the batch must go through iccp_csm_send() to push it out.
+ */
+int iccp_csm_send_more(struct CSM* csm, char* buf, int msg_len)
+{
+    return iccp_csm_send_msg(csm, buf, msg_len, MSG_MORE);
+}
+
 /* Connection State Machine Transition */
 void iccp_csm_transit(struct CSM* csm)
 {
@@ -660,8 +877,7 @@ void iccp_csm_correspond_from_msg(struct CSM* csm, struct Msg* msg)
         ++csm->u_msg_in_count;
     }
 
-    free(msg->buf);
-    free(msg);
+    iccp_csm_free_msg(msg);
 }
 
 /* Receive capability message correspond function */
@@ -669,6 +885,9 @@ void iccp_csm_correspond_from_capability_msg(struct CSM* csm, struct Msg* msg)
 {
     LDPICCPCapabilityTLV* cap = (LDPICCPCapabilityTLV*)&(msg->buf)[sizeof(LDPHdr)];
 
+    if (msg->len < sizeof(LDPHdr) + sizeof(LDPICCPCapabilityTLV))
+        return;
+
     *(uint16_t *)cap = ntohs(*(uint16_t *)cap);
     *(uint16_t *)((uint8_t *)cap + sizeof(ICCParameter)) = ntohs(*(uint16_t *)((uint8_t *)cap + sizeof(ICCParameter)));
 
@@ -689,6 +908,8 @@ void iccp_csm_correspond_from_rg_connect_msg(struct CSM* csm, struct Msg* msg)
 {
     ICCSenderNameTLV* sender = (ICCSenderNameTLV*)&(msg->buf)[sizeof(ICCHdr)];
 
+    if (msg->len < sizeof(ICCHdr) + sizeof(ICCParameter))
+        return;
     *(uint16_t *)sender = ntohs(*(uint16_t *)sender);
 
     if (sender->icc_parameter.u_bit == 0x0 &&
@@ -704,6 +925,8 @@ void iccp_csm_correspond_from_rg_disconnect_msg(struct CSM* csm, struct Msg* msg
 {
     DisconnectCodeTLV* diconn_code = (DisconnectCodeTLV*)&(msg->buf)[sizeof(ICCHdr)];
 
+    if (msg->len < sizeof(ICCHdr) + sizeof(DisconnectCodeTLV))
+        return;
     *(uint16_t *)diconn_code = ntohs(*(uint16_t *)diconn_code);
 
     if (diconn_code->icc_parameter.u_bit == 0x0
@@ -728,7 +951,7 @@ void iccp_csm_enqueue_msg(struct CSM* csm, struct Msg* msg)
     if (csm == NULL)
     {
         if (msg != NULL)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
 
@@ -739,6 +962,18 @@ void iccp_csm_enqueue_msg(struct CSM* csm, struct Msg* msg)
 
     *(uint16_t *)icc_hdr = ntohs(*(uint16_t *)icc_hdr);
 
+    /* Only the capability message has no ICC header, the scheduler
+     * already checked the LDP header */
+    if ((icc_hdr->ldp_hdr.msg_type != MSG_T_CAPABILITY && msg->len < sizeof(ICCHdr))
+        || (icc_hdr->ldp_hdr.msg_type == MSG_T_NOTIFICATION && msg->len < sizeof(ICCHdr) + sizeof(NAKTLV)))
+    {
+        ICCPD_LOG_WARN("ICCP_FSM", "Drop short msg from peer, msg_type 0x%x len %d",
+            icc_hdr->ldp_hdr.msg_type, msg->len);
+        SYSTEM_INCR_INVALID_PEER_MSG_COUNTER(system_get_instance());
+        iccp_csm_free_msg(msg);
+        return;
+    }
+
     if (icc_hdr->ldp_hdr.msg_type == MSG_T_RG_APP_DATA)
     {
         app_csm_enqueue_msg(csm, msg);
@@ -786,6 +1021,7 @@ struct Msg* iccp_csm_dequeue_msg(struct CSM* csm)
 int iccp_csm_init_msg(struct Msg** msg, char* data, int len)
 {
     struct Msg* iccp_msg = NULL;
+    struct System* sys = NULL;
 
     if (msg == NULL)
         return -2;
@@ -793,29 +1029,52 @@ int iccp_csm_init_msg(struct Msg** msg, char* data, int len)
     if (data == NULL || len <= 0)
         return MCLAG_ERROR;
 
-    iccp_msg = (struct Msg*)malloc(sizeof(struct Msg));
+    sys = system_get_instance();
+
+    /* Msg and its payload come from one pool object, the payload is
+     * stored right behind the Msg header unless it is too big*/
+    iccp_msg = (struct Msg*)mem_pool_alloc(mem_pool_get(MEM_POOL_MSG));
     if (iccp_msg == NULL)
-        goto err_ret;
+        return MCLAG_ERROR;
 
-    iccp_msg->buf = (char*)malloc(len);
-    if (iccp_msg->buf == NULL)
-        goto err_ret;
+    /* Pool objects are recycled, clear the header but not the inline payload */
+    memset(iccp_msg, 0, sizeof(struct Msg));
+
+    if (len <= MSG_INLINE_BUF_SIZE)
+    {
+        iccp_msg->buf = MSG_INLINE_BUF(iccp_msg);
+    }
+    else
+    {
+        iccp_msg->buf = (char*)malloc(len);
+        if (iccp_msg->buf == NULL)
+        {
+            mem_pool_free(mem_pool_get(MEM_POOL_MSG), iccp_msg);
+            return MCLAG_ERROR;
+        }
+        SYSTEM_INCR_MSG_BUF_OVERFLOW_COUNTER(sys);
+    }
 
     memcpy(iccp_msg->buf, data, len);
     iccp_msg->len = len;
     *msg = iccp_msg;
+    SYSTEM_INCR_MSG_ENTRY_ALLOC_COUNTER(sys);
 
     return 0;
+}
 
- err_ret:
-    if (iccp_msg)
-    {
-        if (iccp_msg->buf)
-            free(iccp_msg->buf);
-        free(iccp_msg);
-    }
+void iccp_csm_free_msg(struct Msg* msg)
+{
+    if (msg == NULL)
+        return;
+
+    if (msg->buf && msg->buf != MSG_INLINE_BUF(msg))
+        free(msg->buf);
+
+    mem_pool_free(mem_pool_get(MEM_POOL_MSG), msg);
+    SYSTEM_INCR_MSG_ENTRY_FREE_COUNTER(system_get_instance());
 
-    return MCLAG_ERROR;
+    return;
 }
 
 /* MAC Message initialization */
@@ -826,10 +1085,10 @@ int iccp_csm_init_mac_msg(struct MACMsg **mac_msg, char* data, int len)
     if (mac_msg == NULL)
         return -2;
 
-    if (data == NULL || len <= 0)
+    if (data == NULL || len <= 0 || len > sizeof(struct MACMsg))
         return MCLAG_ERROR;
 
-    iccp_mac_msg = (struct MACMsg*)malloc(sizeof(struct MACMsg));
+    iccp_mac_msg = (struct MACMsg*)mem_pool_alloc(mem_pool_get(MEM_POOL_MAC_MSG));
     if (iccp_mac_msg == NULL)
        return -3;
 
@@ -837,10 +1096,22 @@ int iccp_csm_init_mac_msg(struct MACMsg **mac_msg, char* data, int len)
     memcpy(iccp_mac_msg, data, len);
 
     *mac_msg = iccp_mac_msg;
+    SYSTEM_INCR_MAC_ENTRY_ALLOC_COUNTER(system_get_instance());
 
     return 0;
 }
 
+void iccp_csm_free_mac_msg(struct MACMsg* mac_msg)
+{
+    if (mac_msg == NULL)
+        return;
+
+    mem_pool_free(mem_pool_get(MEM_POOL_MAC_MSG), mac_msg);
+    SYSTEM_INCR_MAC_ENTRY_FREE_COUNTER(system_get_instance());
+
+    return;
+}
+
 
 void iccp_csm_stp_role_count(struct CSM *csm)
 {
@@ -37,6 +37,8 @@
 #include "../include/mlacp_link_handler.h"
 #include "../include/port.h"
 #include "../include/iccp_netlink.h"
+#include "../include/iccp_ifm.h"
+#include "mclagdctl/mclagdctl.h"
 
 #define fwd_neigh_state_valid(state) (state & (NUD_REACHABLE | NUD_STALE | NUD_DELAY | NUD_PROBE | NUD_PERMANENT))
 
@@ -47,7 +49,10 @@
 
 static int iccp_valid_handler(struct nl_msg *msg, void *arg)
 {
+    struct System *sys = (struct System *)arg;
     struct nlmsghdr *nlh = nlmsg_hdr(msg);
+    struct ifinfomsg *ifi = NULL;
+    struct LocalInterface *lif = NULL;
     unsigned int event = 0;
 
     if (nlh->nlmsg_type != RTM_NEWLINK)
@@ -56,6 +61,11 @@ static int iccp_valid_handler(struct nl_msg *msg, void *arg)
     if (nl_msg_parse(msg, &iccp_event_handler_obj_input_newlink, &event) < 0)
         ICCPD_LOG_ERR(__FUNCTION__, "Unknown message type.");
 
+    /* Still in the kernel, see iccp_sys_local_if_list_resync */
+    ifi = (struct ifinfomsg *)NLMSG_DATA(nlh);
+    if ((lif = local_if_find_by_ifindex(ifi->ifi_index)) != NULL)
+        lif->sync_gen = sys->lif_sync_gen;
+
     return 0;
 }
 
@@ -113,20 +123,70 @@ int iccp_sys_local_if_list_get_init()
     return ret;
 }
 
-static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int msgtype, int is_del)
+/* Re-read the kernel interfaces after the link event socket overran.
+ * Unchanged interfaces are left alone by the newlink handler, the ones
+ * the dump no longer reports lost their RTM_DELLINK and are destroyed.
+ */
+int iccp_sys_local_if_list_resync()
+{
+    struct System *sys = NULL;
+    struct LocalInterface *lif = NULL;
+    int ret;
+
+    if (!(sys = system_get_instance()))
+        return MCLAG_ERROR;
+
+    SYSTEM_INCR_NETLINK_LINK_RESYNC_COUNTER(sys);
+    ++sys->lif_sync_gen;
+
+    ret = iccp_sys_local_if_list_get_init();
+    if (ret < 0)
+    {
+        /* Partial dump, nothing can be purged from it */
+        sys->need_sync_netlink_again = 1;
+        return ret;
+    }
+
+    /* Vxlan tunnels share one interface for many kernel devs, and vlans
+     * from the config have no ifindex before the kernel creates them
+     */
+    lif = LIST_FIRST(&(sys->lif_list));
+    while (lif)
+    {
+        if (lif->ifindex <= 0 || lif->type == IF_T_VXLAN
+            || lif->sync_gen == sys->lif_sync_gen)
+        {
+            lif = LIST_NEXT(lif, system_next);
+            continue;
+        }
+
+        ICCPD_LOG_NOTICE(__FUNCTION__, "Interface %s ifindex %d is gone from the kernel",
+                         lif->name, lif->ifindex);
+        SYSTEM_INCR_NETLINK_RESYNC_STALE_COUNTER(sys);
+        local_if_destroy(lif->name);
+
+        /* Destroy may unlink more than this interface, start over */
+        lif = LIST_FIRST(&(sys->lif_list));
+    }
+
+    return 0;
+}
+
+static void do_arp_learn_from_kernel(struct iccp_neigh_rec *rec)
 {
+    int msgtype = rec->msgtype;
     struct System *sys = NULL;
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct ARPMsg *arp_msg = NULL, *arp_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vlan_member = 0;
     struct Msg *msg_send = NULL;
     uint16_t vid = 0;
     int entry_exists = 0;
     struct LocalInterface *peer_link_if = NULL;
     int ln = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     char buf[MAX_BUFSIZE] = { 0 };
     size_t msg_len = 0;
@@ -140,7 +200,7 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
         return;
 
     /* Find local itf*/
-    if (!(arp_lif = local_if_find_by_ifindex(ndm->ndm_ifindex)))
+    if (!(arp_lif = local_if_find_by_ifindex(rec->ifindex)))
         return;
 
     /* create ARP msg*/
@@ -148,16 +208,15 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     arp_msg = (struct ARPMsg *)&buf;
     arp_msg->op_type = NEIGH_SYNC_LIF;
     sprintf(arp_msg->ifname, "%s", arp_lif->name);
-    if (tb[NDA_DST])
-        memcpy(&arp_msg->ipv4_addr, RTA_DATA(tb[NDA_DST]), RTA_PAYLOAD(tb[NDA_DST]));
-    if (!is_del && tb[NDA_LLADDR])
-        memcpy(arp_msg->mac_addr, RTA_DATA(tb[NDA_LLADDR]), RTA_PAYLOAD(tb[NDA_LLADDR]));
+    memcpy(&arp_msg->ipv4_addr, rec->dst, sizeof(arp_msg->ipv4_addr));
+    if (!rec->is_del && rec->has_lladdr)
+        memcpy(arp_msg->mac_addr, rec->lladdr, ETHER_ADDR_LEN);
 
     arp_msg->ipv4_addr = arp_msg->ipv4_addr;
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "ARP type %s, state (%04X)(%d) ifindex [%d] (%s) ip %s, mac [%02X:%02X:%02X:%02X:%02X:%02X]",
-                    msgtype == RTM_NEWNEIGH ? "New":"Del", ndm->ndm_state, fwd_neigh_state_valid(ndm->ndm_state),
-                    ndm->ndm_ifindex, arp_lif->name,
+                    msgtype == RTM_NEWNEIGH ? "New":"Del", rec->state, fwd_neigh_state_valid(rec->state),
+                    rec->ifindex, arp_lif->name,
                     show_ip_str(arp_msg->ipv4_addr),
                     arp_msg->mac_addr[0], arp_msg->mac_addr[1], arp_msg->mac_addr[2], arp_msg->mac_addr[3], arp_msg->mac_addr[4],
                     arp_msg->mac_addr[5]);
@@ -181,8 +240,7 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     }
 
     if (vlan_id) {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
+        vlan_itf = local_if_find_vlan_itf(vlan_id);
     }
 
     /* Find MLACP itf, member of port-channel*/
@@ -201,30 +259,30 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
             {
                 vid = 0;
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                vlan_id_list = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
+                vlan_member = local_if_is_vlan_member(lif_po, vlan_id);
 
-                if (!vlan_id_list) {
+                if (!vlan_member) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (!vlan_id_list->vlan_itf) {
+                if (!vlan_itf) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (vlan_id_list->vlan_itf->ifindex != ndm->ndm_ifindex) {
+                if (vlan_itf->ifindex != rec->ifindex) {
                     ln = __LINE__;
                     continue;
                 }
 
-                vid = vlan_id_list->vid;
+                vid = vlan_id;
                 ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from mclag enabled member port of vlan %d", vid);
             }
             else
             {
                 /* Is the ARP belong to a L3 mode MLAG itf?*/
-                if (ndm->ndm_ifindex != lif_po->ifindex) {
+                if (rec->ifindex != lif_po->ifindex) {
                     ln = __LINE__;
                     continue;
                 }
@@ -243,11 +301,11 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
            peer_link_if = csm->peer_link_if;
            if (!local_if_is_l3_mode(peer_link_if)) {
                vid = 0;
-               vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+               vlan_member = local_if_is_vlan_member(peer_link_if, vlan_id);
 
-               if (vlan_id_list && vlan_id_list->vlan_itf) {
-                   if (vlan_id_list->vlan_itf->ifindex == ndm->ndm_ifindex) {
-                       vid = vlan_id_list->vid;
+               if (vlan_member && vlan_itf) {
+                   if (vlan_itf->ifindex == rec->ifindex) {
+                       vid = vlan_id;
                        ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from peer link vlan %d", vid);
                        verify_arp = 1;
                        lif_po = peer_link_if;
@@ -268,8 +326,8 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     }
 
     if (vid != 0) {
-        if (vid && vlan_id_list && vlan_id_list->vlan_itf) {
-            if (arp_msg->ipv4_addr == vlan_id_list->vlan_itf->ipv4_addr) {
+        if (vid && vlan_member && vlan_itf) {
+            if (arp_msg->ipv4_addr == vlan_itf->ipv4_addr) {
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Ignore My ip %s", show_ip_str(arp_msg->ipv4_addr));
                 return;
             }
@@ -277,7 +335,7 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     }
 
     /* update lif ARP*/
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    LIST_FOREACH(msg, ARP_HASH_HEAD(csm, arp_msg->ipv4_addr), hash_next)
     {
         arp_info = (struct ARPMsg *)msg->buf;
         if (arp_info->ipv4_addr != arp_msg->ipv4_addr)
@@ -287,9 +345,8 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
         if (msgtype == RTM_DELNEIGH)
         {
             /* delete ARP*/
-            TAILQ_REMOVE(&MLACP(csm).arp_list, msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_dequeue_arp(csm, msg);
+            iccp_csm_free_msg(msg);
             msg = NULL;
             ICCPD_LOG_DEBUG(__FUNCTION__, "Delete ARP %s", show_ip_str(arp_msg->ipv4_addr));
         }
@@ -301,9 +358,11 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
                 || memcmp(arp_info->mac_addr, arp_msg->mac_addr, ETHER_ADDR_LEN) != 0)
             {
                 arp_update = 1;
+                msg->warm_restored = 0;
                 arp_info->op_type = arp_msg->op_type;
                 sprintf(arp_info->ifname, "%s", arp_msg->ifname);
                 memcpy(arp_info->mac_addr, arp_msg->mac_addr, ETHER_ADDR_LEN);
+                mclagd_ctl_watch_arp(csm, arp_info, MCLAGD_WATCH_OP_ADD);
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Update ARP for %s", show_ip_str(arp_msg->ipv4_addr));
             }
         }
@@ -338,6 +397,7 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
             arp_msg->flag = 0;
             if (iccp_csm_init_msg(&msg_send, (char *)arp_msg, msg_len) == 0)
             {
+                msg_send->lat_stamp = iccp_timer_now_usec();
                 TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
                 /*ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ARP[ADD] message for %s",
                                 show_ip_str(arp_msg->ipv4_addr));*/
@@ -356,6 +416,7 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
             arp_msg->flag = 0;
             if (iccp_csm_init_msg(&msg_send, (char *)arp_msg, msg_len) == 0)
             {
+                msg_send->lat_stamp = iccp_timer_now_usec();
                 TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
                 /*ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ARP[DEL] message for %s",
                                 show_ip_str(arp_msg->ipv4_addr));*/
@@ -372,20 +433,21 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     return;
 }
 
-static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int msgtype, int is_del)
+static void do_ndisc_learn_from_kernel(struct iccp_neigh_rec *rec)
 {
+    int msgtype = rec->msgtype;
     struct System *sys = NULL;
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct NDISCMsg *ndisc_msg = NULL, *ndisc_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vlan_member = 0;
     struct Msg *msg_send = NULL;
     uint16_t vid = 0;
     int entry_exists = 0;
     int is_link_local = 0;
     int ln = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     char buf[MAX_BUFSIZE] = { 0 };
     size_t msg_len = 0;
@@ -401,7 +463,7 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
         return;
 
     /* Find local itf */
-    if (!(ndisc_lif = local_if_find_by_ifindex(ndm->ndm_ifindex)))
+    if (!(ndisc_lif = local_if_find_by_ifindex(rec->ifindex)))
         return;
 
     /* create NDISC msg */
@@ -409,14 +471,13 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
     ndisc_msg = (struct NDISCMsg *)&buf;
     ndisc_msg->op_type = NEIGH_SYNC_LIF;
     sprintf(ndisc_msg->ifname, "%s", ndisc_lif->name);
-    if (tb[NDA_DST])
-        memcpy(&ndisc_msg->ipv6_addr, RTA_DATA(tb[NDA_DST]), RTA_PAYLOAD(tb[NDA_DST]));
-    if (!is_del && tb[NDA_LLADDR])
-        memcpy(ndisc_msg->mac_addr, RTA_DATA(tb[NDA_LLADDR]), RTA_PAYLOAD(tb[NDA_LLADDR]));
+    memcpy(&ndisc_msg->ipv6_addr, rec->dst, sizeof(ndisc_msg->ipv6_addr));
+    if (!rec->is_del && rec->has_lladdr)
+        memcpy(ndisc_msg->mac_addr, rec->lladdr, ETHER_ADDR_LEN);
 
     ICCPD_LOG_NOTICE(__FUNCTION__, "ndisc type %s, state (%04X)(%d), ifindex [%d] (%s), ip %s, mac [%02X:%02X:%02X:%02X:%02X:%02X]",
-                    msgtype == RTM_NEWNEIGH ? "New" : "Del", ndm->ndm_state, fwd_neigh_state_valid(ndm->ndm_state),
-                    ndm->ndm_ifindex, ndisc_lif->name,
+                    msgtype == RTM_NEWNEIGH ? "New" : "Del", rec->state, fwd_neigh_state_valid(rec->state),
+                    rec->ifindex, ndisc_lif->name,
                     show_ipv6_str((char *)ndisc_msg->ipv6_addr),
                     ndisc_msg->mac_addr[0], ndisc_msg->mac_addr[1], ndisc_msg->mac_addr[2], ndisc_msg->mac_addr[3], ndisc_msg->mac_addr[4],
                     ndisc_msg->mac_addr[5]);
@@ -442,8 +503,7 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
     }
 
     if (vlan_id) {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
+        vlan_itf = local_if_find_vlan_itf(vlan_id);
     }
     /* Find MLACP itf, member of port-channel */
     LIST_FOREACH(csm, &(sys->csm_list), next)
@@ -461,30 +521,30 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                vlan_id_list = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
+                vlan_member = local_if_is_vlan_member(lif_po, vlan_id);
 
-                if (!vlan_id_list) {
+                if (!vlan_member) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (!vlan_id_list->vlan_itf) {
+                if (!vlan_itf) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (vlan_id_list->vlan_itf->ifindex != ndm->ndm_ifindex) {
+                if (vlan_itf->ifindex != rec->ifindex) {
                     ln = __LINE__;
                     continue;
                 }
 
-                vid = vlan_id_list->vid;
+                vid = vlan_id;
                 ICCPD_LOG_DEBUG(__FUNCTION__, "neighor is from intf %s of vlan %d", lif_po->name, vid);
             }
             else
             {
                 /* Is the ND belong to a L3 mode MLAG itf? */
-                if (ndm->ndm_ifindex != lif_po->ifindex) {
+                if (rec->ifindex != lif_po->ifindex) {
                     ln = __LINE__;
                     continue;
                 }
@@ -503,11 +563,11 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
            peer_link_if = csm->peer_link_if;
            if (!local_if_is_l3_mode(peer_link_if)) {
                vid = 0;
-               vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+               vlan_member = local_if_is_vlan_member(peer_link_if, vlan_id);
 
-               if (vlan_id_list && vlan_id_list->vlan_itf) {
-                   if (vlan_id_list->vlan_itf->ifindex == ndm->ndm_ifindex) {
-                       vid = vlan_id_list->vid;
+               if (vlan_member && vlan_itf) {
+                   if (vlan_itf->ifindex == rec->ifindex) {
+                       vid = vlan_id;
                        ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from peer link vlan %d", vid);
                        verify_neigh = 1;
                        lif_po = peer_link_if;
@@ -533,8 +593,8 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
         is_link_local = 1;
     }
 
-    if (vid && vlan_id_list && vlan_id_list->vlan_itf) {
-        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_addr, 16) == 0)
+    if (vid && vlan_member && vlan_itf) {
+        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_itf->ipv6_addr, 16) == 0)
         {
             ICCPD_LOG_DEBUG(__FUNCTION__, "Ignoring neighbor entry for My Ip %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
             return;
@@ -542,7 +602,7 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
 
         if (is_link_local)
         {
-            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_ll_addr, 16) == 0)
+            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_itf->ipv6_ll_addr, 16) == 0)
             {
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Ignoring neighbor entry for My Ip %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
                 return;
@@ -551,7 +611,7 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
     }
 
     /* update lif ND */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    LIST_FOREACH(msg, NDISC_HASH_HEAD(csm, ndisc_msg->ipv6_addr), hash_next)
     {
         ndisc_info = (struct NDISCMsg *)msg->buf;
 
@@ -562,22 +622,23 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
         if (msgtype == RTM_DELNEIGH)
         {
             /* delete ND */
-            TAILQ_REMOVE(&MLACP(csm).ndisc_list, msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_dequeue_ndisc(csm, msg);
+            iccp_csm_free_msg(msg);
             msg = NULL;
             ICCPD_LOG_DEBUG(__FUNCTION__, "Delete neighbor %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
         }
         else
         {
             /* update ND */
-            if (ndisc_info->op_type != ndisc_info->op_type
-                || strcmp(ndisc_info->ifname, ndisc_info->ifname) != 0 || memcmp(ndisc_info->mac_addr, ndisc_info->mac_addr, ETHER_ADDR_LEN) != 0)
+            if (ndisc_info->op_type != ndisc_msg->op_type
+                || strcmp(ndisc_info->ifname, ndisc_msg->ifname) != 0 || memcmp(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN) != 0)
             {
                 neigh_update = 1;
+                msg->warm_restored = 0;
                 ndisc_info->op_type = ndisc_msg->op_type;
                 sprintf(ndisc_info->ifname, "%s", ndisc_msg->ifname);
                 memcpy(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN);
+                mclagd_ctl_watch_ndisc(csm, ndisc_info, MCLAGD_WATCH_OP_ADD);
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Update neighbor for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
             }
         }
@@ -611,6 +672,7 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
             ndisc_msg->flag = 0;
             if (iccp_csm_init_msg(&msg_send, (char *)ndisc_msg, msg_len) == 0)
             {
+                msg_send->lat_stamp = iccp_timer_now_usec();
                 TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
                 /* ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue Ndisc[ADD] for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr)); */
             }
@@ -628,6 +690,7 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
             ndisc_msg->flag = 0;
             if (iccp_csm_init_msg(&msg_send, (char *)ndisc_msg, msg_len) == 0)
             {
+                msg_send->lat_stamp = iccp_timer_now_usec();
                 TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
                 /* ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue Ndisc[DEL] for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr)); */
             }
@@ -672,35 +735,29 @@ void ifm_parse_rtattr(struct rtattr **tb, int max, struct rtattr *rta, int len)
     }
 }
 
-int do_one_neigh_request(struct nlmsghdr *n)
+/* Reduce a neighbor netlink message to an iccp_neigh_rec. Only looks at the
+ * message itself, so it can run outside of the main thread.
+ * Returns 1 if rec should be handled, 0 if the message is ignored.
+ */
+int iccp_neigh_parse(struct nlmsghdr *n, struct iccp_neigh_rec *rec)
 {
     struct ndmsg *ndm = NLMSG_DATA(n);
     int len = n->nlmsg_len;
     struct rtattr *tb[NDA_MAX + 1] = {{0}};
-    int is_del = 0;
-    int msgtype = n->nlmsg_type;
-    struct CSM* csm = NULL;
-
-    if (n->nlmsg_type == NLMSG_DONE)
-    {
-        return 0;
-    }
 
     /* process msg_type RTM_NEWNEIGH, RTM_GETNEIGH, RTM_DELNEIGH */
     if (n->nlmsg_type != RTM_NEWNEIGH && n->nlmsg_type  != RTM_DELNEIGH )
         return(0);
 
-    /*Check if mclag configured*/
-    csm = system_get_first_csm();
-    if (!csm)
-        return(0);
-
     len -= NLMSG_LENGTH(sizeof(*ndm));
     if (len < 0)
         return MCLAG_ERROR;
 
     ifm_parse_rtattr(tb, NDA_MAX, NDA_RTA(ndm), len);
 
+    memset(rec, 0, sizeof(struct iccp_neigh_rec));
+    rec->msgtype = n->nlmsg_type;
+
     if (ndm->ndm_state == NUD_INCOMPLETE
         || ndm->ndm_state == NUD_FAILED
         || ndm->ndm_state == NUD_NOARP
@@ -710,11 +767,11 @@ int do_one_neigh_request(struct nlmsghdr *n)
         if ((ndm->ndm_state == NUD_FAILED)
                 || (ndm->ndm_state == NUD_INCOMPLETE))
         {
-            is_del = 1;
-            msgtype = RTM_DELNEIGH;
+            rec->is_del = 1;
+            rec->msgtype = RTM_DELNEIGH;
         }
 
-        if (!is_del) {
+        if (!rec->is_del) {
             return(0);
         }
     }
@@ -724,25 +781,120 @@ int do_one_neigh_request(struct nlmsghdr *n)
         return(0);
     }
 
-    if (ndm->ndm_family == AF_INET)
+    if (ndm->ndm_family != AF_INET && ndm->ndm_family != AF_INET6)
+        return(0);
+
+    rec->family = ndm->ndm_family;
+    rec->ifindex = ndm->ndm_ifindex;
+    rec->state = ndm->ndm_state;
+    memcpy(rec->dst, RTA_DATA(tb[NDA_DST]),
+           RTA_PAYLOAD(tb[NDA_DST]) < sizeof(rec->dst) ? RTA_PAYLOAD(tb[NDA_DST]) : sizeof(rec->dst));
+    if (tb[NDA_LLADDR] && RTA_PAYLOAD(tb[NDA_LLADDR]) >= ETHER_ADDR_LEN)
+    {
+        memcpy(rec->lladdr, RTA_DATA(tb[NDA_LLADDR]), ETHER_ADDR_LEN);
+        rec->has_lladdr = 1;
+    }
+
+    return 1;
+}
+
+void do_one_neigh_rec(struct iccp_neigh_rec *rec)
+{
+    /*Check if mclag configured*/
+    if (!system_get_first_csm())
+        return;
+
+    if (rec->family == AF_INET)
     {
-        do_arp_learn_from_kernel(ndm, tb, msgtype, is_del);
+        do_arp_learn_from_kernel(rec);
     }
 
-    if (ndm->ndm_family == AF_INET6)
+    if (rec->family == AF_INET6)
     {
-        do_ndisc_learn_from_kernel(ndm, tb, msgtype, is_del);
+        do_ndisc_learn_from_kernel(rec);
     }
 
+    return;
+}
+
+int do_one_neigh_request(struct nlmsghdr *n)
+{
+    struct iccp_neigh_rec rec;
+    int ret;
+
+    if (n->nlmsg_type == NLMSG_DONE)
+    {
+        return 0;
+    }
+
+    ret = iccp_neigh_parse(n, &rec);
+    if (ret <= 0)
+        return ret;
+
+    do_one_neigh_rec(&rec);
+
     return (0);
 }
 
+/* Tag the learned entry of a dumped neighbor, see iccp_neigh_resync */
+static void iccp_neigh_mark(struct System *sys, struct iccp_neigh_rec *rec)
+{
+    struct CSM *csm = NULL;
+    struct Msg *msg = NULL;
+    struct ARPMsg *arp_info = NULL;
+    struct NDISCMsg *ndisc_info = NULL;
+    uint32_t ipv4_addr = 0;
+    uint32_t ipv6_addr[4];
+
+    if (rec->is_del)
+        return;
+
+    memcpy(&ipv4_addr, rec->dst, sizeof(ipv4_addr));
+    memcpy(ipv6_addr, rec->dst, sizeof(ipv6_addr));
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (rec->family == AF_INET)
+        {
+            LIST_FOREACH(msg, ARP_HASH_HEAD(csm, ipv4_addr), hash_next)
+            {
+                arp_info = (struct ARPMsg *)msg->buf;
+                if (arp_info->ipv4_addr == ipv4_addr)
+                {
+                    msg->sync_gen = sys->neigh_sync_gen;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            LIST_FOREACH(msg, NDISC_HASH_HEAD(csm, ipv6_addr), hash_next)
+            {
+                ndisc_info = (struct NDISCMsg *)msg->buf;
+                if (memcmp(ndisc_info->ipv6_addr, ipv6_addr, 16) == 0)
+                {
+                    msg->sync_gen = sys->neigh_sync_gen;
+                    break;
+                }
+            }
+        }
+    }
+
+    return;
+}
+
 /*Handle arp received from kernel*/
 static int iccp_neigh_valid_handler(struct nl_msg *msg, void *arg)
 {
+    struct System *sys = (struct System *)arg;
     struct nlmsghdr *nlh = nlmsg_hdr(msg);
+    struct iccp_neigh_rec rec;
 
-    do_one_neigh_request(nlh);
+    if (iccp_neigh_parse(nlh, &rec) <= 0)
+        return 0;
+
+    do_one_neigh_rec(&rec);
+    iccp_neigh_mark(sys, &rec);
 
     return 0;
 }
@@ -798,6 +950,102 @@ int iccp_neigh_get_init()
     return ret;
 }
 
+/* Feed a delete for every locally learned entry of the list the last
+ * dump did not report, it is what the missed RTM_DELNEIGH would have done.
+ */
+static void iccp_neigh_sweep(struct System *sys, struct CSM *csm, int family)
+{
+    struct Msg *msg = NULL;
+    struct Msg *msg_next = NULL;
+    struct ARPMsg *arp_info = NULL;
+    struct NDISCMsg *ndisc_info = NULL;
+    struct LocalInterface *lif = NULL;
+    struct iccp_neigh_rec rec;
+    char *ifname = NULL;
+    uint8_t learn_flag;
+
+    if (family == AF_INET)
+        msg = TAILQ_FIRST(&(MLACP(csm).arp_list));
+    else
+        msg = TAILQ_FIRST(&(MLACP(csm).ndisc_list));
+
+    while (msg)
+    {
+        /* Only this entry can be dequeued by the delete */
+        msg_next = TAILQ_NEXT(msg, tail);
+
+        if (family == AF_INET)
+        {
+            arp_info = (struct ARPMsg *)msg->buf;
+            learn_flag = arp_info->learn_flag;
+            ifname = arp_info->ifname;
+        }
+        else
+        {
+            ndisc_info = (struct NDISCMsg *)msg->buf;
+            learn_flag = ndisc_info->learn_flag;
+            ifname = ndisc_info->ifname;
+        }
+
+        if (learn_flag != NEIGH_LOCAL || msg->sync_gen == sys->neigh_sync_gen
+            || !(lif = local_if_find_by_name(ifname)))
+        {
+            msg = msg_next;
+            continue;
+        }
+
+        memset(&rec, 0, sizeof(struct iccp_neigh_rec));
+        rec.msgtype = RTM_DELNEIGH;
+        rec.is_del = 1;
+        rec.family = family;
+        rec.ifindex = lif->ifindex;
+        if (family == AF_INET)
+            memcpy(rec.dst, &arp_info->ipv4_addr, sizeof(arp_info->ipv4_addr));
+        else
+            memcpy(rec.dst, ndisc_info->ipv6_addr, sizeof(ndisc_info->ipv6_addr));
+
+        SYSTEM_INCR_NETLINK_RESYNC_STALE_COUNTER(sys);
+        do_one_neigh_rec(&rec);
+
+        msg = msg_next;
+    }
+
+    return;
+}
+
+/* Re-read the kernel neighbors after the neighbor event socket overran.
+ * The dump goes through the learning path, which finds unchanged entries
+ * in the neighbor hash and leaves them alone.
+ */
+int iccp_neigh_resync()
+{
+    struct System *sys = NULL;
+    struct CSM *csm = NULL;
+    int ret;
+
+    if (!(sys = system_get_instance()))
+        return MCLAG_ERROR;
+
+    SYSTEM_INCR_NETLINK_NEIGH_RESYNC_COUNTER(sys);
+    ++sys->neigh_sync_gen;
+
+    ret = iccp_neigh_get_init();
+    if (ret < 0)
+    {
+        /* Partial dump, nothing can be purged from it */
+        sys->need_sync_neigh_again = 1;
+        return ret;
+    }
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        iccp_neigh_sweep(sys, csm, AF_INET);
+        iccp_neigh_sweep(sys, csm, AF_INET6);
+    }
+
+    return 0;
+}
+
 /*When received ARP packets from kernel, update arp information*/
 void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, uint8_t mac_addr[ETHER_ADDR_LEN])
 {
@@ -805,13 +1053,13 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct ARPMsg *arp_msg = NULL, *arp_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vlan_member = 0;
     struct Msg *msg_send = NULL;
     uint16_t vid = 0;
     struct LocalInterface *peer_link_if = NULL;
     int ln = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     char buf[MAX_BUFSIZE] = { 0 };
     size_t msg_len = 0;
@@ -858,8 +1106,7 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     }
 
     if (vlan_id) {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
+        vlan_itf = local_if_find_vlan_itf(vlan_id);
     }
     /* Find MLACP itf, member of port-channel*/
     LIST_FOREACH(csm, &(sys->csm_list), next)
@@ -877,24 +1124,24 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                vlan_id_list = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
+                vlan_member = local_if_is_vlan_member(lif_po, vlan_id);
 
-                if (!vlan_id_list) {
+                if (!vlan_member) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (!vlan_id_list->vlan_itf) {
+                if (!vlan_itf) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (vlan_id_list->vlan_itf->ifindex != ifindex) {
+                if (vlan_itf->ifindex != ifindex) {
                     ln = __LINE__;
                     continue;
                 }
 
-                vid = vlan_id_list->vid;
+                vid = vlan_id;
                 ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from mclag enabled port %s of vlan %d",
                                               lif_po->name, vid);
             }
@@ -919,11 +1166,11 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
            peer_link_if = csm->peer_link_if;
            if (!local_if_is_l3_mode(peer_link_if)) {
                vid = 0;
-               vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+               vlan_member = local_if_is_vlan_member(peer_link_if, vlan_id);
 
-               if (vlan_id_list && vlan_id_list->vlan_itf) {
-                   if (vlan_id_list->vlan_itf->ifindex == ifindex) {
-                       vid = vlan_id_list->vid;
+               if (vlan_member && vlan_itf) {
+                   if (vlan_itf->ifindex == ifindex) {
+                       vid = vlan_id;
                        ICCPD_LOG_DEBUG(__FUNCTION__, "ARP is from peer link vlan %d", vid);
                        verify_arp = 1;
                        lif_po = peer_link_if;
@@ -951,8 +1198,8 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
             return;
         }
     } else {
-        if (vid && vlan_id_list && vlan_id_list->vlan_itf) {
-            if (arp_msg->ipv4_addr == vlan_id_list->vlan_itf->ipv4_addr) {
+        if (vid && vlan_member && vlan_itf) {
+            if (arp_msg->ipv4_addr == vlan_itf->ipv4_addr) {
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Ignore My ip %s", show_ip_str(arp_msg->ipv4_addr));
                 return;
             }
@@ -960,7 +1207,7 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     }
 
     /* update lif ARP*/
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    LIST_FOREACH(msg, ARP_HASH_HEAD(csm, arp_msg->ipv4_addr), hash_next)
     {
         arp_info = (struct ARPMsg*)msg->buf;
         if (arp_info->ipv4_addr != arp_msg->ipv4_addr)
@@ -971,9 +1218,11 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
             || strcmp(arp_info->ifname, arp_msg->ifname) != 0
             || memcmp(arp_info->mac_addr, arp_msg->mac_addr, ETHER_ADDR_LEN) != 0)
         {
+            msg->warm_restored = 0;
             arp_info->op_type = arp_msg->op_type;
             sprintf(arp_info->ifname, "%s", arp_msg->ifname);
             memcpy(arp_info->mac_addr, arp_msg->mac_addr, ETHER_ADDR_LEN);
+            mclagd_ctl_watch_arp(csm, arp_info, MCLAGD_WATCH_OP_ADD);
             ICCPD_LOG_DEBUG(__FUNCTION__, "Update ARP for %s",
                             show_ip_str(arp_msg->ipv4_addr));
         }
@@ -1003,6 +1252,7 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
         arp_msg->flag = 0;
         if (iccp_csm_init_msg(&msg_send, (char*)arp_msg, msg_len) == 0)
         {
+            msg_send->lat_stamp = iccp_timer_now_usec();
             TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg_send, tail);
             /*ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ARP[ADD] for %s",
                             show_ip_str(arp_msg->ipv4_addr));*/
@@ -1021,7 +1271,8 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
     struct NDISCMsg *ndisc_msg = NULL, *ndisc_info = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vlan_member = 0;
     struct Msg *msg_send = NULL;
     char mac_str[18] = "";
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
@@ -1034,7 +1285,6 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     size_t msg_len = 0;
     char addr_null[16] = { 0 };
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     struct LocalInterface *lif_po = NULL, *ndisc_lif = NULL;
 
@@ -1076,8 +1326,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     }
 
     if (vlan_id) {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
+        vlan_itf = local_if_find_vlan_itf(vlan_id);
     }
     /* Find MLACP itf, member of port-channel */
     LIST_FOREACH(csm, &(sys->csm_list), next)
@@ -1094,24 +1343,24 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
             if (!local_if_is_l3_mode(lif_po))
             {
                 /* Is the L2 MLAG itf belong to a vlan?*/
-                vlan_id_list = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
+                vlan_member = local_if_is_vlan_member(lif_po, vlan_id);
 
-                if (!vlan_id_list) {
+                if (!vlan_member) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (!vlan_id_list->vlan_itf) {
+                if (!vlan_itf) {
                     ln = __LINE__;
                     continue;
                 }
 
-                if (vlan_id_list->vlan_itf->ifindex != ifindex) {
+                if (vlan_itf->ifindex != ifindex) {
                     ln = __LINE__;
                     continue;
                 }
 
-                vid = vlan_id_list->vid;
+                vid = vlan_id;
             }
             else
             {
@@ -1134,11 +1383,11 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
            peer_link_if = csm->peer_link_if;
            if (!local_if_is_l3_mode(peer_link_if)) {
                vid = 0;
-               vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+               vlan_member = local_if_is_vlan_member(peer_link_if, vlan_id);
 
-               if (vlan_id_list && vlan_id_list->vlan_itf) {
-                   if (vlan_id_list->vlan_itf->ifindex == ifindex) {
-                       vid = vlan_id_list->vid;
+               if (vlan_member && vlan_itf) {
+                   if (vlan_itf->ifindex == ifindex) {
+                       vid = vlan_id;
                        ICCPD_LOG_DEBUG(__FUNCTION__, "ND is from peer link vlan %d", vid);
                        verify_ndisc = 1;
                        lif_po = peer_link_if;
@@ -1164,8 +1413,8 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
         is_link_local = 1;
     }
 
-    if (vid && vlan_id_list && vlan_id_list->vlan_itf) {
-        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_addr, 16) == 0)
+    if (vid && vlan_member && vlan_itf) {
+        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_itf->ipv6_addr, 16) == 0)
         {
             ICCPD_LOG_DEBUG(__FUNCTION__, "Ignoring neighbor entry for My Ip %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
             return;
@@ -1173,7 +1422,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
 
         if (is_link_local)
         {
-            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_ll_addr, 16) == 0)
+            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)vlan_itf->ipv6_ll_addr, 16) == 0)
             {
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Ignoring neighbor entry for My Ip %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
                 return;
@@ -1182,7 +1431,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     }
 
     /* update lif ND */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    LIST_FOREACH(msg, NDISC_HASH_HEAD(csm, ndisc_msg->ipv6_addr), hash_next)
     {
         ndisc_info = (struct NDISCMsg *)msg->buf;
 
@@ -1201,9 +1450,11 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
         if (ndisc_info->op_type != ndisc_msg->op_type
             || strcmp(ndisc_info->ifname, ndisc_msg->ifname) != 0 || memcmp(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN) != 0)
         {
+            msg->warm_restored = 0;
             ndisc_info->op_type = ndisc_msg->op_type;
             sprintf(ndisc_info->ifname, "%s", ndisc_msg->ifname);
             memcpy(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN);
+            mclagd_ctl_watch_ndisc(csm, ndisc_info, MCLAGD_WATCH_OP_ADD);
              ICCPD_LOG_DEBUG(__FUNCTION__, "Update ND for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
         }
         break;
@@ -1247,6 +1498,7 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
         ndisc_msg->flag = 0;
         if (iccp_csm_init_msg(&msg_send, (char *)ndisc_msg, msg_len) == 0)
         {
+            msg_send->lat_stamp = iccp_timer_now_usec();
             TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg_send, tail);
             /* ICCPD_LOG_DEBUG(__FUNCTION__, "Enqueue ND[ADD] for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr)); */
         }
@@ -1327,34 +1579,15 @@ struct PendingVlanMbrIf* find_pending_vlan_mbr_if(struct System *sys, const char
 //add specific vlan id to pending vlan membership interface
 int add_pending_vlan_mbr(struct PendingVlanMbrIf* mbr_if, uint16_t vid)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-    char vlan_name[16] = "";
-    if (!mbr_if)
+    if (!mbr_if || vid >= VLAN_ID_MAX)
     {
         return MCLAG_ERROR;
     }
 
-    sprintf(vlan_name, "Vlan%d", vid);
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
-    vlan = RB_FIND(vlan_rb_tree, &(mbr_if->vlan_tree), &vlan_key);
-
-    if (!vlan)
+    if (!VLAN_BITMAP_TEST(&mbr_if->vlan_bitmap, vid))
     {
-        vlan = (struct VLAN_ID*)malloc(sizeof(struct VLAN_ID));
-        if (!vlan)
-        {
-            ICCPD_LOG_WARN(__FUNCTION__, "Add Pending Vlan Member for If:%s Vlan:%d creation, malloc failed", mbr_if->name, vid);
-            return MCLAG_ERROR;
-        }
-
-        memset(vlan, 0, sizeof(struct VLAN_ID));
-        vlan->vid = vid;
-
         ICCPD_LOG_DEBUG(__FUNCTION__, "Add VLAN %d to pending vlan member if:%s ", vid, mbr_if->name);
-        RB_INSERT(vlan_rb_tree, &(mbr_if->vlan_tree), vlan);
+        VLAN_BITMAP_SET(&mbr_if->vlan_bitmap, vid);
     }
     return 0;
 }
@@ -1362,21 +1595,14 @@ int add_pending_vlan_mbr(struct PendingVlanMbrIf* mbr_if, uint16_t vid)
 //delete specific vlan id from pending vlan membership interface
 void del_pending_vlan_mbr(struct PendingVlanMbrIf* mbr_if, uint16_t vid)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-    if (!mbr_if)
+    if (!mbr_if || vid >= VLAN_ID_MAX)
     {
         return;
     }
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
 
-    vlan = RB_FIND(vlan_rb_tree, &(mbr_if->vlan_tree), &vlan_key);
-
-    if (vlan != NULL)
+    if (VLAN_BITMAP_TEST(&mbr_if->vlan_bitmap, vid))
     {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(mbr_if->vlan_tree), vlan);
-        free(vlan);
+        VLAN_BITMAP_CLR(&mbr_if->vlan_bitmap, vid);
         ICCPD_LOG_DEBUG(__FUNCTION__, "Remove VLAN %d from pending vlan mbr If:%s ",vid, mbr_if->name);
     }
     return;
@@ -1386,15 +1612,8 @@ void del_pending_vlan_mbr(struct PendingVlanMbrIf* mbr_if, uint16_t vid)
 //delete all pending vlan members for a given vlan member interface
 void del_all_pending_vlan_mbrs(struct PendingVlanMbrIf* lif)
 {
-    struct VLAN_ID* vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
-
     ICCPD_LOG_DEBUG(__FUNCTION__, "Remove all Pending VLANs from %s", lif->name);
-    RB_FOREACH_SAFE(vlan, vlan_rb_tree, &(lif->vlan_tree), vlan_temp)
-    {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(lif->vlan_tree), vlan);
-        free(vlan);
-    }
+    VLAN_BITMAP_ZERO(&lif->vlan_bitmap);
     return;
 }
 
@@ -1404,8 +1623,6 @@ void update_pending_vlan_mbr(char *mbr_if_name, unsigned int vlan_id,  int add_f
 {
     struct System *sys = NULL;
     struct PendingVlanMbrIf *mbr_if;
-    struct VLAN_ID* vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
 
     if (!(sys = system_get_instance()))
     {
@@ -1429,7 +1646,7 @@ void update_pending_vlan_mbr(char *mbr_if_name, unsigned int vlan_id,  int add_f
             return;
         }
         snprintf(mbr_if->name, MAX_L_PORT_NAME, "%s", mbr_if_name);
-        RB_INIT(vlan_rb_tree, &mbr_if->vlan_tree);
+        VLAN_BITMAP_ZERO(&mbr_if->vlan_bitmap);
         LIST_INSERT_HEAD(&(sys->pending_vlan_mbr_if_list), mbr_if, if_next);
     }
     if (add_flag)
@@ -1449,8 +1666,7 @@ void update_pending_vlan_mbr(char *mbr_if_name, unsigned int vlan_id,  int add_f
 void move_pending_vlan_mbr_to_lif(struct System *sys, struct LocalInterface* lif)
 {
     struct PendingVlanMbrIf *mbr_if;
-    struct VLAN_ID* vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
+    int vid;
     if (!sys || !lif)
     {
         return;
@@ -1463,13 +1679,13 @@ void move_pending_vlan_mbr_to_lif(struct System *sys, struct LocalInterface* lif
         return;
     }
 
-    RB_FOREACH_SAFE(vlan, vlan_rb_tree, &(mbr_if->vlan_tree), vlan_temp)
+    VLAN_BITMAP_FOREACH(vid, &mbr_if->vlan_bitmap)
     {
         //add vlan to system lif
-        local_if_add_vlan(lif, vlan->vid);
+        local_if_add_vlan(lif, vid);
 
         //delete from pending vlan member if
-        del_pending_vlan_mbr(mbr_if, vlan->vid);
+        del_pending_vlan_mbr(mbr_if, vid);
     }
 
     ICCPD_LOG_DEBUG(__FUNCTION__, "Delete pending vlan member if %s \n", lif->name);
@@ -32,6 +32,7 @@
 #include "../include/logger.h"
 #include "../include/scheduler.h"
 #include "../include/system.h"
+#include "../include/iccp_netlink.h"
 
 int check_instance(char* pid_file_path)
 {
@@ -253,20 +254,30 @@ int main(int argc, char* argv[])
         free(sys->cmd_file_path);
     if (sys->config_file_path != NULL)
         free(sys->config_file_path);
+    if (sys->mclagdctl_file_path != NULL)
+        free(sys->mclagdctl_file_path);
     sys->log_file_path = strdup(parser.log_file_path);
     sys->cmd_file_path = strdup(parser.cmd_file_path);
     sys->config_file_path = strdup(parser.config_file_path);
     sys->mclagdctl_file_path = strdup(parser.mclagdctl_file_path);
+    if (sys->warm_snapshot_path != NULL)
+        free(sys->warm_snapshot_path);
+    sys->warm_snapshot_path = strdup(parser.warm_snapshot_path);
     sys->pid_file_fd = pid_file_fd;
     sys->telnet_port = parser.telnet_port;
+    if (parser.netlink_rcvbuf > 0 && parser.netlink_rcvbuf != sys->netlink_rcvbuf_size)
+    {
+        sys->netlink_rcvbuf_size = parser.netlink_rcvbuf;
+        iccp_netlink_event_sock_set_rcvbuf(sys);
+    }
     parser.finalize(&parser);
     iccpd_signal_init(sys);
     ICCPD_LOG_INFO(__FUNCTION__, "Iccpd is started, process id = %d.  uid  %d ", getpid(), getuid());
     scheduler_init();
     scheduler_start();
     system_finalize();
-    /*scheduler_finalize();
-       log_finalize();*/
+    /*scheduler_finalize();*/
+    log_finalize();
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,247 @@
+/*
+ * iccp_mem_pool.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/iccp_mem_pool.h"
+#include "../include/iccp_csm.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/system.h"
+#include "../include/logger.h"
+
+#define MEM_POOL_ALIGN              16
+#define MEM_POOL_ROUNDUP(x)         (((x) + MEM_POOL_ALIGN - 1) & ~((size_t)MEM_POOL_ALIGN - 1))
+#define MEM_POOL_HDR_SIZE           MEM_POOL_ROUNDUP(sizeof(struct mem_pool_obj))
+#define MEM_POOL_CHUNK_SIZE(pool)   (MEM_POOL_HDR_SIZE + (pool)->obj_size)
+#define MEM_POOL_SLAB_HDR_SIZE      MEM_POOL_ROUNDUP(sizeof(struct mem_pool_slab))
+
+static struct mem_pool g_mem_pools[MEM_POOL_MAX];
+
+void mem_pool_init(struct mem_pool* pool, const char* name, size_t obj_size, uint32_t objs_per_slab)
+{
+    if (!pool)
+        return;
+
+    memset(pool, 0, sizeof(struct mem_pool));
+    pool->name = name;
+    pool->obj_size = MEM_POOL_ROUNDUP(obj_size);
+    pool->objs_per_slab = objs_per_slab ? objs_per_slab : MEM_POOL_SLAB_OBJ_NUM;
+    LIST_INIT(&pool->partial_list);
+    LIST_INIT(&pool->full_list);
+
+    return;
+}
+
+static struct mem_pool_slab* mem_pool_slab_create(struct mem_pool* pool)
+{
+    struct mem_pool_slab* slab = NULL;
+    struct mem_pool_obj* obj = NULL;
+    char* chunk = NULL;
+    uint32_t i;
+
+    slab = (struct mem_pool_slab*)malloc(MEM_POOL_SLAB_HDR_SIZE + MEM_POOL_CHUNK_SIZE(pool) * pool->objs_per_slab);
+    if (!slab)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to allocate slab for pool %s", pool->name);
+        return NULL;
+    }
+
+    SLIST_INIT(&slab->free_list);
+    slab->in_use = 0;
+
+    chunk = (char*)slab + MEM_POOL_SLAB_HDR_SIZE;
+    for (i = 0; i < pool->objs_per_slab; ++i)
+    {
+        obj = (struct mem_pool_obj*)(chunk + i * MEM_POOL_CHUNK_SIZE(pool));
+        obj->slab = slab;
+        SLIST_INSERT_HEAD(&slab->free_list, obj, next);
+    }
+
+    ++pool->slab_count;
+    ++pool->empty_slab_count;
+    SYSTEM_INCR_MEM_POOL_SLAB_ALLOC_COUNTER(system_get_instance());
+
+    return slab;
+}
+
+static void mem_pool_slab_destroy(struct mem_pool* pool, struct mem_pool_slab* slab)
+{
+    --pool->slab_count;
+    --pool->empty_slab_count;
+    SYSTEM_INCR_MEM_POOL_SLAB_FREE_COUNTER(system_get_instance());
+    free(slab);
+
+    return;
+}
+
+void* mem_pool_alloc(struct mem_pool* pool)
+{
+    struct mem_pool_slab* slab = NULL;
+    struct mem_pool_obj* obj = NULL;
+
+    if (!pool || pool->obj_size == 0)
+        return NULL;
+
+    slab = LIST_FIRST(&pool->partial_list);
+    if (!slab)
+    {
+        slab = mem_pool_slab_create(pool);
+        if (!slab)
+        {
+            SYSTEM_INCR_MEM_POOL_ALLOC_FAIL_COUNTER(system_get_instance());
+            return NULL;
+        }
+        LIST_INSERT_HEAD(&pool->partial_list, slab, next);
+    }
+
+    obj = SLIST_FIRST(&slab->free_list);
+    SLIST_REMOVE_HEAD(&slab->free_list, next);
+
+    if (slab->in_use++ == 0)
+        --pool->empty_slab_count;
+
+    if (SLIST_EMPTY(&slab->free_list))
+    {
+        LIST_REMOVE(slab, next);
+        LIST_INSERT_HEAD(&pool->full_list, slab, next);
+    }
+
+    if (++pool->in_use > pool->in_use_max)
+        pool->in_use_max = pool->in_use;
+
+    return (char*)obj + MEM_POOL_HDR_SIZE;
+}
+
+void mem_pool_free(struct mem_pool* pool, void* ptr)
+{
+    struct mem_pool_slab* slab = NULL;
+    struct mem_pool_obj* obj = NULL;
+
+    if (!pool || !ptr)
+        return;
+
+    obj = (struct mem_pool_obj*)((char*)ptr - MEM_POOL_HDR_SIZE);
+    slab = obj->slab;
+
+    /* Slab was full, it has a free object again */
+    if (SLIST_EMPTY(&slab->free_list))
+    {
+        LIST_REMOVE(slab, next);
+        LIST_INSERT_HEAD(&pool->partial_list, slab, next);
+    }
+
+    SLIST_INSERT_HEAD(&slab->free_list, obj, next);
+    --pool->in_use;
+
+    if (--slab->in_use == 0)
+    {
+        /* Keep one empty slab cached to absorb add/del churn,
+         * give the rest back once a burst is over*/
+        if (++pool->empty_slab_count > 1)
+        {
+            LIST_REMOVE(slab, next);
+            mem_pool_slab_destroy(pool, slab);
+        }
+    }
+
+    return;
+}
+
+void mem_pool_destroy(struct mem_pool* pool)
+{
+    struct mem_pool_slab* slab = NULL;
+
+    if (!pool)
+        return;
+
+    if (pool->in_use)
+        ICCPD_LOG_NOTICE(__FUNCTION__, "Pool %s destroyed with %u objects in use",
+            pool->name, pool->in_use);
+
+    while (!LIST_EMPTY(&pool->partial_list))
+    {
+        slab = LIST_FIRST(&pool->partial_list);
+        LIST_REMOVE(slab, next);
+        free(slab);
+    }
+
+    while (!LIST_EMPTY(&pool->full_list))
+    {
+        slab = LIST_FIRST(&pool->full_list);
+        LIST_REMOVE(slab, next);
+        free(slab);
+    }
+
+    pool->slab_count = 0;
+    pool->empty_slab_count = 0;
+    pool->in_use = 0;
+
+    return;
+}
+
+struct mem_pool* mem_pool_get(enum MEM_POOL_TYPE type)
+{
+    struct mem_pool* pool = NULL;
+
+    if (type >= MEM_POOL_MAX)
+        return NULL;
+
+    pool = &g_mem_pools[type];
+    if (pool->obj_size != 0)
+        return pool;
+
+    switch (type)
+    {
+        case MEM_POOL_MSG:
+            mem_pool_init(pool, "msg", sizeof(struct Msg) + MSG_INLINE_BUF_SIZE, MEM_POOL_SLAB_OBJ_NUM);
+            break;
+
+        case MEM_POOL_MAC_MSG:
+            mem_pool_init(pool, "mac_msg", sizeof(struct MACMsg), MEM_POOL_SLAB_OBJ_NUM);
+            break;
+
+        default:
+            return NULL;
+    }
+
+    return pool;
+}
+
+void mem_pool_finalize(void)
+{
+    int type;
+
+    for (type = 0; type < MEM_POOL_MAX; ++type)
+    {
+        if (g_mem_pools[type].obj_size == 0)
+            continue;
+
+        ICCPD_LOG_INFO(__FUNCTION__, "Pool %s in use %u, max in use %u, slabs %u",
+            g_mem_pools[type].name, g_mem_pools[type].in_use,
+            g_mem_pools[type].in_use_max, g_mem_pools[type].slab_count);
+        mem_pool_destroy(&g_mem_pools[type]);
+    }
+
+    return;
+}
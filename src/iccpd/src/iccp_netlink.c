@@ -58,6 +58,7 @@
 #include "../include/iccp_netlink.h"
 #include "../include/mlacp_sync_update.h"
 #include "../include/mlacp_tlv.h"
+#include "../include/iccp_nl_worker.h"
 
 /**
  * SECTION: Netlink helpers
@@ -73,8 +74,9 @@
 #define NETLINK_BROADCAST_SEND_ERROR    0x4
 #endif
 
-/* Use the same socket buffer size as in SwSS common */
-#define NETLINK_SOCKET_BUFFER_SIZE      16777216
+#ifndef NETLINK_NO_ENOBUFS
+#define NETLINK_NO_ENOBUFS              5
+#endif
 
 static int iccp_ack_handler(struct nl_msg *msg, void *arg)
 {
@@ -501,18 +503,7 @@ void iccp_set_interface_ipadd_mac(struct LocalInterface *lif, char * mac_addr )
 
     /*send msg*/
     if (sys->sync_fd)
-    {
-        if (write(sys->sync_fd,msg_buf, msg_hdr->len) == -1)
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
-        }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
-    }
+        iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
     return;
 }
 
@@ -626,7 +617,8 @@ void update_if_ipmac_on_standby(struct LocalInterface* lif_po, int dir)
 {
     struct CSM* csm;
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    struct VLAN_ID *vlan = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vid;
 
     csm = lif_po->csm;
     struct LocalInterface* lif_Bri;
@@ -689,44 +681,45 @@ void update_if_ipmac_on_standby(struct LocalInterface* lif_po, int dir)
     }
     else
     {
-        RB_FOREACH(vlan, vlan_rb_tree, &(lif_po->vlan_tree))
+        VLAN_BITMAP_FOREACH(vid, &lif_po->vlan_bitmap)
         {
-            if (!vlan->vlan_itf)
+            vlan_itf = local_if_find_vlan_itf(vid);
+            if (!vlan_itf)
                 continue;
 
             /*If the po is under a vlan, update vlan mac*/
-            if (local_if_is_l3_mode(vlan->vlan_itf))
+            if (local_if_is_l3_mode(vlan_itf))
             {
 
                 ICCPD_LOG_NOTICE(__FUNCTION__,
                         "%s Change the system-id of %s from [%02X:%02X:%02X:%02X:%02X:%02X] to [%02X:%02X:%02X:%02X:%02X:%02X], proto %d, dir %d",
                         (csm->role_type == STP_ROLE_STANDBY) ? "Standby" : "Active",
-                        vlan->vlan_itf->name, vlan->vlan_itf->l3_mac_addr[0], vlan->vlan_itf->l3_mac_addr[1],
-                        vlan->vlan_itf->l3_mac_addr[2], vlan->vlan_itf->l3_mac_addr[3],
-                        vlan->vlan_itf->l3_mac_addr[4], vlan->vlan_itf->l3_mac_addr[5],
+                        vlan_itf->name, vlan_itf->l3_mac_addr[0], vlan_itf->l3_mac_addr[1],
+                        vlan_itf->l3_mac_addr[2], vlan_itf->l3_mac_addr[3],
+                        vlan_itf->l3_mac_addr[4], vlan_itf->l3_mac_addr[5],
                         MLACP(csm).remote_system.system_id[0], MLACP(csm).remote_system.system_id[1],
                         MLACP(csm).remote_system.system_id[2], MLACP(csm).remote_system.system_id[3],
                         MLACP(csm).remote_system.system_id[4], MLACP(csm).remote_system.system_id[5],
-                        vlan->vlan_itf->is_l3_proto_enabled, dir);
+                        vlan_itf->is_l3_proto_enabled, dir);
 
-                if ((memcmp(vlan->vlan_itf->l3_mac_addr, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN) != 0)
-                        && (vlan->vlan_itf->is_l3_proto_enabled == false))
+                if ((memcmp(vlan_itf->l3_mac_addr, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN) != 0)
+                        && (vlan_itf->is_l3_proto_enabled == false))
                 {
-                    ret = iccp_netlink_if_hwaddr_set(vlan->vlan_itf->ifindex, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
+                    ret = iccp_netlink_if_hwaddr_set(vlan_itf->ifindex, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
                     if (ret != 0)
                     {
-                        ICCPD_LOG_NOTICE(__FUNCTION__, "Set %s mac error, ret = %d, dir %d", vlan->vlan_itf->name, ret, dir);
+                        ICCPD_LOG_NOTICE(__FUNCTION__, "Set %s mac error, ret = %d, dir %d", vlan_itf->name, ret, dir);
                     }
 
                     /* Refresh link local address according the new MAC */
-                    iccp_netlink_if_shutdown_set(vlan->vlan_itf->ifindex);
-                    iccp_netlink_if_startup_set(vlan->vlan_itf->ifindex);
+                    iccp_netlink_if_shutdown_set(vlan_itf->ifindex);
+                    iccp_netlink_if_startup_set(vlan_itf->ifindex);
 
-                    iccp_set_interface_ipadd_mac(vlan->vlan_itf, macaddr);
-                    memcpy(vlan->vlan_itf->l3_mac_addr, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
+                    iccp_set_interface_ipadd_mac(vlan_itf, macaddr);
+                    memcpy(vlan_itf->l3_mac_addr, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
                 }
             } else {
-                ICCPD_LOG_NOTICE(__FUNCTION__, "%s not L3 interface, dir %d", vlan->vlan_itf->name, dir);
+                ICCPD_LOG_NOTICE(__FUNCTION__, "%s not L3 interface, dir %d", vlan_itf->name, dir);
             }
         }
     }
@@ -738,7 +731,8 @@ void recover_if_ipmac_on_standby(struct LocalInterface *lif_po, int dir)
 {
     struct CSM *csm;
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    struct VLAN_ID *vlan = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vid;
 
     csm = lif_po->csm;
     char macaddr[64];
@@ -792,31 +786,32 @@ void recover_if_ipmac_on_standby(struct LocalInterface *lif_po, int dir)
     }
     else
     {
-        RB_FOREACH(vlan, vlan_rb_tree, &(lif_po->vlan_tree))
+        VLAN_BITMAP_FOREACH(vid, &lif_po->vlan_bitmap)
         {
-            if (!vlan->vlan_itf)
+            vlan_itf = local_if_find_vlan_itf(vid);
+            if (!vlan_itf)
                 continue;
 
             /*If the po is under a vlan, update vlan mac*/
-            if (local_if_is_l3_mode(vlan->vlan_itf) && (vlan->vlan_itf->is_l3_proto_enabled == false))
+            if (local_if_is_l3_mode(vlan_itf) && (vlan_itf->is_l3_proto_enabled == false))
             {
-                ret = iccp_netlink_if_hwaddr_set(vlan->vlan_itf->ifindex, MLACP(csm).system_id, ETHER_ADDR_LEN);
+                ret = iccp_netlink_if_hwaddr_set(vlan_itf->ifindex, MLACP(csm).system_id, ETHER_ADDR_LEN);
                 if (ret != 0)
                 {
                     if (ret != ICCP_NLE_SEQ_MISMATCH) {
-                        ICCPD_LOG_NOTICE(__FUNCTION__, "Set %s mac error, ret = %d", vlan->vlan_itf->name, ret);
+                        ICCPD_LOG_NOTICE(__FUNCTION__, "Set %s mac error, ret = %d", vlan_itf->name, ret);
                     }
                 }
 
                 /* Refresh link local address according the new MAC */
-                iccp_netlink_if_shutdown_set(vlan->vlan_itf->ifindex);
-                iccp_netlink_if_startup_set(vlan->vlan_itf->ifindex);
+                iccp_netlink_if_shutdown_set(vlan_itf->ifindex);
+                iccp_netlink_if_startup_set(vlan_itf->ifindex);
 
-                iccp_set_interface_ipadd_mac(vlan->vlan_itf, macaddr);
-                memcpy(vlan->vlan_itf->l3_mac_addr, MLACP(csm).system_id, ETHER_ADDR_LEN);
+                iccp_set_interface_ipadd_mac(vlan_itf, macaddr);
+                memcpy(vlan_itf->l3_mac_addr, MLACP(csm).system_id, ETHER_ADDR_LEN);
             } else {
                 ICCPD_LOG_NOTICE(__FUNCTION__, "%s not L3 interface, proto %d, dir %d",
-                        vlan->vlan_itf->name, vlan->vlan_itf->is_l3_proto_enabled, dir);
+                        vlan_itf->name, vlan_itf->is_l3_proto_enabled, dir);
             }
         }
     }
@@ -957,7 +952,7 @@ void iccp_event_handler_obj_input_newlink(struct nl_object *obj, void *arg)
 
     if (lif && (lif->ifindex == -1) && (lif->type == IF_T_VLAN))
     {
-        lif->ifindex = ifindex;
+        local_if_set_ifindex(lif, ifindex);
         lif->state = (op_state == IF_OPER_UP) ? PORT_STATE_UP : PORT_STATE_DOWN;
 
         if (addr_type == AF_LLC)
@@ -1072,6 +1067,7 @@ void iccp_event_handler_obj_input_newlink(struct nl_object *obj, void *arg)
             {
                 memcpy( lif->mac_addr, nl_addr_get_binary_addr(nl_addr), ETHER_ADDR_LEN);
                 lif->port_config_sync = 1;
+                local_if_set_dirty(lif);
             }
 
         default:
@@ -1239,7 +1235,7 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
 
         LIST_FOREACH(csm, &(sys->csm_list), next)
         {
-            TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+            LIST_FOREACH(msg, ARP_HASH_HEAD(csm, lif->ipv4_addr), hash_next)
             {
                 arp_info = (struct ARPMsg *)msg->buf;
                 if (arp_info->ipv4_addr == lif->ipv4_addr) {
@@ -1250,9 +1246,8 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
 
             if (msg)
             {
-                TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
-                free(msg->buf);
-                free(msg);
+                mlacp_dequeue_arp(csm, msg);
+                iccp_csm_free_msg(msg);
                 msg = NULL;
                 break;
             }
@@ -1261,7 +1256,7 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
 
         LIST_FOREACH(csm, &(sys->csm_list), next)
         {
-            TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+            LIST_FOREACH(msg, NDISC_HASH_HEAD(csm, lif->ipv6_addr), hash_next)
             {
                 ndisc_info = (struct NDISCMsg *)msg->buf;
 
@@ -1273,9 +1268,8 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
 
             if (msg)
             {
-                TAILQ_REMOVE(&MLACP(csm).ndisc_list, msg, tail);
-                free(msg->buf);
-                free(msg);
+                mlacp_dequeue_ndisc(csm, msg);
+                iccp_csm_free_msg(msg);
                 msg = NULL;
                 break;
             }
@@ -1314,6 +1308,7 @@ void iccp_event_handler_obj_input_newaddr(struct nl_object *obj, void *arg)
         lif->prefixlen = nl_addr_get_prefixlen(nl_addr);
         lif->l3_mode = 1;
         lif->port_config_sync = 1;
+        local_if_set_dirty(lif);
         if (memcmp((char *)lif->ipv6_addr, addr_null, 16) == 0)
         {
             update_if_ipmac_on_standby(lif, 6);
@@ -1351,6 +1346,7 @@ void iccp_event_handler_obj_input_newaddr(struct nl_object *obj, void *arg)
         lif->prefixlen_v6 = nl_addr_get_prefixlen(nl_addr);
         lif->l3_mode = 1;
         lif->port_config_sync = 1;
+        local_if_set_dirty(lif);
         if (lif->ipv4_addr == 0)
         {
             update_if_ipmac_on_standby(lif, 7);
@@ -1533,13 +1529,22 @@ int iccp_sys_local_if_list_get_addr()
     return ret;
 }
 
-static int iccp_route_event_handler(struct nl_msg *msg, void *arg)
+/* Apply one route event handed over by the netlink worker thread.
+ * Neighbor events normally arrive pre-parsed, see iccp_nl_worker.c.
+ */
+int iccp_route_event_input(struct nlmsghdr *nlh)
 {
-    struct nlmsghdr *nlh = nlmsg_hdr(msg);
+    struct nl_msg *msg = NULL;
     unsigned int event = 1;
 
-    /* Update netlink message counters */
-    system_update_netlink_counters(nlh->nlmsg_type, nlh);
+    if (nlh->nlmsg_type == RTM_NEWNEIGH || nlh->nlmsg_type == RTM_DELNEIGH)
+        return do_one_neigh_request(nlh);
+
+    msg = nlmsg_convert(nlh);
+    if (!msg)
+        return MCLAG_ERROR;
+    /* nl_msg_parse picks the cache ops by protocol, a copied message has none */
+    nlmsg_set_proto(msg, NETLINK_ROUTE);
 
     switch (nlh->nlmsg_type)
     {
@@ -1555,11 +1560,6 @@ static int iccp_route_event_handler(struct nl_msg *msg, void *arg)
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Unknown message type(RTM_DELLINK)");
             break;
 
-        case RTM_NEWNEIGH:
-        case RTM_DELNEIGH:
-            do_one_neigh_request(nlh);
-            break;
-
         case RTM_NEWADDR:
             if (nl_msg_parse(msg, &iccp_event_handler_obj_input_newaddr, NULL) < 0)
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Unknown message type.");
@@ -1570,10 +1570,12 @@ static int iccp_route_event_handler(struct nl_msg *msg, void *arg)
             break;
 
         default:
-            return NL_OK;
+            break;
     }
 
-    return NL_STOP;
+    nlmsg_free(msg);
+
+    return 0;
 }
 
 /**
@@ -1639,6 +1641,64 @@ int iccp_make_nd_socket(void)
     return sock;
 }
 
+/* SO_RCVBUF is capped by net.core.rmem_max, which is far below what a
+ * neighbor storm needs on a default kernel. SO_RCVBUFFORCE is not capped
+ * but needs CAP_NET_ADMIN, so fall back when it is refused.
+ */
+static int iccp_netlink_set_rcvbuf(struct nl_sock *sk, const char *name, int size)
+{
+    int fd = nl_socket_get_fd(sk);
+    int val = 0;
+    socklen_t len = sizeof(val);
+
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+    {
+        ICCPD_LOG_NOTICE(__FUNCTION__, "SO_RCVBUFFORCE on netlink %s sock failed, errno %d", name, errno);
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0)
+        {
+            ICCPD_LOG_ERR(__FUNCTION__, "Failed to set buffer size of netlink %s sock, errno %d", name, errno);
+            return MCLAG_ERROR;
+        }
+    }
+
+    /* The kernel reports twice the requested size, it adds its overhead */
+    if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &val, &len) == 0)
+    {
+        if (val < size)
+            ICCPD_LOG_WARN(__FUNCTION__, "Netlink %s sock rcvbuf is %d, below the requested %d, check net.core.rmem_max",
+                           name, val, size);
+        else
+            ICCPD_LOG_INFO(__FUNCTION__, "Netlink %s sock rcvbuf is %d", name, val);
+    }
+
+    /* An overrun must be reported, it is what triggers the resync */
+    val = 0;
+    len = sizeof(val);
+    if (getsockopt(fd, SOL_NETLINK, NETLINK_NO_ENOBUFS, &val, &len) == 0 && val)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "NETLINK_NO_ENOBUFS is set on netlink %s sock, clear it", name);
+        val = 0;
+        if (setsockopt(fd, SOL_NETLINK, NETLINK_NO_ENOBUFS, &val, sizeof(val)) < 0)
+            ICCPD_LOG_ERR(__FUNCTION__, "Failed to clear NETLINK_NO_ENOBUFS on netlink %s sock", name);
+    }
+
+    return 0;
+}
+
+int iccp_netlink_event_sock_set_rcvbuf(struct System *sys)
+{
+    int err;
+
+    if (!sys->route_event_sock || !sys->neigh_event_sock)
+        return MCLAG_ERROR;
+
+    err = iccp_netlink_set_rcvbuf(sys->route_event_sock, "link event", sys->netlink_rcvbuf_size);
+    if (err)
+        return err;
+
+    return iccp_netlink_set_rcvbuf(sys->neigh_event_sock, "neigh event", sys->netlink_rcvbuf_size);
+}
+
 /*init netlink socket*/
 int iccp_system_init_netlink_socket()
 {
@@ -1699,15 +1759,24 @@ int iccp_system_init_netlink_socket()
         goto err_route_event_sock_connect;
     }
 
-    /* Set the same buffer size as done in SwSS common*/
-    //err = nl_socket_set_buffer_size(sys->route_event_sock, 98304, 0);
-    err = nl_socket_set_buffer_size(sys->route_event_sock, NETLINK_SOCKET_BUFFER_SIZE, 0);
+    /* Neighbor events get their own socket, an overrun then tells which
+     * kernel table has to be re-read
+     */
+    sys->neigh_event_sock = nl_socket_alloc();
+    if (!sys->neigh_event_sock)
+        goto err_neigh_event_sock_alloc;
+
+    err = nl_connect(sys->neigh_event_sock, NETLINK_ROUTE);
     if (err)
     {
-        ICCPD_LOG_ERR(__FUNCTION__, "Failed to set buffer size of netlink route event sock.");
-        goto err_route_event_sock_connect;
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to connect to netlink sys->neigh_event_sock. ");
+        goto err_neigh_event_sock_connect;
     }
 
+    err = iccp_netlink_event_sock_set_rcvbuf(sys);
+    if (err)
+        goto err_neigh_event_sock_connect;
+
     val = NETLINK_BROADCAST_SEND_ERROR;
     err = setsockopt(nl_socket_get_fd(sys->genric_event_sock), SOL_NETLINK,
                      NETLINK_BROADCAST_ERROR, &val, sizeof(val));
@@ -1735,11 +1804,13 @@ int iccp_system_init_netlink_socket()
     nl_socket_modify_cb(sys->genric_event_sock, NL_CB_VALID, NL_CB_CUSTOM,
                         iccp_genric_event_handler, sys);
 
+    /* route_event_sock and neigh_event_sock are read by the netlink worker
+     * thread, see iccp_nl_worker.c
+     */
     nl_socket_disable_seq_check(sys->route_event_sock);
-    nl_socket_modify_cb(sys->route_event_sock, NL_CB_VALID, NL_CB_CUSTOM,
-                        iccp_route_event_handler, sys);
+    nl_socket_disable_seq_check(sys->neigh_event_sock);
 
-    err = nl_socket_add_membership(sys->route_event_sock, RTNLGRP_NEIGH);
+    err = nl_socket_add_membership(sys->neigh_event_sock, RTNLGRP_NEIGH);
     if (err < 0)
     {
         ICCPD_LOG_ERR(__FUNCTION__,  "Failed to add netlink membership.");
@@ -1814,6 +1885,10 @@ int iccp_system_init_netlink_socket()
 
 err_return:
 
+err_neigh_event_sock_connect:
+    nl_socket_free(sys->neigh_event_sock);
+
+err_neigh_event_sock_alloc:
 err_route_event_sock_connect:
     nl_socket_free(sys->route_event_sock);
 
@@ -1844,6 +1919,7 @@ void iccp_system_dinit_netlink_socket()
     if ((sys = system_get_instance()) == NULL )
         return;
 
+    nl_socket_free(sys->neigh_event_sock);
     nl_socket_free(sys->route_event_sock);
     nl_socket_free(sys->route_sock);
     nl_socket_free(sys->genric_event_sock);
@@ -1870,11 +1946,6 @@ static int iccp_netlink_genic_sock_event_handler(struct System *sys)
     return ret;
 }
 
-static int iccp_get_netlink_route_sock_event_fd(struct System *sys)
-{
-    return nl_socket_get_fd(sys->route_event_sock);
-}
-
 static int iccp_get_receive_arp_packet_sock_fd(struct System *sys)
 {
     return sys->arp_receive_fd;
@@ -2037,7 +2108,13 @@ void iccp_netlink_sync_again()
         sys->need_sync_netlink_again = 0;
 
         /*Get kernel interface and port */
-        iccp_sys_local_if_list_get_init();
+        iccp_sys_local_if_list_resync();
+    }
+
+    if (sys->need_sync_neigh_again)
+    {
+        sys->need_sync_neigh_again = 0;
+        iccp_neigh_resync();
     }
 
     if (sys->need_sync_team_again)
@@ -2056,27 +2133,6 @@ void iccp_netlink_sync_again()
     return;
 }
 
-static int iccp_netlink_route_sock_event_handler(struct System *sys)
-{
-    int ret = 0;
-
-    ret = nl_recvmsgs_default(sys->route_event_sock);
-
-    if (ret)
-    {
-        sys->need_sync_netlink_again = 1;
-        ICCPD_LOG_NOTICE(__FUNCTION__, "fd %d recvmsg error ret = %d  errno = %d ", nl_socket_get_fd(sys->route_event_sock), ret, errno);
-        SYSTEM_INCR_NETLINK_RX_ERROR();
-    }
-    /*get netlink info again when error happens */
-    if (ret == 0 && sys->need_sync_netlink_again == 1)
-    {
-        iccp_netlink_sync_again();
-    }
-
-    return ret;
-}
-
 extern int iccp_get_receive_fdb_sock_fd(struct System *sys);
 
 /* cond HIDDEN_SYMBOLS */
@@ -2097,8 +2153,8 @@ static const struct iccp_eventfd iccp_eventfds[] = {
         .event_handler = iccp_netlink_genic_sock_event_handler,
     },
     {
-        .get_fd = iccp_get_netlink_route_sock_event_fd,
-        .event_handler = iccp_netlink_route_sock_event_handler,
+        .get_fd = iccp_get_nl_worker_event_fd,
+        .event_handler = iccp_nl_worker_event_handler,
     },
     {
         .get_fd = iccp_get_receive_arp_packet_sock_fd,
@@ -2107,6 +2163,10 @@ static const struct iccp_eventfd iccp_eventfds[] = {
     {
      .get_fd = iccp_get_receive_ndisc_packet_sock_fd,
      .event_handler = iccp_receive_ndisc_packet_handler,
+    },
+    {
+        .get_fd = iccp_get_timer_fd,
+        .event_handler = iccp_timer_wheel_handler,
     }
 };
 
@@ -2160,12 +2220,13 @@ close_efd:
 
 /**
  *
- * @details Handler events which happened on event filedescriptor.
+ * @details Handler events which happened on event filedescriptor,
+ *          waiting at most timeout_msec (-1 blocks until an event).
  *
  * @return Zero on success or negative number in case of an error.
  **/
 
-int iccp_handle_events(struct System * sys)
+int iccp_handle_events(struct System * sys, int timeout_msec)
 {
     struct epoll_event events[ICCP_EVENT_FDS_COUNT + sys->readfd_count];
     struct CSM* csm = NULL;
@@ -2178,7 +2239,7 @@ int iccp_handle_events(struct System * sys)
 
     max_nfds = ICCP_EVENT_FDS_COUNT + sys->readfd_count;
 
-    nfds = epoll_wait(sys->epoll_fd, events, max_nfds, EPOLL_TIMEOUT_MSEC);
+    nfds = epoll_wait(sys->epoll_fd, events, max_nfds, timeout_msec);
 
     /* Go over list of event fds and handle them sequentially */
     for (i = 0; i < nfds; i++)
@@ -2200,18 +2261,20 @@ int iccp_handle_events(struct System * sys)
 
         if (events[i].data.fd == sys->sync_ctrl_fd)
         {
-            int client_fd = mclagd_ctl_sock_accept(sys->sync_ctrl_fd);
-            if (client_fd > 0)
-            {
-                mclagd_ctl_interactive_process(client_fd);
-                close(client_fd);
-            }
+            mclagd_ctl_sock_accept(sys->sync_ctrl_fd);
             continue;
         }
 
+        if (mclagd_ctl_client_event(events[i].data.fd, events[i].events) == 0)
+            continue;
+
         if (events[i].data.fd == sys->sync_fd)
         {
-            iccp_mclagsyncd_msg_handler(sys);
+            if (events[i].events & EPOLLOUT)
+                iccp_mclagsyncd_tx_flush(sys);
+
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                iccp_mclagsyncd_msg_handler(sys);
             continue;
         }
 
@@ -2222,19 +2285,30 @@ int iccp_handle_events(struct System * sys)
             continue;
         }
 
-        if (FD_ISSET(events[i].data.fd, &sys->readfd))
+        csm = system_get_csm_by_fd(events[i].data.fd);
+        if (csm == NULL)
+            continue;
+
+        if (!FD_ISSET(events[i].data.fd, &sys->readfd))
         {
-            LIST_FOREACH(csm, &(sys->csm_list), next)
+            /* Non-blocking connect to peer finished */
+            if (csm->conn_fd == events[i].data.fd)
+                session_client_conn_complete(csm);
+            continue;
+        }
+
+        if (csm->sock_fd == events[i].data.fd)
+        {
+            if (events[i].events & EPOLLOUT)
+                iccp_csm_tx_queue_flush(csm);
+
+            if (!(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+                continue;
+
+            if (scheduler_csm_read_callback(csm) != MCLAG_ERROR)
             {
-                if (csm->sock_fd == events[i].data.fd )
-                {
-                    if (scheduler_csm_read_callback(csm) != MCLAG_ERROR)
-                    {
-                        //consider any msg from peer as heartbeat update, this will be in scenarios of scaled msg sync b/w peers
-                        mlacp_fsm_update_heartbeat(csm, &dummy_tlv);
-                    }
-                    break;
-                }
+                //consider any msg from peer as heartbeat update, this will be in scenarios of scaled msg sync b/w peers
+                mlacp_fsm_update_heartbeat(csm, &dummy_tlv);
             }
         }
     }
@@ -2252,8 +2326,6 @@ void update_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir)
     char macaddr[64];
     uint8_t system_mac[ETHER_ADDR_LEN];
     int ret = 0;
-    struct VLAN_ID vlan_key = { 0 };
-    struct VLAN_ID *vlan = NULL;
     int vid = 0, vlan_member = 0;
 
     if (lif_vlan->type != IF_T_VLAN)
@@ -2264,17 +2336,13 @@ void update_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir)
 
     sscanf (lif_vlan->name, "Vlan%d", &vid);
 
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
     ICCPD_LOG_DEBUG(__FUNCTION__, " ifname %s vid %d, l3_proto %d, dir %d\n",
             lif_vlan->name, vid, lif_vlan->is_l3_proto_enabled, dir);
     LIST_FOREACH(csm, &(sys->csm_list), next)
     {
         if (csm->peer_link_if) {
             lif_peer = csm->peer_link_if;
-            vlan = RB_FIND(vlan_rb_tree, &(lif_peer->vlan_tree), &vlan_key);
-            if (vlan && vlan->vlan_itf)
+            if (local_if_is_vlan_member(lif_peer, vid) && local_if_find_vlan_itf(vid))
             {
                 vlan_member = 1;
                 break;
@@ -2285,8 +2353,7 @@ void update_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir)
         {
             if (lif_po->type == IF_T_PORT_CHANNEL)
             {
-                vlan = RB_FIND(vlan_rb_tree, &(lif_po->vlan_tree), &vlan_key);
-                if (vlan)
+                if (local_if_is_vlan_member(lif_po, vid))
                 {
                     vlan_member = 1;
                     break;
@@ -2468,18 +2535,20 @@ void recover_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir, ui
 
 void update_vlan_if_mac_on_iccp_up(struct LocalInterface* lif_peer, int is_up, uint8_t *remote_system_mac)
 {
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vid;
 
     ICCPD_LOG_NOTICE(__FUNCTION__, " lif name %s, up %d", lif_peer->name, is_up);
-    RB_FOREACH(vlan_id_list, vlan_rb_tree, &(lif_peer->vlan_tree))
+    VLAN_BITMAP_FOREACH(vid, &lif_peer->vlan_bitmap)
     {
-        if (!vlan_id_list->vlan_itf)
+        vlan_itf = local_if_find_vlan_itf(vid);
+        if (!vlan_itf)
             continue;
 
         if (is_up) {
-            update_vlan_if_mac_on_standby(vlan_id_list->vlan_itf, 4);
+            update_vlan_if_mac_on_standby(vlan_itf, 4);
         } else {
-            recover_vlan_if_mac_on_standby(vlan_id_list->vlan_itf, 4, remote_system_mac);
+            recover_vlan_if_mac_on_standby(vlan_itf, 4, remote_system_mac);
         }
 
     }
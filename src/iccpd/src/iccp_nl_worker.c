@@ -0,0 +1,462 @@
+/*
+ * iccp_nl_worker.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* The route event sockets (link and address events, neighbor events) are
+ * drained by a worker thread so that neighbor storms neither overrun the
+ * kernel socket nor delay the ICCP session I/O in the main loop. The worker
+ * only parses and counts in private, all state, the system counters
+ * included, is still owned and updated by the main thread.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <netlink/netlink.h>
+#include <netlink/socket.h>
+
+#include "../include/iccp_nl_worker.h"
+#include "../include/iccp_netlink.h"
+#include "../include/iccp_ifm.h"
+#include "../include/system.h"
+#include "../include/logger.h"
+
+#define NL_WORKER_RING_MASK         (NL_WORKER_RING_SIZE - 1)
+#define NL_WORKER_REC_ALIGN(len)    (((len) + 7) & ~((size_t)7))
+#define NL_WORKER_REC_SIZE(len)     NL_WORKER_REC_ALIGN(sizeof(struct nl_worker_rec_hdr) + (len))
+
+struct nl_worker
+{
+    char* ring;
+    uint64_t head;      /* consumer position, written by main thread only */
+    uint64_t tail;      /* producer position, written by worker only */
+    int event_fd;       /* wakes the main loop */
+    int stop;
+    int started;
+    pthread_t thread;
+    char* recv_buf;     /* worker private */
+    struct nl_worker_counters counters;     /* worker private, not yet published */
+};
+
+static struct nl_worker g_nl_worker = { .event_fd = -1 };
+
+static void iccp_nl_worker_signal(struct nl_worker* worker)
+{
+    uint64_t val = 1;
+
+    if (write(worker->event_fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+        ICCPD_LOG_ERR(__FUNCTION__, "Netlink worker eventfd write error %d", errno);
+
+    return;
+}
+
+/* Producer side, waits for the main thread if the ring is full so no
+ * event is lost; the kernel socket buffer absorbs the burst meanwhile.
+ */
+static int iccp_nl_worker_put(struct nl_worker* worker, uint16_t type, const void* data, uint32_t len)
+{
+    struct nl_worker_rec_hdr* hdr = NULL;
+    size_t need = NL_WORKER_REC_SIZE(len);
+    size_t contig;
+    size_t off;
+    uint64_t head;
+    uint64_t tail = worker->tail;
+    int full = 0;
+
+    if (need > NL_WORKER_RING_SIZE / 2)
+        return MCLAG_ERROR;
+
+    while (1)
+    {
+        off = tail & NL_WORKER_RING_MASK;
+        contig = NL_WORKER_RING_SIZE - off;
+        head = __atomic_load_n(&worker->head, __ATOMIC_ACQUIRE);
+        if (NL_WORKER_RING_SIZE - (tail - head) >= need + (contig < need ? contig : 0))
+            break;
+
+        if (__atomic_load_n(&worker->stop, __ATOMIC_RELAXED))
+            return MCLAG_ERROR;
+        if (!full)
+        {
+            full = 1;
+            ++worker->counters.ring_full_count;
+            iccp_nl_worker_signal(worker);
+        }
+        usleep(1000);
+    }
+
+    /* Records never wrap, pad out the end of the ring instead */
+    if (contig < need)
+    {
+        hdr = (struct nl_worker_rec_hdr*)(worker->ring + off);
+        hdr->type = NL_WORKER_REC_PAD;
+        hdr->len = contig - sizeof(struct nl_worker_rec_hdr);
+        tail += contig;
+        off = 0;
+    }
+
+    hdr = (struct nl_worker_rec_hdr*)(worker->ring + off);
+    hdr->type = type;
+    hdr->len = len;
+    if (len)
+        memcpy(hdr + 1, data, len);
+    tail += need;
+
+    __atomic_store_n(&worker->tail, tail, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+static void iccp_nl_worker_count(struct nl_worker* worker, struct nlmsghdr* nlh)
+{
+    struct nl_worker_counters* cnt = &worker->counters;
+    struct ndmsg* ndm = NLMSG_DATA(nlh);
+
+    switch (nlh->nlmsg_type)
+    {
+        case RTM_NEWLINK:
+            ++cnt->newlink_count;
+            break;
+        case RTM_DELLINK:
+            ++cnt->dellink_count;
+            break;
+        case RTM_NEWNEIGH:
+            ++cnt->newnbr_count;
+            if (ndm->ndm_family == AF_BRIDGE)
+                ++cnt->newmac_count;
+            break;
+        case RTM_DELNEIGH:
+            ++cnt->delnbr_count;
+            if (ndm->ndm_family == AF_BRIDGE)
+                ++cnt->delmac_count;
+            break;
+        case RTM_NEWADDR:
+            ++cnt->newaddr_count;
+            break;
+        case RTM_DELADDR:
+            ++cnt->deladdr_count;
+            break;
+        default:
+            ++cnt->unknown_type_count;
+            cnt->unknown_type = nlh->nlmsg_type;
+            break;
+    }
+
+    return;
+}
+
+/* Hand the counts gathered since the last call to the main thread */
+static int iccp_nl_worker_publish_counters(struct nl_worker* worker)
+{
+    static const struct nl_worker_counters zero;
+
+    if (memcmp(&worker->counters, &zero, sizeof(zero)) == 0)
+        return 0;
+
+    if (iccp_nl_worker_put(worker, NL_WORKER_REC_COUNTERS, &worker->counters, sizeof(worker->counters)) != 0)
+        return 0;
+
+    memset(&worker->counters, 0, sizeof(worker->counters));
+
+    return 1;
+}
+
+/* Runs in the worker thread, must not touch iccpd state */
+static int iccp_nl_worker_input(struct nl_worker* worker, struct nlmsghdr* nlh)
+{
+    struct iccp_neigh_rec rec;
+
+    iccp_nl_worker_count(worker, nlh);
+
+    switch (nlh->nlmsg_type)
+    {
+        case RTM_NEWNEIGH:
+        case RTM_DELNEIGH:
+            if (iccp_neigh_parse(nlh, &rec) <= 0)
+                return 0;
+            return iccp_nl_worker_put(worker, NL_WORKER_REC_NEIGH, &rec, sizeof(rec));
+
+        case RTM_NEWLINK:
+        case RTM_DELLINK:
+        case RTM_NEWADDR:
+        case RTM_DELADDR:
+            return iccp_nl_worker_put(worker, NL_WORKER_REC_NLMSG, nlh, nlh->nlmsg_len);
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/* Returns 1 if anything was queued for the main thread */
+static int iccp_nl_worker_recv(struct nl_worker* worker, int fd, uint32_t sock)
+{
+    struct nlmsghdr* nlh = NULL;
+    ssize_t len;
+    int produced = 0;
+    int i;
+
+    for (i = 0; i < NL_WORKER_RECV_MAX; ++i)
+    {
+        len = recv(fd, worker->recv_buf, NL_WORKER_RECV_BUF_SIZE, MSG_DONTWAIT);
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            /* ENOBUFS, the kernel dropped events of this socket */
+            ICCPD_LOG_NOTICE(__FUNCTION__, "fd %d recv error errno = %d", fd, errno);
+            if (iccp_nl_worker_put(worker, NL_WORKER_REC_RESYNC, &sock, sizeof(sock)) == 0)
+                produced = 1;
+            break;
+        }
+        if (len == 0)
+            break;
+
+        for (nlh = (struct nlmsghdr*)worker->recv_buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+        {
+            if (iccp_nl_worker_input(worker, nlh) == 0)
+                produced = 1;
+        }
+    }
+
+    return produced;
+}
+
+static void* iccp_nl_worker_main(void* arg)
+{
+    struct nl_worker* worker = &g_nl_worker;
+    struct System* sys = (struct System*)arg;
+    struct pollfd pfd[NL_WORKER_SOCK_NUM];
+    sigset_t sigset;
+    int produced;
+    int i;
+
+    /* Signals are handled by the main thread */
+    sigfillset(&sigset);
+    pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+    pfd[NL_WORKER_SOCK_LINK].fd = nl_socket_get_fd(sys->route_event_sock);
+    pfd[NL_WORKER_SOCK_NEIGH].fd = nl_socket_get_fd(sys->neigh_event_sock);
+    for (i = 0; i < NL_WORKER_SOCK_NUM; ++i)
+        pfd[i].events = POLLIN;
+
+    while (!__atomic_load_n(&worker->stop, __ATOMIC_RELAXED))
+    {
+        if (poll(pfd, NL_WORKER_SOCK_NUM, NL_WORKER_POLL_MSEC) <= 0)
+            continue;
+
+        produced = 0;
+        for (i = 0; i < NL_WORKER_SOCK_NUM; ++i)
+        {
+            if (pfd[i].revents & (POLLIN | POLLERR))
+                produced |= iccp_nl_worker_recv(worker, pfd[i].fd, i);
+        }
+        produced |= iccp_nl_worker_publish_counters(worker);
+
+        if (produced)
+            iccp_nl_worker_signal(worker);
+    }
+
+    return NULL;
+}
+
+int iccp_nl_worker_init(struct System* sys)
+{
+    struct nl_worker* worker = &g_nl_worker;
+
+    worker->ring = (char*)malloc(NL_WORKER_RING_SIZE);
+    worker->recv_buf = (char*)malloc(NL_WORKER_RECV_BUF_SIZE);
+    if (!worker->ring || !worker->recv_buf)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Netlink worker ring alloc failed");
+        goto err;
+    }
+    worker->head = 0;
+    worker->tail = 0;
+    worker->stop = 0;
+
+    worker->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (worker->event_fd < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Netlink worker eventfd create error %d", errno);
+        goto err;
+    }
+
+    return 0;
+
+ err:
+    free(worker->ring);
+    free(worker->recv_buf);
+    worker->ring = NULL;
+    worker->recv_buf = NULL;
+    return MCLAG_ERROR;
+}
+
+int iccp_nl_worker_start(struct System* sys)
+{
+    struct nl_worker* worker = &g_nl_worker;
+    int err;
+
+    if (!worker->ring || !sys->route_event_sock || !sys->neigh_event_sock)
+        return MCLAG_ERROR;
+
+    err = pthread_create(&worker->thread, NULL, iccp_nl_worker_main, sys);
+    if (err != 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Netlink worker thread create error %d", err);
+        return MCLAG_ERROR;
+    }
+    worker->started = 1;
+
+    return 0;
+}
+
+void iccp_nl_worker_stop(struct System* sys)
+{
+    struct nl_worker* worker = &g_nl_worker;
+
+    if (worker->started)
+    {
+        __atomic_store_n(&worker->stop, 1, __ATOMIC_RELAXED);
+        pthread_join(worker->thread, NULL);
+        worker->started = 0;
+    }
+
+    if (worker->event_fd >= 0)
+        close(worker->event_fd);
+    worker->event_fd = -1;
+    free(worker->ring);
+    free(worker->recv_buf);
+    worker->ring = NULL;
+    worker->recv_buf = NULL;
+
+    return;
+}
+
+int iccp_get_nl_worker_event_fd(struct System* sys)
+{
+    return g_nl_worker.event_fd;
+}
+
+static void iccp_nl_worker_add_counters(struct System* sys, struct nl_worker_counters* cnt)
+{
+    if (cnt->unknown_type_count && sys->dbg_counters.unknown_type_count < 5)
+        ICCPD_LOG_NOTICE(__FUNCTION__, "NETLINK_COUNTER: Unknown type %d", cnt->unknown_type);
+
+    sys->dbg_counters.newlink_count += cnt->newlink_count;
+    sys->dbg_counters.dellink_count += cnt->dellink_count;
+    sys->dbg_counters.newnbr_count += cnt->newnbr_count;
+    sys->dbg_counters.newmac_count += cnt->newmac_count;
+    sys->dbg_counters.delnbr_count += cnt->delnbr_count;
+    sys->dbg_counters.delmac_count += cnt->delmac_count;
+    sys->dbg_counters.newaddr_count += cnt->newaddr_count;
+    sys->dbg_counters.deladdr_count += cnt->deladdr_count;
+    sys->dbg_counters.unknown_type_count += cnt->unknown_type_count;
+    sys->dbg_counters.netlink_ring_full_counter += cnt->ring_full_count;
+
+    return;
+}
+
+/* Consumer side, runs in the main loop */
+int iccp_nl_worker_event_handler(struct System* sys)
+{
+    struct nl_worker* worker = &g_nl_worker;
+    struct nl_worker_rec_hdr* hdr = NULL;
+    uint64_t val;
+    uint64_t head = worker->head;
+    uint64_t tail;
+    int count = 0;
+
+    if (read(worker->event_fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+        return -errno;
+
+    tail = __atomic_load_n(&worker->tail, __ATOMIC_ACQUIRE);
+    while (head != tail && count < NL_WORKER_DRAIN_MAX)
+    {
+        hdr = (struct nl_worker_rec_hdr*)(worker->ring + (head & NL_WORKER_RING_MASK));
+        switch (hdr->type)
+        {
+            case NL_WORKER_REC_NEIGH:
+                do_one_neigh_rec((struct iccp_neigh_rec*)(hdr + 1));
+                SYSTEM_INCR_NETLINK_RING_REC_COUNTER(sys);
+                ++count;
+                break;
+
+            case NL_WORKER_REC_NLMSG:
+                iccp_route_event_input((struct nlmsghdr*)(hdr + 1));
+                SYSTEM_INCR_NETLINK_RING_REC_COUNTER(sys);
+                ++count;
+                break;
+
+            case NL_WORKER_REC_COUNTERS:
+                iccp_nl_worker_add_counters(sys, (struct nl_worker_counters*)(hdr + 1));
+                break;
+
+            case NL_WORKER_REC_RESYNC:
+                if (*(uint32_t*)(hdr + 1) == NL_WORKER_SOCK_NEIGH)
+                {
+                    sys->need_sync_neigh_again = 1;
+                    SYSTEM_INCR_NETLINK_NEIGH_OVERRUN_COUNTER(sys);
+                }
+                else
+                {
+                    sys->need_sync_netlink_again = 1;
+                    SYSTEM_INCR_NETLINK_LINK_OVERRUN_COUNTER(sys);
+                }
+                SYSTEM_INCR_NETLINK_RX_ERROR();
+                break;
+
+            default:
+                break;
+        }
+
+        head += NL_WORKER_REC_SIZE(hdr->len);
+        __atomic_store_n(&worker->head, head, __ATOMIC_RELEASE);
+    }
+
+    /* Leave the rest for the next loop, peer sockets are served first */
+    if (head != tail)
+    {
+        iccp_nl_worker_signal(worker);
+        return 0;
+    }
+
+    /* Get netlink info again when events were lost, once the events queued
+     * before the dump are applied so they cannot undo it
+     */
+    if (sys->need_sync_netlink_again || sys->need_sync_neigh_again)
+        iccp_netlink_sync_again();
+
+    return 0;
+}
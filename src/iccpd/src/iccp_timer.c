@@ -0,0 +1,316 @@
+/*
+ * iccp_timer.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "../include/iccp_timer.h"
+#include "../include/system.h"
+#include "../include/logger.h"
+
+#define ICCP_TIMER_LEVEL_SHIFT(n)   (ICCP_TIMER_ROOT_BITS + (n) * ICCP_TIMER_LEVEL_BITS)
+#define ICCP_TIMER_MAX_TICKS        ((uint64_t)1 << ICCP_TIMER_LEVEL_SHIFT(ICCP_TIMER_LEVEL_NUM))
+
+struct iccp_timer_wheel
+{
+    uint64_t tick;      /* next tick to run */
+    uint64_t armed;     /* tick the timerfd is armed for, 0 if disarmed */
+    uint32_t count;     /* pending timers */
+    int running;        /* expiring timers, timerfd is re-armed afterwards */
+
+    struct iccp_timer_list root[ICCP_TIMER_ROOT_SIZE];
+    struct iccp_timer_list level[ICCP_TIMER_LEVEL_NUM][ICCP_TIMER_LEVEL_SIZE];
+};
+
+static struct iccp_timer_wheel g_timer_wheel;
+
+uint64_t iccp_timer_now_msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t iccp_timer_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void iccp_timer_wheel_add(struct iccp_timer_wheel* wheel, struct iccp_timer* timer)
+{
+    struct iccp_timer_list* list = NULL;
+    uint64_t delta;
+    int n;
+
+    if (timer->expire <= wheel->tick)
+    {
+        /* Already due, run it on the next tick */
+        list = &wheel->root[wheel->tick & ICCP_TIMER_ROOT_MASK];
+    }
+    else if ((delta = timer->expire - wheel->tick) < ICCP_TIMER_ROOT_SIZE)
+    {
+        list = &wheel->root[timer->expire & ICCP_TIMER_ROOT_MASK];
+    }
+    else
+    {
+        if (delta >= ICCP_TIMER_MAX_TICKS)
+            timer->expire = wheel->tick + ICCP_TIMER_MAX_TICKS - 1;
+
+        for (n = 0; n < ICCP_TIMER_LEVEL_NUM - 1; ++n)
+        {
+            if (delta < ((uint64_t)1 << ICCP_TIMER_LEVEL_SHIFT(n + 1)))
+                break;
+        }
+        list = &wheel->level[n][(timer->expire >> ICCP_TIMER_LEVEL_SHIFT(n)) & ICCP_TIMER_LEVEL_MASK];
+    }
+
+    LIST_INSERT_HEAD(list, timer, next);
+
+    return;
+}
+
+/* Move the timers of the current slot of level n one level down */
+static int iccp_timer_cascade(struct iccp_timer_wheel* wheel, int n)
+{
+    struct iccp_timer* timer = NULL;
+    int index = (wheel->tick >> ICCP_TIMER_LEVEL_SHIFT(n)) & ICCP_TIMER_LEVEL_MASK;
+
+    while ((timer = LIST_FIRST(&wheel->level[n][index])) != NULL)
+    {
+        LIST_REMOVE(timer, next);
+        iccp_timer_wheel_add(wheel, timer);
+    }
+
+    return index;
+}
+
+static void iccp_timer_run_tick(struct iccp_timer_wheel* wheel)
+{
+    struct iccp_timer_list expired;
+    struct iccp_timer* timer = NULL;
+    int index = wheel->tick & ICCP_TIMER_ROOT_MASK;
+    int n;
+
+    if (index == 0)
+    {
+        for (n = 0; n < ICCP_TIMER_LEVEL_NUM; ++n)
+        {
+            if (iccp_timer_cascade(wheel, n) != 0)
+                break;
+        }
+    }
+
+    /* Detach the slot first, handlers may restart their own timer */
+    LIST_INIT(&expired);
+    while ((timer = LIST_FIRST(&wheel->root[index])) != NULL)
+    {
+        LIST_REMOVE(timer, next);
+        LIST_INSERT_HEAD(&expired, timer, next);
+    }
+    ++wheel->tick;
+
+    while ((timer = LIST_FIRST(&expired)) != NULL)
+    {
+        LIST_REMOVE(timer, next);
+        timer->next.le_prev = NULL;
+        --wheel->count;
+        SYSTEM_INCR_TIMER_EXPIRE_COUNTER(system_get_instance());
+
+        if (timer->handler)
+            timer->handler(timer->arg);
+    }
+
+    return;
+}
+
+/* First tick worth waking up for: the earliest non-empty slot of the root
+ * level, or the next cascade if it comes first.
+ */
+static uint64_t iccp_timer_wheel_next(struct iccp_timer_wheel* wheel)
+{
+    uint64_t tick;
+
+    if (wheel->count == 0)
+        return 0;
+
+    for (tick = wheel->tick; ; ++tick)
+    {
+        if (!LIST_EMPTY(&wheel->root[tick & ICCP_TIMER_ROOT_MASK]))
+            return tick;
+        if (((tick + 1) & ICCP_TIMER_ROOT_MASK) == 0)
+            return tick + 1;
+    }
+}
+
+static void iccp_timer_wheel_arm(struct iccp_timer_wheel* wheel, uint64_t expire)
+{
+    struct System* sys = NULL;
+    struct itimerspec its;
+    uint64_t msec;
+
+    if ((sys = system_get_instance()) == NULL || sys->timer_fd < 0)
+        return;
+
+    /* A zero it_value disarms the timerfd */
+    memset(&its, 0, sizeof(its));
+    if (expire)
+    {
+        msec = expire * ICCP_TIMER_TICK_MSEC;
+        its.it_value.tv_sec = msec / 1000;
+        its.it_value.tv_nsec = (msec % 1000) * 1000000;
+    }
+
+    if (timerfd_settime(sys->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Timerfd settime error %d", errno);
+        return;
+    }
+    wheel->armed = expire;
+
+    return;
+}
+
+void iccp_timer_init(struct iccp_timer* timer, iccp_timer_handler_t handler, void* arg)
+{
+    memset(timer, 0, sizeof(struct iccp_timer));
+    timer->handler = handler;
+    timer->arg = arg;
+
+    return;
+}
+
+/* (Re)start timer to fire msec from now */
+void iccp_timer_start(struct iccp_timer* timer, uint64_t msec)
+{
+    struct iccp_timer_wheel* wheel = &g_timer_wheel;
+    uint64_t now = iccp_timer_now_msec();
+
+    iccp_timer_stop(timer);
+
+    /* Nothing pending, the wheel may have been idle for a long time */
+    if (wheel->count == 0 && !wheel->running)
+        wheel->tick = now / ICCP_TIMER_TICK_MSEC;
+
+    /* Round up, a timer never fires early */
+    timer->expire = (now + msec + ICCP_TIMER_TICK_MSEC - 1) / ICCP_TIMER_TICK_MSEC;
+    iccp_timer_wheel_add(wheel, timer);
+    ++wheel->count;
+
+    if (!wheel->running && (wheel->armed == 0 || timer->expire < wheel->armed))
+        iccp_timer_wheel_arm(wheel, timer->expire);
+
+    return;
+}
+
+/* The timerfd is left armed, an early wakeup finds nothing to run */
+void iccp_timer_stop(struct iccp_timer* timer)
+{
+    if (!ICCP_TIMER_PENDING(timer))
+        return;
+
+    LIST_REMOVE(timer, next);
+    timer->next.le_prev = NULL;
+    --g_timer_wheel.count;
+
+    return;
+}
+
+int iccp_timer_wheel_init(struct System* sys)
+{
+    struct iccp_timer_wheel* wheel = &g_timer_wheel;
+    int i, n;
+
+    memset(wheel, 0, sizeof(struct iccp_timer_wheel));
+    for (i = 0; i < ICCP_TIMER_ROOT_SIZE; ++i)
+        LIST_INIT(&wheel->root[i]);
+    for (n = 0; n < ICCP_TIMER_LEVEL_NUM; ++n)
+    {
+        for (i = 0; i < ICCP_TIMER_LEVEL_SIZE; ++i)
+            LIST_INIT(&wheel->level[n][i]);
+    }
+    wheel->tick = iccp_timer_now_msec() / ICCP_TIMER_TICK_MSEC;
+
+    sys->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (sys->timer_fd < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Timerfd create error %d", errno);
+        return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
+void iccp_timer_wheel_finalize(struct System* sys)
+{
+    if (sys->timer_fd >= 0)
+        close(sys->timer_fd);
+    sys->timer_fd = -1;
+    g_timer_wheel.armed = 0;
+
+    return;
+}
+
+int iccp_get_timer_fd(struct System* sys)
+{
+    return sys->timer_fd;
+}
+
+/* Run every timer that is due, then re-arm the timerfd for the next one */
+int iccp_timer_wheel_handler(struct System* sys)
+{
+    struct iccp_timer_wheel* wheel = &g_timer_wheel;
+    uint64_t expirations;
+    uint64_t now;
+
+    if (read(sys->timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        return -errno;
+
+    SYSTEM_INCR_TIMER_WAKEUP_COUNTER(sys);
+    wheel->armed = 0;
+    wheel->running = 1;
+
+    now = iccp_timer_now_msec() / ICCP_TIMER_TICK_MSEC;
+    while (wheel->tick <= now)
+    {
+        if (wheel->count == 0)
+        {
+            wheel->tick = now + 1;
+            break;
+        }
+        iccp_timer_run_tick(wheel);
+    }
+
+    wheel->running = 0;
+    iccp_timer_wheel_arm(wheel, iccp_timer_wheel_next(wheel));
+
+    return 0;
+}
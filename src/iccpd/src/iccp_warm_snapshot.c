@@ -0,0 +1,692 @@
+/*
+ * iccp_warm_snapshot.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* On the way down for a warm reboot iccpd writes its MAC and neighbor tables
+ * to a snapshot file. After restart the tables of a domain are restored from
+ * it once mclagsyncd configures the domain, without touching the chip or the
+ * kernel. mclagsyncd and the kernel then replay their state, local entries
+ * nobody replayed are removed when the reconcile timer fires, counted from
+ * when mclagsyncd connects. Peer entries the peer did not resend are removed
+ * once the session enters EXCHANGE. Entries that did not change are not sent
+ * to the peer again, it kept them during the reboot.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include "../include/iccp_warm_snapshot.h"
+#include "../include/iccp_ifm.h"
+#include "../include/logger.h"
+#include "../include/mlacp_fsm.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/mlacp_sync_update.h"
+#include "../include/system.h"
+
+#define FNV1A_INIT  0x811c9dc5
+#define FNV1A_PRIME 0x01000193
+
+struct iccp_warm_buf
+{
+    char* data;
+    size_t len;
+    size_t size;
+};
+
+/* Snapshot loaded at start, mapped until the reconcile timer fires */
+struct iccp_warm_snapshot
+{
+    char* base;
+    size_t len;
+    time_t save_time;
+    struct iccp_timer reconcile_timer;
+};
+
+static struct iccp_warm_snapshot g_warm_snapshot;
+
+static uint32_t iccp_warm_checksum(const char* data, size_t len)
+{
+    uint32_t hash = FNV1A_INIT;
+    size_t i;
+
+    for (i = 0; i < len; ++i)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= FNV1A_PRIME;
+    }
+
+    return hash;
+}
+
+static void* iccp_warm_buf_append(struct iccp_warm_buf* buf, const void* data, size_t len)
+{
+    char* new_data = NULL;
+    size_t new_size;
+    void* dst = NULL;
+
+    if (buf->len + len > buf->size)
+    {
+        new_size = buf->size ? buf->size : 64 * 1024;
+        while (new_size < buf->len + len)
+            new_size *= 2;
+
+        if ((new_data = (char*)realloc(buf->data, new_size)) == NULL)
+            return NULL;
+        buf->data = new_data;
+        buf->size = new_size;
+    }
+
+    dst = buf->data + buf->len;
+    if (data)
+        memcpy(dst, data, len);
+    else
+        memset(dst, 0, len);
+    buf->len += len;
+
+    return dst;
+}
+
+/* Returns the offset of the section header, it is completed by the caller */
+static long iccp_warm_section_begin(struct iccp_warm_buf* buf, uint16_t type, uint16_t rec_len, int mlag_id)
+{
+    struct iccp_warm_section_hdr* sect = NULL;
+
+    if ((sect = iccp_warm_buf_append(buf, NULL, sizeof(struct iccp_warm_section_hdr))) == NULL)
+        return MCLAG_ERROR;
+
+    sect->type = type;
+    sect->rec_len = rec_len;
+    sect->mlag_id = mlag_id;
+
+    return (char*)sect - buf->data;
+}
+
+static int iccp_warm_save_csm(struct iccp_warm_buf* buf, struct CSM* csm, uint32_t* section_num)
+{
+    struct iccp_warm_domain_rec domain;
+    struct iccp_warm_mac_rec mac_rec;
+    struct MACMsg* mac_msg = NULL;
+    struct Msg* msg = NULL;
+    long offset;
+    uint32_t num;
+
+    memset(&domain, 0, sizeof(struct iccp_warm_domain_rec));
+    memcpy(domain.sender_ip, csm->sender_ip, INET_ADDRSTRLEN);
+    memcpy(domain.peer_ip, csm->peer_ip, INET_ADDRSTRLEN);
+    memcpy(domain.peer_itf_name, csm->peer_itf_name, IFNAMSIZ);
+    memcpy(domain.remote_system_id, MLACP(csm).remote_system.system_id, ETHER_ADDR_LEN);
+    domain.remote_system_priority = MLACP(csm).remote_system.system_priority;
+    domain.peer_sync_epoch = MLACP(csm).peer_sync_epoch;
+    domain.peer_sync_seq = MLACP(csm).peer_sync_seq;
+
+    if ((offset = iccp_warm_section_begin(buf, ICCP_WARM_SECTION_DOMAIN,
+                                          sizeof(struct iccp_warm_domain_rec), csm->mlag_id)) < 0
+        || !iccp_warm_buf_append(buf, &domain, sizeof(struct iccp_warm_domain_rec)))
+        return MCLAG_ERROR;
+    ((struct iccp_warm_section_hdr*)(buf->data + offset))->rec_num = 1;
+
+    if ((offset = iccp_warm_section_begin(buf, ICCP_WARM_SECTION_MAC,
+                                          sizeof(struct iccp_warm_mac_rec), csm->mlag_id)) < 0)
+        return MCLAG_ERROR;
+    num = 0;
+    RB_FOREACH (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+    {
+        memset(&mac_rec, 0, sizeof(struct iccp_warm_mac_rec));
+        mac_rec.vid = mac_msg->vid;
+        memcpy(mac_rec.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+        mac_rec.fdb_type = mac_msg->fdb_type;
+        mac_rec.age_flag = mac_msg->age_flag;
+        mac_rec.pending_local_del = mac_msg->pending_local_del;
+        mac_rec.add_to_syncd = mac_msg->add_to_syncd;
+        memcpy(mac_rec.ifname, mac_msg->ifname, MAX_L_PORT_NAME);
+        memcpy(mac_rec.origin_ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+
+        if (!iccp_warm_buf_append(buf, &mac_rec, sizeof(struct iccp_warm_mac_rec)))
+            return MCLAG_ERROR;
+        ++num;
+    }
+    ((struct iccp_warm_section_hdr*)(buf->data + offset))->rec_num = num;
+
+    if ((offset = iccp_warm_section_begin(buf, ICCP_WARM_SECTION_ARP,
+                                          sizeof(struct ARPMsg), csm->mlag_id)) < 0)
+        return MCLAG_ERROR;
+    num = 0;
+    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    {
+        if (!iccp_warm_buf_append(buf, msg->buf, sizeof(struct ARPMsg)))
+            return MCLAG_ERROR;
+        ++num;
+    }
+    ((struct iccp_warm_section_hdr*)(buf->data + offset))->rec_num = num;
+
+    if ((offset = iccp_warm_section_begin(buf, ICCP_WARM_SECTION_NDISC,
+                                          sizeof(struct NDISCMsg), csm->mlag_id)) < 0)
+        return MCLAG_ERROR;
+    num = 0;
+    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    {
+        if (!iccp_warm_buf_append(buf, msg->buf, sizeof(struct NDISCMsg)))
+            return MCLAG_ERROR;
+        ++num;
+    }
+    ((struct iccp_warm_section_hdr*)(buf->data + offset))->rec_num = num;
+
+    *section_num += 4;
+
+    return 0;
+}
+
+/* Write the snapshot next to its final name, then rename it in place so
+ * that a restart never sees a partial file.
+ */
+int iccp_warm_snapshot_save(struct System* sys)
+{
+    struct iccp_warm_snapshot_hdr* hdr = NULL;
+    struct iccp_warm_buf buf;
+    struct CSM* csm = NULL;
+    char tmp_path[PATH_MAX];
+    uint32_t section_num = 0;
+    size_t written = 0;
+    ssize_t ret;
+    int fd = -1;
+    int err = MCLAG_ERROR;
+
+    memset(&buf, 0, sizeof(struct iccp_warm_buf));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", sys->warm_snapshot_path);
+
+    if (!iccp_warm_buf_append(&buf, NULL, sizeof(struct iccp_warm_snapshot_hdr)))
+        goto out;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (iccp_warm_save_csm(&buf, csm, &section_num) < 0)
+        {
+            ICCPD_LOG_ERR(__FUNCTION__, "Warm snapshot of mclag %d failed, no memory", csm->mlag_id);
+            goto out;
+        }
+    }
+
+    hdr = (struct iccp_warm_snapshot_hdr*)buf.data;
+    hdr->magic = ICCP_WARM_SNAPSHOT_MAGIC;
+    hdr->version = ICCP_WARM_SNAPSHOT_VERSION;
+    hdr->hdr_len = sizeof(struct iccp_warm_snapshot_hdr);
+    hdr->len = buf.len;
+    hdr->save_time = time(NULL);
+    hdr->section_num = section_num;
+    hdr->checksum = iccp_warm_checksum(buf.data + hdr->hdr_len, buf.len - hdr->hdr_len);
+
+    if ((fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Open warm snapshot %s failed, errno %d", tmp_path, errno);
+        goto out;
+    }
+
+    while (written < buf.len)
+    {
+        ret = write(fd, buf.data + written, buf.len - written);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ICCPD_LOG_ERR(__FUNCTION__, "Write warm snapshot %s failed, errno %d", tmp_path, errno);
+            goto out;
+        }
+        written += ret;
+    }
+
+    if (fsync(fd) < 0 || close(fd) < 0)
+    {
+        fd = -1;
+        ICCPD_LOG_ERR(__FUNCTION__, "Flush warm snapshot %s failed, errno %d", tmp_path, errno);
+        goto out;
+    }
+    fd = -1;
+
+    if (rename(tmp_path, sys->warm_snapshot_path) < 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Rename warm snapshot to %s failed, errno %d", sys->warm_snapshot_path, errno);
+        goto out;
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm snapshot %s saved, %u sections, %zu bytes",
+                     sys->warm_snapshot_path, section_num, buf.len);
+    err = 0;
+
+ out:
+    if (fd >= 0)
+        close(fd);
+    if (err < 0)
+        unlink(tmp_path);
+    free(buf.data);
+
+    return err;
+}
+
+static struct iccp_warm_section_hdr* iccp_warm_section_next(struct iccp_warm_section_hdr* sect)
+{
+    char* next = NULL;
+
+    if (sect == NULL)
+        next = g_warm_snapshot.base + sizeof(struct iccp_warm_snapshot_hdr);
+    else
+        next = (char*)(sect + 1) + (size_t)sect->rec_len * sect->rec_num;
+
+    if (next >= g_warm_snapshot.base + g_warm_snapshot.len)
+        return NULL;
+
+    return (struct iccp_warm_section_hdr*)next;
+}
+
+static int iccp_warm_rec_len(uint16_t type)
+{
+    switch (type)
+    {
+        case ICCP_WARM_SECTION_DOMAIN:
+            return sizeof(struct iccp_warm_domain_rec);
+
+        case ICCP_WARM_SECTION_MAC:
+            return sizeof(struct iccp_warm_mac_rec);
+
+        case ICCP_WARM_SECTION_ARP:
+            return sizeof(struct ARPMsg);
+
+        case ICCP_WARM_SECTION_NDISC:
+            return sizeof(struct NDISCMsg);
+    }
+
+    return MCLAG_ERROR;
+}
+
+/* The whole file is checked before anything is restored from it */
+static int iccp_warm_snapshot_validate(const char* base, size_t len)
+{
+    const struct iccp_warm_snapshot_hdr* hdr = (const struct iccp_warm_snapshot_hdr*)base;
+    struct iccp_warm_section_hdr sect;
+    size_t offset;
+    uint32_t i;
+
+    if (len < sizeof(struct iccp_warm_snapshot_hdr))
+        return MCLAG_ERROR;
+
+    if (hdr->magic != ICCP_WARM_SNAPSHOT_MAGIC || hdr->version != ICCP_WARM_SNAPSHOT_VERSION
+        || hdr->hdr_len != sizeof(struct iccp_warm_snapshot_hdr) || hdr->len != len)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Warm snapshot magic 0x%x version %u len %u not supported",
+                       hdr->magic, hdr->version, hdr->len);
+        return MCLAG_ERROR;
+    }
+
+    if (hdr->checksum != iccp_warm_checksum(base + hdr->hdr_len, len - hdr->hdr_len))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Warm snapshot checksum mismatch");
+        return MCLAG_ERROR;
+    }
+
+    offset = hdr->hdr_len;
+    for (i = 0; i < hdr->section_num; ++i)
+    {
+        if (offset + sizeof(struct iccp_warm_section_hdr) > len)
+            return MCLAG_ERROR;
+
+        memcpy(&sect, base + offset, sizeof(struct iccp_warm_section_hdr));
+        if (iccp_warm_rec_len(sect.type) != sect.rec_len)
+            return MCLAG_ERROR;
+
+        offset += sizeof(struct iccp_warm_section_hdr);
+        if ((len - offset) / sect.rec_len < sect.rec_num)
+            return MCLAG_ERROR;
+        offset += (size_t)sect.rec_len * sect.rec_num;
+    }
+
+    return (offset == len) ? 0 : MCLAG_ERROR;
+}
+
+/* MACs learned here that mclagsyncd did not replay have aged out */
+static void iccp_warm_reconcile_mac(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL, *mac_temp = NULL;
+    char ifname[MAX_L_PORT_NAME];
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+    uint16_t vid;
+    uint8_t fdb_type;
+    int local_num = 0;
+
+    RB_FOREACH_SAFE (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    {
+        /* Peer MACs keep the mark until the peer has resynced */
+        if (!(mac_msg->warm_state & MAC_WARM_STALE) || (mac_msg->age_flag & MAC_AGE_LOCAL))
+            continue;
+        mac_msg->warm_state &= ~MAC_WARM_STALE;
+
+        /* The update handler frees the entry, work on a copy */
+        memcpy(mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+        memcpy(ifname, mac_msg->ifname, MAX_L_PORT_NAME);
+        vid = mac_msg->vid;
+        fdb_type = mac_msg->fdb_type;
+
+        do_mac_update_from_syncd(mac_addr, vid, ifname, fdb_type, MAC_SYNC_DEL);
+        ++local_num;
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm reconcile mclag %d: %d local stale MACs removed",
+                     csm->mlag_id, local_num);
+
+    return;
+}
+
+/* Entered EXCHANGE, the peer has resent its MACs or resumed from what it
+ * sent before. Restored peer MACs it did not send are gone.
+ */
+void iccp_warm_snapshot_peer_reconcile(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL, *mac_temp = NULL;
+    struct mLACPMACData mac_data;
+    int peer_num = 0;
+
+    if (!csm->warm_peer_stale)
+        return;
+    csm->warm_peer_stale = 0;
+
+    RB_FOREACH_SAFE (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    {
+        if (!(mac_msg->warm_state & MAC_WARM_STALE) || !(mac_msg->age_flag & MAC_AGE_LOCAL))
+            continue;
+        mac_msg->warm_state &= ~MAC_WARM_STALE;
+
+        memset(&mac_data, 0, sizeof(struct mLACPMACData));
+        mac_data.type = MAC_SYNC_DEL;
+        mac_data.mac_type = mac_msg->fdb_type;
+        memcpy(mac_data.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+        mac_data.vid = htons(mac_msg->vid);
+        memcpy(mac_data.ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+        mlacp_fsm_update_mac_entry_from_peer(csm, &mac_data);
+        ++peer_num;
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm reconcile mclag %d: %d peer stale MACs removed",
+                     csm->mlag_id, peer_num);
+
+    return;
+}
+
+static void iccp_warm_reconcile_timer_handler(void* arg)
+{
+    struct System* sys = (struct System*)arg;
+    struct CSM* csm = NULL;
+
+    /* mclagsyncd went away, the window starts over when it is back */
+    if (sys->sync_fd <= 0)
+        return;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        iccp_warm_reconcile_mac(csm);
+    }
+
+    /* Restored local neighbors missing from the kernel dump are swept */
+    iccp_neigh_resync();
+
+    munmap(g_warm_snapshot.base, g_warm_snapshot.len);
+    g_warm_snapshot.base = NULL;
+    g_warm_snapshot.len = 0;
+
+    return;
+}
+
+/* mclagsyncd replays the FDB once connected, give it the whole window */
+void iccp_warm_snapshot_syncd_connected(struct System* sys)
+{
+    if (g_warm_snapshot.base == NULL)
+        return;
+
+    iccp_timer_start(&g_warm_snapshot.reconcile_timer, ICCP_WARM_RECONCILE_MSEC);
+
+    return;
+}
+
+/* Map the snapshot of a warm restart. It is removed in any case, a later
+ * restart must not pick up state that old.
+ */
+int iccp_warm_snapshot_load(struct System* sys)
+{
+    struct stat st;
+    char* base = NULL;
+    int fd;
+
+    if (sys->warmboot_start != WARM_REBOOT)
+    {
+        unlink(sys->warm_snapshot_path);
+        return 0;
+    }
+
+    if ((fd = open(sys->warm_snapshot_path, O_RDONLY)) < 0)
+    {
+        ICCPD_LOG_NOTICE(__FUNCTION__, "No warm snapshot %s, errno %d", sys->warm_snapshot_path, errno);
+        return MCLAG_ERROR;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(struct iccp_warm_snapshot_hdr))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Warm snapshot %s is truncated", sys->warm_snapshot_path);
+        goto failed;
+    }
+
+    /* Private and writable, restored sections are marked in place */
+    base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Map warm snapshot %s failed, errno %d", sys->warm_snapshot_path, errno);
+        goto failed;
+    }
+
+    if (iccp_warm_snapshot_validate(base, st.st_size) < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Warm snapshot %s is invalid, ignored", sys->warm_snapshot_path);
+        munmap(base, st.st_size);
+        goto failed;
+    }
+
+    close(fd);
+    unlink(sys->warm_snapshot_path);
+
+    g_warm_snapshot.base = base;
+    g_warm_snapshot.len = st.st_size;
+    g_warm_snapshot.save_time = ((struct iccp_warm_snapshot_hdr*)base)->save_time;
+    /* Started once mclagsyncd connects */
+    iccp_timer_init(&g_warm_snapshot.reconcile_timer, iccp_warm_reconcile_timer_handler, sys);
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm snapshot %s loaded, saved %ld seconds ago",
+                     sys->warm_snapshot_path, (long)(time(NULL) - g_warm_snapshot.save_time));
+
+    return 0;
+
+ failed:
+    close(fd);
+    unlink(sys->warm_snapshot_path);
+
+    return MCLAG_ERROR;
+}
+
+static void iccp_warm_restore_mac(struct CSM* csm, struct iccp_warm_section_hdr* sect)
+{
+    struct iccp_warm_mac_rec rec;
+    struct MACMsg mac_data;
+    struct MACMsg* mac_msg = NULL;
+    char* data = (char*)(sect + 1);
+    uint32_t i;
+
+    for (i = 0; i < sect->rec_num; ++i)
+    {
+        memcpy(&rec, data + (size_t)i * sect->rec_len, sizeof(struct iccp_warm_mac_rec));
+
+        memset(&mac_data, 0, sizeof(struct MACMsg));
+        mac_data.vid = rec.vid;
+        memcpy(mac_data.mac_addr, rec.mac_addr, ETHER_ADDR_LEN);
+        if (RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb, &mac_data))
+            continue;
+
+        mac_data.op_type = MAC_SYNC_ADD;
+        mac_data.fdb_type = rec.fdb_type;
+        mac_data.age_flag = rec.age_flag;
+        mac_data.pending_local_del = rec.pending_local_del;
+        mac_data.add_to_syncd = rec.add_to_syncd;
+        memcpy(mac_data.ifname, rec.ifname, MAX_L_PORT_NAME);
+        memcpy(mac_data.origin_ifname, rec.origin_ifname, MAX_L_PORT_NAME);
+        mac_data.warm_state = MAC_WARM_RESTORED | MAC_WARM_STALE;
+        if (rec.age_flag & MAC_AGE_LOCAL)
+            csm->warm_peer_stale = 1;
+
+        /* Still programmed in the chip, only the table is rebuilt */
+        if (iccp_csm_init_mac_msg(&mac_msg, (char*)&mac_data, sizeof(struct MACMsg)) == 0)
+        {
+            RB_INSERT(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+            mlacp_mac_index_add(csm, mac_msg);
+        }
+    }
+
+    return;
+}
+
+static void iccp_warm_restore_neigh(struct CSM* csm, struct iccp_warm_section_hdr* sect)
+{
+    struct ARPMsg arp_msg, *arp_info = NULL;
+    struct NDISCMsg ndisc_msg, *ndisc_info = NULL;
+    struct Msg* msg = NULL;
+    char* data = (char*)(sect + 1);
+    uint32_t i;
+
+    for (i = 0; i < sect->rec_num; ++i)
+    {
+        if (sect->type == ICCP_WARM_SECTION_ARP)
+        {
+            memcpy(&arp_msg, data + (size_t)i * sect->rec_len, sizeof(struct ARPMsg));
+            LIST_FOREACH(msg, ARP_HASH_HEAD(csm, arp_msg.ipv4_addr), hash_next)
+            {
+                arp_info = (struct ARPMsg*)msg->buf;
+                if (arp_info->ipv4_addr == arp_msg.ipv4_addr)
+                    break;
+            }
+            if (msg || iccp_csm_init_msg(&msg, (char*)&arp_msg, sizeof(struct ARPMsg)) != 0)
+                continue;
+            msg->warm_restored = 1;
+            mlacp_enqueue_arp(csm, msg);
+        }
+        else
+        {
+            memcpy(&ndisc_msg, data + (size_t)i * sect->rec_len, sizeof(struct NDISCMsg));
+            LIST_FOREACH(msg, NDISC_HASH_HEAD(csm, ndisc_msg.ipv6_addr), hash_next)
+            {
+                ndisc_info = (struct NDISCMsg*)msg->buf;
+                if (memcmp(ndisc_info->ipv6_addr, ndisc_msg.ipv6_addr, sizeof(ndisc_msg.ipv6_addr)) == 0)
+                    break;
+            }
+            if (msg || iccp_csm_init_msg(&msg, (char*)&ndisc_msg, sizeof(struct NDISCMsg)) != 0)
+                continue;
+            msg->warm_restored = 1;
+            mlacp_enqueue_ndisc(csm, msg);
+        }
+    }
+
+    return;
+}
+
+/* Called once mclagsyncd has configured the domain */
+void iccp_warm_snapshot_restore(struct CSM* csm)
+{
+    struct iccp_warm_section_hdr* sect = NULL;
+    struct iccp_warm_domain_rec domain;
+    int found = 0;
+
+    if (csm == NULL || g_warm_snapshot.base == NULL)
+        return;
+
+    while ((sect = iccp_warm_section_next(sect)) != NULL)
+    {
+        if (sect->mlag_id != csm->mlag_id || sect->type != ICCP_WARM_SECTION_DOMAIN)
+            continue;
+
+        memcpy(&domain, sect + 1, sizeof(struct iccp_warm_domain_rec));
+        found = 1;
+        break;
+    }
+
+    if (!found)
+        return;
+
+    /* The tables belong to another session if the endpoints changed */
+    if (strncmp(domain.sender_ip, csm->sender_ip, INET_ADDRSTRLEN) != 0
+        || strncmp(domain.peer_ip, csm->peer_ip, INET_ADDRSTRLEN) != 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Warm snapshot of mclag %d is for %s -> %s, ignored",
+                       csm->mlag_id, domain.sender_ip, domain.peer_ip);
+        found = 0;
+    }
+
+    sect = NULL;
+    while ((sect = iccp_warm_section_next(sect)) != NULL)
+    {
+        if (sect->mlag_id != csm->mlag_id)
+            continue;
+
+        if (found)
+        {
+            if (sect->type == ICCP_WARM_SECTION_MAC)
+                iccp_warm_restore_mac(csm, sect);
+            else if (sect->type == ICCP_WARM_SECTION_ARP || sect->type == ICCP_WARM_SECTION_NDISC)
+                iccp_warm_restore_neigh(csm, sect);
+        }
+
+        /* Restored once, a domain re-created later starts empty */
+        sect->mlag_id = -1;
+    }
+
+    if (!found)
+        return;
+
+    csm->warm_snapshot_time = g_warm_snapshot.save_time;
+    /* The peer's entries came back, it may resync only what changed */
+    MLACP(csm).peer_sync_epoch = domain.peer_sync_epoch;
+    MLACP(csm).peer_sync_seq = domain.peer_sync_seq;
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm snapshot of mclag %d restored, peer %s system %s",
+                     csm->mlag_id, domain.peer_ip, mac_addr_to_str(domain.remote_system_id));
+
+    return;
+}
+
+/* Whether the peer still holds what this node had before the warm reboot.
+ * It waits WARM_REBOOT_TIMEOUT for the session to come back, then treats
+ * the reboot as a cold one.
+ */
+int iccp_warm_snapshot_peer_synced(struct CSM* csm)
+{
+    return csm->warm_snapshot_time != 0
+           && time(NULL) - csm->warm_snapshot_time < WARM_REBOOT_TIMEOUT;
+}
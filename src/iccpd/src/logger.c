@@ -23,7 +23,14 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include "../include/cmd_option.h"
 #include "../include/logger.h"
@@ -38,6 +45,39 @@ static uint32_t _iccpd_log_level_map[] =
     LOG_DEBUG
 };
 
+struct LoggerConfig g_logger_config =
+{
+    .console_log_enabled = 0,
+    .log_level = NOTICE_LOG_LEVEL,
+    .init = 1
+};
+
+/* Bounded multi-producer single-consumer queue, a producer owns slot
+ * (pos & mask) while seq == pos and publishes it with seq = pos + 1,
+ * the writer hands it back with seq = pos + LOG_RING_SIZE.
+ */
+struct LogRingSlot
+{
+    uint32_t seq;
+    uint8_t level;
+    char msg[LOGBUF_SIZE];
+};
+
+struct LogRing
+{
+    struct LogRingSlot* slots;
+    uint32_t head;          /* next slot to reserve, shared by producers */
+    uint32_t tail;          /* next slot to write, writer thread only */
+    uint32_t dropped;
+    uint32_t waiting;       /* writer is about to sleep, needs a kick */
+    int event_fd;
+    int stop;
+    int started;
+    pthread_t thread;
+};
+
+static struct LogRing log_ring = { .event_fd = -1 };
+
 char* log_level_to_string(int level)
 {
     switch (level)
@@ -66,16 +106,7 @@ char* log_level_to_string(int level)
 
 struct LoggerConfig* logger_get_configuration()
 {
-    static struct LoggerConfig config;
-
-    if (config.init == 0)
-    {
-        config.console_log_enabled = 0;
-        config.log_level = NOTICE_LOG_LEVEL;
-        config.init = 1;
-    }
-
-    return &config;
+    return &g_logger_config;
 }
 
 void logger_set_configuration(int log_level)
@@ -88,53 +119,243 @@ void logger_set_configuration(int log_level)
     return;
 }
 
+static int log_format(char* buf, int level, const char* tag, const char* format, va_list args)
+{
+    unsigned int   prefix_len;
+    unsigned int   avbl_buf_len;
+    unsigned int   print_len;
+
+    prefix_len = snprintf(buf, LOGBUF_SIZE, "[%s.%s] ", tag, log_level_to_string(level));
+    if (prefix_len >= LOGBUF_SIZE)
+        return LOGBUF_SIZE - 1;
+    avbl_buf_len = LOGBUF_SIZE - prefix_len;
+
+    print_len = vsnprintf(buf + prefix_len, avbl_buf_len, format, args);
+
+    /* Since osal_vsnprintf doesn't always return the exact size written to the buffer,
+     * we must check if the user string length exceeds the remaing buffer size.
+     */
+    if (print_len >= avbl_buf_len)
+    {
+        print_len = avbl_buf_len - 1;
+    }
+
+    buf[prefix_len + print_len] = '\0';
+
+    return prefix_len + print_len;
+}
+
+static struct LogRingSlot* log_ring_reserve()
+{
+    struct LogRingSlot* slot;
+    uint32_t pos, seq;
+    int32_t diff;
+
+    pos = __atomic_load_n(&log_ring.head, __ATOMIC_RELAXED);
+    while (1)
+    {
+        slot = &log_ring.slots[pos & (LOG_RING_SIZE - 1)];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        diff = (int32_t)(seq - pos);
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&log_ring.head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                return slot;
+        }
+        else if (diff < 0)
+        {
+            /* Writer is a full ring behind */
+            return NULL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&log_ring.head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void log_ring_kick()
+{
+    uint64_t one = 1;
+
+    if (write(log_ring.event_fd, &one, sizeof(one)) < 0)
+        return;
+}
+
+static void log_ring_publish(struct LogRingSlot* slot)
+{
+    __atomic_store_n(&slot->seq, __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+
+    /* A lost kick only delays the writer until its poll timeout */
+    if (__atomic_exchange_n(&log_ring.waiting, 0, __ATOMIC_SEQ_CST))
+        log_ring_kick();
+}
+
+/* Write everything published so far, returns the number of messages */
+static int log_ring_drain()
+{
+    struct LogRingSlot* slot;
+    uint32_t dropped;
+    int count = 0;
+
+    while (1)
+    {
+        slot = &log_ring.slots[log_ring.tail & (LOG_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != log_ring.tail + 1)
+            break;
+
+        ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[slot->level], "%s", slot->msg);
+
+        __atomic_store_n(&slot->seq, log_ring.tail + LOG_RING_SIZE, __ATOMIC_RELEASE);
+        log_ring.tail++;
+        count++;
+    }
+
+    dropped = __atomic_exchange_n(&log_ring.dropped, 0, __ATOMIC_RELAXED);
+    if (dropped)
+        ICCPD_UTILS_SYSLOG(LOG_WARNING, "[%s.%s] %u log messages dropped, ring full",
+                           __FUNCTION__, log_level_to_string(WARN_LOG_LEVEL), dropped);
+
+    return count;
+}
+
+static void* log_ring_writer(void* arg)
+{
+    struct pollfd pfd;
+    sigset_t sigset;
+    uint64_t count;
+
+    /* Signals are handled by the main thread */
+    sigfillset(&sigset);
+    pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+    pfd.fd = log_ring.event_fd;
+    pfd.events = POLLIN;
+
+    while (!__atomic_load_n(&log_ring.stop, __ATOMIC_ACQUIRE))
+    {
+        if (log_ring_drain() > 0)
+            continue;
+
+        /* Ask for a kick, then look again so a message published
+         * before the flag was seen is not left behind until the timeout.
+         */
+        __atomic_store_n(&log_ring.waiting, 1, __ATOMIC_SEQ_CST);
+        if (log_ring_drain() > 0)
+            continue;
+
+        if (poll(&pfd, 1, 1000) > 0)
+        {
+            if (read(log_ring.event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+                break;
+        }
+    }
+
+    log_ring_drain();
+
+    return NULL;
+}
+
+static int log_ring_start()
+{
+    uint32_t i;
+    int err;
+
+    log_ring.slots = (struct LogRingSlot*)malloc(sizeof(struct LogRingSlot) * LOG_RING_SIZE);
+    if (!log_ring.slots)
+        return -1;
+
+    for (i = 0; i < LOG_RING_SIZE; ++i)
+        log_ring.slots[i].seq = i;
+    log_ring.head = 0;
+    log_ring.tail = 0;
+    log_ring.dropped = 0;
+    log_ring.waiting = 0;
+    log_ring.stop = 0;
+
+    log_ring.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (log_ring.event_fd < 0)
+        goto err;
+
+    err = pthread_create(&log_ring.thread, NULL, log_ring_writer, NULL);
+    if (err != 0)
+        goto err;
+
+    __atomic_store_n(&log_ring.started, 1, __ATOMIC_RELEASE);
+
+    return 0;
+
+ err:
+    if (log_ring.event_fd >= 0)
+        close(log_ring.event_fd);
+    log_ring.event_fd = -1;
+    free(log_ring.slots);
+    log_ring.slots = NULL;
+
+    return -1;
+}
+
 void log_init(struct CmdOptionParser* parser)
 {
     struct LoggerConfig* config = logger_get_configuration();
 
     config->console_log_enabled = parser->console_log;
+
+    /* Without the writer thread messages go to syslog directly */
+    if (log_ring_start() < 0)
+        ICCPD_LOG_WARN(__FUNCTION__, "Log writer thread start error, logging synchronously");
 }
 
 void log_finalize()
 {
-    /*do nothing*/
+    if (!__atomic_load_n(&log_ring.started, __ATOMIC_ACQUIRE))
+        return;
+
+    /* Later messages go to syslog directly, the writer flushes the rest */
+    __atomic_store_n(&log_ring.started, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&log_ring.stop, 1, __ATOMIC_RELEASE);
+    log_ring_kick();
+    pthread_join(log_ring.thread, NULL);
+
+    close(log_ring.event_fd);
+    log_ring.event_fd = -1;
+    free(log_ring.slots);
+    log_ring.slots = NULL;
 }
 
 void write_log(int level, const char* tag, const char* format, ...)
 {
-    struct LoggerConfig* config = logger_get_configuration();
+    struct LogRingSlot* slot;
     char buf[LOGBUF_SIZE];
     va_list args;
-    unsigned int   prefix_len;
-    unsigned int   avbl_buf_len;
-    unsigned int   print_len;
 
-#if 0
-    if (!config->console_log_enabled)
+    if (level > g_logger_config.log_level)
         return;
-#endif
 
-    if (level > config->log_level)
+    /* Critical messages usually come right before exit, keep them synchronous */
+    if (level == CRITICAL_LOG_LEVEL || !__atomic_load_n(&log_ring.started, __ATOMIC_ACQUIRE))
+    {
+        va_start(args, format);
+        log_format(buf, level, tag, format, args);
+        va_end(args);
+        ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[level], "%s", buf);
         return;
+    }
 
-    prefix_len = snprintf(buf, LOGBUF_SIZE, "[%s.%s] ", tag, log_level_to_string(level));
-    avbl_buf_len = LOGBUF_SIZE - prefix_len;
-
-    va_start(args, format);
-    print_len = vsnprintf(buf + prefix_len, avbl_buf_len, format, args);
-    va_end(args);
-
-    /* Since osal_vsnprintf doesn't always return the exact size written to the buffer,
-     * we must check if the user string length exceeds the remaing buffer size.
-     */
-    if (print_len > avbl_buf_len)
+    slot = log_ring_reserve();
+    if (!slot)
     {
-        print_len = avbl_buf_len;
+        __atomic_fetch_add(&log_ring.dropped, 1, __ATOMIC_RELAXED);
+        return;
     }
 
-    buf[prefix_len + print_len] = '\0';
-    ICCPD_UTILS_SYSLOG(_iccpd_log_level_map[level], "%s", buf);
+    slot->level = level;
+    va_start(args, format);
+    log_format(slot->msg, level, tag, format, args);
+    va_end(args);
+    log_ring_publish(slot);
 
     return;
 }
-
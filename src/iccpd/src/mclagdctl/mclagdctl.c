@@ -25,6 +25,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
 #include <getopt.h>
 #include <errno.h>
 #include <sys/socket.h>
@@ -37,16 +38,21 @@
 
 static int mclagdctl_sock_fd = -1;
 char *mclagdctl_sock_path = "/var/run/iccpd/mclagdctl.sock";
+/* 0 waits for ever, a watch stream can stay quiet for long */
+static int mclagdctl_read_timeout_sec = 10;
+static int mclagdctl_watch_json = 0;
 
 /*
    Already implemented command:
    mclagdctl -i dump state
    mclagdctl -i dump arp
    mclagdctl -i dump nd
-   mclagdctl -i dump mac
+   mclagdctl -i dump mac [vlan <vid>] [port <ifname>] [age local|peer|none] [page <size>]
    mclagdctl -i dump unique_ip
    mclagdctl -i dump portlist local
    mclagdctl -i dump portlist peer
+   mclagdctl dump debug latency
+   mclagdctl [-i id] watch [json]
  */
 
 #define ETHER_ADDR_LEN 6
@@ -143,6 +149,14 @@ static struct command_type command_types[] =
         .enca_msg = mclagdctl_enca_dump_dbg_counters,
         .parse_msg = mclagdctl_parse_dump_dbg_counters,
     },
+    {
+        .id = ID_CMDTYPE_D_D_L,
+        .parent_id = ID_CMDTYPE_D_D,
+        .info_type = INFO_TYPE_DUMP_LATENCY,
+        .name = "latency",
+        .enca_msg = mclagdctl_enca_dump_latency,
+        .parse_msg = mclagdctl_parse_dump_latency,
+    },
     {
         .id = ID_CMDTYPE_C,
         .name = "config",
@@ -157,6 +171,13 @@ static struct command_type command_types[] =
         .enca_msg = mclagdctl_enca_config_loglevel,
         .parse_msg = mclagdctl_parse_config_loglevel,
     },
+    {
+        .id = ID_CMDTYPE_W,
+        .info_type = INFO_TYPE_WATCH,
+        .name = "watch",
+        .enca_msg = mclagdctl_enca_watch,
+        .parse_msg = mclagdctl_parse_watch,
+    },
 };
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
@@ -235,10 +256,10 @@ int mclagdctl_sock_read(int fd, unsigned char *r_buf, int total_len)
     {
         FD_ZERO(&read_fd);
         FD_SET(fd, &read_fd);
-        tv.tv_sec = 10;
+        tv.tv_sec = mclagdctl_read_timeout_sec;
         tv.tv_usec = 0;
 
-        switch ((ret = select(fd + 1, &read_fd, NULL, NULL, &tv)))
+        switch ((ret = select(fd + 1, &read_fd, NULL, NULL, mclagdctl_read_timeout_sec ? &tv : NULL)))
         {
             case -1:    // error
                 fprintf(stdout, "Mclagdctl:Select return error:%s\n", strerror(errno));
@@ -451,6 +472,7 @@ int mclagdctl_parse_dump_ndisc(char *msg, int data_len)
 int mclagdctl_enca_dump_mac(char *msg, int mclag_id, int argc, char **argv)
 {
     struct mclagdctl_req_hdr req;
+    int i;
 
     if (mclag_id <= 0)
     {
@@ -461,6 +483,43 @@ int mclagdctl_enca_dump_mac(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_MAC;
     req.mclag_id = mclag_id;
+
+    /* Optional filters, as keyword value pairs */
+    for (i = 0; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "vlan") == 0)
+            req.filter_vid = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "port") == 0)
+            snprintf(req.filter_ifname, sizeof(req.filter_ifname), "%s", argv[i + 1]);
+        else if (strcmp(argv[i], "page") == 0)
+            req.page_size = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "age") == 0)
+        {
+            if (strcmp(argv[i + 1], "local") == 0)
+                req.filter_age = MCLAGD_DUMP_AGE_LOCAL;
+            else if (strcmp(argv[i + 1], "peer") == 0)
+                req.filter_age = MCLAGD_DUMP_AGE_PEER;
+            else if (strcmp(argv[i + 1], "none") == 0)
+                req.filter_age = MCLAGD_DUMP_AGE_NONE;
+            else
+            {
+                fprintf(stderr, "Unknown age filter \"%s\", use local, peer or none\n", argv[i + 1]);
+                return MCLAG_ERROR;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Unknown mac filter \"%s\"\n", argv[i]);
+            return MCLAG_ERROR;
+        }
+    }
+
+    if (i < argc)
+    {
+        fprintf(stderr, "Missing value for mac filter \"%s\"\n", argv[i]);
+        return MCLAG_ERROR;
+    }
+
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
@@ -471,17 +530,23 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
     struct mclagd_mac_msg * mac_info = NULL;
     int len = 0;
     int count = 0;
+    /* Called once per page, numbering goes on across pages */
+    static int printed = -1;
 
-    fprintf(stdout, "%-60s\n", "TYPE: S-STATIC, D-DYNAMIC; AGE: L-Local age, P-Peer age");
-
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-5s", "TYPE");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-5s", "VID");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "%-20s", "ORIGIN-DEV");
-    fprintf(stdout, "%-5s", "AGE");
-    fprintf(stdout, "\n");
+    if (printed < 0)
+    {
+        fprintf(stdout, "%-60s\n", "TYPE: S-STATIC, D-DYNAMIC; AGE: L-Local age, P-Peer age");
+
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-5s", "TYPE");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-5s", "VID");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "%-20s", "ORIGIN-DEV");
+        fprintf(stdout, "%-5s", "AGE");
+        fprintf(stdout, "\n");
+        printed = 0;
+    }
 
     len = sizeof(struct mclagd_mac_msg);
 
@@ -489,7 +554,7 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
     {
         mac_info = (struct mclagd_mac_msg*)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        fprintf(stdout, "%-6d", ++printed);
 
         if (mac_info->fdb_type == MAC_TYPE_STATIC_CTL)
             fprintf(stdout, "%-5s", "S");
@@ -575,6 +640,15 @@ int mclagdctl_parse_dump_local_portlist(char *msg, int data_len)
             fprintf(stdout, "%s: %s\n", "IsIsolateWithPeerlink", lif_info->isolate_to_peer_link ? "Yes" : "No");
             fprintf(stdout,"%s: %s\n" ,"IsTrafficDisable", lif_info->is_traffic_disable ? "Yes":"No");
             fprintf(stdout, "%s: %s\n", "VlanList", lif_info->vlanlist);
+            fprintf(stdout, "%s: %s\n", "Consistency", lif_info->consistency);
+            if (lif_info->consistency_time)
+            {
+                time_t change_time = lif_info->consistency_time;
+                char time_str[32];
+
+                strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&change_time));
+                fprintf(stdout, "%s: %s\n", "ConsistencyChanged", time_str);
+            }
         }
         else
         {
@@ -756,6 +830,8 @@ static char *mclagdctl_dbg_counter_iccpid2str(ICCP_DBG_CNTR_MSG_e iccp_cntr_id)
             return "Warmboot";
         case ICCP_DBG_CNTR_MSG_IF_UP_ACK:
             return "IfUpAck";
+        case ICCP_DBG_CNTR_MSG_SYNC_RESUME:
+            return "SyncResume";
         default:
             return "Unknown";
     }
@@ -820,6 +896,8 @@ static char *mclagdctl_dbg_counter_syncdrx2str(SYNCD_RX_DBG_CNTR_MSG_e syncdrx_i
             return "CfgMclagUniqueIp";
         case SYNCD_RX_DBG_CNTR_MSG_VLAN_MBR_UPDATES:
             return "vlanMbrshipChange";
+        case SYNCD_RX_DBG_CNTR_MSG_CAPABILITY:
+            return "Capability";
         default:
             return "Unknown";
     }
@@ -860,6 +938,56 @@ int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len)
         sys_counter_p->socket_close_err_counter);
     fprintf(stdout, "%-20s%u\n", "Socket cleanup:",
         sys_counter_p->socket_cleanup_counter);
+    fprintf(stdout, "%-20s%u\n", "MAC entry alloc:",
+        sys_counter_p->mac_entry_alloc_counter);
+    fprintf(stdout, "%-20s%u\n", "MAC entry free:",
+        sys_counter_p->mac_entry_free_counter);
+    fprintf(stdout, "%-20s%u\n", "Msg entry alloc:",
+        sys_counter_p->msg_entry_alloc_counter);
+    fprintf(stdout, "%-20s%u\n", "Msg entry free:",
+        sys_counter_p->msg_entry_free_counter);
+    fprintf(stdout, "%-20s%u\n", "Msg buf overflow:",
+        sys_counter_p->msg_buf_overflow_counter);
+    fprintf(stdout, "%-20s%u\n", "Pool slab alloc:",
+        sys_counter_p->mem_pool_slab_alloc_counter);
+    fprintf(stdout, "%-20s%u\n", "Pool slab free:",
+        sys_counter_p->mem_pool_slab_free_counter);
+    fprintf(stdout, "%-20s%u\n", "Pool alloc fail:",
+        sys_counter_p->mem_pool_alloc_fail_counter);
+    fprintf(stdout, "%-20s%u\n", "Msg pool in use:",
+        sys_counter_p->msg_pool_in_use);
+    fprintf(stdout, "%-20s%u\n", "Msg pool max:",
+        sys_counter_p->msg_pool_in_use_max);
+    fprintf(stdout, "%-20s%u\n", "MAC pool in use:",
+        sys_counter_p->mac_msg_pool_in_use);
+    fprintf(stdout, "%-20s%u\n", "MAC pool max:",
+        sys_counter_p->mac_msg_pool_in_use_max);
+    fprintf(stdout, "%-20s%u\n", "Syncd FDB batch:",
+        sys_counter_p->syncd_fdb_batch_msg_counter);
+    fprintf(stdout, "%-20s%u\n", "Syncd FDB entry ok:",
+        sys_counter_p->syncd_fdb_entry_ok_counter);
+    fprintf(stdout, "%-20s%u\n", "Syncd FDB entry err:",
+        sys_counter_p->syncd_fdb_entry_err_counter);
+    fprintf(stdout, "%-20s%u\n", "Syncd FDB coalesce:",
+        sys_counter_p->syncd_fdb_coalesce_counter);
+    fprintf(stdout, "%-20s%u\n", "Timer wakeup:",
+        sys_counter_p->timer_wakeup_counter);
+    fprintf(stdout, "%-20s%u\n", "Timer expire:",
+        sys_counter_p->timer_expire_counter);
+    fprintf(stdout, "%-20s%u\n", "Netlink ring rec:",
+        sys_counter_p->netlink_ring_rec_counter);
+    fprintf(stdout, "%-20s%u\n", "Netlink ring full:",
+        sys_counter_p->netlink_ring_full_counter);
+    fprintf(stdout, "%-20s%u\n", "Link sock overrun:",
+        sys_counter_p->netlink_link_overrun_counter);
+    fprintf(stdout, "%-20s%u\n", "Neigh sock overrun:",
+        sys_counter_p->netlink_neigh_overrun_counter);
+    fprintf(stdout, "%-20s%u\n", "Link resync:",
+        sys_counter_p->netlink_link_resync_counter);
+    fprintf(stdout, "%-20s%u\n", "Neigh resync:",
+        sys_counter_p->netlink_neigh_resync_counter);
+    fprintf(stdout, "%-20s%u\n", "Resync stale:",
+        sys_counter_p->netlink_resync_stale_counter);
 
     fprintf(stdout, "\n");
     fprintf(stdout, "%-20s%u\n\n", "Warmboot:", sys_counter_p->warmboot_counter);
@@ -906,6 +1034,19 @@ int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len)
                 iccp_counter_p->iccp_counters[j][1][1]);
         }
         fprintf(stdout, "\n");
+        fprintf(stdout, "%-20s%u\n", "Tx queue depth:",
+            iccp_counter_p->tx_queue_depth);
+        fprintf(stdout, "%-20s%u\n", "Tx queue max:",
+            iccp_counter_p->tx_queue_max_depth);
+        fprintf(stdout, "%-20s%u\n", "Tx queue pause:",
+            iccp_counter_p->tx_queue_pause_count);
+        fprintf(stdout, "%-20s%u\n", "Tx queue drop:",
+            iccp_counter_p->tx_queue_drop_count);
+        fprintf(stdout, "%-20s%u\n", "Resync full:",
+            iccp_counter_p->resync_full_count);
+        fprintf(stdout, "%-20s%u\n", "Resync delta:",
+            iccp_counter_p->resync_delta_count);
+        fprintf(stdout, "\n");
     }
     /* Netlink counters */
     fprintf(stdout, "\nNetlink Counters\n");
@@ -924,6 +1065,92 @@ int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len)
     return 0;
 }
 
+int mclagdctl_enca_dump_latency(char *msg, int mclag_id, int argc, char **argv)
+{
+    struct mclagdctl_req_hdr req;
+
+    memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
+    req.info_type = INFO_TYPE_DUMP_LATENCY;
+    req.mclag_id = mclag_id;
+    memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
+
+    return 1;
+}
+
+static char *mclagdctl_latency_type2str(SYSTEM_LATENCY_TYPE_e type)
+{
+    switch (type)
+    {
+        case LATENCY_MAC_TO_PEER:
+            return "MAC to peer";
+        case LATENCY_MAC_TO_SYNCD:
+            return "MAC to syncd";
+        case LATENCY_ARP_TO_PEER:
+            return "ARP to peer";
+        case LATENCY_ND_TO_PEER:
+            return "ND to peer";
+        case LATENCY_PO_STATE_TO_PEER:
+            return "PO state to peer";
+        case LATENCY_HEARTBEAT_INTERVAL:
+            return "Heartbeat interval";
+        default:
+            return "Unknown";
+    }
+}
+
+/* Upper bound of the bucket holding the given percentile, the
+ * histogram does not keep finer resolution than that */
+static uint64_t mclagdctl_latency_percentile(system_latency_hist_t *hist, int percent)
+{
+    uint64_t rank, sum = 0;
+    uint64_t bound;
+    int i;
+
+    if (hist->count == 0)
+        return 0;
+
+    rank = (hist->count * percent + 99) / 100;
+    for (i = 0; i < LATENCY_HIST_BUCKET_NUM - 1; ++i)
+    {
+        sum += hist->buckets[i];
+        if (sum >= rank)
+            break;
+    }
+
+    bound = (i == LATENCY_HIST_BUCKET_NUM - 1) ? hist->max_usec : ((uint64_t)1 << i);
+    return (bound < hist->max_usec) ? bound : hist->max_usec;
+}
+
+int mclagdctl_parse_dump_latency(char *msg, int data_len)
+{
+    system_latency_info_t *latency_p;
+    system_latency_hist_t *hist;
+    int i;
+
+    if (data_len < sizeof(system_latency_info_t))
+        return MCLAG_ERROR;
+
+    latency_p = (system_latency_info_t *)msg;
+
+    fprintf(stdout, "%-20s%-12s%-12s%-12s%-12s%-12s\n",
+        "Latency (us)", "Count", "Avg", "P50", "P99", "Max");
+    fprintf(stdout, "%-20s%-12s%-12s%-12s%-12s%-12s\n",
+        "------------", "-----", "---", "---", "---", "---");
+    for (i = 0; i < LATENCY_TYPE_MAX; ++i)
+    {
+        hist = &latency_p->hist[i];
+        fprintf(stdout, "%-20s%-12lu%-12lu%-12lu%-12lu%-12lu\n",
+            mclagdctl_latency_type2str(i),
+            hist->count,
+            hist->count ? hist->sum_usec / hist->count : 0,
+            mclagdctl_latency_percentile(hist, 50),
+            mclagdctl_latency_percentile(hist, 99),
+            hist->max_usec);
+    }
+
+    return 0;
+}
+
 int mclagdctl_enca_config_loglevel(char *msg, int log_level,  int argc, char **argv)
 {
     struct mclagdctl_req_hdr req;
@@ -949,6 +1176,177 @@ int mclagdctl_parse_config_loglevel(char *msg, int data_len)
     return 0;
 }
 
+int mclagdctl_enca_watch(char *msg, int mclag_id, int argc, char **argv)
+{
+    struct mclagdctl_req_hdr req;
+
+    if (argc > 0)
+    {
+        if (strcmp(argv[0], "json") != 0)
+        {
+            fprintf(stderr, "Unknown watch option \"%s\", use json\n", argv[0]);
+            return MCLAG_ERROR;
+        }
+        mclagdctl_watch_json = 1;
+    }
+
+    memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
+    req.info_type = INFO_TYPE_WATCH;
+    req.mclag_id = mclag_id;
+    memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
+
+    mclagdctl_read_timeout_sec = 0;
+
+    return 1;
+}
+
+static char *mclagdctl_watch_type2str(uint8_t type)
+{
+    switch (type)
+    {
+        case MCLAGD_WATCH_MAC:
+            return "mac";
+
+        case MCLAGD_WATCH_ARP:
+            return "arp";
+
+        case MCLAGD_WATCH_NDISC:
+            return "nd";
+
+        case MCLAGD_WATCH_PORTCHANNEL:
+            return "portchannel";
+
+        case MCLAGD_WATCH_SESSION:
+            return "session";
+
+        case MCLAGD_WATCH_SYNCED:
+            return "synced";
+
+        case MCLAGD_WATCH_OVERFLOW:
+            return "overflow";
+
+        default:
+            break;
+    }
+
+    return "unknown";
+}
+
+static char *mclagdctl_watch_op2str(uint8_t op)
+{
+    switch (op)
+    {
+        case MCLAGD_WATCH_OP_ADD:
+            return "add";
+
+        case MCLAGD_WATCH_OP_DEL:
+            return "del";
+
+        case MCLAGD_WATCH_OP_UP:
+            return "up";
+
+        case MCLAGD_WATCH_OP_DOWN:
+            return "down";
+
+        default:
+            break;
+    }
+
+    return "-";
+}
+
+int mclagdctl_parse_watch(char *msg, int data_len)
+{
+    struct mclagd_watch_event *ev = NULL;
+
+    if (data_len < sizeof(struct mclagd_watch_event))
+        return MCLAG_ERROR;
+
+    ev = (struct mclagd_watch_event *)msg;
+    ev->ifname[sizeof(ev->ifname) - 1] = '\0';
+    ev->origin_ifname[sizeof(ev->origin_ifname) - 1] = '\0';
+    ev->ip_addr[sizeof(ev->ip_addr) - 1] = '\0';
+
+    if (mclagdctl_watch_json)
+    {
+        fprintf(stdout, "{\"seq\":%llu,\"time\":%lld,\"mclag_id\":%d,\"type\":\"%s\",\"op\":\"%s\"",
+            (unsigned long long)ev->seq, (long long)ev->time, ev->mclag_id,
+            mclagdctl_watch_type2str(ev->type), mclagdctl_watch_op2str(ev->op));
+
+        switch (ev->type)
+        {
+            case MCLAGD_WATCH_MAC:
+                fprintf(stdout, ",\"vlan\":%d,\"mac\":\"%s\",\"fdb_type\":\"%s\",\"port\":\"%s\",\"origin_port\":\"%s\",\"age\":\"%s%s\"",
+                    ev->vid, mac_addr_to_str(ev->mac_addr), ev->fdb_type == MAC_TYPE_STATIC ? "static" : "dynamic",
+                    ev->ifname, ev->origin_ifname,
+                    (ev->flag & MAC_AGE_LOCAL) ? "L" : "", (ev->flag & MAC_AGE_PEER) ? "P" : "");
+                break;
+
+            case MCLAGD_WATCH_ARP:
+            case MCLAGD_WATCH_NDISC:
+                fprintf(stdout, ",\"ip\":\"%s\",\"mac\":\"%s\",\"port\":\"%s\",\"learn\":\"%s\"",
+                    ev->ip_addr, mac_addr_to_str(ev->mac_addr), ev->ifname, ev->flag ? "remote" : "local");
+                break;
+
+            case MCLAGD_WATCH_PORTCHANNEL:
+                fprintf(stdout, ",\"port\":\"%s\",\"side\":\"%s\"", ev->ifname, ev->flag ? "peer" : "local");
+                break;
+
+            case MCLAGD_WATCH_SESSION:
+                fprintf(stdout, ",\"peer_ip\":\"%s\"", ev->ip_addr);
+                break;
+
+            case MCLAGD_WATCH_OVERFLOW:
+                fprintf(stdout, ",\"lost\":%u", ev->lost);
+                break;
+
+            default:
+                break;
+        }
+        fprintf(stdout, "}\n");
+    }
+    else
+    {
+        fprintf(stdout, "%-10llu %-4d %-12s %-5s", (unsigned long long)ev->seq, ev->mclag_id,
+            mclagdctl_watch_type2str(ev->type), mclagdctl_watch_op2str(ev->op));
+
+        switch (ev->type)
+        {
+            case MCLAGD_WATCH_MAC:
+                fprintf(stdout, " vlan %d %s %s port %s origin %s age %s%s",
+                    ev->vid, mac_addr_to_str(ev->mac_addr), ev->fdb_type == MAC_TYPE_STATIC ? "static" : "dynamic",
+                    ev->ifname, ev->origin_ifname,
+                    (ev->flag & MAC_AGE_LOCAL) ? "L" : "", (ev->flag & MAC_AGE_PEER) ? "P" : "");
+                break;
+
+            case MCLAGD_WATCH_ARP:
+            case MCLAGD_WATCH_NDISC:
+                fprintf(stdout, " %s %s port %s %s",
+                    ev->ip_addr, mac_addr_to_str(ev->mac_addr), ev->ifname, ev->flag ? "remote" : "local");
+                break;
+
+            case MCLAGD_WATCH_PORTCHANNEL:
+                fprintf(stdout, " %s %s", ev->flag ? "peer" : "local", ev->ifname);
+                break;
+
+            case MCLAGD_WATCH_SESSION:
+                fprintf(stdout, " peer %s", ev->ip_addr);
+                break;
+
+            case MCLAGD_WATCH_OVERFLOW:
+                fprintf(stdout, " %u records lost", ev->lost);
+                break;
+
+            default:
+                break;
+        }
+        fprintf(stdout, "\n");
+    }
+    fflush(stdout);
+
+    return 0;
+}
+
 static bool __mclagdctl_cmd_executable(struct command_type *cmd_type)
 {
     if (!cmd_type->enca_msg || !cmd_type->parse_msg)
@@ -1020,7 +1418,10 @@ static int mclagdctl_find_cmd(struct command_type **pcmd_type, int *argc, char *
             return -EINVAL;
         }
 
-        if (__mclagdctl_cmd_executable(cmd_type) && __mclagdctl_cmd_param_cnt(cmd_type) >= *argc)
+        /* Words left that are not a sub command are the command's own options */
+        if (__mclagdctl_cmd_executable(cmd_type)
+            && (__mclagdctl_cmd_param_cnt(cmd_type) >= *argc
+                || !__mclagdctl_get_cmd_by_parent(*argv[0], cmd_type->id)))
         {
             *pcmd_type = cmd_type;
             return 0;
@@ -1081,6 +1482,11 @@ static void mclagdctl_print_help(const char *argv0)
         for (j = 0; cmd_type->params[j]; j++)
             fprintf(stdout, " %s", cmd_type->params[j]);
 
+        if (cmd_type->info_type == INFO_TYPE_DUMP_MAC)
+            fprintf(stdout, " [vlan <vid>] [port <ifname>] [age local|peer|none] [page <size>]");
+        else if (cmd_type->info_type == INFO_TYPE_WATCH)
+            fprintf(stdout, " [json]");
+
         fprintf(stdout, "\n");
     }
 }
@@ -1106,6 +1512,7 @@ int main(int argc, char **argv)
     int len = 0;
     char *data;
     struct mclagd_reply_hdr *reply;
+    struct mclagdctl_req_hdr req;
 
     while ((opt = getopt_long(argc, argv, "hi:l:", long_options, NULL)) >= 0)
     {
@@ -1195,7 +1602,10 @@ int main(int argc, char **argv)
         goto mclagdctl_disconnect;
     }
 
-    ret = mclagdctl_sock_write(mclagdctl_sock_fd, buf, sizeof(struct mclagdctl_req_hdr));
+    memcpy(&req, buf, sizeof(struct mclagdctl_req_hdr));
+
+ next_page:
+    ret = mclagdctl_sock_write(mclagdctl_sock_fd, (char *)&req, sizeof(struct mclagdctl_req_hdr));
 
     if (ret <= 0)
     {
@@ -1205,6 +1615,7 @@ int main(int argc, char **argv)
     }
 
     /*read data length*/
+ next_record:
     memset(buf, 0, MCLAGDCTL_CMD_SIZE);
     ret = mclagdctl_sock_read(mclagdctl_sock_fd, buf, sizeof(int));
     if (ret <= 0)
@@ -1270,6 +1681,23 @@ int main(int argc, char **argv)
 
     cmd_type->parse_msg((char *)(rcv_buf + sizeof(struct mclagd_reply_hdr)), len - sizeof(struct mclagd_reply_hdr));
 
+    /* Watch, records keep coming until the daemon or the user stops it */
+    if (reply->info_type == INFO_TYPE_WATCH)
+    {
+        free(rcv_buf);
+        rcv_buf = NULL;
+        goto next_record;
+    }
+
+    /* Paged dump, ask for the next page where this one stopped */
+    if (reply->more)
+    {
+        memcpy(&req.cursor, &reply->cursor, sizeof(struct mclagd_dump_cursor));
+        free(rcv_buf);
+        rcv_buf = NULL;
+        goto next_page;
+    }
+
     ret = EXIT_SUCCESS;
 
  mclagdctl_disconnect:
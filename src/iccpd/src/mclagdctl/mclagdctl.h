@@ -60,9 +60,11 @@ enum id_command_type
     ID_CMDTYPE_D_P_P,
     ID_CMDTYPE_D_D,
     ID_CMDTYPE_D_D_C,
+    ID_CMDTYPE_D_D_L,
     ID_CMDTYPE_C,
     ID_CMDTYPE_C_L,
     ID_CMDTYPE_C_D,
+    ID_CMDTYPE_W,
 };
 
 enum mclagdctl_notify_peer_type
@@ -78,6 +80,8 @@ enum mclagdctl_notify_peer_type
     INFO_TYPE_DUMP_DBG_COUNTERS,
     INFO_TYPE_CONFIG_LOGLEVEL,
     INFO_TYPE_CONFIG_DOWN,
+    INFO_TYPE_DUMP_LATENCY,
+    INFO_TYPE_WATCH,
     INFO_TYPE_FINISH,
 };
 
@@ -91,6 +95,26 @@ enum log_level_type
     DEBUG = 5
 };
 
+/* Entries per page of a paged dump (mac) */
+#define MCLAGD_DUMP_PAGE_SIZE 1024
+#define MCLAGD_DUMP_PAGE_MAX  8192
+
+enum mclagd_dump_age_filter
+{
+    MCLAGD_DUMP_AGE_ANY = 0,
+    MCLAGD_DUMP_AGE_LOCAL,  /* aged out in local switch */
+    MCLAGD_DUMP_AGE_PEER,   /* aged out in peer switch */
+    MCLAGD_DUMP_AGE_NONE,   /* not aged anywhere */
+};
+
+/* Where a paged dump resumes, handed back by the client unchanged */
+struct mclagd_dump_cursor
+{
+    int mclag_id;           /* 0 starts from the first mclag */
+    unsigned short vid;
+    unsigned char mac_addr[ETHER_ADDR_LEN];
+};
+
 struct mclagdctl_req_hdr
 {
     int info_type;
@@ -98,6 +122,13 @@ struct mclagdctl_req_hdr
     char para1[MCLAGDCTL_PARA2_LEN];
     char para2[MCLAGDCTL_PARA2_LEN];
     char para3[MCLAGDCTL_PARA2_LEN];
+
+    /* Paged dump, zero for the first page of an unfiltered dump */
+    struct mclagd_dump_cursor cursor;
+    int page_size;
+    int filter_vid;
+    int filter_age;         /* enum mclagd_dump_age_filter */
+    char filter_ifname[MCLAGDCTL_MAX_L_PORT_NANE];
 };
 
 struct mclagd_reply_hdr
@@ -105,6 +136,8 @@ struct mclagd_reply_hdr
     int info_type;
     int data_len;
     int exec_result;
+    int more;               /* paged dump: request again from cursor */
+    struct mclagd_dump_cursor cursor;
 };
 
 #define EXEC_TYPE_SUCCESS  -1
@@ -198,6 +231,8 @@ struct mclagd_local_if
     unsigned char isolate_to_peer_link;
     bool is_traffic_disable;
     char vlanlist[MCLAGDCTL_PARA3_LEN];
+    char consistency[MCLAGDCTL_PARA2_LEN];
+    int64_t consistency_time;   /* when the consistency result last changed, 0 if never checked */
 };
 
 struct mclagd_peer_if
@@ -226,6 +261,46 @@ struct mclagd_unique_ip_if
     char name[MCLAGDCTL_MAX_L_PORT_NANE];
 };
 
+/* Watch: after a WATCH request the client gets a snapshot of the current
+ * state as records, a MCLAGD_WATCH_SYNCED record, then one record per
+ * change. Change records may already come in between snapshot records.
+ * Every record is a reply of its own carrying one event. */
+enum mclagd_watch_type
+{
+    MCLAGD_WATCH_MAC = 1,
+    MCLAGD_WATCH_ARP,
+    MCLAGD_WATCH_NDISC,
+    MCLAGD_WATCH_PORTCHANNEL,
+    MCLAGD_WATCH_SESSION,
+    MCLAGD_WATCH_SYNCED,        /* snapshot done */
+    MCLAGD_WATCH_OVERFLOW,      /* lost records were dropped, resubscribe */
+};
+
+enum mclagd_watch_op
+{
+    MCLAGD_WATCH_OP_ADD = 1,    /* added or changed, the record has the new state */
+    MCLAGD_WATCH_OP_DEL,
+    MCLAGD_WATCH_OP_UP,
+    MCLAGD_WATCH_OP_DOWN,
+};
+
+struct mclagd_watch_event
+{
+    uint64_t seq;               /* per client, a gap means records were dropped */
+    int64_t time;               /* wall clock seconds */
+    int mclag_id;
+    uint32_t lost;              /* MCLAGD_WATCH_OVERFLOW only */
+    uint8_t type;               /* enum mclagd_watch_type */
+    uint8_t op;                 /* enum mclagd_watch_op */
+    uint8_t flag;               /* MAC age flag, neighbor learn flag, 1 for a peer port-channel */
+    uint8_t fdb_type;
+    unsigned short vid;
+    unsigned char mac_addr[MCLAGDCTL_ETHER_ADDR_LEN];
+    char ifname[MCLAGDCTL_MAX_L_PORT_NANE];
+    char origin_ifname[MCLAGDCTL_MAX_L_PORT_NANE];
+    char ip_addr[MCLAGDCTL_INET6_ADDR_LEN]; /* neighbor address, peer address of a session */
+};
+
 extern int mclagdctl_enca_dump_state(char *msg, int mclag_id,  int argc, char **argv);
 extern int mclagdctl_parse_dump_state(char *msg, int data_len);
 extern int mclagdctl_enca_dump_arp(char *msg, int mclag_id, int argc, char **argv);
@@ -240,8 +315,12 @@ extern int mclagdctl_enca_dump_peer_portlist(char *msg, int mclag_id,  int argc,
 extern int mclagdctl_parse_dump_peer_portlist(char *msg, int data_len);
 int mclagdctl_enca_config_loglevel(char *msg, int log_level,  int argc, char **argv);
 int mclagdctl_parse_config_loglevel(char *msg, int data_len);
+int mclagdctl_enca_watch(char *msg, int mclag_id, int argc, char **argv);
+int mclagdctl_parse_watch(char *msg, int data_len);
 
 extern int mclagdctl_enca_dump_dbg_counters(char *msg, int mclag_id, int argc, char **argv);
 extern int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len);
+extern int mclagdctl_enca_dump_latency(char *msg, int mclag_id, int argc, char **argv);
+extern int mclagdctl_parse_dump_latency(char *msg, int data_len);
 extern int mclagdctl_enca_dump_unique_ip(char *msg, int mclag_id, int argc, char **argv);
 extern int mclagdctl_parse_dump_unique_ip(char *msg, int data_len);
@@ -42,6 +42,9 @@
 #include "../include/mlacp_sync_update.h"
 #include "../include/system.h"
 #include "../include/scheduler.h"
+#include "../include/iccp_warm_snapshot.h"
+#include "../include/mlacp_sync_log.h"
+#include "mclagdctl/mclagdctl.h"
 
 #include <signal.h>
 
@@ -55,8 +58,7 @@
         while (!TAILQ_EMPTY(&(list))) { \
             msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), msg, tail); \
-            free(msg->buf); \
-            free(msg); \
+            iccp_csm_free_msg(msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
@@ -68,7 +70,7 @@
             mac_msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), mac_msg, tail); \
             if (mac_msg->op_type == MAC_SYNC_DEL) \
-                free(mac_msg); \
+                iccp_csm_free_mac_msg(mac_msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
@@ -94,6 +96,7 @@
                     lif->is_arp_accept = 0; \
             } \
             LIST_REMOVE (lif, mlacp_next); \
+            local_if_clear_dirty(lif); \
         } \
         LIST_INIT(&(list)); \
     }
@@ -134,7 +137,6 @@ static int MACMsg_compare(const struct MACMsg *mac1, const struct MACMsg *mac2)
 
 RB_GENERATE(mac_rb_tree, MACMsg, mac_entry_rb, MACMsg_compare);
 
-#define WARM_REBOOT_TIMEOUT 90
 #define PEER_REBOOT_TIMEOUT 300
 
 /*****************************************
@@ -165,6 +167,7 @@ static void mlacp_sync_recv_portChanInfo(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_peerLlinkInfo(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_arpInfo(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_stpInfo(struct CSM* csm, struct Msg* msg);
+static void mlacp_sync_recv_syncResume(struct CSM* csm, struct Msg* msg);
 
 /* Sync Handler*/
 static void mlacp_sync_send_nak_handler(struct CSM* csm,  struct Msg* msg);
@@ -249,14 +252,27 @@ static void mlacp_sync_send_aggState(struct CSM* csm)
             msg_len = mlacp_prepare_for_Aggport_state(csm, g_csm_buf, CSM_BUFFER_SIZE, local_if);
             iccp_csm_send(csm, g_csm_buf, msg_len);
             local_if->changed = 0;
+            system_latency_record(LATENCY_PO_STATE_TO_PEER, &local_if->changed_stamp);
             /*ICCPD_LOG_DEBUG("mlacp_fsm", "  [SYNC_Send] PortChannel, csm-if-name=[%s], len=[%d]", local_if->name, msg_len);*/
         }
     }
 
     return;
 }
-#define MAX_MAC_ENTRY_NUM 30
-#define MAX_NEIGH_ENTRY_NUM 40
+/* MAC/ARP/ND info is batched by size, a message is flushed when the next
+ * entry would not fit. The peer reads a whole message into a CSM_BUFFER_SIZE
+ * buffer and the LDP message length is 16 bits.
+ */
+#define MLACP_SYNC_MSG_MAX_LEN \
+    ((CSM_BUFFER_SIZE < 0xFFFF) ? CSM_BUFFER_SIZE : 0xFFFF)
+#define MLACP_SYNC_MAX_ENTRY_NUM(tlv_type, entry_type) \
+    ((int)((MLACP_SYNC_MSG_MAX_LEN - sizeof(ICCHdr) - sizeof(tlv_type)) / sizeof(entry_type)))
+#define MAX_MAC_ENTRY_NUM \
+    MLACP_SYNC_MAX_ENTRY_NUM(struct mLACPMACInfoTLV, struct mLACPMACData)
+#define MAX_ARP_ENTRY_NUM \
+    MLACP_SYNC_MAX_ENTRY_NUM(struct mLACPARPInfoTLV, struct ARPMsg)
+#define MAX_NDISC_ENTRY_NUM \
+    MLACP_SYNC_MAX_ENTRY_NUM(struct mLACPNDISCInfoTLV, struct NDISCMsg)
 static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
 {
     int msg_len = 0;
@@ -264,6 +280,10 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
     struct MACMsg mac_find;
     int count = 0;
 
+    /* Peer is not keeping up, leave the entries queued */
+    if (ICCP_CSM_TX_PAUSED(csm))
+        return;
+
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
     memset(&mac_find, 0, sizeof(struct MACMsg));
 
@@ -274,6 +294,8 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
 
         msg_len = mlacp_prepare_for_mac_info_to_peer(csm, g_csm_buf, CSM_BUFFER_SIZE, mac_msg, count);
         count++;
+        system_latency_record(LATENCY_MAC_TO_PEER, &mac_msg->peer_tx_stamp);
+        mlacp_sync_log_mac_sent(csm, mac_msg);
 
         //free mac_msg if marked for delete.
         if (mac_msg->op_type == MAC_SYNC_DEL)
@@ -285,15 +307,21 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
                 mac_find.vid = mac_msg->vid ;
                 memcpy(mac_find.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
                 if (!RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb ,&mac_find))
-                    free(mac_msg);
+                    iccp_csm_free_mac_msg(mac_msg);
             }
         }
 
         if (count >= MAX_MAC_ENTRY_NUM)
         {
-            iccp_csm_send(csm, g_csm_buf, msg_len);
+            /* more to come, let the kernel coalesce the segments */
+            if (TAILQ_EMPTY(&(MLACP(csm).mac_msg_list)))
+                iccp_csm_send(csm, g_csm_buf, msg_len);
+            else
+                iccp_csm_send_more(csm, g_csm_buf, msg_len);
             count = 0;
             memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
+            if (ICCP_CSM_TX_PAUSED(csm))
+                break;
         }
         /*ICCPD_LOG_DEBUG("mlacp_fsm", "  [SYNC_Send] MacInfo,len=[%d]", msg_len);*/
     }
@@ -310,6 +338,10 @@ static void mlacp_sync_send_syncArpInfo(struct CSM* csm)
     struct Msg* msg = NULL;
     int count = 0;
 
+    /* Peer is not keeping up, leave the entries queued */
+    if (ICCP_CSM_TX_PAUSED(csm))
+        return;
+
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
 
     while (!TAILQ_EMPTY(&(MLACP(csm).arp_msg_list)))
@@ -319,13 +351,19 @@ static void mlacp_sync_send_syncArpInfo(struct CSM* csm)
 
         msg_len = mlacp_prepare_for_arp_info(csm, g_csm_buf, CSM_BUFFER_SIZE, (struct ARPMsg*)msg->buf, count, NEIGH_SYNC_CLIENT_IP);
         count++;
-        free(msg->buf);
-        free(msg);
-        if (count >= MAX_NEIGH_ENTRY_NUM)
+        system_latency_record(LATENCY_ARP_TO_PEER, &msg->lat_stamp);
+        mlacp_sync_log_arp_sent(csm, (struct ARPMsg*)msg->buf);
+        iccp_csm_free_msg(msg);
+        if (count >= MAX_ARP_ENTRY_NUM)
         {
-            iccp_csm_send(csm, g_csm_buf, msg_len);
+            if (TAILQ_EMPTY(&(MLACP(csm).arp_msg_list)))
+                iccp_csm_send(csm, g_csm_buf, msg_len);
+            else
+                iccp_csm_send_more(csm, g_csm_buf, msg_len);
             count = 0;
             memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
+            if (ICCP_CSM_TX_PAUSED(csm))
+                break;
         }
         /*ICCPD_LOG_DEBUG("mlacp_fsm", "  [SYNC_Send] ArpInfo,len=[%d]", msg_len);*/
     }
@@ -342,6 +380,10 @@ static void mlacp_sync_send_syncNdiscInfo(struct CSM *csm)
     struct Msg *msg = NULL;
     int count = 0;
 
+    /* Peer is not keeping up, leave the entries queued */
+    if (ICCP_CSM_TX_PAUSED(csm))
+        return;
+
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
 
     while (!TAILQ_EMPTY(&(MLACP(csm).ndisc_msg_list)))
@@ -351,13 +393,19 @@ static void mlacp_sync_send_syncNdiscInfo(struct CSM *csm)
 
         msg_len = mlacp_prepare_for_ndisc_info(csm, g_csm_buf, CSM_BUFFER_SIZE, (struct NDISCMsg *)msg->buf, count, NEIGH_SYNC_CLIENT_IP);
         count++;
-        free(msg->buf);
-        free(msg);
-        if (count >= MAX_NEIGH_ENTRY_NUM)
+        system_latency_record(LATENCY_ND_TO_PEER, &msg->lat_stamp);
+        mlacp_sync_log_ndisc_sent(csm, (struct NDISCMsg *)msg->buf);
+        iccp_csm_free_msg(msg);
+        if (count >= MAX_NDISC_ENTRY_NUM)
         {
-            iccp_csm_send(csm, g_csm_buf, msg_len);
+            if (TAILQ_EMPTY(&(MLACP(csm).ndisc_msg_list)))
+                iccp_csm_send(csm, g_csm_buf, msg_len);
+            else
+                iccp_csm_send_more(csm, g_csm_buf, msg_len);
             count = 0;
             memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
+            if (ICCP_CSM_TX_PAUSED(csm))
+                break;
         }
         /* ICCPD_LOG_DEBUG("mlacp_fsm", " [SYNC_Send] NDInfo,len=[%d]", msg_len); */
     }
@@ -414,14 +462,23 @@ static void mlacp_sync_send_heartbeat(struct CSM* csm)
 {
     int msg_len = 0;
 
-    if ((csm->heartbeat_send_time == 0) ||
-        ((time(NULL) - csm->heartbeat_send_time) > csm->keepalive_time))
-    {
-        memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
-        msg_len = mlacp_prepare_for_heartbeat(csm, g_csm_buf, CSM_BUFFER_SIZE);
-        iccp_csm_send(csm, g_csm_buf, msg_len);
-        time(&csm->heartbeat_send_time);
-    }
+    memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
+    msg_len = mlacp_prepare_for_heartbeat(csm, g_csm_buf, CSM_BUFFER_SIZE);
+    iccp_csm_send(csm, g_csm_buf, msg_len);
+    iccp_timer_start(&csm->heartbeat_timer, (uint64_t)csm->keepalive_time * 1000);
+
+    return;
+}
+
+/* Keepalive expired, the timer is not re-armed once the session is down */
+void mlacp_heartbeat_timer_handler(void* arg)
+{
+    struct CSM* csm = (struct CSM*)arg;
+
+    if (csm->sock_fd <= 0 || csm->app_csm.current_state != APP_OPERATIONAL)
+        return;
+
+    mlacp_sync_send_heartbeat(csm);
 
     return;
 }
@@ -444,6 +501,74 @@ static void mlacp_sync_send_syncDoneData(struct CSM* csm)
  * Sync Receiver APIs
  *
  *****************************************************************/
+/* Fixed part of each TLV, the receiver drops anything shorter */
+static size_t mlacp_sync_recv_min_len(uint16_t type)
+{
+    switch (type)
+    {
+        case TLV_T_MLACP_SYSTEM_CONFIG:
+            return sizeof(mLACPSysConfigTLV);
+
+        case TLV_T_MLACP_AGGREGATOR_CONFIG:
+            return sizeof(mLACPAggConfigTLV);
+
+        case TLV_T_MLACP_AGGREGATOR_STATE:
+            return sizeof(mLACPAggPortStateTLV);
+
+        case TLV_T_MLACP_SYNC_DATA:
+            return sizeof(mLACPSyncDataTLV);
+
+        case TLV_T_MLACP_SYNC_REQUEST:
+            return sizeof(mLACPSyncReqTLV);
+
+        case TLV_T_MLACP_PORT_CHANNEL_INFO:
+            return sizeof(mLACPPortChannelInfoTLV);
+
+        case TLV_T_MLACP_PEERLINK_INFO:
+            return sizeof(mLACPPeerLinkInfoTLV);
+
+        case TLV_T_MLACP_MAC_INFO:
+            return sizeof(struct mLACPMACInfoTLV);
+
+        case TLV_T_MLACP_ARP_INFO:
+            return sizeof(struct mLACPARPInfoTLV);
+
+        case TLV_T_MLACP_NDISC_INFO:
+            return sizeof(struct mLACPNDISCInfoTLV);
+
+        case TLV_T_MLACP_HEARTBEAT:
+            return sizeof(struct mLACPHeartbeatTLV);
+
+        case TLV_T_MLACP_WARMBOOT_FLAG:
+            return sizeof(struct mLACPWarmbootTLV);
+
+        case TLV_T_MLACP_IF_UP_ACK:
+            return sizeof(struct mLACPIfUpAckTLV);
+
+        case TLV_T_MLACP_SYNC_RESUME:
+            return sizeof(struct mLACPSyncResumeTLV);
+
+        default:
+            return sizeof(ICCParameter);
+    }
+}
+
+/* Check that num entries of entry_len behind a TLV of fixed_len are in msg */
+static int mlacp_sync_recv_entries_fit(struct CSM* csm, struct Msg* msg,
+                                       size_t fixed_len, size_t entry_len, uint16_t num)
+{
+    ICCParameter *icc_param = (ICCParameter*)&(msg->buf[sizeof(ICCHdr)]);
+
+    if ((size_t)msg->len >= sizeof(ICCHdr) + fixed_len + (size_t)num * entry_len)
+        return 1;
+
+    ICCPD_LOG_WARN("ICCP_FSM", "RX %s with %u entries overruns msg len %d, drop",
+        get_tlv_type_string(icc_param->type), num, msg->len);
+    MLACP_SET_ICCP_RX_DBG_COUNTER(csm, icc_param->type, ICCP_DBG_CNTR_STS_ERR);
+
+    return 0;
+}
+
 static void mlacp_sync_recv_sysConf(struct CSM* csm, struct Msg* msg)
 {
     mLACPSysConfigTLV* sysconf = NULL;
@@ -490,6 +615,7 @@ static void mlacp_sync_recv_aggConf(struct CSM* csm, struct Msg* msg)
     mLACPAggConfigTLV* portconf = NULL;
 
     portconf = (mLACPAggConfigTLV*)&(msg->buf[sizeof(ICCHdr)]);
+    portconf->agg_name[MAX_L_PORT_NAME - 1] = '\0';
     if (mlacp_fsm_update_Agg_conf(csm, portconf) == MCLAG_ERROR)
     {
         mlacp_sync_send_nak_handler(csm, msg);
@@ -577,6 +703,10 @@ static void mlacp_sync_recv_portChanInfo(struct CSM* csm, struct Msg* msg)
     mLACPPortChannelInfoTLV* portconf = NULL;
 
     portconf = (mLACPPortChannelInfoTLV*)&(msg->buf[sizeof(ICCHdr)]);
+    if (!mlacp_sync_recv_entries_fit(csm, msg, sizeof(mLACPPortChannelInfoTLV),
+                                     sizeof(struct mLACPVLANData), ntohs(portconf->num_of_vlan_id)))
+        return;
+    portconf->if_name[MAX_L_PORT_NAME - 1] = '\0';
     if (mlacp_fsm_update_port_channel_info(csm, portconf) == MCLAG_ERROR)
     {
         mlacp_sync_send_nak_handler(csm, msg);
@@ -597,6 +727,7 @@ static void mlacp_sync_recv_peerLlinkInfo(struct CSM* csm, struct Msg* msg)
     mLACPPeerLinkInfoTLV* peerlink = NULL;
 
     peerlink = (mLACPPeerLinkInfoTLV*)&(msg->buf[sizeof(ICCHdr)]);
+    peerlink->if_name[MAX_L_PORT_NAME - 1] = '\0';
     mlacp_fsm_update_peerlink_info( csm, peerlink);
     MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
         peerlink->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
@@ -606,10 +737,18 @@ static void mlacp_sync_recv_peerLlinkInfo(struct CSM* csm, struct Msg* msg)
 
 static void mlacp_sync_recv_macInfo(struct CSM* csm, struct Msg* msg)
 {
+    struct System* sys = NULL;
     struct mLACPMACInfoTLV* mac_info = NULL;
 
     mac_info = (struct mLACPMACInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    if (!mlacp_sync_recv_entries_fit(csm, msg, sizeof(struct mLACPMACInfoTLV),
+                                     sizeof(struct mLACPMACData), ntohs(mac_info->num_of_entry)))
+        return;
+    if ((sys = system_get_instance()) != NULL)
+        sys->peer_rx_usec = msg->lat_stamp;
     mlacp_fsm_update_mac_info_from_peer(csm, mac_info);
+    if (sys)
+        sys->peer_rx_usec = 0;
     MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
         mac_info->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
 
@@ -621,6 +760,9 @@ static void mlacp_sync_recv_arpInfo(struct CSM* csm, struct Msg* msg)
     struct mLACPARPInfoTLV* arp_info = NULL;
 
     arp_info = (struct mLACPARPInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    if (!mlacp_sync_recv_entries_fit(csm, msg, sizeof(struct mLACPARPInfoTLV),
+                                     sizeof(struct ARPMsg), ntohs(arp_info->num_of_entry)))
+        return;
     mlacp_fsm_update_arp_info(csm, arp_info);
     MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
         arp_info->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
@@ -633,6 +775,9 @@ static void mlacp_sync_recv_ndiscInfo(struct CSM *csm, struct Msg *msg)
     struct mLACPNDISCInfoTLV *ndisc_info = NULL;
 
     ndisc_info = (struct mLACPNDISCInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    if (!mlacp_sync_recv_entries_fit(csm, msg, sizeof(struct mLACPNDISCInfoTLV),
+                                     sizeof(struct NDISCMsg), ntohs(ndisc_info->num_of_entry)))
+        return;
     mlacp_fsm_update_ndisc_info(csm, ndisc_info);
 
     return;
@@ -650,6 +795,30 @@ static void mlacp_sync_recv_heartbeat(struct CSM* csm, struct Msg* msg)
 
     tlv = (struct mLACPHeartbeatTLV *)(&msg->buf[sizeof(ICCHdr)]);
     mlacp_fsm_update_heartbeat(csm, tlv);
+    if (csm->heartbeat_rx_usec && msg->lat_stamp > csm->heartbeat_rx_usec)
+        system_latency_add(LATENCY_HEARTBEAT_INTERVAL, msg->lat_stamp - csm->heartbeat_rx_usec);
+    csm->heartbeat_rx_usec = msg->lat_stamp;
+    MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+        tlv->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
+
+    return;
+}
+
+static void mlacp_sync_recv_syncResume(struct CSM* csm, struct Msg* msg)
+{
+    ICCParameter *icc_param = (ICCParameter*)&(msg->buf[sizeof(ICCHdr)]);
+    struct mLACPSyncResumeTLV *tlv = NULL;
+
+    /* Also reached from the sync stage, ahead of the receiver's length check */
+    if (msg->len < sizeof(ICCHdr) + sizeof(struct mLACPSyncResumeTLV))
+    {
+        MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+            icc_param->type, ICCP_DBG_CNTR_STS_ERR);
+        return;
+    }
+
+    tlv = (struct mLACPSyncResumeTLV *)(&msg->buf[sizeof(ICCHdr)]);
+    mlacp_sync_log_recv_resume(csm, tlv);
     MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
         tlv->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
 
@@ -707,19 +876,33 @@ static void mlacp_fsm_recv_if_up_ack(struct CSM* csm, struct Msg* msg)
 void mlacp_local_lif_state_mac_handler(struct CSM* csm)
 {
     struct LocalInterface* local_if = NULL;
+    time_t now;
+    time_t expire_time = 0;
+
+    /* Nothing to do until the earliest po down timer expires */
+    if (MLACP(csm).po_down_expire_time == 0)
+        return;
+    now = time(NULL);
+    if (now <= MLACP(csm).po_down_expire_time)
+        return;
 
     LIST_FOREACH(local_if, &(MLACP(csm).lif_list), mlacp_next)
     {
         if ((local_if->state == PORT_STATE_DOWN) && (local_if->type == IF_T_PORT_CHANNEL))
         {
             // clear the pending macs if timer is expired.
-            if (local_if->po_down_time && ((time(NULL) - local_if->po_down_time) > MLACP_LOCAL_IF_DOWN_TIMER))
+            if (local_if->po_down_time && ((now - local_if->po_down_time) > MLACP_LOCAL_IF_DOWN_TIMER))
             {
                 mlacp_local_lif_clear_pending_mac(csm, local_if);
                 local_if->po_down_time = 0;
             }
         }
+
+        if (local_if->po_down_time
+            && (expire_time == 0 || local_if->po_down_time + MLACP_LOCAL_IF_DOWN_TIMER < expire_time))
+            expire_time = local_if->po_down_time + MLACP_LOCAL_IF_DOWN_TIMER;
     }
+    MLACP(csm).po_down_expire_time = expire_time;
 }
 
 void mlacp_peer_link_learning_handler(struct CSM* csm)
@@ -772,6 +955,7 @@ void mlacp_init(struct CSM* csm, int all)
     MLACP(csm).error_msg = NULL;
 
     MLACP(csm).current_state = MLACP_STATE_INIT;
+    MLACP(csm).prev_state = MLACP_STATE_INIT;
     memset(MLACP(csm).remote_system.system_id, 0, ETHER_ADDR_LEN);
 
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).mlacp_msg_list);
@@ -780,6 +964,7 @@ void mlacp_init(struct CSM* csm, int all)
     mlacp_mac_msg_queue_reinit(csm);
 
     PIF_QUEUE_REINIT(MLACP(csm).pif_list);
+    peer_if_hash_init(csm);
     LIF_PURGE_QUEUE_REINIT(MLACP(csm).lif_purge_list);
 
     if (all != 0)
@@ -787,13 +972,16 @@ void mlacp_init(struct CSM* csm, int all)
         /* if no clean all, keep the arp info & local interface info for next connection*/
         MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_list);
         MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_list);
+        mlacp_neigh_hash_init(csm);
         RB_INIT(mac_rb_tree, &MLACP(csm).mac_rb );
+        mlacp_mac_index_init(csm);
         LIF_QUEUE_REINIT(MLACP(csm).lif_list);
 
         MLACP(csm).node_id = MLACP_SYSCONF_NODEID_MSB_MASK;
         MLACP(csm).node_id |= (((inet_addr(csm->sender_ip) >> 24) << 4) & MLACP_SYSCONF_NODEID_NODEID_MASK);
         MLACP(csm).node_id |= rand() % MLACP_SYSCONF_NODEID_FREE_MASK;
     }
+    mlacp_sync_log_init(csm, all);
 
     return;
 }
@@ -814,14 +1002,19 @@ void mlacp_finalize(struct CSM* csm)
     mlacp_mac_msg_queue_reinit(csm);
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_list);
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_list);
+    mlacp_neigh_hash_init(csm);
 
     RB_INIT(mac_rb_tree, &MLACP(csm).mac_rb );
+    mlacp_mac_index_init(csm);
 
     /* remove lif & lif-purge queue */
     LIF_QUEUE_REINIT(MLACP(csm).lif_list);
     LIF_PURGE_QUEUE_REINIT(MLACP(csm).lif_purge_list);
     /* remove & destroy pif queue */
     PIF_QUEUE_REINIT(MLACP(csm).pif_list);
+    peer_if_hash_init(csm);
+
+    mlacp_sync_log_finalize(csm);
 
     return;
 }
@@ -834,10 +1027,10 @@ void mlacp_fsm_transit(struct CSM* csm)
 {
     struct System* sys = NULL;
     struct Msg* msg = NULL;
-    static MLACP_APP_STATE_E prev_state = MLACP_SYNC_SYSCONF;
     ICCHdr* icc_hdr = NULL;
     ICCParameter* icc_param = NULL;
     int have_msg = 1;
+    int num_msg = 0;
 
     if (csm == NULL)
         return;
@@ -877,7 +1070,9 @@ void mlacp_fsm_transit(struct CSM* csm)
         }
     }
 
-    mlacp_sync_send_heartbeat(csm);
+    /* First heartbeat of the session, the timer drives the rest */
+    if (!ICCP_TIMER_PENDING(&csm->heartbeat_timer))
+        mlacp_sync_send_heartbeat(csm);
 
     mlacp_local_lif_state_mac_handler(csm);
     mlacp_peer_link_learning_handler(csm);
@@ -888,10 +1083,11 @@ void mlacp_fsm_transit(struct CSM* csm)
         if (MLACP(csm).current_state != MLACP_STATE_INIT)
         {
             /* Handler NAK First*/
-            msg = mlacp_dequeue_msg(csm);
+            msg = (num_msg < MLACP_RX_MSG_BUDGET) ? mlacp_dequeue_msg(csm) : NULL;
             if (msg != NULL)
             {
                 have_msg = 1;
+                ++num_msg;
                 icc_hdr = (ICCHdr*)msg->buf;
                 icc_param = (ICCParameter*)&msg->buf[sizeof(ICCHdr)];
                 /*ICCPD_LOG_DEBUG("mlacp_fsm", "  SYNC: Message Type = %X, TLV=%s, Len=%d", icc_hdr->ldp_hdr.msg_type, get_tlv_type_string(icc_param->type), msg->len);*/
@@ -899,8 +1095,7 @@ void mlacp_fsm_transit(struct CSM* csm)
                 if (icc_hdr->ldp_hdr.msg_type == MSG_T_NOTIFICATION && icc_param->type == TLV_T_NAK)
                 {
                     mlacp_sync_recv_nak_handler(csm, msg);
-                    free(msg->buf);
-                    free(msg);
+                    iccp_csm_free_msg(msg);
                     continue;
                 }
             }
@@ -910,11 +1105,17 @@ void mlacp_fsm_transit(struct CSM* csm)
             }
         }
 
-        if (prev_state != MLACP(csm).current_state)
+        if (MLACP(csm).prev_state != MLACP(csm).current_state)
         {
             if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
+            {
+                iccp_warm_snapshot_peer_reconcile(csm);
                 mlacp_peer_conn_handler(csm);
-            prev_state = MLACP(csm).current_state;
+                /* Sync stages are over and the MACs queued, the delta
+                 * covered this resync only */
+                MLACP(csm).resync_delta = 0;
+            }
+            MLACP(csm).prev_state = MLACP(csm).current_state;
         }
 
         /* Sync State */
@@ -922,8 +1123,6 @@ void mlacp_fsm_transit(struct CSM* csm)
         {
             MLACP(csm).wait_for_sync_data = 0;
             MLACP(csm).current_state = MLACP_STATE_STAGE1;
-            mlacp_resync_arp(csm);
-            mlacp_resync_ndisc(csm);
         }
 
         switch (MLACP(csm).current_state)
@@ -946,8 +1145,7 @@ void mlacp_fsm_transit(struct CSM* csm)
         /*ICCPD_LOG_DEBUG("mlacp_fsm", "  Next State = %s", mlacp_state(csm));*/
         if (msg)
         {
-            free(msg->buf);
-            free(msg);
+            iccp_csm_free_msg(msg);
         }
     }
 }
@@ -985,7 +1183,7 @@ void mlacp_enqueue_msg(struct CSM* csm, struct Msg* msg)
     if (csm == NULL )
     {
         if (msg != NULL )
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
 
@@ -1014,8 +1212,18 @@ struct Msg* mlacp_dequeue_msg(struct CSM* csm)
 void mlacp_sync_mac(struct CSM* csm)
 {
     struct MACMsg* mac_msg = NULL;
+    int peer_synced = iccp_warm_snapshot_peer_synced(csm);
+
     RB_FOREACH (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
     {
+        /*Unchanged since the warm reboot snapshot, the peer kept it*/
+        if (peer_synced && (mac_msg->warm_state & MAC_WARM_RESTORED))
+            continue;
+
+        /*Peer kept it over the reconnect*/
+        if (!mlacp_sync_log_mac_changed(csm, mac_msg))
+            continue;
+
         /*If MAC with local age flag, dont sync to peer. Such MAC only exist when peer is warm-reboot.
           If peer is warm-reboot, peer age flag is not set when connection is lost.
           When MAC is aged in local switch, this MAC is not deleted for no peer age flag.
@@ -1056,7 +1264,7 @@ void mlacp_local_lif_clear_pending_mac(struct CSM* csm, struct LocalInterface *l
 {
     ICCPD_LOG_DEBUG("ICCP_FDB", "mlacp_local_lif_clear_pending_mac If: %s ", local_lif->name );
     struct MACMsg* mac_msg = NULL, *mac_temp = NULL;
-    RB_FOREACH_SAFE (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    MAC_LIST_FOREACH_SAFE (mac_msg, MAC_ORIGIN_HASH_HEAD(csm, local_lif->name), origin_hash_next, mac_temp)
     {
         if (mac_msg->pending_local_del && strcmp(mac_msg->origin_ifname, local_lif->name) == 0)
         {
@@ -1070,11 +1278,13 @@ void mlacp_local_lif_clear_pending_mac(struct CSM* csm, struct LocalInterface *l
             {
                 //TBD do we need to send delete notification to peer .?
                 MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+                mlacp_sync_log_mac_del(csm, mac_msg);
+                mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_DEL);
 
                 mac_msg->op_type = MAC_SYNC_DEL;
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    iccp_csm_free_mac_msg(mac_msg);
                 }
             }
             else
@@ -1094,11 +1304,19 @@ static void mlacp_resync_arp(struct CSM* csm)
     struct ARPMsg* arp_msg = NULL;
     struct Msg *msg_send = NULL;
 
+    int peer_synced = iccp_warm_snapshot_peer_synced(csm);
+
     /* recover ARP info sync from peer*/
     if (!TAILQ_EMPTY(&(MLACP(csm).arp_list)))
     {
         TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
         {
+            /* Unchanged since the warm reboot snapshot, the peer kept it */
+            if (peer_synced && msg->warm_restored)
+                continue;
+            if (!mlacp_sync_log_neigh_changed(csm, msg, 1))
+                continue;
+
             arp_msg = (struct ARPMsg*)msg->buf;
             arp_msg->op_type = NEIGH_SYNC_ADD;
             arp_msg->flag = 0;
@@ -1120,11 +1338,18 @@ static void mlacp_resync_ndisc(struct CSM *csm)
     struct NDISCMsg *ndisc_msg = NULL;
     struct Msg *msg_send = NULL;
 
+    int peer_synced = iccp_warm_snapshot_peer_synced(csm);
+
     /* recover ndisc info sync from peer */
     if (!TAILQ_EMPTY(&(MLACP(csm).ndisc_list)))
     {
         TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
         {
+            if (peer_synced && msg->warm_restored)
+                continue;
+            if (!mlacp_sync_log_neigh_changed(csm, msg, 0))
+                continue;
+
             ndisc_msg = (struct NDISCMsg *)msg->buf;
             ndisc_msg->op_type = NEIGH_SYNC_ADD;
             ndisc_msg->flag = 0;
@@ -1214,6 +1439,13 @@ static void mlacp_sync_receiver_handler(struct CSM* csm, struct Msg* msg)
         return;
 
     icc_param = (ICCParameter*)&(msg->buf[sizeof(ICCHdr)]);
+    if (msg->len < sizeof(ICCHdr) + mlacp_sync_recv_min_len(icc_param->type))
+    {
+        ICCPD_LOG_WARN("ICCP_FSM", "RX short %s from peer, len %d, drop",
+            get_tlv_type_string(icc_param->type), msg->len);
+        MLACP_SET_ICCP_RX_DBG_COUNTER(csm, icc_param->type, ICCP_DBG_CNTR_STS_ERR);
+        return;
+    }
 
     /*fprintf(stderr, " Recv Type [%d]\n", icc_param->type);*/
     switch (icc_param->type)
@@ -1287,6 +1519,10 @@ static void mlacp_sync_receiver_handler(struct CSM* csm, struct Msg* msg)
             mlacp_fsm_recv_if_up_ack(csm, msg);
             break;
 
+        case TLV_T_MLACP_SYNC_RESUME:
+            mlacp_sync_recv_syncResume(csm, msg);
+            break;
+
         default:
             ICCPD_LOG_ERR("ICCP_FSM", "Receive unsupported msg 0x%x from peer",
                 icc_param->type);
@@ -1391,12 +1627,21 @@ static void mlacp_stage_sync_send_handler(struct CSM* csm, struct Msg* msg)
             icc_hdr = (ICCHdr*)msg->buf;
             icc_param = (ICCParameter*)&msg->buf[sizeof(ICCHdr)];
 
-            if (icc_hdr->ldp_hdr.msg_type == MSG_T_RG_APP_DATA && icc_param->type == TLV_T_MLACP_SYNC_REQUEST)
+            if (icc_hdr->ldp_hdr.msg_type == MSG_T_RG_APP_DATA && icc_param->type == TLV_T_MLACP_SYNC_RESUME)
+            {
+                /* Precedes the sync request, picks full or delta resync */
+                mlacp_sync_recv_syncResume(csm, msg);
+            }
+            else if (icc_hdr->ldp_hdr.msg_type == MSG_T_RG_APP_DATA && icc_param->type == TLV_T_MLACP_SYNC_REQUEST)
             {
                 mlacp_sync_req = (mLACPSyncReqTLV*)&msg->buf[sizeof(ICCHdr)];
                 MLACP(csm).wait_for_sync_data = 1;
                 MLACP(csm).sync_req_num = ntohs(mlacp_sync_req->req_num);
 
+                mlacp_sync_log_resync_start(csm);
+                mlacp_resync_arp(csm);
+                mlacp_resync_ndisc(csm);
+
                 /* Reply the peer all sync info*/
                 mlacp_sync_send_all_info_handler(csm);
             }
@@ -1413,6 +1658,9 @@ static void mlacp_stage_sync_request_handler(struct CSM* csm, struct Msg* msg)
     /* Socket server send sync request first*/
     if (MLACP(csm).wait_for_sync_data == 0)
     {
+        /* Tell the peer which of its entries are still here */
+        mlacp_sync_log_send_request(csm);
+
         // Send out the request for ALL
         memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
         msg_len = mlacp_prepare_for_sync_request_tlv(csm, g_csm_buf, CSM_BUFFER_SIZE);
@@ -1457,7 +1705,7 @@ static void mlacp_exchange_handler(struct CSM* csm, struct Msg* msg)
 {
     int len;
     struct System* sys = NULL;
-    struct LocalInterface* lif = NULL, *lif_purge = NULL;
+    struct LocalInterface* lif = NULL, *lif_next = NULL, *lif_purge = NULL;
 
     ICCHdr* icc_hdr = NULL;
 
@@ -1522,9 +1770,12 @@ static void mlacp_exchange_handler(struct CSM* csm, struct Msg* msg)
         }
     }
 
-    /* Send mlag lif*/
-    LIST_FOREACH(lif, &(MLACP(csm).lif_list), mlacp_next)
+    /* Send mlag lif, only the ones changed since the last pass*/
+    lif = LIST_FIRST(&(MLACP(csm).lif_dirty_list));
+    while (lif != NULL)
     {
+        lif_next = LIST_NEXT(lif, mlacp_dirty_next);
+
         if (lif->type == IF_T_PORT_CHANNEL && lif->port_config_sync)
         {
             /* Disable traffic distribution on LAG members if LAG is down */
@@ -1554,8 +1805,14 @@ static void mlacp_exchange_handler(struct CSM* csm, struct Msg* msg)
             if (iccp_csm_send(csm, g_csm_buf, len) > 0)
             {
                 lif->changed = 0;
+                system_latency_record(LATENCY_PO_STATE_TO_PEER, &lif->changed_stamp);
             }
         }
+
+        /* Failed sends stay queued and are retried on the next pass */
+        if (lif->type != IF_T_PORT_CHANNEL || (!lif->port_config_sync && !lif->changed))
+            local_if_clear_dirty(lif);
+        lif = lif_next;
     }
 
     /* Send MAC info if any*/
@@ -1567,6 +1824,9 @@ static void mlacp_exchange_handler(struct CSM* csm, struct Msg* msg)
     /* Send Ndisc info if any */
     mlacp_sync_send_syncNdiscInfo(csm);
 
+    /* Tell the peer where to resume from if the queues drained */
+    mlacp_sync_log_send_mark(csm);
+
     /*If peer is warm reboot*/
     if (csm->peer_warm_reboot_time != 0)
     {
@@ -1661,6 +1921,9 @@ ICCP_DBG_CNTR_MSG_e mlacp_fsm_iccp_to_dbg_msg_type(uint32_t tlv_type)
         case TLV_T_MLACP_IF_UP_ACK:
             return ICCP_DBG_CNTR_MSG_IF_UP_ACK;
 
+        case TLV_T_MLACP_SYNC_RESUME:
+            return ICCP_DBG_CNTR_MSG_SYNC_RESUME;
+
         default:
             ICCPD_LOG_DEBUG(__FUNCTION__, "No debug counter for TLV type %u",
                 tlv_type);
@@ -30,6 +30,7 @@
 #include <sys/queue.h>
 #include <sys/epoll.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <linux/un.h>
 #include <linux/if_arp.h>
 #include <sys/ioctl.h>
@@ -47,6 +48,8 @@
 #include "../include/iccp_netlink.h"
 #include "../include/scheduler.h"
 #include "../include/iccp_ifm.h"
+#include "../include/iccp_warm_snapshot.h"
+#include "../include/mlacp_sync_log.h"
 
 /*****************************************
 * Enum
@@ -63,41 +66,78 @@ typedef enum route_manipulate_type
 * Global
 *
 * ***************************************/
-char g_ipv4_str[INET_ADDRSTRLEN];
-char g_ipv6_str[INET6_ADDRSTRLEN];
 char g_iccp_mlagsyncd_recv_buf[ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE] = { 0 };
+/* Bytes in g_iccp_mlagsyncd_recv_buf not parsed yet, a partial frame is
+ * kept at the front of the buffer until the rest arrives */
+static size_t g_iccp_mlagsyncd_recv_len = 0;
 char g_iccp_mlagsyncd_send_buf[ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE] = { 0 };
 
+/* FDB set/del collected during one scheduler loop, sent as one SET_FDB
+ * msg when mclagsyncd advertises MCLAG_SYNCD_CAP_FDB_BATCH. The msg
+ * length field is 16 bits. */
+#define SYNCD_FDB_BATCH_BUF_SIZE    0xFFFF
+#define SYNCD_FDB_BATCH_MAX_ENTRY \
+    ((int)((SYNCD_FDB_BATCH_BUF_SIZE - sizeof(struct IccpSyncdHDr)) / sizeof(struct mclag_fdb_info)))
+static char g_iccp_mlagsyncd_fdb_batch_buf[SYNCD_FDB_BATCH_BUF_SIZE];
+static int g_iccp_mlagsyncd_fdb_batch_count = 0;
+/* Peer receive time of each batched entry, 0 for local ones */
+static uint64_t g_iccp_mlagsyncd_fdb_batch_stamp[SYNCD_FDB_BATCH_MAX_ENTRY];
+/* Batch index + 1 by vid/MAC, 0 if free. A burst of aging or moves
+ * touches an entry several times per loop, only its last op is sent */
+#define SYNCD_FDB_BATCH_HASH_SIZE   4096
+static uint16_t g_iccp_mlagsyncd_fdb_batch_hash[SYNCD_FDB_BATCH_HASH_SIZE];
+
 
 extern void mlacp_sync_mac(struct CSM* csm);
 
-#define SYNCD_SEND_RETRY_INTERVAL_USEC    50000 //50 mseconds
-#define SYNCD_SEND_RETRY_MAX              5
+/* Bytes mclagsyncd did not take yet, flushed on EPOLLOUT. A msg is
+ * queued whole or not at all so the stream framing stays intact. */
+#define SYNCD_TX_QUEUE_SIZE               (4 * 1024 * 1024)
+static char *g_iccp_mlagsyncd_tx_buf = NULL;
+static size_t g_iccp_mlagsyncd_tx_head = 0;
+static size_t g_iccp_mlagsyncd_tx_len = 0;
 
-#define SYNCD_RECV_RETRY_INTERVAL_USEC    50000 //50 mseconds
-#define SYNCD_RECV_RETRY_MAX              5
+/* Socket reads per EPOLLIN, level triggered epoll calls back for the rest */
+#define SYNCD_RECV_READ_MAX               16
 
 /*****************************************
 * Tool : show ip string
 *
 * ***************************************/
-char *show_ip_str(uint32_t ipv4_addr)
+char *show_ip_str_r(uint32_t ipv4_addr, char buf[INET_ADDRSTRLEN])
 {
     struct in_addr in_addr;
 
-    memset(g_ipv4_str, 0, sizeof(g_ipv4_str));
     in_addr.s_addr = ipv4_addr;
-    inet_ntop(AF_INET, &in_addr, g_ipv4_str, INET_ADDRSTRLEN);
+    if (!inet_ntop(AF_INET, &in_addr, buf, INET_ADDRSTRLEN))
+        buf[0] = '\0';
+
+    return buf;
+}
+
+char *show_ipv6_str_r(char *ipv6_addr, char buf[INET6_ADDRSTRLEN])
+{
+    if (!inet_ntop(AF_INET6, ipv6_addr, buf, INET6_ADDRSTRLEN))
+        buf[0] = '\0';
+
+    return buf;
+}
 
-    return g_ipv4_str;
+/* Rotating per thread buffers, see mac_addr_to_str() */
+char *show_ip_str(uint32_t ipv4_addr)
+{
+    static __thread char ip_str[ADDR_STR_RING_SIZE][INET_ADDRSTRLEN];
+    static __thread unsigned int idx;
+
+    return show_ip_str_r(ipv4_addr, ip_str[idx++ % ADDR_STR_RING_SIZE]);
 }
 
 char *show_ipv6_str(char *ipv6_addr)
 {
-    memset(g_ipv6_str, 0, sizeof(g_ipv6_str));
-    inet_ntop(AF_INET6, ipv6_addr, g_ipv6_str, INET6_ADDRSTRLEN);
+    static __thread char ip_str[ADDR_STR_RING_SIZE][INET6_ADDRSTRLEN];
+    static __thread unsigned int idx;
 
-    return g_ipv6_str;
+    return show_ipv6_str_r(ipv6_addr, ip_str[idx++ % ADDR_STR_RING_SIZE]);
 }
 
 static int getHwAddr(char *buff, char *mac)
@@ -328,6 +368,9 @@ static void update_po_if_info(struct CSM *csm,
     if (local_if->po_active != po_state)
     {
         local_if->changed = 1;
+        if (local_if->changed_stamp == 0)
+            local_if->changed_stamp = iccp_timer_now_usec();
+        local_if_set_dirty(local_if);
         local_if->po_active = (po_state != 0);
 
         /*printf("update po [%s=%d]\n",local_if->name, local_if->po_active);*/
@@ -396,14 +439,110 @@ static int peer_po_is_alive(struct CSM *csm, int po_ifindex)
     return pif_active;
 }
 
-// return -1 if failed
+/* Watch for EPOLLOUT on the syncd socket only while bytes are queued */
+static void iccp_mclagsyncd_tx_set_pollout(struct System *sys, int enable)
+{
+    struct epoll_event event;
+
+    event.data.fd = sys->sync_fd;
+    event.events = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, sys->sync_fd, &event) != 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Syncd socket %d epoll mod error %d",
+            sys->sync_fd, errno);
+    }
+}
+
+static int iccp_mclagsyncd_tx_queue_put(struct System *sys, char *buf, size_t len)
+{
+    if (g_iccp_mlagsyncd_tx_buf == NULL)
+    {
+        g_iccp_mlagsyncd_tx_buf = (char *)malloc(SYNCD_TX_QUEUE_SIZE);
+        if (g_iccp_mlagsyncd_tx_buf == NULL)
+        {
+            ICCPD_LOG_ERR(__FUNCTION__, "Failed to allocate mclagsyncd output queue");
+            return MCLAG_ERROR;
+        }
+        g_iccp_mlagsyncd_tx_head = 0;
+        g_iccp_mlagsyncd_tx_len = 0;
+    }
+
+    if (g_iccp_mlagsyncd_tx_len + len > SYNCD_TX_QUEUE_SIZE)
+        return MCLAG_ERROR;
+
+    if (g_iccp_mlagsyncd_tx_head + g_iccp_mlagsyncd_tx_len + len > SYNCD_TX_QUEUE_SIZE)
+    {
+        memmove(g_iccp_mlagsyncd_tx_buf, g_iccp_mlagsyncd_tx_buf + g_iccp_mlagsyncd_tx_head,
+            g_iccp_mlagsyncd_tx_len);
+        g_iccp_mlagsyncd_tx_head = 0;
+    }
+
+    memcpy(g_iccp_mlagsyncd_tx_buf + g_iccp_mlagsyncd_tx_head + g_iccp_mlagsyncd_tx_len, buf, len);
+    if (g_iccp_mlagsyncd_tx_len == 0)
+        iccp_mclagsyncd_tx_set_pollout(sys, 1);
+    g_iccp_mlagsyncd_tx_len += len;
+
+    return 0;
+}
+
+/* Push queued bytes to mclagsyncd, returns the number of bytes still queued */
+size_t iccp_mclagsyncd_tx_flush(struct System *sys)
+{
+    ssize_t rc;
+
+    if (sys == NULL || sys->sync_fd <= 0 || g_iccp_mlagsyncd_tx_len == 0)
+        return 0;
+
+    while (g_iccp_mlagsyncd_tx_len > 0)
+    {
+        rc = send(sys->sync_fd, g_iccp_mlagsyncd_tx_buf + g_iccp_mlagsyncd_tx_head,
+            g_iccp_mlagsyncd_tx_len, MSG_DONTWAIT);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            /* Connection is going down, the read path reconnects */
+            ICCPD_LOG_ERR(__FUNCTION__, "Flush %zu bytes to mclagsyncd failed, Error:%s",
+                g_iccp_mlagsyncd_tx_len, strerror(errno));
+            shutdown(sys->sync_fd, SHUT_RDWR);
+            g_iccp_mlagsyncd_tx_len = 0;
+            break;
+        }
+
+        g_iccp_mlagsyncd_tx_head += rc;
+        g_iccp_mlagsyncd_tx_len -= rc;
+    }
+
+    if (g_iccp_mlagsyncd_tx_len == 0)
+    {
+        g_iccp_mlagsyncd_tx_head = 0;
+        iccp_mclagsyncd_tx_set_pollout(sys, 0);
+    }
+
+    return g_iccp_mlagsyncd_tx_len;
+}
+
+/* Drop the output queue, the syncd socket is closed */
+static void iccp_mclagsyncd_tx_queue_free(void)
+{
+    if (g_iccp_mlagsyncd_tx_buf)
+        free(g_iccp_mlagsyncd_tx_buf);
+    g_iccp_mlagsyncd_tx_buf = NULL;
+    g_iccp_mlagsyncd_tx_head = 0;
+    g_iccp_mlagsyncd_tx_len = 0;
+}
+
+/* Send msg to mclagsyncd, never waits on the socket. What it does not
+ * take goes to the output queue.
+ * return -1 if failed
+ */
 ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t msg_len)
 {
     struct System *sys;
-    ssize_t write = 0;
-    int num_retry = 0;
-    size_t pos = 0;
-    int send_len = 0;
+    ssize_t send_len = 0;
 
     sys = system_get_instance();
     if (sys == NULL)
@@ -412,55 +551,46 @@ ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t msg_
         return MCLAG_ERROR;
     }
 
-    if (sys->sync_fd)
+    if (sys->sync_fd <= 0)
     {
-        while (msg_len > 0)
-        {
-            send_len = send(sys->sync_fd, &send_buff[pos], msg_len, MSG_DONTWAIT);
+        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
+        return MCLAG_ERROR;
+    }
 
-            if (send_len == -1)
-            {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    ++num_retry;
-                    if (num_retry > SYNCD_SEND_RETRY_MAX)
-                    {
-                        ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() retry failed,msg_type: %d msg_len/send_len %d/%d",
-                                msg_type, msg_len, send_len);
-                        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                                            sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
-                        return MCLAG_ERROR;
-                    }
-                    else
-                    {
-                        usleep(SYNCD_SEND_RETRY_INTERVAL_USEC);
-                        send_len = 0;
-                    }
-                }
-                else
-                {
-                    ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() failed, msg_type: %d errno %d",
-                            msg_type, errno);
-                    SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
-                    return MCLAG_ERROR;
-                }
-            }
-            else if (send_len == 0)
+    /* Keep FDB changes ahead of whatever was queued after them */
+    if (send_buff != g_iccp_mlagsyncd_fdb_batch_buf)
+        iccp_send_fdb_batch_to_syncd();
+
+    /* Keep the stream in order, only write directly when nothing is queued */
+    if (iccp_mclagsyncd_tx_flush(sys) == 0)
+    {
+        send_len = send(sys->sync_fd, send_buff, msg_len, MSG_DONTWAIT);
+        if (send_len < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
             {
-                ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() failed socket closed msg_type: %d errno %d",
+                ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() failed, msg_type: %d errno %d",
                         msg_type, errno);
-                SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                                    sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
+                SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
                 return MCLAG_ERROR;
             }
-            msg_len -= send_len;
-            pos += send_len;
+            send_len = 0;
         }
-        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_OK);
     }
 
-    return pos;
+    /* The rest of a partly sent msg always fits, the queue was empty */
+    if (send_len < msg_len
+        && iccp_mclagsyncd_tx_queue_put(sys, send_buff + send_len, msg_len - send_len) < 0)
+    {
+        ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd output queue full, msg_type: %d msg_len %d queued %zu",
+                msg_type, msg_len, g_iccp_mlagsyncd_tx_len);
+        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
+        return MCLAG_ERROR;
+    }
+
+    SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_OK);
 
+    return msg_len;
 }
 
 #if 0
@@ -542,19 +672,12 @@ void set_peerlink_mlag_port_learn(struct LocalInterface *lif, int enable)
     /*send msg*/
     if (sys->sync_fd)
     {
-        rc = write(sys->sync_fd,msg_buf, msg_hdr->len);
+        rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
         if ((rc <= 0) || (rc != msg_hdr->len))
         {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
             ICCPD_LOG_ERR(__FUNCTION__, "Failed to write for %s, rc %d",
                 lif->name, rc);
         }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
     }
     return;
 }
@@ -843,7 +966,7 @@ int mlacp_link_del_iccp_info(
     msg_hdr->len += (sizeof(mclag_sub_option_hdr_t) + sub_msg->op_len);
 
     if (sys->sync_fd)
-        rc = send(sys->sync_fd,msg_buf, msg_hdr->len, MSG_DONTWAIT);
+        rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
 
     if ((rc <= 0) || (rc != msg_hdr->len))
     {
@@ -853,7 +976,6 @@ int mlacp_link_del_iccp_info(
     }
     else
     {
-        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
         ICCPD_LOG_DEBUG("ICCP_FSM", "Delete mlag %d", mlag_id);
         return 0;
     }
@@ -1085,8 +1207,8 @@ void update_peerlink_isolate_from_all_csm_lif(
     char *msg_buf = g_iccp_mlagsyncd_send_buf;
     struct System *sys;
 
-    char mlag_po_buf[512];
-    int src_len = 0, dst_len = 0;
+    char mlag_po_buf[ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE];
+    int src_len = 0, dst_len = 0, dst_max, len;
     ssize_t rc;
 
     sys = system_get_instance();
@@ -1100,7 +1222,7 @@ void update_peerlink_isolate_from_all_csm_lif(
         return;
 
     memset(msg_buf, 0, ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE);
-    memset(mlag_po_buf, 0, 511);
+    memset(mlag_po_buf, 0, sizeof(mlag_po_buf));
 
     msg_hdr = (struct IccpSyncdHDr *)msg_buf;
     msg_hdr->ver = ICCPD_TO_MCLAGSYNCD_HDR_VERSION;
@@ -1156,6 +1278,9 @@ void update_peerlink_isolate_from_all_csm_lif(
     sub_msg = (mclag_sub_option_hdr_t  *)&msg_buf[msg_hdr->len];
     sub_msg->op_type = MCLAG_SUB_OPTION_TYPE_ISOLATE_DST;
 
+    /* The list goes in one message, what is left of the send buffer */
+    dst_max = ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE - msg_hdr->len - sizeof(mclag_sub_option_hdr_t);
+
     /*traverse all portchannel member port and send msg to syncd */
     LIST_FOREACH(lif, &(MLACP(csm).lif_list), mlacp_next)
     {
@@ -1166,11 +1291,16 @@ void update_peerlink_isolate_from_all_csm_lif(
         if (lif->isolate_to_peer_link == 1)
         {
             /* need to isolate port,  get it's member name */
-            if (strlen(mlag_po_buf) != 0)
-                dst_len += snprintf(mlag_po_buf + dst_len, sizeof(mlag_po_buf) - dst_len, "%s", ",");
-
-            dst_len += snprintf(mlag_po_buf + dst_len, sizeof(mlag_po_buf) - dst_len, "%s%s%s",
-                                lif->name, lif->portchannel_member_buf[0] == 0 ? "" : ",", lif->portchannel_member_buf);
+            len = snprintf(mlag_po_buf + dst_len, dst_max - dst_len, "%s%s%s%s",
+                           dst_len ? "," : "", lif->name,
+                           lif->portchannel_member_buf[0] == 0 ? "" : ",", lif->portchannel_member_buf);
+            if (len >= dst_max - dst_len)
+            {
+                mlag_po_buf[dst_len] = '\0';
+                ICCPD_LOG_ERR(__FUNCTION__, "Port isolate list too long, %s and later ports not sent", lif->name);
+                break;
+            }
+            dst_len += len;
         }
     }
 
@@ -1191,18 +1321,9 @@ void update_peerlink_isolate_from_all_csm_lif(
     /*send msg*/
     if (sys->sync_fd)
     {
-        rc = write(sys->sync_fd,msg_buf, msg_hdr->len);
+        rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
         if ((rc <= 0) || (rc != msg_hdr->len))
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
             ICCPD_LOG_ERR(__FUNCTION__, "Failed to write, rc %d", rc);
-        }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
     }
 
     return;
@@ -1381,31 +1502,33 @@ static void update_l2_po_state(struct CSM *csm,
                                int po_state)
 {
     ROUTE_MANIPULATE_TYPE_E route_type = ROUTE_NONE;
-    struct VLAN_ID *vlan = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vid;
     struct LocalInterface *set_l3_vlan_if = NULL;
 
     if (!csm || !lif)
         return;
 
     /*Is there any L3 vlan over L2 po?*/
-    RB_FOREACH (vlan, vlan_rb_tree, &(lif->vlan_tree))
+    VLAN_BITMAP_FOREACH(vid, &lif->vlan_bitmap)
     {
         route_type = ROUTE_NONE;
 
-        if (!vlan->vlan_itf)
+        vlan_itf = local_if_find_vlan_itf(vid);
+        if (!vlan_itf)
             continue;
 
         /* If the po is under a vlan, update vlan state first*/
-        update_vlan_if_info(csm, lif, vlan->vlan_itf, po_state);
+        update_vlan_if_info(csm, lif, vlan_itf, po_state);
 
-        if (!local_if_is_l3_mode(vlan->vlan_itf))
+        if (!local_if_is_l3_mode(vlan_itf))
             continue;
 
         /*NOTE
          * assume only one mlag per vlan
          * need to add rules for per mlag per vlan later (arp list?)
          */
-        set_l3_vlan_if = vlan->vlan_itf;
+        set_l3_vlan_if = vlan_itf;
         if (po_state != lif->po_active
             || MLACP(csm).current_state != set_l3_vlan_if->mlacp_state)
         {
@@ -1472,14 +1595,6 @@ static void update_l3_po_state(struct CSM *csm,
     return;
 }
 
-int is_local_vlan_on(struct VLAN_ID* vlan_id_list)
-{
-    if (!vlan_id_list->vlan_itf)
-        return 0;
-
-    return 1;
-}
-
 void syn_arp_info_to_peer(struct CSM *csm, struct LocalInterface *local_if)
 {
     struct Msg *msg = NULL;
@@ -1557,7 +1672,8 @@ void update_stp_peer_link(struct CSM *csm,
                           int po_state, int new_create)
 {
     struct LocalInterface *lif = NULL;
-    struct VLAN_ID *vlan = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vid;
 
     if (!csm || !pif)
         return;
@@ -1592,11 +1708,12 @@ void update_stp_peer_link(struct CSM *csm,
         }
         else
         {
-            RB_FOREACH(vlan, vlan_rb_tree, &(lif->vlan_tree))
+            VLAN_BITMAP_FOREACH(vid, &lif->vlan_bitmap)
             {
-                if (!is_local_vlan_on(vlan))
+                vlan_itf = local_if_find_vlan_itf(vid);
+                if (!vlan_itf)
                     continue;
-                if (!local_if_is_l3_mode(vlan->vlan_itf))
+                if (!local_if_is_l3_mode(vlan_itf))
                     continue;
 
                 /*NOTE
@@ -1604,15 +1721,15 @@ void update_stp_peer_link(struct CSM *csm,
                  * need to add rules for per mlag per bridge later (arp list?)
                  */
                 if (po_state == 1 && lif->po_active == 0)
-                    set_l3_itf_state(csm, vlan->vlan_itf, ROUTE_ADD);
+                    set_l3_itf_state(csm, vlan_itf, ROUTE_ADD);
                 else if (po_state == 0 && lif->po_active == 0)
-                    set_l3_itf_state(csm, vlan->vlan_itf, ROUTE_DEL);
+                    set_l3_itf_state(csm, vlan_itf, ROUTE_DEL);
 
                 /*If pif change to active, and local is also active, syn arp to peer*/
                 if (po_state == 1 && lif->po_active == 1)
                 {
-                    syn_arp_info_to_peer(csm, vlan->vlan_itf);
-                    syn_ndisc_info_to_peer(csm, vlan->vlan_itf);
+                    syn_arp_info_to_peer(csm, vlan_itf);
+                    syn_ndisc_info_to_peer(csm, vlan_itf);
                 }
             }
         }
@@ -1622,6 +1739,94 @@ void update_stp_peer_link(struct CSM *csm,
     return;
 }
 
+/* Send the FDB entries batched so far as one SET_FDB msg */
+void iccp_send_fdb_batch_to_syncd()
+{
+    struct IccpSyncdHDr * msg_hdr;
+    struct System *sys;
+    ssize_t rc;
+    int count = g_iccp_mlagsyncd_fdb_batch_count;
+    int i;
+
+    if (count == 0)
+        return;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    g_iccp_mlagsyncd_fdb_batch_count = 0;
+    memset(g_iccp_mlagsyncd_fdb_batch_hash, 0, sizeof(g_iccp_mlagsyncd_fdb_batch_hash));
+
+    msg_hdr = (struct IccpSyncdHDr *)g_iccp_mlagsyncd_fdb_batch_buf;
+    msg_hdr->ver = ICCPD_TO_MCLAGSYNCD_HDR_VERSION;
+    msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB;
+    msg_hdr->len = sizeof(struct IccpSyncdHDr) + count * sizeof(struct mclag_fdb_info);
+
+    if (sys->sync_fd > 0)
+    {
+        rc = iccp_send_to_mclagsyncd(msg_hdr->type, g_iccp_mlagsyncd_fdb_batch_buf, msg_hdr->len);
+        if (rc > 0)
+        {
+            ++sys->dbg_counters.syncd_fdb_batch_msg_counter;
+            SYSTEM_ADD_SYNCD_FDB_ENTRY_COUNTER(sys, count, 1);
+            for (i = 0; i < count; ++i)
+                system_latency_record(LATENCY_MAC_TO_SYNCD, &g_iccp_mlagsyncd_fdb_batch_stamp[i]);
+            ICCPD_LOG_DEBUG("ICCP_FDB", "Send fdb batch to syncd: %d entries", count);
+            return;
+        }
+        ICCPD_LOG_WARN(__FUNCTION__, "Send %d fdb entries to Mclagsyncd failed rc: %d", count, rc);
+    }
+    else
+    {
+        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
+        ICCPD_LOG_ERR(__FUNCTION__, "Invalid sync_fd, drop %d fdb entries", count);
+    }
+    SYSTEM_ADD_SYNCD_FDB_ENTRY_COUNTER(sys, count, 0);
+
+    return;
+}
+
+/* Batch slot for the vid/MAC, the one of an earlier op on it if any */
+static struct mclag_fdb_info *iccp_fdb_batch_slot(struct System *sys, struct MACMsg* mac_msg)
+{
+    struct mclag_fdb_info *mac_info;
+    uint32_t hash = mac_msg->vid;
+    uint16_t idx;
+    int i;
+
+    for (i = 0; i < ETHER_ADDR_LEN; ++i)
+        hash = hash * 31 + mac_msg->mac_addr[i];
+    hash &= SYNCD_FDB_BATCH_HASH_SIZE - 1;
+
+    while ((idx = g_iccp_mlagsyncd_fdb_batch_hash[hash]) != 0)
+    {
+        mac_info = (struct mclag_fdb_info *)&g_iccp_mlagsyncd_fdb_batch_buf[sizeof(struct IccpSyncdHDr)
+            + (idx - 1) * sizeof(struct mclag_fdb_info)];
+        if (mac_info->vid == mac_msg->vid && memcmp(mac_info->mac, mac_msg->mac_addr, ETHER_ADDR_LEN) == 0)
+        {
+            ++sys->dbg_counters.syncd_fdb_coalesce_counter;
+            /* Keep the stamp of the first op, it waited longest */
+            if (g_iccp_mlagsyncd_fdb_batch_stamp[idx - 1] == 0)
+                g_iccp_mlagsyncd_fdb_batch_stamp[idx - 1] = sys->peer_rx_usec;
+            return mac_info;
+        }
+        hash = (hash + 1) & (SYNCD_FDB_BATCH_HASH_SIZE - 1);
+    }
+
+    if (g_iccp_mlagsyncd_fdb_batch_count >= SYNCD_FDB_BATCH_MAX_ENTRY)
+    {
+        iccp_send_fdb_batch_to_syncd();
+        return iccp_fdb_batch_slot(sys, mac_msg);
+    }
+
+    mac_info = (struct mclag_fdb_info *)&g_iccp_mlagsyncd_fdb_batch_buf[sizeof(struct IccpSyncdHDr)
+        + g_iccp_mlagsyncd_fdb_batch_count * sizeof(struct mclag_fdb_info)];
+    g_iccp_mlagsyncd_fdb_batch_stamp[g_iccp_mlagsyncd_fdb_batch_count] = sys->peer_rx_usec;
+    g_iccp_mlagsyncd_fdb_batch_hash[hash] = ++g_iccp_mlagsyncd_fdb_batch_count;
+
+    return mac_info;
+}
+
 void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type, uint8_t oper)
 {
     struct IccpSyncdHDr * msg_hdr;
@@ -1630,6 +1835,8 @@ void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type, uin
     struct mclag_fdb_info * mac_info;
     ssize_t rc;
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    int batch = 0;
+    uint64_t rx_usec;
 
     sys = system_get_instance();
     if (sys == NULL)
@@ -1644,38 +1851,57 @@ void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type, uin
         return;
     }
 
-    memset(msg_buf, 0, ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE);
-
-    msg_hdr = (struct IccpSyncdHDr *)msg_buf;
-    msg_hdr->ver = ICCPD_TO_MCLAGSYNCD_HDR_VERSION;
-    msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB;
+    if (sys->sync_fd > 0 && (sys->syncd_capability & MCLAG_SYNCD_CAP_FDB_BATCH))
+    {
+        mac_info = iccp_fdb_batch_slot(sys, mac_msg);
+        batch = 1;
+    }
+    else
+    {
+        memset(msg_buf, 0, ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE);
+        mac_info = (struct mclag_fdb_info *)&msg_buf[sizeof(struct IccpSyncdHDr)];
+    }
 
     /*mac msg */
-    mac_info = (struct mclag_fdb_info *)&msg_buf[sizeof(struct IccpSyncdHDr)];
+    memset(mac_info, 0, sizeof(struct mclag_fdb_info));
     mac_info->vid = mac_msg->vid;
     memcpy(mac_info->port_name, mac_msg->ifname, MAX_L_PORT_NAME);
     memcpy(mac_info->mac, mac_msg->mac_addr, ETHER_ADDR_LEN);
     mac_info->type = mac_type;
     mac_info->op_type = oper;
-    msg_hdr->len = sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_info);
 
-    ICCPD_LOG_DEBUG("ICCP_FDB", "Send fdb to syncd: write mac msg vid : %d ; ifname %s ; mac %s fdb type %d ; op type %s",
-        mac_info->vid, mac_info->port_name, mac_addr_to_str(mac_info->mac), mac_info->type,
+    ICCPD_LOG_DEBUG("ICCP_FDB", "Send fdb to syncd: %s mac msg vid : %d ; ifname %s ; mac %s fdb type %d ; op type %s",
+        batch ? "batch" : "write", mac_info->vid, mac_info->port_name, mac_addr_to_str(mac_info->mac), mac_info->type,
         oper == MAC_SYNC_ADD ? "add" : "del");
 
-    /*send msg*/
-    if (sys->sync_fd > 0 )
+    if (!batch)
     {
-        rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
-        if (rc <= 0)
+        msg_hdr = (struct IccpSyncdHDr *)msg_buf;
+        msg_hdr->ver = ICCPD_TO_MCLAGSYNCD_HDR_VERSION;
+        msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB;
+        msg_hdr->len = sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_info);
+
+        /*send msg*/
+        if (sys->sync_fd > 0 )
         {
-            ICCPD_LOG_WARN(__FUNCTION__, "Send to Mclagsyncd failed rc: %d",rc);
+            rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
+            if (rc <= 0)
+            {
+                ICCPD_LOG_WARN(__FUNCTION__, "Send to Mclagsyncd failed rc: %d",rc);
+            }
+            else
+            {
+                rx_usec = sys->peer_rx_usec;
+                system_latency_record(LATENCY_MAC_TO_SYNCD, &rx_usec);
+            }
+            SYSTEM_ADD_SYNCD_FDB_ENTRY_COUNTER(sys, 1, rc > 0);
+        }
+        else
+        {
+            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
+            SYSTEM_ADD_SYNCD_FDB_ENTRY_COUNTER(sys, 1, 0);
+            ICCPD_LOG_ERR(__FUNCTION__, "Invalid sync_fd Failed to write, fd %d", sys->sync_fd);
         }
-    }
-    else
-    {
-        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
-        ICCPD_LOG_ERR(__FUNCTION__, "Invalid sync_fd Failed to write, fd %d", sys->sync_fd);
     }
 
     if (oper == MAC_SYNC_DEL)
@@ -1686,6 +1912,79 @@ void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type, uin
     return;
 }
 
+/*****************************************
+* MAC interface index
+*
+* mac_rb entries are also hashed by origin_ifname and ifname so that
+* interface and peer-link events only visit the MACs on that interface.
+* Names of entries in mac_rb must be changed through the setters below.
+* ***************************************/
+void mlacp_mac_index_init(struct CSM* csm)
+{
+    int i;
+
+    if (!csm)
+        return;
+
+    for (i = 0; i < MAC_IF_HASH_SIZE; ++i)
+    {
+        LIST_INIT(&(MLACP(csm).mac_origin_hash[i]));
+        LIST_INIT(&(MLACP(csm).mac_ifname_hash[i]));
+    }
+
+    return;
+}
+
+void mlacp_mac_index_add(struct CSM* csm, struct MACMsg* mac_msg)
+{
+    if (!csm || !mac_msg)
+        return;
+
+    LIST_INSERT_HEAD(MAC_ORIGIN_HASH_HEAD(csm, mac_msg->origin_ifname), mac_msg, origin_hash_next);
+    LIST_INSERT_HEAD(MAC_IFNAME_HASH_HEAD(csm, mac_msg->ifname), mac_msg, ifname_hash_next);
+    mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
+
+    return;
+}
+
+void mlacp_mac_set_ifname(struct CSM* csm, struct MACMsg* mac_msg, const char* ifname)
+{
+    int indexed = IF_IN_HASH(mac_msg, ifname_hash_next);
+
+    if (ifname == mac_msg->ifname || strncmp(mac_msg->ifname, ifname, MAX_L_PORT_NAME) == 0)
+        return;
+
+    if (indexed)
+        LIST_REMOVE(mac_msg, ifname_hash_next);
+    snprintf(mac_msg->ifname, MAX_L_PORT_NAME, "%s", ifname);
+    if (indexed)
+    {
+        LIST_INSERT_HEAD(MAC_IFNAME_HASH_HEAD(csm, mac_msg->ifname), mac_msg, ifname_hash_next);
+        mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
+    }
+
+    return;
+}
+
+void mlacp_mac_set_origin_ifname(struct CSM* csm, struct MACMsg* mac_msg, const char* ifname)
+{
+    int indexed = IF_IN_HASH(mac_msg, origin_hash_next);
+
+    if (ifname == mac_msg->origin_ifname || strncmp(mac_msg->origin_ifname, ifname, MAX_L_PORT_NAME) == 0)
+        return;
+
+    if (indexed)
+        LIST_REMOVE(mac_msg, origin_hash_next);
+    snprintf(mac_msg->origin_ifname, MAX_L_PORT_NAME, "%s", ifname);
+    if (indexed)
+    {
+        LIST_INSERT_HEAD(MAC_ORIGIN_HASH_HEAD(csm, mac_msg->origin_ifname), mac_msg, origin_hash_next);
+        mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
+    }
+
+    return;
+}
+
 void add_mac_to_chip(struct MACMsg* mac_msg, uint8_t mac_type)
 {
     iccp_send_fdb_entry_to_syncd( mac_msg, mac_type, MAC_SYNC_ADD);
@@ -1722,6 +2021,7 @@ uint8_t set_mac_local_age_flag(struct CSM *csm, struct MACMsg* mac_msg, uint8_t
                 mac_msg->op_type = MAC_SYNC_ADD;
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
+                    mac_msg->peer_tx_stamp = iccp_timer_now_usec();
                     TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), mac_msg, tail);
                 }
                 /*ICCPD_LOG_DEBUG(__FUNCTION__, "MAC-msg-list enqueue: %s, add %s vlan-id %d, age_flag %d",
@@ -1745,6 +2045,7 @@ uint8_t set_mac_local_age_flag(struct CSM *csm, struct MACMsg* mac_msg, uint8_t
                 mac_msg->op_type = MAC_SYNC_DEL;
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
+                    mac_msg->peer_tx_stamp = iccp_timer_now_usec();
                     TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), mac_msg, tail);
                 }
 
@@ -1773,6 +2074,9 @@ static void update_l2_mac_state(struct CSM *csm,
     if (po_state == 0)
     {
         lif->po_down_time = time(NULL);
+        if (MLACP(csm).po_down_expire_time == 0
+            || MLACP(csm).po_down_expire_time > lif->po_down_time + MLACP_LOCAL_IF_DOWN_TIMER)
+            MLACP(csm).po_down_expire_time = lif->po_down_time + MLACP_LOCAL_IF_DOWN_TIMER;
         ICCPD_LOG_DEBUG("ICCP_FDB", "Intf down,  ifname: %s, po_down_time: %u", lif->name, lif->po_down_time);
     }
     else
@@ -1782,7 +2086,7 @@ static void update_l2_mac_state(struct CSM *csm,
     }
 
 
-    RB_FOREACH_SAFE (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    MAC_LIST_FOREACH_SAFE (mac_msg, MAC_ORIGIN_HASH_HEAD(csm, lif->name), origin_hash_next, mac_temp)
     {
         /* find the MAC for this interface*/
         if (strcmp(lif->name, mac_msg->origin_ifname) != 0)
@@ -1796,7 +2100,7 @@ static void update_l2_mac_state(struct CSM *csm,
             {
                 if ((strlen(csm->peer_itf_name) != 0) && csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
                 {
-                    memcpy(mac_msg->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                    mlacp_mac_set_ifname(csm, mac_msg, csm->peer_itf_name);
 
                     ICCPD_LOG_DEBUG("ICCP_FDB", "Intf down, MAC learn local only, age flag %d, "
                        "redirect MAC to peer-link: %s, MAC %s vlan-id %d",
@@ -1808,7 +2112,7 @@ static void update_l2_mac_state(struct CSM *csm,
                 else
                 {
                     del_mac_from_chip(mac_msg);
-                    memcpy(mac_msg->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                    mlacp_mac_set_ifname(csm, mac_msg, csm->peer_itf_name);
                     ICCPD_LOG_DEBUG("ICCP_FDB", "Intf down,  MAC learn local only, age flag %d, "
                        "can not redirect, del MAC as peer-link %s not available or down, "
                        "MAC %s vlan-id %d", mac_msg->age_flag, mac_msg->ifname,
@@ -1821,6 +2125,8 @@ static void update_l2_mac_state(struct CSM *csm,
             }
 
             mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 1, 1);
+            if (mac_msg->age_flag != (MAC_AGE_LOCAL | MAC_AGE_PEER))
+                mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
 
             ICCPD_LOG_DEBUG("ICCP_FDB", "Intf down, age flag %d, MAC %s, "
                 "vlan-id %d, Interface: %s", mac_msg->age_flag ,
@@ -1837,12 +2143,14 @@ static void update_l2_mac_state(struct CSM *csm,
                        mac_msg->vid, mac_msg->ifname);
 
                 MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+                mlacp_sync_log_mac_del(csm, mac_msg);
+                mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_DEL);
 
                 // free only if not in change list to be send to peer node,
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    iccp_csm_free_mac_msg(mac_msg);
                 }
             }
             else
@@ -1854,7 +2162,7 @@ static void update_l2_mac_state(struct CSM *csm,
                     /*Is need to delete the old item before add?(Old item probably is static)*/
                     if (csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
                     {
-                        memcpy(mac_msg->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                        mlacp_mac_set_ifname(csm, mac_msg, csm->peer_itf_name);
                         add_mac_to_chip(mac_msg, mac_msg->fdb_type);
                         ICCPD_LOG_DEBUG("ICCP_FDB", "Intf down, age flag %d, "
                            "redirect MAC to peer-link: %s, MAC %s vlan-id %d",
@@ -1866,7 +2174,7 @@ static void update_l2_mac_state(struct CSM *csm,
                         /*must redirect but peerlink is down, del mac from ASIC*/
                         /*if peerlink change to up, mac will add back to ASIC*/
                         del_mac_from_chip(mac_msg);
-                        memcpy(mac_msg->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                        mlacp_mac_set_ifname(csm, mac_msg, csm->peer_itf_name);
                         ICCPD_LOG_DEBUG("ICCP_FDB", "Intf down, age flag %d, "
                            "can not redirect, del MAC as peer-link: %s down, "
                            "MAC %s vlan-id %d", mac_msg->age_flag, mac_msg->ifname,
@@ -1903,7 +2211,7 @@ static void update_l2_mac_state(struct CSM *csm,
                 //mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 0, 1);
 
                 /*Reverse interface from peer-link to the original portchannel*/
-                memcpy(mac_msg->ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+                mlacp_mac_set_ifname(csm, mac_msg, mac_msg->origin_ifname);
 
                 /*Send dynamic or static mac add message to mclagsyncd*/
 
@@ -1927,11 +2235,13 @@ static void update_l2_mac_state(struct CSM *csm,
                     {
                         //TBD do we need to send delete notification to peer .?
                         MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+                        mlacp_sync_log_mac_del(csm, mac_msg);
+                        mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_DEL);
 
                         mac_msg->op_type = MAC_SYNC_DEL;
                         if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                         {
-                            free(mac_msg);
+                            iccp_csm_free_mac_msg(mac_msg);
                         }
                     }
                     else
@@ -1951,7 +2261,7 @@ static void update_l2_mac_state(struct CSM *csm,
                 mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 0, 1);
 
 
-                memcpy(mac_msg->ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+                mlacp_mac_set_ifname(csm, mac_msg, mac_msg->origin_ifname);
 
                 /*Send dynamic or static mac add message to mclagsyncd*/
                 add_mac_to_chip(mac_msg, mac_msg->fdb_type);
@@ -1975,7 +2285,7 @@ void update_orphan_port_mac(struct CSM *csm,
     if (!state)
         return;
 
-    RB_FOREACH_SAFE (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    MAC_LIST_FOREACH_SAFE (mac_msg, MAC_ORIGIN_HASH_HEAD(csm, lif->name), origin_hash_next, mac_temp)
     {
         if (strcmp(mac_msg->origin_ifname, lif->name ) != 0)
             continue;
@@ -1992,6 +2302,7 @@ void update_orphan_port_mac(struct CSM *csm,
 
             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
             {
+                mac_msg->peer_tx_stamp = iccp_timer_now_usec();
                 TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), mac_msg, tail);
             }
         }
@@ -2013,7 +2324,7 @@ void mlacp_convert_remote_mac_to_local(struct CSM *csm, char *po_name)
         return;
     }
 
-    RB_FOREACH_SAFE (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    MAC_LIST_FOREACH_SAFE (mac_msg, MAC_ORIGIN_HASH_HEAD(csm, po_name), origin_hash_next, mac_temp)
     {
         if (strcmp(mac_msg->origin_ifname, po_name) != 0)
             continue;
@@ -2022,6 +2333,7 @@ void mlacp_convert_remote_mac_to_local(struct CSM *csm, char *po_name)
         if (mac_msg->age_flag == MAC_AGE_LOCAL)
         {
             mac_msg->age_flag = MAC_AGE_PEER;
+            mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
             ICCPD_LOG_DEBUG("ICCP_FDB", "Convert remote mac on Origin Interface as local: interface %s, "
                     "interface %s, MAC %s vlan-id %d age flag:%d", mac_msg->origin_ifname,
                     mac_msg->ifname, mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid, mac_msg->age_flag);
@@ -2033,6 +2345,7 @@ void mlacp_convert_remote_mac_to_local(struct CSM *csm, char *po_name)
 
             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
             {
+                mac_msg->peer_tx_stamp = iccp_timer_now_usec();
                 TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), mac_msg, tail);
             }
         }
@@ -2047,7 +2360,7 @@ static void update_remote_macs_to_peerlink(struct CSM *csm, struct LocalInterfac
     if (!csm || !lif)
         return;
 
-    RB_FOREACH (mac_entry, mac_rb_tree, &MLACP(csm).mac_rb)
+    LIST_FOREACH (mac_entry, MAC_ORIGIN_HASH_HEAD(csm, lif->name), origin_hash_next)
     {
         /* find the MAC for this interface*/
         if (strcmp(lif->name, mac_entry->origin_ifname) != 0)
@@ -2074,7 +2387,7 @@ static void update_remote_macs_to_peerlink(struct CSM *csm, struct LocalInterfac
                 //change it
                 if (strcmp(mac_entry->ifname, csm->peer_itf_name) != 0)
                 {
-                    memcpy(mac_entry->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                    mlacp_mac_set_ifname(csm, mac_entry, csm->peer_itf_name);
                     add_mac_to_chip(mac_entry, mac_entry->fdb_type);
                     ICCPD_LOG_DEBUG("ICCP_FDB", "Update remote macs to peer: age flag %d, "
                             "redirect MAC to peer-link: %s, MAC %s vlan-id %d",
@@ -2101,6 +2414,7 @@ void mlacp_portchannel_state_handler(struct CSM* csm,
             local_if->po_active, local_if->is_traffic_disable,
             mlacp_state(csm), local_if->port_config_sync, local_if->changed);
 
+    mclagd_ctl_watch_po(csm, local_if->name, 0, po_state);
     update_peerlink_isolate_from_lif(csm, local_if, po_state);
 
     update_l2_mac_state(csm, local_if, po_state);
@@ -2260,6 +2574,7 @@ void mlacp_peer_conn_handler(struct CSM* csm)
     ICCPD_LOG_NOTICE("ICCP_FSM", "ICCP session up: warm reboot %s, role %s",
         (sys->warmboot_start == WARM_REBOOT) ? "yes" : "no",
         (csm->role_type == STP_ROLE_STANDBY) ? "standby" : "active");
+    mclagd_ctl_watch_session(csm, 1);
 
     /*If peer connect again, don't flush FDB*/
     if (once_connected == 0)
@@ -2273,6 +2588,8 @@ void mlacp_peer_conn_handler(struct CSM* csm)
 
     sys->csm_trans_time = time(NULL);
     mlacp_conn_handler_fdb(csm);
+    /* Only the first session after a warm reboot can skip what the peer kept */
+    csm->warm_snapshot_time = 0;
 
     LIST_FOREACH(lif, &(MLACP(csm).lif_list), mlacp_next)
     {
@@ -2325,6 +2642,8 @@ void mlacp_peer_disconn_fdb_handler(struct CSM* csm)
         if (strcmp(mac_msg->ifname, csm->peer_itf_name) == 0)
         {
             mac_msg->age_flag |= MAC_AGE_PEER;
+            if (mac_msg->age_flag != (MAC_AGE_LOCAL | MAC_AGE_PEER) && !mac_msg->pending_local_del)
+                mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
 
             /* local and peer both aged, to be deleted*/
             // delete peer-link check, delete all remote macs which are aged local and remote.
@@ -2337,11 +2656,13 @@ void mlacp_peer_disconn_fdb_handler(struct CSM* csm)
                 del_mac_from_chip(mac_msg);
 
                 MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+                mlacp_sync_log_mac_del(csm, mac_msg);
+                mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_DEL);
                 // free only if not in change list to be send to peer node,
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    iccp_csm_free_mac_msg(mac_msg);
                 }
             }
         }
@@ -2351,6 +2672,7 @@ void mlacp_peer_disconn_fdb_handler(struct CSM* csm)
             {
                 // MAC learned on both nodes convert to local not update to ASIC required.
                 mac_msg->age_flag = MAC_AGE_PEER;
+                mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
                 ICCPD_LOG_DEBUG("ICCP_FDB", "ICCP session down: MAC learned on both nodes update to local only"
                     " flag %d interface %s, MAC %s vlan-id %d", mac_msg->age_flag, mac_msg->ifname,
                     mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid);
@@ -2360,6 +2682,7 @@ void mlacp_peer_disconn_fdb_handler(struct CSM* csm)
                 // MAC is remote pointing to MCLAG PO convert to local
                 add_mac_to_chip(mac_msg, MAC_TYPE_DYNAMIC_LOCAL);
                 mac_msg->age_flag = MAC_AGE_PEER;
+                mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
                 ICCPD_LOG_DEBUG("ICCP_FDB", "ICCP session down: MAC is remote convert to local"
                     " flag %d interface %s, MAC %s vlan-id %d", mac_msg->age_flag, mac_msg->ifname,
                     mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid);
@@ -2395,6 +2718,7 @@ void mlacp_peer_disconn_handler(struct CSM* csm)
             (sys->warmboot_exit == WARM_REBOOT) ? "yes" : "no",
             (csm->role_type == STP_ROLE_STANDBY) ? "standby" : "active",
             mlacp_state(csm));
+        mclagd_ctl_watch_session(csm, 0);
     }
     /*If warm reboot, don't change FDB and MAC address*/
     if (sys->warmboot_exit == WARM_REBOOT)
@@ -2411,6 +2735,9 @@ void mlacp_peer_disconn_handler(struct CSM* csm)
         return;
     }
 
+    /* The peer entries are dropped, the next resync must be a full one */
+    MLACP(csm).peer_sync_seq = 0;
+
     mlacp_peer_disconn_fdb_handler(csm);
 
     /* Send ICCP down update to Mclagsyncd before clearing all port isolation
@@ -2475,7 +2802,7 @@ void mlacp_peerlink_up_handler(struct CSM* csm)
         csm->peer_itf_name, mlacp_state(csm));
 
     /*If peer link up, set all the mac that point to the peer-link in ASIC*/
-    RB_FOREACH (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+    LIST_FOREACH (mac_msg, MAC_IFNAME_HASH_HEAD(csm, csm->peer_itf_name), ifname_hash_next)
     {
         /* Find the MAC that the port is peer-link to be added*/
         if (strcmp(mac_msg->ifname, csm->peer_itf_name) != 0)
@@ -2503,14 +2830,18 @@ void mlacp_peerlink_down_handler(struct CSM* csm)
         csm->peer_itf_name, mlacp_state(csm));
 
     /*If peer link down, remove all the mac that point to the peer-link*/
-    RB_FOREACH_SAFE (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    MAC_LIST_FOREACH_SAFE (mac_msg, MAC_IFNAME_HASH_HEAD(csm, csm->peer_itf_name), ifname_hash_next, mac_temp)
     {
         /* Find the MAC that the port is peer-link to be deleted*/
         if (strcmp(mac_msg->ifname, csm->peer_itf_name) != 0)
             continue;
 
         if (!mac_msg->pending_local_del)
+        {
             mac_msg->age_flag = set_mac_local_age_flag(csm, mac_msg, 1, 1);
+            if (mac_msg->age_flag != (MAC_AGE_LOCAL | MAC_AGE_PEER))
+                mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
+        }
 
         ICCPD_LOG_DEBUG("ICCP_FDB", "Peer link down, del MAC for peer-link: %s,"
             " MAC %s vlan-id %d", mac_msg->ifname, mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid);
@@ -2523,12 +2854,14 @@ void mlacp_peerlink_down_handler(struct CSM* csm)
         {
             /*If local and peer both aged, del the mac*/
             MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+            mlacp_sync_log_mac_del(csm, mac_msg);
+            mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_DEL);
 
             // free only if not in change list to be send to peer node,
             // else free is taken care after sending the update to peer
             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
             {
-                free(mac_msg);
+                iccp_csm_free_mac_msg(mac_msg);
             }
         }
     }
@@ -2664,6 +2997,13 @@ void syncd_info_close()
         close(sys->sync_fd);
         sys->sync_fd = -1;
     }
+    g_iccp_mlagsyncd_recv_len = 0;
+    iccp_mclagsyncd_tx_queue_free();
+
+    /* Whatever was batched is lost with the connection, a new mclagsyncd
+     * advertises its capabilities again */
+    iccp_send_fdb_batch_to_syncd();
+    sys->syncd_capability = 0;
 
     return;
 }
@@ -2803,6 +3143,12 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
         /*same MAC exist*/
         if (mac_exist)
         {
+            uint8_t old_age_flag = mac_info->age_flag;
+            uint8_t old_fdb_type = mac_info->fdb_type;
+
+            /*Replayed by mclagsyncd after warm reboot*/
+            mac_info->warm_state &= ~MAC_WARM_STALE;
+
             /*If the current mac port is peer-link, it will handle by port up event*/
             /*if(strcmp(csm->peer_itf_name, mac_info->ifname) == 0)
                {
@@ -2826,7 +3172,8 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
 
                     mac_info->pending_local_del = 1;
                     mac_info->fdb_type = mac_msg->fdb_type;
-                    memcpy(&mac_info->origin_ifname, mac_msg->ifname, MAX_L_PORT_NAME);
+                    mac_info->warm_state &= ~MAC_WARM_RESTORED;
+                    mlacp_mac_set_origin_ifname(csm, mac_info, mac_msg->ifname);
 
                     //existing mac must be pointing to peer_link, else update if info and send to syncd
                     if (strcmp(mac_info->ifname, csm->peer_itf_name) == 0)
@@ -2837,9 +3184,11 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                     {
                         // this for the case of MAC move , existing mac may point to different interface.
                         // need to update the ifname and update to syncd.
-                        memcpy(&mac_info->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                        mlacp_mac_set_ifname(csm, mac_info, csm->peer_itf_name);
                         add_mac_to_chip(mac_info, mac_msg->fdb_type);
                     }
+                    if (mac_info->fdb_type != old_fdb_type)
+                        mclagd_ctl_watch_mac(csm, mac_info, MCLAGD_WATCH_OP_ADD);
 
                     return;
                 }
@@ -2854,8 +3203,9 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                 || strcmp(mac_info->origin_ifname, mac_msg->ifname) != 0)
             {
                 mac_info->fdb_type = mac_msg->fdb_type;
-                sprintf(mac_info->ifname, "%s", mac_msg->ifname);
-                sprintf(mac_info->origin_ifname, "%s", mac_msg->ifname);
+                mac_info->warm_state &= ~MAC_WARM_RESTORED;
+                mlacp_mac_set_ifname(csm, mac_info, mac_msg->ifname);
+                mlacp_mac_set_origin_ifname(csm, mac_info, mac_msg->ifname);
 
                 /*Remove MAC_AGE_LOCAL flag*/
                 mac_info->age_flag = set_mac_local_age_flag(csm, mac_info, 0, 1);
@@ -2871,6 +3221,8 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
 		    mac_info->age_flag = MAC_AGE_PEER;
                     del_mac_from_chip(mac_msg);
                 }
+                if (mac_info->age_flag != old_age_flag || mac_info->fdb_type != old_fdb_type)
+                    mclagd_ctl_watch_mac(csm, mac_info, MCLAGD_WATCH_OP_ADD);
             }
             else
             {
@@ -2887,6 +3239,8 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                             mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid, mac_msg->ifname);
                     del_mac_from_chip(mac_msg);
                 }
+                if (mac_info->age_flag != old_age_flag)
+                    mclagd_ctl_watch_mac(csm, mac_info, MCLAGD_WATCH_OP_ADD);
                 return;
             }
         }
@@ -2926,6 +3280,7 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
             if (iccp_csm_init_mac_msg(&new_mac_msg, (char*)mac_msg, msg_len) == 0)
             {
                 RB_INSERT(mac_rb_tree, &MLACP(csm).mac_rb, new_mac_msg);
+                mlacp_mac_index_add(csm, new_mac_msg);
 
                 ICCPD_LOG_DEBUG("ICCP_FDB", "MAC update from mclagsyncd: MAC-list enqueue interface %s, "
                         "MAC %s vlan-id %d", mac_msg->ifname,
@@ -2950,6 +3305,7 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
 
                 if ((MLACP(csm).current_state == MLACP_STATE_EXCHANGE))
                 {
+                    new_mac_msg->peer_tx_stamp = iccp_timer_now_usec();
                     TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), new_mac_msg, tail);
 
                     ICCPD_LOG_DEBUG("ICCP_FDB", "MAC update from mclagsyncd: MAC-msg-list enqueue interface %s, "
@@ -2980,6 +3336,8 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                 }
                 /*Set MAC_AGE_LOCAL flag*/
                 mac_info->age_flag = set_mac_local_age_flag(csm, mac_info, 1, 1);
+                if (mac_info->age_flag != (MAC_AGE_LOCAL | MAC_AGE_PEER))
+                    mclagd_ctl_watch_mac(csm, mac_info, MCLAGD_WATCH_OP_ADD);
 
                 if (mac_info->age_flag == (MAC_AGE_LOCAL | MAC_AGE_PEER))
                 {
@@ -2994,12 +3352,14 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
 
                     /*If peer link is down, del the mac*/
                     MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_info);
+                    mlacp_sync_log_mac_del(csm, mac_info);
+                    mclagd_ctl_watch_mac(csm, mac_info, MCLAGD_WATCH_OP_DEL);
 
                     // free only if not in change list to be send to peer node,
                     // else free is taken care after sending the update to peer
                     if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_info, tail))
                     {
-                        free(mac_info);
+                        iccp_csm_free_mac_msg(mac_info);
                     }
                 }
                 else if (csm->peer_link_if && csm->peer_link_if->state != PORT_STATE_DOWN)
@@ -3017,6 +3377,8 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
 
             /*Add MAC_AGE_LOCAL flag*/
             mac_info->age_flag = set_mac_local_age_flag(csm, mac_info, 1, 1);
+            if (mac_info->age_flag != (MAC_AGE_LOCAL | MAC_AGE_PEER))
+                mclagd_ctl_watch_mac(csm, mac_info, MCLAGD_WATCH_OP_ADD);
 
             if (mac_info->age_flag == (MAC_AGE_LOCAL | MAC_AGE_PEER))
             {
@@ -3031,12 +3393,14 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                 }
                 /*If local and peer both aged, del the mac (local orphan mac is here)*/
                 MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_info);
+                mlacp_sync_log_mac_del(csm, mac_info);
+                mclagd_ctl_watch_mac(csm, mac_info, MCLAGD_WATCH_OP_DEL);
 
                 // free only if not in change list to be send to peer node,
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_info, tail))
                 {
-                    free(mac_info);
+                    iccp_csm_free_mac_msg(mac_info);
                 }
             }
             else
@@ -3050,7 +3414,7 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                     /*If local if is down, redirect the mac to peer-link*/
                     if (strlen(csm->peer_itf_name) != 0)
                     {
-                        memcpy(&mac_info->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                        mlacp_mac_set_ifname(csm, mac_info, csm->peer_itf_name);
 
                         if (csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
                         {
@@ -3143,6 +3507,10 @@ int iccp_mclagsyncd_mclag_domain_cfg_handler(struct System *sys, char *msg_buf)
                     set_session_timeout(cfg_info->domain_id, HEARTBEAT_TIMEOUT_SEC);
                 }
             }
+
+            /* Tables saved before a warm reboot, needs the session addresses */
+            if (cfg_info->op_type == MCLAG_CFG_OPER_ADD)
+                iccp_warm_snapshot_restore(system_get_csm_by_mlacp_id(cfg_info->domain_id));
         } //MCLAG Domain create/update End
         else if (cfg_info->op_type == MCLAG_CFG_OPER_DEL) //mclag domain delete
         {
@@ -3206,6 +3574,26 @@ int iccp_mclagsyncd_mclag_iface_cfg_handler(struct System *sys, char *msg_buf)
     return 0;
 }
 
+int iccp_mclagsyncd_capability_handler(struct System *sys, char *msg_buf)
+{
+    struct IccpSyncdHDr * msg_hdr;
+    struct mclag_syncd_capability_info * cap_info;
+
+    msg_hdr = (struct IccpSyncdHDr *)msg_buf;
+    if (msg_hdr->len < sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_syncd_capability_info))
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "capability msg length %d too short", msg_hdr->len);
+        return MCLAG_ERROR;
+    }
+
+    cap_info = (struct mclag_syncd_capability_info *)&msg_buf[sizeof(struct IccpSyncdHDr)];
+    sys->syncd_capability = cap_info->flags;
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Mclagsyncd capability 0x%x, fdb batch %s",
+        sys->syncd_capability, (sys->syncd_capability & MCLAG_SYNCD_CAP_FDB_BATCH) ? "on" : "off");
+
+    return 0;
+}
+
 int iccp_mclagsyncd_mclag_unique_ip_cfg_handler(struct System *sys, char *msg_buf)
 {
     struct IccpSyncdHDr *msg_hdr;
@@ -3370,207 +3758,41 @@ int iccp_receive_fdb_handler_from_syncd(struct System *sys, char *msg_buf)
     return 0;
 }
 
-int iccp_mclagsyncd_msg_handler(struct System *sys)
+/* Dispatch every complete frame in the receive buffer, frames are
+ * handed to the handlers in place.
+ */
+static int iccp_mclagsyncd_parse_recv_buf(struct System *sys)
 {
-    int num_bytes_rxed = 0;
     char *msg_buf = g_iccp_mlagsyncd_recv_buf;
     struct IccpSyncdHDr * msg_hdr;
-    int pos = 0;
-    int recv_len = 0;
-    int num_retry = 0;
-    errno = 0;
-
-    if (sys == NULL)
-        return MCLAG_ERROR;
-    memset(msg_buf, 0, ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE);
-
-    /* read (max_size - msg_size) so that we have space to
-       accomodate anything remaining in the last message */
-    num_bytes_rxed = recv(sys->sync_fd, msg_buf,
-            ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE - MCLAG_MAX_MSG_LEN, MSG_DONTWAIT );
+    size_t pos = 0;
 
-    if (num_bytes_rxed <= 0)
+    while (g_iccp_mlagsyncd_recv_len - pos >= sizeof(struct IccpSyncdHDr))
     {
-        // if received count is 0 socket is closed.
-        if (num_bytes_rxed == 0)
+        msg_hdr = (struct IccpSyncdHDr *)(&msg_buf[pos]);
+
+        /* A 16 bit length always fits the receive buffer, only a length
+         * short of the header can stall the stream */
+        if (msg_hdr->len < sizeof(struct IccpSyncdHDr))
         {
-            ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd read erro:%d ", num_bytes_rxed);
-            SYSTEM_INCR_RX_READ_SOCK_ZERO_COUNTER(system_get_instance());
+            ICCPD_LOG_ERR(__FUNCTION__, "msg length %d invalid, type %d",
+                msg_hdr->len, msg_hdr->type);
             return MCLAG_ERROR;
         }
 
-        while( num_bytes_rxed < 0 )
-        {
-            recv_len = recv(sys->sync_fd, msg_buf,
-                        ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE - MCLAG_MAX_MSG_LEN, MSG_DONTWAIT );
+        /* Wait for the rest of the frame */
+        if (g_iccp_mlagsyncd_recv_len - pos < msg_hdr->len)
+            break;
 
-            if (recv_len == -1)
-            {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    ICCPD_LOG_NOTICE(
-                        "ICCP_FSM", "Recv fom Mclagsyncd Non-blocking recv errno %d, num_retry %d",
-                        errno, num_retry);
-                    ++num_retry;
-                    if (num_retry > SYNCD_RECV_RETRY_MAX)
-                    {
-                        ICCPD_LOG_NOTICE(
-                            "ICCP_FSM", "Recv fom Mclagsyncd retry failed recv_len: %d", recv_len);
-                        SYSTEM_INCR_RX_RETRY_FAIL_COUNTER(system_get_instance());
-                        return MCLAG_ERROR;
-                    }
-                    else
-                    {
-                        usleep(SYNCD_RECV_RETRY_INTERVAL_USEC);
-                        recv_len = 0;
-                    }
-                }
-                else
-                {
-                    ICCPD_LOG_NOTICE("ICCP_FSM", "Recv fom Mclagsyncd retry failed recv_len: %d", recv_len);
-                    SYSTEM_INCR_HDR_READ_SOCK_ERR_COUNTER(system_get_instance());
-                    return MCLAG_ERROR;
-                }
-            }
-            else if (recv_len == 0)
-            {
-                ICCPD_LOG_NOTICE("ICCP_FSM", "Recv fom Mclagsyncd error %d connection closed ", recv_len );
-                SYSTEM_INCR_HDR_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
-                return MCLAG_ERROR;
-            }
+        ICCPD_LOG_DEBUG(__FUNCTION__, "rcv msg version %d type %d len %d pos:%zu pending:%zu ",
+                msg_hdr->ver , msg_hdr->type, msg_hdr->len, pos, g_iccp_mlagsyncd_recv_len);
 
-            num_bytes_rxed += recv_len;
-        }
-    }
-
-    num_retry = 0;
-    while (pos < num_bytes_rxed) //iterate through all msgs
-    {
-        if ((num_bytes_rxed - pos) < sizeof(struct IccpSyncdHDr))
-        {
-            int recv_len = 0, len = 0;
-            int pending_len = sizeof(struct IccpSyncdHDr) - (num_bytes_rxed - pos);
-
-            ICCPD_LOG_NOTICE(__FUNCTION__, "Recv fom Mclagsync header less than expected, trying to retrieve %d bytes more ", pending_len);
-
-            while (recv_len < pending_len)
-            {
-                int remaining_len = pending_len-recv_len;
-                len = recv(sys->sync_fd, msg_buf+num_bytes_rxed+recv_len, remaining_len, MSG_DONTWAIT);
-                if (len <= 0)
-                {
-                    if (len == 0)
-                    {
-                        ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsync header less than expected data read error; recv_len:%d pending_len:%d ", recv_len, pending_len);
-                        SYSTEM_INCR_HDR_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
-                        return MCLAG_ERROR;
-                    }
-
-                    if (len == -1)
-                    {
-                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        {
-                            ICCPD_LOG_NOTICE(
-                                "ICCP_FSM", "Recv fom Mclagsync header less than expected Non-blocking recv errno %d, num_retry %d",
-                                errno, num_retry);
-                            ++num_retry;
-                            if (num_retry > SYNCD_RECV_RETRY_MAX)
-                            {
-                                ICCPD_LOG_ERR(
-                                    "ICCP_FSM", "Recv fom Mclagsync header less than expected Non-blocking recv() retry failed, len: %d, errno: %d", len, errno);
-                                SYSTEM_INCR_RX_RETRY_FAIL_COUNTER(system_get_instance());
-                                return MCLAG_ERROR;
-                            }
-                            else
-                            {
-                                usleep(SYNCD_RECV_RETRY_INTERVAL_USEC);
-                                len = 0;
-                            }
-                        }
-                        else
-                        {
-                            ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd header less than expected error; recv_len:%d errno %d",
-                                           recv_len, errno);
-                            SYSTEM_INCR_HDR_READ_SOCK_ERR_COUNTER(system_get_instance());
-                            return MCLAG_ERROR;
-                        }
-                    }
-                }
-                ICCPD_LOG_NOTICE("ICCP_FSM", "received %d pending bytes", len);
-                recv_len += len;
-            }
-        }
-
-        msg_hdr = (struct IccpSyncdHDr *)(&msg_buf[pos]);
-        ICCPD_LOG_DEBUG(__FUNCTION__, "rcv msg version %d type %d len %d pos:%d num_bytes_rxed:%d ",
-                msg_hdr->ver , msg_hdr->type, msg_hdr->len, pos, num_bytes_rxed);
-
-        if (!msg_hdr->len)
-        {
-            ICCPD_LOG_ERR(__FUNCTION__, "msg length zero!!!!! ");
-            return MCLAG_ERROR;
-        }
         if (msg_hdr->ver != 1)
         {
             ICCPD_LOG_ERR(__FUNCTION__, "msg version %d wrong!!!!! ", msg_hdr->ver);
             pos += msg_hdr->len;
             continue;
         }
-        if ((pos + msg_hdr->len) > num_bytes_rxed)
-        {
-            int recv_len = 0, len = 0;
-            int pending_len = pos + msg_hdr->len - num_bytes_rxed;
-
-            ICCPD_LOG_NOTICE(__FUNCTION__, "Recv fom Mclagsyncd msg less than expected, trying to retrieve %d bytes more ",
-                pending_len);
-
-            while (recv_len < pending_len)
-            {
-                int remaining_len = pending_len-recv_len;
-                len = recv(sys->sync_fd, msg_buf+num_bytes_rxed+recv_len, remaining_len, MSG_DONTWAIT);
-                if (len <= 0)
-                {
-                    if (len == 0)
-                    {
-                        ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd msg less than expected read error; len:%d ",len);
-                        SYSTEM_INCR_TLV_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
-                        return MCLAG_ERROR;
-                    }
-
-                    if (len == -1)
-                    {
-                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        {
-                            ICCPD_LOG_NOTICE(
-                                "ICCP_FSM", "Recv fom Mclagsyncd msg less than expected Non-blocking recv errno %d, num_retry %d",
-                                errno, num_retry);
-                            ++num_retry;
-                            if (num_retry > SYNCD_RECV_RETRY_MAX)
-                            {
-                                ICCPD_LOG_ERR("ICCP_FSM", "Recv fom Mclagsyncd msg less than expected Non-blocking recv() retry failed len %d",len);
-                                SYSTEM_INCR_RX_RETRY_FAIL_COUNTER(system_get_instance());
-                                return MCLAG_ERROR;
-                            }
-                            else
-                            {
-                                usleep(SYNCD_RECV_RETRY_INTERVAL_USEC);
-                                len = 0;
-                            }
-                        }
-                        else
-                        {
-                            ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd msg less than expectedread retry error len:%d , errno %d",
-                                           len, errno);
-                            SYSTEM_INCR_TLV_READ_SOCK_ERR_COUNTER(system_get_instance());
-                            return MCLAG_ERROR;
-                        }
-                    }
-
-                }
-                ICCPD_LOG_NOTICE(__FUNCTION__, "received %d pending bytes", len);
-                recv_len += len;
-            }
-        }
 
         if (msg_hdr->type == MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION)
         {
@@ -3592,6 +3814,10 @@ int iccp_mclagsyncd_msg_handler(struct System *sys)
         {
             iccp_mclagsyncd_vlan_mbr_update_handler(sys, &msg_buf[pos]);
         }
+        else if (msg_hdr->type == MCLAG_SYNCD_MSG_TYPE_CAPABILITY)
+        {
+            iccp_mclagsyncd_capability_handler(sys, &msg_buf[pos]);
+        }
         else
         {
             ICCPD_LOG_ERR(__FUNCTION__, "recv unknown msg type %d ", msg_hdr->type);
@@ -3601,7 +3827,63 @@ int iccp_mclagsyncd_msg_handler(struct System *sys)
         pos += msg_hdr->len;
         SYSTEM_SET_SYNCD_RX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
     }
+
+    if (pos > 0)
+    {
+        g_iccp_mlagsyncd_recv_len -= pos;
+        if (g_iccp_mlagsyncd_recv_len > 0)
+            memmove(msg_buf, &msg_buf[pos], g_iccp_mlagsyncd_recv_len);
+    }
+
+    return 0;
+}
+
+/* Read what mclagsyncd has sent, never wait for the rest of a frame */
+int iccp_mclagsyncd_msg_handler(struct System *sys)
+{
+    char *msg_buf = g_iccp_mlagsyncd_recv_buf;
+    ssize_t recv_len = 0;
+    int num_read = 0;
+
+    if (sys == NULL)
+        return MCLAG_ERROR;
+
+    while (num_read++ < SYNCD_RECV_READ_MAX)
+    {
+        recv_len = recv(sys->sync_fd, msg_buf + g_iccp_mlagsyncd_recv_len,
+                ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE - g_iccp_mlagsyncd_recv_len, MSG_DONTWAIT);
+
+        if (recv_len == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                break;
+
+            ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd error %s, pending len %zu",
+                strerror(errno), g_iccp_mlagsyncd_recv_len);
+            SYSTEM_INCR_RX_READ_SOCK_ERR_COUNTER(system_get_instance());
+            goto recv_err;
+        }
+        else if (recv_len == 0)
+        {
+            ICCPD_LOG_WARN("ICCP_FSM", "Recv fom Mclagsyncd connection closed, pending len %zu",
+                g_iccp_mlagsyncd_recv_len);
+            SYSTEM_INCR_RX_READ_SOCK_ZERO_COUNTER(system_get_instance());
+            goto recv_err;
+        }
+
+        g_iccp_mlagsyncd_recv_len += recv_len;
+        if (iccp_mclagsyncd_parse_recv_buf(sys) < 0)
+            goto recv_err;
+    }
+
     return 0;
+
+ recv_err:
+    /* Reconnect from the scheduler loop, stream framing starts over */
+    syncd_info_close();
+    return MCLAG_ERROR;
 }
 
 
@@ -3685,12 +3967,18 @@ char * mclagd_ctl_cmd_str(int req_type)
         case INFO_TYPE_DUMP_DBG_COUNTERS:
             return "dump debug counters";
 
+        case INFO_TYPE_DUMP_LATENCY:
+            return "dump debug latency";
+
         case INFO_TYPE_DUMP_UNIQUE_IP:
             return "dump unique_ip";
 
         case INFO_TYPE_CONFIG_LOGLEVEL:
             return "config loglevel";
 
+        case INFO_TYPE_WATCH:
+            return "watch";
+
         default:
             break;
     }
@@ -3752,76 +4040,298 @@ int mclagd_ctl_sock_create()
     return sys->sync_ctrl_fd;
 }
 
-int mclagd_ctl_sock_accept(int fd)
+/* mclagdctl connections are served from the event loop. Requests are read
+ * and replies written without blocking, what the socket does not take at
+ * once is kept and flushed on EPOLLOUT, so a large dump never stalls the
+ * peer session. A client may send several requests, one page each.
+ */
+#define MCLAGD_CTL_CLIENT_MAX           8
+#define MCLAGD_CTL_CLIENT_TIMEOUT_MSEC  (30 * 1000)
+/* A watcher with this much unsent is a slow reader, its change records
+ * are dropped and counted until it catches up */
+#define MCLAGD_CTL_WATCH_BUF_MAX        (256 * 1024)
+/* The snapshot is queued in parts of about this size, the next part once
+ * the client read the previous one */
+#define MCLAGD_CTL_WATCH_CHUNK          (64 * 1024)
+
+/* Watch snapshot stages, run for one mclag after the other */
+enum mclagd_ctl_watch_snap
 {
-    struct sockaddr_in client_addr;
-    int client_fd = 0;
-    unsigned int addr_len = 0;
+    MCLAGD_CTL_SNAP_NONE = 0,   /* snapshot sent */
+    MCLAGD_CTL_SNAP_PORT,       /* session and port-channels */
+    MCLAGD_CTL_SNAP_MAC,
+    MCLAGD_CTL_SNAP_ARP,
+    MCLAGD_CTL_SNAP_NDISC,
+};
+
+struct mclagd_ctl_client
+{
+    int fd;
+    int req_len;
+    char req_buf[sizeof(struct mclagdctl_req_hdr)];
+    char *out_buf;
+    int out_len;
+    int out_off;
+    int out_size;
+    int watch;              /* streaming change records */
+    int watch_id;           /* mclag id watched, 0 for all */
+    uint64_t watch_seq;
+    uint32_t watch_lost;    /* dropped since the last overflow record */
+    int watch_snap;         /* enum mclagd_ctl_watch_snap */
+    struct mclagd_dump_cursor watch_cursor; /* mclag and MAC the snapshot resumes at */
+    int watch_bucket;       /* neighbor hash bucket the snapshot resumes at */
+    struct iccp_timer idle_timer;
+    LIST_ENTRY(mclagd_ctl_client) next;
+};
+
+static LIST_HEAD(mclagd_ctl_client_list, mclagd_ctl_client) mclagd_ctl_clients =
+    LIST_HEAD_INITIALIZER(mclagd_ctl_clients);
+static int mclagd_ctl_client_count = 0;
+static int mclagd_ctl_watch_count = 0;
+
+static int mclagd_ctl_process(int client_fd, struct mclagdctl_req_hdr *req);
+static void mclagd_ctl_watch_put_lost(struct mclagd_ctl_client *client);
+static void mclagd_ctl_watch_snapshot(struct mclagd_ctl_client *client);
+
+static struct mclagd_ctl_client *mclagd_ctl_client_find(int fd)
+{
+    struct mclagd_ctl_client *client = NULL;
 
-    client_fd = accept(fd, (struct sockaddr*)&client_addr, &addr_len);
-    if (client_fd < 0)
+    LIST_FOREACH(client, &mclagd_ctl_clients, next)
     {
-        ICCPD_LOG_WARN(__FUNCTION__, "Failed to accept a client from mclagdctl");
-        return MCLAG_ERROR;
+        if (client->fd == fd)
+            return client;
     }
 
-    return client_fd;
+    return NULL;
 }
 
-int mclagd_ctl_sock_read(int fd, char *r_buf, int total_len)
+static void mclagd_ctl_client_close(struct mclagd_ctl_client *client)
 {
-    int read_len = 0;
-    int ret = 0;
-    struct timeval tv = { 0 };
-    fd_set read_fd;
+    struct System *sys = NULL;
 
-    while (read_len < total_len)
-    {
-        FD_ZERO(&read_fd);
-        FD_SET(fd, &read_fd);
-        tv.tv_sec = 5;
-        tv.tv_usec = 0;
+    if ((sys = system_get_instance()) != NULL)
+        epoll_ctl(sys->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
 
-        switch ((ret = select(fd + 1, &read_fd, NULL, NULL, &tv)))
-        {
-            case -1:
-            /* error*/
-            case 0:
-                /* timeout*/
-                return MCLAG_ERROR;
+    close(client->fd);
+    iccp_timer_stop(&client->idle_timer);
+    LIST_REMOVE(client, next);
+    --mclagd_ctl_client_count;
+    if (client->watch)
+        --mclagd_ctl_watch_count;
 
-            default:
-                break;
-        }
+    if (client->out_buf)
+        free(client->out_buf);
+    free(client);
+
+    return;
+}
+
+static void mclagd_ctl_client_idle_handler(void *arg)
+{
+    struct mclagd_ctl_client *client = (struct mclagd_ctl_client *)arg;
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Close idle mclagdctl client fd %d", client->fd);
+    mclagd_ctl_client_close(client);
+
+    return;
+}
+
+static void mclagd_ctl_client_set_events(struct mclagd_ctl_client *client, uint32_t events)
+{
+    struct System *sys = NULL;
+    struct epoll_event event;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    event.data.fd = client->fd;
+    event.events = events;
+    epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
 
-        if (FD_ISSET(fd, &read_fd))
-            ret = read(fd, r_buf + read_len, total_len - read_len);
-        if (ret <= 0)
+    return;
+}
+
+/* Write out the pending reply, waits for EPOLLOUT if the socket is full */
+static int mclagd_ctl_client_flush(struct mclagd_ctl_client *client)
+{
+    int ret;
+
+    while (client->out_off < client->out_len)
+    {
+        ret = write(client->fd, client->out_buf + client->out_off, client->out_len - client->out_off);
+        if (ret < 0)
         {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                mclagd_ctl_client_set_events(client, EPOLLOUT);
+                return 0;
+            }
+
             return MCLAG_ERROR;
         }
-        read_len += ret;
+        client->out_off += ret;
+    }
+
+    /* Reply sent, ready for the next request */
+    client->out_len = 0;
+    client->out_off = 0;
+    if (client->out_size > MCLAGD_CTL_WATCH_BUF_MAX)
+    {
+        free(client->out_buf);
+        client->out_buf = NULL;
+        client->out_size = 0;
+    }
+
+    /* The previous part of the snapshot is read, queue the next one */
+    if (client->watch_snap != MCLAGD_CTL_SNAP_NONE)
+    {
+        mclagd_ctl_watch_snapshot(client);
+        mclagd_ctl_client_set_events(client, EPOLLOUT);
+        return 0;
     }
 
-    return read_len;
+    /* Caught up, tell the watcher what it missed */
+    if (client->watch_lost > 0)
+    {
+        mclagd_ctl_watch_put_lost(client);
+        mclagd_ctl_client_set_events(client, EPOLLOUT);
+        return 0;
+    }
+    mclagd_ctl_client_set_events(client, EPOLLIN);
+
+    return 0;
 }
 
+void mclagd_ctl_sock_accept(int fd)
+{
+    struct System *sys = NULL;
+    struct mclagd_ctl_client *client = NULL;
+    struct epoll_event event;
+    int client_fd;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    client_fd = accept(fd, NULL, NULL);
+    if (client_fd < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to accept a client from mclagdctl");
+        return;
+    }
+    fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK);
+
+    if (mclagd_ctl_client_count >= MCLAGD_CTL_CLIENT_MAX
+        || (client = (struct mclagd_ctl_client *)calloc(1, sizeof(struct mclagd_ctl_client))) == NULL)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Reject mclagdctl client, %d clients connected", mclagd_ctl_client_count);
+        close(client_fd);
+        return;
+    }
+
+    client->fd = client_fd;
+    event.data.fd = client_fd;
+    event.events = EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, client_fd, &event) < 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to add mclagdctl client fd %d to epoll", client_fd);
+        close(client_fd);
+        free(client);
+        return;
+    }
+
+    LIST_INSERT_HEAD(&mclagd_ctl_clients, client, next);
+    ++mclagd_ctl_client_count;
+    iccp_timer_init(&client->idle_timer, mclagd_ctl_client_idle_handler, client);
+    iccp_timer_start(&client->idle_timer, MCLAGD_CTL_CLIENT_TIMEOUT_MSEC);
+
+    return;
+}
+
+/* Returns MCLAG_ERROR if fd is not an mclagdctl client */
+int mclagd_ctl_client_event(int fd, uint32_t events)
+{
+    struct mclagd_ctl_client *client = NULL;
+    int ret;
+
+    if ((client = mclagd_ctl_client_find(fd)) == NULL)
+        return MCLAG_ERROR;
+
+    if (events & EPOLLOUT)
+    {
+        if (mclagd_ctl_client_flush(client) < 0)
+            goto close_client;
+        return 0;
+    }
+
+    if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+        return 0;
+
+    ret = read(client->fd, client->req_buf + client->req_len, sizeof(client->req_buf) - client->req_len);
+    if (ret < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return 0;
+        goto close_client;
+    }
+    if (ret == 0)
+        goto close_client;
+
+    client->req_len += ret;
+    if (client->req_len < sizeof(client->req_buf))
+        return 0;
+
+    client->req_len = 0;
+    if (!client->watch)
+        iccp_timer_start(&client->idle_timer, MCLAGD_CTL_CLIENT_TIMEOUT_MSEC);
+
+    if (mclagd_ctl_process(client->fd, (struct mclagdctl_req_hdr *)client->req_buf) < 0
+        || mclagd_ctl_client_flush(client) < 0)
+        goto close_client;
+
+    return 0;
+
+ close_client:
+    mclagd_ctl_client_close(client);
+    return 0;
+}
+
+/* Queue reply data, it is sent once the request is handled */
 int mclagd_ctl_sock_write(int fd, char *w_buf, int total_len)
 {
-    int write_len = 0;
-    int ret = 0;
+    struct mclagd_ctl_client *client = NULL;
+    char *out_buf = NULL;
+    int out_size;
+
+    if ((client = mclagd_ctl_client_find(fd)) == NULL)
+        return 0;
 
-    while (write_len < total_len)
+    /* Drop what is already written before growing */
+    if (client->out_off > 0 && client->out_len + total_len > client->out_size)
     {
-        ret = write(fd, w_buf + write_len, total_len - write_len);
-        if (ret <= 0)
-        {
+        memmove(client->out_buf, client->out_buf + client->out_off, client->out_len - client->out_off);
+        client->out_len -= client->out_off;
+        client->out_off = 0;
+    }
+
+    if (client->out_len + total_len > client->out_size)
+    {
+        out_size = client->out_size * 2;
+        if (out_size < client->out_len + total_len)
+            out_size = client->out_len + total_len;
+        out_buf = (char *)realloc(client->out_buf, out_size);
+        if (!out_buf)
             return 0;
-        }
-        write_len += ret;
+        client->out_buf = out_buf;
+        client->out_size = out_size;
     }
 
-    return write_len;
+    memcpy(client->out_buf + client->out_len, w_buf, total_len);
+    client->out_len += total_len;
+
+    return total_len;
 }
 
 void mclagd_ctl_handle_dump_state(int client_fd, int mclag_id)
@@ -3850,6 +4360,7 @@ void mclagd_ctl_handle_dump_state(int client_fd, int mclag_id)
         return;
     }
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
     hd->exec_result = EXEC_TYPE_SUCCESS;
     hd->info_type = INFO_TYPE_DUMP_STATE;
     hd->data_len = state_num * sizeof(struct mclagd_state);
@@ -3891,6 +4402,7 @@ void mclagd_ctl_handle_dump_arp(int client_fd, int mclag_id)
     }
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
     hd->exec_result = EXEC_TYPE_SUCCESS;
     hd->info_type = INFO_TYPE_DUMP_ARP;
     hd->data_len = arp_num * sizeof(struct mclagd_arp_msg);
@@ -3931,6 +4443,7 @@ void mclagd_ctl_handle_dump_ndisc(int client_fd, int mclag_id)
     }
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
     hd->exec_result = EXEC_TYPE_SUCCESS;
     hd->info_type = INFO_TYPE_DUMP_NDISC;
     hd->data_len = ndisc_num * sizeof(struct mclagd_ndisc_msg);
@@ -3944,16 +4457,18 @@ void mclagd_ctl_handle_dump_ndisc(int client_fd, int mclag_id)
     return;
 }
 
-void mclagd_ctl_handle_dump_mac(int client_fd, int mclag_id)
+void mclagd_ctl_handle_dump_mac(int client_fd, struct mclagdctl_req_hdr *req)
 {
     char * Pbuf = NULL;
     char buf[512] = { 0 };
     int mac_num = 0;
     int ret = 0;
+    int more = 0;
+    struct mclagd_dump_cursor cursor;
     struct mclagd_reply_hdr *hd = NULL;
     int len_tmp = 0;
 
-    ret = iccp_mac_dump(&Pbuf, &mac_num, mclag_id);
+    ret = iccp_mac_dump(&Pbuf, &mac_num, req, &more, &cursor);
     if (ret != EXEC_TYPE_SUCCESS)
     {
         len_tmp = sizeof(struct mclagd_reply_hdr);
@@ -3971,9 +4486,12 @@ void mclagd_ctl_handle_dump_mac(int client_fd, int mclag_id)
     }
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
     hd->exec_result = EXEC_TYPE_SUCCESS;
     hd->info_type = INFO_TYPE_DUMP_MAC;
     hd->data_len = mac_num * sizeof(struct mclagd_mac_msg);
+    hd->more = more;
+    memcpy(&hd->cursor, &cursor, sizeof(struct mclagd_dump_cursor));
 
     len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
     memcpy(Pbuf, &len_tmp, sizeof(int));
@@ -4013,6 +4531,7 @@ void mclagd_ctl_handle_dump_local_portlist(int client_fd, int mclag_id)
     }
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
     hd->exec_result = EXEC_TYPE_SUCCESS;
     hd->info_type = INFO_TYPE_DUMP_LOCAL_PORTLIST;
     hd->data_len = lif_num * sizeof(struct mclagd_local_if);
@@ -4053,6 +4572,7 @@ void mclagd_ctl_handle_dump_peer_portlist(int client_fd, int mclag_id)
     }
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
     hd->exec_result = EXEC_TYPE_SUCCESS;
     hd->info_type = INFO_TYPE_DUMP_PEER_PORTLIST;
     hd->data_len = pif_num * sizeof(struct mclagd_peer_if);
@@ -4092,6 +4612,7 @@ void mclagd_ctl_handle_dump_dbg_counters(int client_fd, int mclag_id)
     }
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
     hd->exec_result = EXEC_TYPE_SUCCESS;
     hd->info_type = INFO_TYPE_DUMP_DBG_COUNTERS;
     hd->data_len = data_len;
@@ -4103,6 +4624,44 @@ void mclagd_ctl_handle_dump_dbg_counters(int client_fd, int mclag_id)
        free(Pbuf);
 }
 
+void mclagd_ctl_handle_dump_latency(int client_fd)
+{
+    char * Pbuf = NULL;
+    char buf[512] = {0};
+    int data_len = 0;
+    int ret = 0;
+    struct mclagd_reply_hdr *hd = NULL;
+    int len_tmp = 0;
+
+    ret = iccp_cmd_latency_dump(&Pbuf, &data_len);
+    if (ret != EXEC_TYPE_SUCCESS)
+    {
+        len_tmp = sizeof(struct mclagd_reply_hdr);
+        memcpy(buf, &len_tmp, sizeof(int));
+        hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
+        hd->exec_result = ret;
+        hd->info_type = INFO_TYPE_DUMP_LATENCY;
+        hd->data_len = 0;
+        mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
+
+        if (Pbuf)
+            free(Pbuf);
+        return;
+    }
+
+    hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
+    hd->exec_result = EXEC_TYPE_SUCCESS;
+    hd->info_type = INFO_TYPE_DUMP_LATENCY;
+    hd->data_len = data_len;
+    len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
+    memcpy(Pbuf, &len_tmp, sizeof(int));
+    mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
+
+    if (Pbuf)
+       free(Pbuf);
+}
+
 void mclagd_ctl_handle_dump_unique_ip(int client_fd, int mclag_id)
 {
     char *Pbuf = NULL;
@@ -4130,6 +4689,7 @@ void mclagd_ctl_handle_dump_unique_ip(int client_fd, int mclag_id)
     }
 
     hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
     hd->exec_result = EXEC_TYPE_SUCCESS;
     hd->info_type = INFO_TYPE_DUMP_UNIQUE_IP;
     hd->data_len = lif_num * sizeof(struct mclagd_unique_ip_if);
@@ -4145,7 +4705,7 @@ void mclagd_ctl_handle_dump_unique_ip(int client_fd, int mclag_id)
 
 void mclagd_ctl_handle_config_loglevel(int client_fd, int log_level)
 {
-    char buf[sizeof(struct mclagd_reply_hdr)+sizeof(int)];
+    char buf[sizeof(struct mclagd_reply_hdr)+sizeof(int)] = { 0 };
     struct mclagd_reply_hdr *hd = NULL;
     int len_tmp = 0;
 
@@ -4162,23 +4722,442 @@ void mclagd_ctl_handle_config_loglevel(int client_fd, int log_level)
     return;
 }
 
-int mclagd_ctl_interactive_process(int client_fd)
+static void mclagd_ctl_watch_queue(struct mclagd_ctl_client *client, struct mclagd_watch_event *ev)
+{
+    char buf[sizeof(int) + sizeof(struct mclagd_reply_hdr) + sizeof(struct mclagd_watch_event)];
+    struct mclagd_reply_hdr *hd = NULL;
+    int len_tmp = 0;
+
+    ev->seq = ++client->watch_seq;
+
+    len_tmp = sizeof(struct mclagd_reply_hdr) + sizeof(struct mclagd_watch_event);
+    memcpy(buf, &len_tmp, sizeof(int));
+    hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
+    memset(hd, 0, sizeof(struct mclagd_reply_hdr));
+    hd->exec_result = EXEC_TYPE_SUCCESS;
+    hd->info_type = INFO_TYPE_WATCH;
+    hd->data_len = sizeof(struct mclagd_watch_event);
+    memcpy(buf + MCLAGD_REPLY_INFO_HDR, ev, sizeof(struct mclagd_watch_event));
+
+    mclagd_ctl_sock_write(client->fd, buf, sizeof(buf));
+
+    return;
+}
+
+static void mclagd_ctl_watch_put_lost(struct mclagd_ctl_client *client)
+{
+    struct mclagd_watch_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.time = time(NULL);
+    ev.mclag_id = client->watch_id;
+    ev.type = MCLAGD_WATCH_OVERFLOW;
+    ev.lost = client->watch_lost;
+    /* The dropped records used sequence numbers too */
+    client->watch_seq += client->watch_lost;
+    client->watch_lost = 0;
+    mclagd_ctl_watch_queue(client, &ev);
+
+    return;
+}
+
+/* Fan a change record out to the watchers of its mclag */
+static void mclagd_ctl_watch_send(struct mclagd_watch_event *ev)
+{
+    struct mclagd_ctl_client *client = NULL;
+    struct mclagd_ctl_client *client_next = NULL;
+
+    ev->time = time(NULL);
+
+    for (client = LIST_FIRST(&mclagd_ctl_clients); client; client = client_next)
+    {
+        client_next = LIST_NEXT(client, next);
+
+        if (!client->watch)
+            continue;
+        if (client->watch_id > 0 && client->watch_id != ev->mclag_id)
+            continue;
+
+        /* Slow reader, never let it hold the daemon's memory */
+        if (client->watch_lost > 0 || client->out_len - client->out_off >= MCLAGD_CTL_WATCH_BUF_MAX)
+        {
+            /* An overflow record cannot repair a snapshot, drop the client */
+            if (client->watch_snap != MCLAGD_CTL_SNAP_NONE)
+            {
+                ICCPD_LOG_WARN(__FUNCTION__, "Close watch client fd %d, too slow to read the snapshot", client->fd);
+                mclagd_ctl_client_close(client);
+                continue;
+            }
+            client->watch_lost++;
+            continue;
+        }
+
+        if (client->out_len == 0)
+            mclagd_ctl_client_set_events(client, EPOLLOUT);
+        mclagd_ctl_watch_queue(client, ev);
+    }
+
+    return;
+}
+
+static void mclagd_ctl_watch_fill_mac(struct CSM *csm, struct MACMsg *mac_msg, int op,
+                                      struct mclagd_watch_event *ev)
+{
+    memset(ev, 0, sizeof(struct mclagd_watch_event));
+    ev->mclag_id = csm->mlag_id;
+    ev->type = MCLAGD_WATCH_MAC;
+    ev->op = op;
+    ev->flag = mac_msg->age_flag;
+    ev->fdb_type = mac_msg->fdb_type;
+    ev->vid = mac_msg->vid;
+    memcpy(ev->mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+    memcpy(ev->ifname, mac_msg->ifname, MAX_L_PORT_NAME);
+    memcpy(ev->origin_ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+
+    return;
+}
+
+static void mclagd_ctl_watch_fill_arp(struct CSM *csm, struct ARPMsg *arp_msg, int op,
+                                      struct mclagd_watch_event *ev)
+{
+    memset(ev, 0, sizeof(struct mclagd_watch_event));
+    ev->mclag_id = csm->mlag_id;
+    ev->type = MCLAGD_WATCH_ARP;
+    ev->op = op;
+    ev->flag = arp_msg->learn_flag;
+    memcpy(ev->mac_addr, arp_msg->mac_addr, ETHER_ADDR_LEN);
+    memcpy(ev->ifname, arp_msg->ifname, MAX_L_PORT_NAME);
+    show_ip_str_r(arp_msg->ipv4_addr, ev->ip_addr);
+
+    return;
+}
+
+static void mclagd_ctl_watch_fill_ndisc(struct CSM *csm, struct NDISCMsg *ndisc_msg, int op,
+                                        struct mclagd_watch_event *ev)
+{
+    memset(ev, 0, sizeof(struct mclagd_watch_event));
+    ev->mclag_id = csm->mlag_id;
+    ev->type = MCLAGD_WATCH_NDISC;
+    ev->op = op;
+    ev->flag = ndisc_msg->learn_flag;
+    memcpy(ev->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN);
+    memcpy(ev->ifname, ndisc_msg->ifname, MAX_L_PORT_NAME);
+    show_ipv6_str_r((char *)ndisc_msg->ipv6_addr, ev->ip_addr);
+
+    return;
+}
+
+static void mclagd_ctl_watch_fill_po(struct CSM *csm, char *ifname, int is_peer, int up,
+                                     struct mclagd_watch_event *ev)
+{
+    memset(ev, 0, sizeof(struct mclagd_watch_event));
+    ev->mclag_id = csm->mlag_id;
+    ev->type = MCLAGD_WATCH_PORTCHANNEL;
+    ev->op = up ? MCLAGD_WATCH_OP_UP : MCLAGD_WATCH_OP_DOWN;
+    ev->flag = is_peer ? 1 : 0;
+    snprintf(ev->ifname, sizeof(ev->ifname), "%s", ifname);
+
+    return;
+}
+
+static void mclagd_ctl_watch_fill_session(struct CSM *csm, int up, struct mclagd_watch_event *ev)
+{
+    memset(ev, 0, sizeof(struct mclagd_watch_event));
+    ev->mclag_id = csm->mlag_id;
+    ev->type = MCLAGD_WATCH_SESSION;
+    ev->op = up ? MCLAGD_WATCH_OP_UP : MCLAGD_WATCH_OP_DOWN;
+    snprintf(ev->ip_addr, sizeof(ev->ip_addr), "%s", csm->peer_ip);
+
+    return;
+}
+
+void mclagd_ctl_watch_mac(struct CSM *csm, struct MACMsg *mac_msg, int op)
+{
+    struct mclagd_watch_event ev;
+
+    if (mclagd_ctl_watch_count == 0 || !csm || !mac_msg)
+        return;
+
+    mclagd_ctl_watch_fill_mac(csm, mac_msg, op, &ev);
+    mclagd_ctl_watch_send(&ev);
+
+    return;
+}
+
+void mclagd_ctl_watch_arp(struct CSM *csm, struct ARPMsg *arp_msg, int op)
+{
+    struct mclagd_watch_event ev;
+
+    if (mclagd_ctl_watch_count == 0 || !csm || !arp_msg)
+        return;
+
+    mclagd_ctl_watch_fill_arp(csm, arp_msg, op, &ev);
+    mclagd_ctl_watch_send(&ev);
+
+    return;
+}
+
+void mclagd_ctl_watch_ndisc(struct CSM *csm, struct NDISCMsg *ndisc_msg, int op)
+{
+    struct mclagd_watch_event ev;
+
+    if (mclagd_ctl_watch_count == 0 || !csm || !ndisc_msg)
+        return;
+
+    mclagd_ctl_watch_fill_ndisc(csm, ndisc_msg, op, &ev);
+    mclagd_ctl_watch_send(&ev);
+
+    return;
+}
+
+void mclagd_ctl_watch_po(struct CSM *csm, char *ifname, int is_peer, int up)
+{
+    struct mclagd_watch_event ev;
+
+    if (mclagd_ctl_watch_count == 0 || !csm || !ifname)
+        return;
+
+    mclagd_ctl_watch_fill_po(csm, ifname, is_peer, up, &ev);
+    mclagd_ctl_watch_send(&ev);
+
+    return;
+}
+
+void mclagd_ctl_watch_session(struct CSM *csm, int up)
+{
+    struct mclagd_watch_event ev;
+
+    if (mclagd_ctl_watch_count == 0 || !csm)
+        return;
+
+    mclagd_ctl_watch_fill_session(csm, up, &ev);
+    mclagd_ctl_watch_send(&ev);
+
+    return;
+}
+
+/* First mclag after csm (from the start if NULL) the watcher asked for */
+static struct CSM *mclagd_ctl_watch_next_csm(struct mclagd_ctl_client *client, struct CSM *csm)
+{
+    struct System *sys = NULL;
+
+    if (!(sys = system_get_instance()))
+        return NULL;
+
+    for (csm = csm ? LIST_NEXT(csm, next) : LIST_FIRST(&(sys->csm_list)); csm; csm = LIST_NEXT(csm, next))
+    {
+        if (client->watch_id == 0 || csm->mlag_id == client->watch_id)
+            return csm;
+    }
+
+    return NULL;
+}
+
+/* Queue the next part of the snapshot, about MCLAGD_CTL_WATCH_CHUNK bytes,
+ * and the SYNCED record after the last one. The MAC cursor is a key as in
+ * the paged dump and the neighbor cursor a hash bucket, so entries learned
+ * or removed between two parts are neither skipped nor repeated: their
+ * change records are already in the stream.
+ */
+static void mclagd_ctl_watch_snapshot(struct mclagd_ctl_client *client)
+{
+    struct System *sys = NULL;
+    struct CSM *csm = NULL;
+    struct LocalInterface *lif = NULL;
+    struct PeerInterface *pif = NULL;
+    struct MACMsg *mac_msg = NULL;
+    struct MACMsg mac_key;
+    struct Msg *msg = NULL;
+    struct mclagd_watch_event ev;
+
+    if (!(sys = system_get_instance()))
+        return;
+
+    /* The mclag may be gone since the previous part */
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (csm->mlag_id == client->watch_cursor.mclag_id)
+            break;
+    }
+
+    while (csm && client->out_len - client->out_off < MCLAGD_CTL_WATCH_CHUNK)
+    {
+        switch (client->watch_snap)
+        {
+            case MCLAGD_CTL_SNAP_PORT:
+                mclagd_ctl_watch_fill_session(csm, MLACP(csm).current_state == MLACP_STATE_EXCHANGE, &ev);
+                mclagd_ctl_watch_queue(client, &ev);
+
+                LIST_FOREACH(lif, &(MLACP(csm).lif_list), mlacp_next)
+                {
+                    if (lif->type != IF_T_PORT_CHANNEL)
+                        continue;
+                    mclagd_ctl_watch_fill_po(csm, lif->name, 0, lif->state == PORT_STATE_UP, &ev);
+                    mclagd_ctl_watch_queue(client, &ev);
+                }
+
+                LIST_FOREACH(pif, &(MLACP(csm).pif_list), mlacp_next)
+                {
+                    if (pif->type != IF_T_PORT_CHANNEL)
+                        continue;
+                    mclagd_ctl_watch_fill_po(csm, pif->name, 1, pif->state == PORT_STATE_UP, &ev);
+                    mclagd_ctl_watch_queue(client, &ev);
+                }
+
+                client->watch_cursor.vid = 0;
+                memset(client->watch_cursor.mac_addr, 0, ETHER_ADDR_LEN);
+                client->watch_snap = MCLAGD_CTL_SNAP_MAC;
+                break;
+
+            case MCLAGD_CTL_SNAP_MAC:
+                memset(&mac_key, 0, sizeof(struct MACMsg));
+                mac_key.vid = client->watch_cursor.vid;
+                memcpy(mac_key.mac_addr, client->watch_cursor.mac_addr, ETHER_ADDR_LEN);
+
+                for (mac_msg = RB_NFIND(mac_rb_tree, &MLACP(csm).mac_rb, &mac_key); mac_msg;
+                     mac_msg = RB_NEXT(mac_rb_tree, mac_msg))
+                {
+                    if (client->out_len - client->out_off >= MCLAGD_CTL_WATCH_CHUNK)
+                    {
+                        client->watch_cursor.vid = mac_msg->vid;
+                        memcpy(client->watch_cursor.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+                        break;
+                    }
+                    mclagd_ctl_watch_fill_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD, &ev);
+                    mclagd_ctl_watch_queue(client, &ev);
+                }
+
+                if (!mac_msg)
+                {
+                    client->watch_bucket = 0;
+                    client->watch_snap = MCLAGD_CTL_SNAP_ARP;
+                }
+                break;
+
+            case MCLAGD_CTL_SNAP_ARP:
+                for (; client->watch_bucket < NEIGH_HASH_SIZE
+                     && client->out_len - client->out_off < MCLAGD_CTL_WATCH_CHUNK; ++client->watch_bucket)
+                {
+                    LIST_FOREACH(msg, &(MLACP(csm).arp_hash[client->watch_bucket]), hash_next)
+                    {
+                        mclagd_ctl_watch_fill_arp(csm, (struct ARPMsg *)msg->buf, MCLAGD_WATCH_OP_ADD, &ev);
+                        mclagd_ctl_watch_queue(client, &ev);
+                    }
+                }
+
+                if (client->watch_bucket == NEIGH_HASH_SIZE)
+                {
+                    client->watch_bucket = 0;
+                    client->watch_snap = MCLAGD_CTL_SNAP_NDISC;
+                }
+                break;
+
+            case MCLAGD_CTL_SNAP_NDISC:
+                for (; client->watch_bucket < NEIGH_HASH_SIZE
+                     && client->out_len - client->out_off < MCLAGD_CTL_WATCH_CHUNK; ++client->watch_bucket)
+                {
+                    LIST_FOREACH(msg, &(MLACP(csm).ndisc_hash[client->watch_bucket]), hash_next)
+                    {
+                        mclagd_ctl_watch_fill_ndisc(csm, (struct NDISCMsg *)msg->buf, MCLAGD_WATCH_OP_ADD, &ev);
+                        mclagd_ctl_watch_queue(client, &ev);
+                    }
+                }
+
+                if (client->watch_bucket == NEIGH_HASH_SIZE)
+                {
+                    /* This mclag is done, go on with the next one */
+                    if ((csm = mclagd_ctl_watch_next_csm(client, csm)) != NULL)
+                    {
+                        client->watch_cursor.mclag_id = csm->mlag_id;
+                        client->watch_snap = MCLAGD_CTL_SNAP_PORT;
+                    }
+                }
+                break;
+
+            default:
+                csm = NULL;
+                break;
+        }
+    }
+
+    if (csm)
+        return;
+
+    client->watch_snap = MCLAGD_CTL_SNAP_NONE;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.time = time(NULL);
+    ev.mclag_id = client->watch_id;
+    ev.type = MCLAGD_WATCH_SYNCED;
+    mclagd_ctl_watch_queue(client, &ev);
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Watch client fd %d synced to mclag id %d, snapshot %llu records",
+        client->fd, client->watch_id, (unsigned long long)client->watch_seq);
+
+    return;
+}
+
+/* Turn the connection into a watch stream: the current state goes out
+ * first, a part at a time as the client reads it, then the changes. Change
+ * records may already be interleaved with the snapshot. */
+void mclagd_ctl_handle_watch(int client_fd, int mclag_id)
 {
+    struct System *sys = NULL;
+    struct CSM *csm = NULL;
+    struct mclagd_ctl_client *client = NULL;
     char buf[512] = { 0 };
-    int ret = 0;
+    struct mclagd_reply_hdr *hd = NULL;
+    int len_tmp = 0;
+    int id_exist = 0;
 
-    struct mclagdctl_req_hdr* req = NULL;
+    if ((client = mclagd_ctl_client_find(client_fd)) == NULL)
+        return;
 
-    if (client_fd < 0)
-        return MCLAG_ERROR;
+    if (!(sys = system_get_instance()))
+        return;
 
-    ret = mclagd_ctl_sock_read(client_fd, buf, sizeof(struct mclagdctl_req_hdr));
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (mclag_id <= 0 || csm->mlag_id == mclag_id)
+            id_exist = 1;
+    }
 
-    if (ret < 0)
-        return MCLAG_ERROR;
+    if (!id_exist || client->watch)
+    {
+        len_tmp = sizeof(struct mclagd_reply_hdr);
+        memcpy(buf, &len_tmp, sizeof(int));
+        hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
+        hd->exec_result = id_exist ? EXEC_TYPE_FAILED : EXEC_TYPE_NO_EXIST_MCLAGID;
+        hd->info_type = INFO_TYPE_WATCH;
+        hd->data_len = 0;
+        mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
+        return;
+    }
+
+    client->watch = 1;
+    client->watch_id = mclag_id > 0 ? mclag_id : 0;
+    client->watch_seq = 0;
+    client->watch_lost = 0;
+    ++mclagd_ctl_watch_count;
+    iccp_timer_stop(&client->idle_timer);
+
+    memset(&client->watch_cursor, 0, sizeof(struct mclagd_dump_cursor));
+    if ((csm = mclagd_ctl_watch_next_csm(client, NULL)) != NULL)
+    {
+        client->watch_cursor.mclag_id = csm->mlag_id;
+        client->watch_snap = MCLAGD_CTL_SNAP_PORT;
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Watch client fd %d subscribed to mclag id %d",
+        client_fd, client->watch_id);
+
+    mclagd_ctl_watch_snapshot(client);
 
-    req = (struct mclagdctl_req_hdr*)buf;
+    return;
+}
 
+static int mclagd_ctl_process(int client_fd, struct mclagdctl_req_hdr *req)
+{
     ICCPD_LOG_DEBUG(__FUNCTION__, "Receive request %s from mclagdctl", mclagd_ctl_cmd_str(req->info_type));
 
     switch (req->info_type)
@@ -4196,7 +5175,7 @@ int mclagd_ctl_interactive_process(int client_fd)
             break;
 
         case INFO_TYPE_DUMP_MAC:
-            mclagd_ctl_handle_dump_mac(client_fd, req->mclag_id);
+            mclagd_ctl_handle_dump_mac(client_fd, req);
             break;
 
         case INFO_TYPE_DUMP_LOCAL_PORTLIST:
@@ -4211,6 +5190,10 @@ int mclagd_ctl_interactive_process(int client_fd)
              mclagd_ctl_handle_dump_dbg_counters(client_fd, req->mclag_id);
             break;
 
+        case INFO_TYPE_DUMP_LATENCY:
+            mclagd_ctl_handle_dump_latency(client_fd);
+            break;
+
         case INFO_TYPE_DUMP_UNIQUE_IP:
             mclagd_ctl_handle_dump_unique_ip(client_fd, req->mclag_id);
             break;
@@ -4219,6 +5202,10 @@ int mclagd_ctl_interactive_process(int client_fd)
             mclagd_ctl_handle_config_loglevel(client_fd, req->mclag_id);
             break;
 
+        case INFO_TYPE_WATCH:
+            mclagd_ctl_handle_watch(client_fd, req->mclag_id);
+            break;
+
         default:
             return MCLAG_ERROR;
     }
@@ -0,0 +1,500 @@
+/*
+ * mlacp_sync_log.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* Every MAC and neighbor sent to the peer is tagged with the next seq of the
+ * domain and a hash of what was sent, removing a tagged entry leaves a
+ * tombstone in a bounded ring. Once the send queues drain the peer is told
+ * it holds everything up to the current seq. A peer which kept our entries
+ * over the reconnect asks for the changes after that seq, it then gets the
+ * tombstones and the entries sent or changed later instead of all entries.
+ * A new epoch (restart) or tombstones lost from the ring mean a full resync.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <endian.h>
+#include <arpa/inet.h>
+
+#include "../include/mlacp_sync_log.h"
+#include "../include/iccp_csm.h"
+#include "../include/logger.h"
+#include "../include/mlacp_fsm.h"
+#include "../include/mlacp_sync_prepare.h"
+#include "../include/system.h"
+
+#define FNV1A_INIT  0x811c9dc5
+#define FNV1A_PRIME 0x01000193
+
+static uint32_t mlacp_sync_log_hash(uint32_t hash, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+
+    while (len--)
+    {
+        hash ^= *p++;
+        hash *= FNV1A_PRIME;
+    }
+
+    return hash;
+}
+
+static uint32_t mlacp_sync_log_mac_hash(struct MACMsg* mac_msg)
+{
+    uint32_t hash = FNV1A_INIT;
+
+    hash = mlacp_sync_log_hash(hash, &mac_msg->fdb_type, sizeof(mac_msg->fdb_type));
+    return mlacp_sync_log_hash(hash, mac_msg->origin_ifname,
+                               strnlen(mac_msg->origin_ifname, MAX_L_PORT_NAME));
+}
+
+static uint32_t mlacp_sync_log_neigh_hash(uint8_t learn_flag, char* ifname, uint8_t* mac_addr)
+{
+    uint32_t hash = FNV1A_INIT;
+
+    hash = mlacp_sync_log_hash(hash, &learn_flag, sizeof(learn_flag));
+    hash = mlacp_sync_log_hash(hash, ifname, strnlen(ifname, MAX_L_PORT_NAME));
+    return mlacp_sync_log_hash(hash, mac_addr, ETHER_ADDR_LEN);
+}
+
+void mlacp_sync_log_init(struct CSM* csm, int all)
+{
+    if (all != 0)
+    {
+        free(MLACP(csm).sync_log);
+        MLACP(csm).sync_log = NULL;
+        MLACP(csm).sync_log_head = 0;
+        MLACP(csm).sync_log_num = 0;
+        MLACP(csm).sync_log_lost_seq = 0;
+        MLACP(csm).sync_seq = 0;
+        MLACP(csm).peer_sync_epoch = 0;
+        MLACP(csm).peer_sync_seq = 0;
+
+        MLACP(csm).sync_epoch = (uint32_t)time(NULL) ^ ((uint32_t)getpid() << 16) ^ (uint32_t)rand();
+        if (MLACP(csm).sync_epoch == 0)
+            MLACP(csm).sync_epoch = 1;
+    }
+
+    /* Per session */
+    MLACP(csm).sync_mark_seq = 0;
+    MLACP(csm).sync_mark_void = 0;
+    MLACP(csm).peer_resume_capable = 0;
+    MLACP(csm).resync_delta = 0;
+    MLACP(csm).resync_since = 0;
+
+    return;
+}
+
+void mlacp_sync_log_finalize(struct CSM* csm)
+{
+    free(MLACP(csm).sync_log);
+    MLACP(csm).sync_log = NULL;
+    MLACP(csm).sync_log_head = 0;
+    MLACP(csm).sync_log_num = 0;
+
+    return;
+}
+
+/*****************************************
+ * Tag entries sent to the peer
+ *
+ ****************************************/
+void mlacp_sync_log_mac_sent(struct CSM* csm, struct MACMsg* mac_msg)
+{
+    if (mac_msg->op_type != MAC_SYNC_ADD)
+        return;
+
+    mac_msg->sync_seq = ++MLACP(csm).sync_seq;
+    mac_msg->sync_hash = mlacp_sync_log_mac_hash(mac_msg);
+
+    return;
+}
+
+/* The queued message is a copy, tag the entry in arp_list */
+void mlacp_sync_log_arp_sent(struct CSM* csm, struct ARPMsg* arp_msg)
+{
+    struct Msg* msg = NULL;
+
+    if (arp_msg->op_type != NEIGH_SYNC_ADD)
+        return;
+
+    LIST_FOREACH(msg, ARP_HASH_HEAD(csm, arp_msg->ipv4_addr), hash_next)
+    {
+        if (((struct ARPMsg*)msg->buf)->ipv4_addr == arp_msg->ipv4_addr)
+        {
+            msg->sync_seq = ++MLACP(csm).sync_seq;
+            msg->sync_hash = mlacp_sync_log_neigh_hash(arp_msg->learn_flag, arp_msg->ifname, arp_msg->mac_addr);
+            break;
+        }
+    }
+
+    return;
+}
+
+void mlacp_sync_log_ndisc_sent(struct CSM* csm, struct NDISCMsg* ndisc_msg)
+{
+    struct Msg* msg = NULL;
+
+    if (ndisc_msg->op_type != NEIGH_SYNC_ADD)
+        return;
+
+    LIST_FOREACH(msg, NDISC_HASH_HEAD(csm, ndisc_msg->ipv6_addr), hash_next)
+    {
+        if (memcmp(((struct NDISCMsg*)msg->buf)->ipv6_addr, ndisc_msg->ipv6_addr, sizeof(ndisc_msg->ipv6_addr)) == 0)
+        {
+            msg->sync_seq = ++MLACP(csm).sync_seq;
+            msg->sync_hash = mlacp_sync_log_neigh_hash(ndisc_msg->learn_flag, ndisc_msg->ifname, ndisc_msg->mac_addr);
+            break;
+        }
+    }
+
+    return;
+}
+
+/*****************************************
+ * Tombstones of entries the peer was sent
+ *
+ ****************************************/
+static struct mlacp_sync_tombstone* mlacp_sync_log_add(struct CSM* csm)
+{
+    struct mlacp_sync_tombstone* ts = NULL;
+
+    if (MLACP(csm).sync_log == NULL)
+    {
+        MLACP(csm).sync_log = (struct mlacp_sync_tombstone*)calloc(MLACP_SYNC_LOG_SIZE,
+                                                                   sizeof(struct mlacp_sync_tombstone));
+        if (MLACP(csm).sync_log == NULL)
+        {
+            /* Nothing to replay this removal from, no delta covers it */
+            MLACP(csm).sync_log_lost_seq = ++MLACP(csm).sync_seq;
+            return NULL;
+        }
+    }
+
+    ts = &MLACP(csm).sync_log[MLACP(csm).sync_log_head];
+    if (MLACP(csm).sync_log_num == MLACP_SYNC_LOG_SIZE)
+        MLACP(csm).sync_log_lost_seq = ts->seq;
+    else
+        ++MLACP(csm).sync_log_num;
+    MLACP(csm).sync_log_head = (MLACP(csm).sync_log_head + 1) % MLACP_SYNC_LOG_SIZE;
+
+    memset(ts, 0, sizeof(struct mlacp_sync_tombstone));
+    ts->seq = ++MLACP(csm).sync_seq;
+
+    return ts;
+}
+
+void mlacp_sync_log_mac_del(struct CSM* csm, struct MACMsg* mac_msg)
+{
+    struct mlacp_sync_tombstone* ts = NULL;
+
+    if (mac_msg->sync_seq == 0)
+        return;
+    mac_msg->sync_seq = 0;
+
+    if ((ts = mlacp_sync_log_add(csm)) == NULL)
+        return;
+
+    ts->type = MLACP_SYNC_LOG_MAC;
+    ts->u.mac.vid = mac_msg->vid;
+    memcpy(ts->u.mac.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+    ts->u.mac.fdb_type = mac_msg->fdb_type;
+    memcpy(ts->u.mac.origin_ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+
+    return;
+}
+
+void mlacp_sync_log_arp_del(struct CSM* csm, struct Msg* msg)
+{
+    struct mlacp_sync_tombstone* ts = NULL;
+
+    if (msg->sync_seq == 0)
+        return;
+    msg->sync_seq = 0;
+
+    if ((ts = mlacp_sync_log_add(csm)) == NULL)
+        return;
+
+    ts->type = MLACP_SYNC_LOG_ARP;
+    memcpy(&ts->u.arp, msg->buf, sizeof(struct ARPMsg));
+    ts->u.arp.op_type = NEIGH_SYNC_DEL;
+
+    return;
+}
+
+void mlacp_sync_log_ndisc_del(struct CSM* csm, struct Msg* msg)
+{
+    struct mlacp_sync_tombstone* ts = NULL;
+
+    if (msg->sync_seq == 0)
+        return;
+    msg->sync_seq = 0;
+
+    if ((ts = mlacp_sync_log_add(csm)) == NULL)
+        return;
+
+    ts->type = MLACP_SYNC_LOG_NDISC;
+    memcpy(&ts->u.ndisc, msg->buf, sizeof(struct NDISCMsg));
+    ts->u.ndisc.op_type = NEIGH_SYNC_DEL;
+
+    return;
+}
+
+/*****************************************
+ * Whether the resync in progress must send
+ * the entry
+ ****************************************/
+int mlacp_sync_log_mac_changed(struct CSM* csm, struct MACMsg* mac_msg)
+{
+    if (!MLACP(csm).resync_delta)
+        return 1;
+
+    if (mac_msg->sync_seq == 0 || mac_msg->sync_seq > MLACP(csm).resync_since)
+        return 1;
+
+    return mac_msg->sync_hash != mlacp_sync_log_mac_hash(mac_msg);
+}
+
+int mlacp_sync_log_neigh_changed(struct CSM* csm, struct Msg* msg, int is_arp)
+{
+    struct ARPMsg* arp_msg = NULL;
+    struct NDISCMsg* ndisc_msg = NULL;
+    uint32_t hash;
+
+    if (!MLACP(csm).resync_delta)
+        return 1;
+
+    if (msg->sync_seq == 0 || msg->sync_seq > MLACP(csm).resync_since)
+        return 1;
+
+    if (is_arp)
+    {
+        arp_msg = (struct ARPMsg*)msg->buf;
+        hash = mlacp_sync_log_neigh_hash(arp_msg->learn_flag, arp_msg->ifname, arp_msg->mac_addr);
+    }
+    else
+    {
+        ndisc_msg = (struct NDISCMsg*)msg->buf;
+        hash = mlacp_sync_log_neigh_hash(ndisc_msg->learn_flag, ndisc_msg->ifname, ndisc_msg->mac_addr);
+    }
+
+    return msg->sync_hash != hash;
+}
+
+/*****************************************
+ * Resume exchange
+ *
+ ****************************************/
+static void mlacp_sync_log_send(struct CSM* csm, uint8_t type, uint32_t epoch, uint64_t seq)
+{
+    int msg_len;
+
+    memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
+    msg_len = mlacp_prepare_for_sync_resume(csm, g_csm_buf, CSM_BUFFER_SIZE, type, epoch, seq);
+    if (msg_len > 0)
+        iccp_csm_send(csm, g_csm_buf, msg_len);
+
+    return;
+}
+
+/* Sent right before the sync request */
+void mlacp_sync_log_send_request(struct CSM* csm)
+{
+    mlacp_sync_log_send(csm, SYNC_RESUME_TYPE_REQUEST,
+                        MLACP(csm).peer_sync_epoch, MLACP(csm).peer_sync_seq);
+
+    return;
+}
+
+/* All queued entries are out, the peer holds everything up to sync_seq */
+void mlacp_sync_log_send_mark(struct CSM* csm)
+{
+    if (!MLACP(csm).peer_resume_capable || MLACP(csm).current_state != MLACP_STATE_EXCHANGE)
+        return;
+
+    /* Something was dropped on the way, the peer must not resume from here */
+    if (MLACP(csm).sync_mark_void)
+    {
+        if (MLACP(csm).sync_mark_void == 1)
+        {
+            mlacp_sync_log_send(csm, SYNC_RESUME_TYPE_MARK, MLACP(csm).sync_epoch, 0);
+            MLACP(csm).sync_mark_void = 2;
+        }
+        return;
+    }
+
+    if (MLACP(csm).sync_seq == MLACP(csm).sync_mark_seq || ICCP_CSM_TX_PAUSED(csm))
+        return;
+
+    if (!TAILQ_EMPTY(&(MLACP(csm).mac_msg_list))
+        || !TAILQ_EMPTY(&(MLACP(csm).arp_msg_list))
+        || !TAILQ_EMPTY(&(MLACP(csm).ndisc_msg_list)))
+        return;
+
+    mlacp_sync_log_send(csm, SYNC_RESUME_TYPE_MARK, MLACP(csm).sync_epoch, MLACP(csm).sync_seq);
+    MLACP(csm).sync_mark_seq = MLACP(csm).sync_seq;
+
+    return;
+}
+
+static void mlacp_sync_log_peer_kept(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL;
+
+    /* Peer MACs restored from the warm reboot snapshot are current, the
+     * peer only sends what changed */
+    RB_FOREACH (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+    {
+        if (mac_msg->age_flag & MAC_AGE_LOCAL)
+            mac_msg->warm_state &= ~MAC_WARM_STALE;
+    }
+
+    return;
+}
+
+void mlacp_sync_log_recv_resume(struct CSM* csm, struct mLACPSyncResumeTLV* tlv)
+{
+    uint32_t epoch = ntohl(tlv->epoch);
+    uint64_t seq = be64toh(tlv->seq);
+
+    switch (tlv->type)
+    {
+        case SYNC_RESUME_TYPE_REQUEST:
+            MLACP(csm).peer_resume_capable = 1;
+            MLACP(csm).resync_delta = (epoch == MLACP(csm).sync_epoch && seq != 0
+                                       && seq <= MLACP(csm).sync_seq
+                                       && seq >= MLACP(csm).sync_log_lost_seq);
+            MLACP(csm).resync_since = MLACP(csm).resync_delta ? seq : 0;
+            ICCPD_LOG_DEBUG("ICCP_FSM", "RX resume request epoch %u seq %llu, local epoch %u seq %llu",
+                            epoch, (unsigned long long)seq, MLACP(csm).sync_epoch,
+                            (unsigned long long)MLACP(csm).sync_seq);
+            break;
+
+        case SYNC_RESUME_TYPE_FULL:
+            MLACP(csm).peer_sync_epoch = epoch;
+            MLACP(csm).peer_sync_seq = 0;
+            ICCPD_LOG_NOTICE("ICCP_FSM", "Peer resyncs all entries");
+            break;
+
+        case SYNC_RESUME_TYPE_DELTA:
+            mlacp_sync_log_peer_kept(csm);
+            ICCPD_LOG_NOTICE("ICCP_FSM", "Peer resyncs entries changed after seq %llu",
+                             (unsigned long long)seq);
+            break;
+
+        case SYNC_RESUME_TYPE_MARK:
+            MLACP(csm).peer_sync_epoch = epoch;
+            MLACP(csm).peer_sync_seq = seq;
+            break;
+
+        default:
+            ICCPD_LOG_WARN("ICCP_FSM", "Unknown resume type %u from peer", tlv->type);
+            break;
+    }
+
+    return;
+}
+
+static void mlacp_sync_log_replay(struct CSM* csm)
+{
+    struct mlacp_sync_tombstone* ts = NULL;
+    struct MACMsg mac_data, *mac_msg = NULL;
+    struct Msg* msg = NULL;
+    uint32_t i, idx;
+    int num = 0;
+
+    for (i = 0; i < MLACP(csm).sync_log_num; ++i)
+    {
+        idx = (MLACP(csm).sync_log_head + MLACP_SYNC_LOG_SIZE - MLACP(csm).sync_log_num + i) % MLACP_SYNC_LOG_SIZE;
+        ts = &MLACP(csm).sync_log[idx];
+        if (ts->seq <= MLACP(csm).resync_since)
+            continue;
+
+        /* Re-added since, the live entry is sent if it changed */
+        if (ts->type == MLACP_SYNC_LOG_MAC)
+        {
+            memset(&mac_data, 0, sizeof(struct MACMsg));
+            mac_data.vid = ts->u.mac.vid;
+            memcpy(mac_data.mac_addr, ts->u.mac.mac_addr, ETHER_ADDR_LEN);
+            if (RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb, &mac_data))
+                continue;
+
+            mac_data.op_type = MAC_SYNC_DEL;
+            mac_data.fdb_type = ts->u.mac.fdb_type;
+            memcpy(mac_data.origin_ifname, ts->u.mac.origin_ifname, MAX_L_PORT_NAME);
+            memcpy(mac_data.ifname, ts->u.mac.origin_ifname, MAX_L_PORT_NAME);
+            if (iccp_csm_init_mac_msg(&mac_msg, (char*)&mac_data, sizeof(struct MACMsg)) != 0)
+                continue;
+            TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), mac_msg, tail);
+        }
+        else if (ts->type == MLACP_SYNC_LOG_ARP)
+        {
+            LIST_FOREACH(msg, ARP_HASH_HEAD(csm, ts->u.arp.ipv4_addr), hash_next)
+            {
+                if (((struct ARPMsg*)msg->buf)->ipv4_addr == ts->u.arp.ipv4_addr)
+                    break;
+            }
+            if (msg || iccp_csm_init_msg(&msg, (char*)&ts->u.arp, sizeof(struct ARPMsg)) != 0)
+                continue;
+            TAILQ_INSERT_TAIL(&(MLACP(csm).arp_msg_list), msg, tail);
+        }
+        else
+        {
+            LIST_FOREACH(msg, NDISC_HASH_HEAD(csm, ts->u.ndisc.ipv6_addr), hash_next)
+            {
+                if (memcmp(((struct NDISCMsg*)msg->buf)->ipv6_addr, ts->u.ndisc.ipv6_addr,
+                           sizeof(ts->u.ndisc.ipv6_addr)) == 0)
+                    break;
+            }
+            if (msg || iccp_csm_init_msg(&msg, (char*)&ts->u.ndisc, sizeof(struct NDISCMsg)) != 0)
+                continue;
+            TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_msg_list), msg, tail);
+        }
+        ++num;
+    }
+
+    ICCPD_LOG_NOTICE("ICCP_FSM", "Resync mclag %d after seq %llu: %d removals replayed",
+                     csm->mlag_id, (unsigned long long)MLACP(csm).resync_since, num);
+
+    return;
+}
+
+/* The peer asked for our entries, tell it which resync follows */
+void mlacp_sync_log_resync_start(struct CSM* csm)
+{
+    if (!MLACP(csm).resync_delta)
+    {
+        ++MLACP(csm).dbg_counters.resync_full_count;
+        if (MLACP(csm).peer_resume_capable)
+            mlacp_sync_log_send(csm, SYNC_RESUME_TYPE_FULL, MLACP(csm).sync_epoch, 0);
+        ICCPD_LOG_NOTICE("ICCP_FSM", "Resync mclag %d: all entries", csm->mlag_id);
+        return;
+    }
+
+    ++MLACP(csm).dbg_counters.resync_delta_count;
+    mlacp_sync_log_send(csm, SYNC_RESUME_TYPE_DELTA, MLACP(csm).sync_epoch, MLACP(csm).resync_since);
+    mlacp_sync_log_replay(csm);
+
+    return;
+}
@@ -25,6 +25,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <endian.h>
 
 #include <sys/queue.h>
 
@@ -467,7 +468,7 @@ int mlacp_prepare_for_port_channel_info(struct CSM* csm, char* buf,
     size_t msg_len;
     size_t tlv_len;
     size_t name_len = MAX_L_PORT_NAME;
-    struct VLAN_ID* vlan_id = NULL;
+    int vid;
     int num_of_vlan_id = 0;
 
     if (csm == NULL )
@@ -482,9 +483,7 @@ int mlacp_prepare_for_port_channel_info(struct CSM* csm, char* buf,
         return MCLAG_ERROR;
 
     /* Calculate VLAN ID Length */
-    RB_FOREACH(vlan_id, vlan_rb_tree, &(port_channel->vlan_tree))
-        if (vlan_id != NULL)
-            num_of_vlan_id++;
+    num_of_vlan_id = vlan_bitmap_count(&port_channel->vlan_bitmap);
 
     tlv_len = sizeof(struct mLACPPortChannelInfoTLV) + sizeof(struct mLACPVLANData) * num_of_vlan_id;
 
@@ -517,15 +516,12 @@ int mlacp_prepare_for_port_channel_info(struct CSM* csm, char* buf,
     tlv->num_of_vlan_id = htons(num_of_vlan_id);
 
     num_of_vlan_id = 0;
-    RB_FOREACH(vlan_id, vlan_rb_tree, &(port_channel->vlan_tree))
+    VLAN_BITMAP_FOREACH(vid, &port_channel->vlan_bitmap)
     {
-        if (vlan_id != NULL )
-        {
-            tlv->vlanData[num_of_vlan_id].vlan_id = htons(vlan_id->vid);
+        tlv->vlanData[num_of_vlan_id].vlan_id = htons(vid);
 
-            num_of_vlan_id++;
-            ICCPD_LOG_DEBUG(__FUNCTION__, "PortChannel%d: ipv4 addr = %s vlan id %d num %d ", port_channel->po_id, show_ip_str( tlv->ipv4_addr), vlan_id->vid, num_of_vlan_id );
-        }
+        num_of_vlan_id++;
+        ICCPD_LOG_DEBUG(__FUNCTION__, "PortChannel%d: ipv4 addr = %s vlan id %d num %d ", port_channel->po_id, show_ip_str( tlv->ipv4_addr), vid, num_of_vlan_id );
     }
 
     ICCPD_LOG_DEBUG(__FUNCTION__, "PortChannel%d: ipv4 addr = %s  l3 mode %d", port_channel->po_id, show_ip_str( tlv->ipv4_addr),  tlv->l3_mode);
@@ -627,6 +623,45 @@ int mlacp_prepare_for_heartbeat(struct CSM* csm, char* buf, size_t max_buf_size)
     return msg_len;
 }
 
+/*****************************************
+* Prepare Send sync resume
+*
+* ***************************************/
+int mlacp_prepare_for_sync_resume(struct CSM* csm, char* buf, size_t max_buf_size, uint8_t type, uint32_t epoch, uint64_t seq)
+{
+    ICCHdr* icc_hdr = (ICCHdr*)buf;
+    struct mLACPSyncResumeTLV* tlv = (struct mLACPSyncResumeTLV*)&buf[sizeof(ICCHdr)];
+    size_t msg_len = sizeof(ICCHdr) + sizeof(struct mLACPSyncResumeTLV);
+
+    if (csm == NULL)
+        return MCLAG_ERROR;
+
+    if (buf == NULL)
+        return MCLAG_ERROR;
+
+    if (msg_len > max_buf_size)
+        return MCLAG_ERROR;
+
+    memset(buf, 0, max_buf_size);
+
+    /* ICC header */
+    mlacp_fill_icc_header(csm, icc_hdr, msg_len);
+
+    /* Sync resume TLV */
+    tlv->icc_parameter.u_bit = 0;
+    tlv->icc_parameter.f_bit = 0;
+    tlv->icc_parameter.type = htons(TLV_T_MLACP_SYNC_RESUME);
+
+    tlv->icc_parameter.len = htons(sizeof(struct mLACPSyncResumeTLV) - sizeof(ICCParameter));
+    tlv->type = type;
+    tlv->epoch = htonl(epoch);
+    tlv->seq = htobe64(seq);
+
+    ICCPD_LOG_DEBUG("ICCP_FSM", "TX sync resume: type %u epoch %u seq %llu",
+        type, epoch, (unsigned long long)seq);
+    return msg_len;
+}
+
 /*****************************************
 * Prepare Send warm-reboot flag
 *
@@ -35,6 +35,8 @@
 #include "../include/iccp_consistency_check.h"
 #include "../include/port.h"
 #include "../include/openbsd_tree.h"
+#include "../include/mlacp_sync_log.h"
+#include "mclagdctl/mclagdctl.h"
 
 /*****************************************
 * Port-Conf Update
@@ -131,8 +133,12 @@ int mlacp_fsm_update_Agg_conf(struct CSM* csm, mLACPAggConfigTLV* portconf)
         new_create = 1;
     }
 
+    /* Config for a port the peer never created, nothing to update */
+    if (pif == NULL)
+        return 0;
+
     pif->po_id = ntohs(portconf->agg_id);
-    memcpy(pif->name, portconf->agg_name, portconf->agg_name_len);
+    peer_if_set_name(pif, portconf->agg_name, portconf->agg_name_len);
     memcpy(pif->mac_addr, portconf->mac_addr, ETHER_ADDR_LEN);
 
     po_active = (pif->state == PORT_STATE_UP);
@@ -185,6 +191,7 @@ int mlacp_fsm_update_Aggport_state(struct CSM* csm, mLACPAggPortStateTLV* tlv)
             continue;
 
         peer_if->state = tlv->agg_state;
+        mclagd_ctl_watch_po(csm, peer_if->name, 1, po_active);
 
         update_stp_peer_link(csm, peer_if, po_active, 0);
         update_peerlink_isolate_from_pif(csm, peer_if, po_active, 0);
@@ -213,6 +220,15 @@ int mlacp_fsm_update_Aggport_state(struct CSM* csm, mLACPAggPortStateTLV* tlv)
 /*****************************************
 * Recv from peer, MAC-Info Update
 * ***************************************/
+/* Tell the watchers about an in-place age flag change of an existing MAC */
+static void mlacp_fsm_watch_mac_age(struct CSM* csm, struct MACMsg* mac_msg, uint8_t old_age_flag)
+{
+    if (mac_msg->age_flag != old_age_flag)
+        mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_ADD);
+
+    return;
+}
+
 int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *MacData)
 {
     struct Msg* msg = NULL;
@@ -220,6 +236,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
     struct MACMsg mac_data, mac_find;
     struct LocalInterface* local_if = NULL;
     uint8_t from_mclag_intf = 0;/*0: orphan port, 1: MCLAG port*/
+    uint8_t old_age_flag = 0;
     memset(&mac_data, 0, sizeof(struct MACMsg));
     memset(&mac_find, 0, sizeof(struct MACMsg));
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
@@ -258,10 +275,13 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
             "MAC %s vlan-id %d, fdb_type: %d, op_type %s", mac_msg->age_flag, mac_msg->ifname,
             mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid, mac_msg->fdb_type,
             (mac_msg->op_type == MAC_SYNC_ADD) ? "add":"del");
+        old_age_flag = mac_msg->age_flag;
 
         if (MacData->type == MAC_SYNC_ADD)
         {
             mac_msg->age_flag &= ~MAC_AGE_PEER;
+            /*Resent by the peer after warm reboot*/
+            mac_msg->warm_state &= ~MAC_WARM_STALE;
 
             if (from_mclag_intf && mac_msg->pending_local_del)
             {
@@ -290,7 +310,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                 if (mac_msg->fdb_type != MAC_TYPE_STATIC)
                 {
                     /*Update local item*/
-                    memcpy(&mac_msg->origin_ifname, MacData->ifname, MAX_L_PORT_NAME);
+                    mlacp_mac_set_origin_ifname(csm, mac_msg, MacData->ifname);
                 }
                 else
                 {
@@ -299,6 +319,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                         mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid);
                     //set back the peer age flag
                     mac_msg->age_flag |= MAC_AGE_PEER;
+                    mlacp_fsm_watch_mac_age(csm, mac_msg, old_age_flag);
                     return 0;
                 }
 
@@ -316,13 +337,14 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                             ICCPD_LOG_NOTICE("ICCP_FDB", "Remote MAC ADD local IF down, MAC already points to Peer_link done processing "
                                 " interface  %s, MAC %s vlan-id %d ", mac_msg->ifname,
                                 mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid);
+                            mlacp_fsm_watch_mac_age(csm, mac_msg, old_age_flag);
                             return 0;
                         }
 
                         if (csm->peer_link_if && (csm->peer_link_if->state == PORT_STATE_UP))
                         {
                             /*Redirect the mac to peer-link*/
-                            memcpy(&mac_msg->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                            mlacp_mac_set_ifname(csm, mac_msg, csm->peer_itf_name);
 
                             /*Send mac add message to mclagsyncd*/
                             add_mac_to_chip(mac_msg, mac_msg->fdb_type);
@@ -335,7 +357,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                         else
                         {
                             /*Redirect the mac to peer-link, if peerlink is down FdbOrch deletes MAC*/
-                            memcpy(&mac_msg->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                            mlacp_mac_set_ifname(csm, mac_msg, csm->peer_itf_name);
 
                             add_mac_to_chip(mac_msg, mac_msg->fdb_type);
 
@@ -350,18 +372,20 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                         del_mac_from_chip(mac_msg);
 
                         /*Update local item*/
-                        memcpy(&mac_msg->ifname, MacData->ifname, MAX_L_PORT_NAME);
+                        mlacp_mac_set_ifname(csm, mac_msg, MacData->ifname);
 
                         /*if orphan port mac but no peerlink, don't keep this mac*/
                         if (from_mclag_intf == 0)
                         {
                             MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+                            mlacp_sync_log_mac_del(csm, mac_msg);
+                            mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_DEL);
 
                             // free only if not in change list to be send to peer node,
                             // else free is taken care after sending the update to peer
                             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                             {
-                                free(mac_msg);
+                                iccp_csm_free_mac_msg(mac_msg);
                             }
 
                             ICCPD_LOG_ERR(__FUNCTION__, "Ignore Recv MAC ADD "
@@ -374,7 +398,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                 else
                 {
                     /*Update local item*/
-                    memcpy(&mac_msg->ifname, MacData->ifname, MAX_L_PORT_NAME);
+                    mlacp_mac_set_ifname(csm, mac_msg, MacData->ifname);
 
                     /*from MCLAG port and the local port is up, add mac to ASIC to update port*/
                     add_mac_to_chip(mac_msg, mac_msg->fdb_type);
@@ -391,13 +415,14 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                         ICCPD_LOG_DEBUG("ICCP_FDB", "Remote MAC ADD learn on Orphan port ,MAC already points to Peer_link"
                             " interface  %s, MAC %s vlan-id %d ", mac_msg->ifname,
                             mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid);
+                        mlacp_fsm_watch_mac_age(csm, mac_msg, old_age_flag);
                         return 0;
                     }
 
                     if (csm->peer_link_if && csm->peer_link_if->state == PORT_STATE_UP)
                     {
                         /*Redirect the mac to peer-link*/
-                        memcpy(&mac_msg->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                        mlacp_mac_set_ifname(csm, mac_msg, csm->peer_itf_name);
 
                         ICCPD_LOG_DEBUG("ICCP_FDB", "Remote MAC ADD learn on Orphan port ,point MAC address to Peer_link"
                             "interface  %s, MAC %s vlan-id %d ", mac_msg->ifname,
@@ -409,7 +434,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                     {
                         /*Redirect the mac to peer-link*/
                          /*must redirect but if peerlink is down FdbOrch will delete MAC */
-                        memcpy(&mac_msg->ifname, csm->peer_itf_name, MAX_L_PORT_NAME);
+                        mlacp_mac_set_ifname(csm, mac_msg, csm->peer_itf_name);
                         add_mac_to_chip(mac_msg, mac_msg->fdb_type);
 
                         ICCPD_LOG_DEBUG("ICCP_FDB", "Remote MAC ADD learn on Orphan port ,point MAC address to Peer_link"
@@ -418,6 +443,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                     }
                 }
             }
+            mlacp_fsm_watch_mac_age(csm, mac_msg, old_age_flag);
 
             // Code to exchange MAC_SYNC_ACK notifications can be enabled in future, if MAC SYNC issues observed.
             #if 0
@@ -462,16 +488,19 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
 
             /*If local and peer both aged, del the mac*/
             MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+            mlacp_sync_log_mac_del(csm, mac_msg);
+            mclagd_ctl_watch_mac(csm, mac_msg, MCLAGD_WATCH_OP_DEL);
 
             // free only if not in change list to be send to peer node,
             // else free is taken care after sending the update to peer
             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
             {
-                free(mac_msg);
+                iccp_csm_free_mac_msg(mac_msg);
             }
         }
         else
         {
+            mlacp_fsm_watch_mac_age(csm, mac_msg, old_age_flag);
             return 0;
         }
     }
@@ -522,6 +551,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
         {
             /*ICCPD_LOG_INFO(__FUNCTION__, "add mac queue successfully");*/
             RB_INSERT(mac_rb_tree, &MLACP(csm).mac_rb, new_mac_msg);
+            mlacp_mac_index_add(csm, new_mac_msg);
 
             /*If the mac is from orphan port, or from MCLAG port but the local port is down*/
             if (strcmp(mac_msg->ifname, csm->peer_itf_name) == 0)
@@ -564,8 +594,11 @@ int mlacp_fsm_update_mac_info_from_peer(struct CSM* csm, struct mLACPMACInfoTLV*
 
     for (i = 0; i < count; i++)
     {
+        tlv->MacEntry[i].ifname[MAX_L_PORT_NAME - 1] = '\0';
         mlacp_fsm_update_mac_entry_from_peer(csm, &(tlv->MacEntry[i]));
     }
+
+    return 0;
 }
 
 /*****************************************
@@ -579,7 +612,7 @@ void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg)
     if (!csm)
     {
         if (msg)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
     if (!msg)
@@ -589,6 +622,8 @@ void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg)
     if (arp_msg->op_type != NEIGH_SYNC_DEL)
     {
         TAILQ_INSERT_TAIL(&(MLACP(csm).arp_list), msg, tail);
+        LIST_INSERT_HEAD(ARP_HASH_HEAD(csm, arp_msg->ipv4_addr), msg, hash_next);
+        mclagd_ctl_watch_arp(csm, arp_msg, MCLAGD_WATCH_OP_ADD);
     }
 
     return;
@@ -605,7 +640,7 @@ void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg)
     if (!csm)
     {
         if (msg)
-            free(msg);
+            iccp_csm_free_msg(msg);
         return;
     }
     if (!msg)
@@ -615,6 +650,70 @@ void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg)
     if (ndisc_msg->op_type != NEIGH_SYNC_DEL)
     {
         TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_list), msg, tail);
+        LIST_INSERT_HEAD(NDISC_HASH_HEAD(csm, ndisc_msg->ipv6_addr), msg, hash_next);
+        mclagd_ctl_watch_ndisc(csm, ndisc_msg, MCLAGD_WATCH_OP_ADD);
+    }
+
+    return;
+}
+
+/*****************************************
+ * Tool : Remove ARP Info from ARP list
+ *
+ ****************************************/
+void mlacp_dequeue_arp(struct CSM* csm, struct Msg* msg)
+{
+    if (!csm || !msg)
+        return;
+
+    mlacp_sync_log_arp_del(csm, msg);
+    mclagd_ctl_watch_arp(csm, (struct ARPMsg *)msg->buf, MCLAGD_WATCH_OP_DEL);
+    TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
+    if (msg->hash_next.le_prev)
+    {
+        LIST_REMOVE(msg, hash_next);
+        msg->hash_next.le_prev = NULL;
+    }
+
+    return;
+}
+
+/*****************************************
+ * Tool : Remove Ndisc Info from ndisc list
+ *
+ ****************************************/
+void mlacp_dequeue_ndisc(struct CSM *csm, struct Msg *msg)
+{
+    if (!csm || !msg)
+        return;
+
+    mlacp_sync_log_ndisc_del(csm, msg);
+    mclagd_ctl_watch_ndisc(csm, (struct NDISCMsg *)msg->buf, MCLAGD_WATCH_OP_DEL);
+    TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
+    if (msg->hash_next.le_prev)
+    {
+        LIST_REMOVE(msg, hash_next);
+        msg->hash_next.le_prev = NULL;
+    }
+
+    return;
+}
+
+/*****************************************
+ * Tool : Reset ARP/Ndisc hash index, the
+ * entries must already be freed
+ ****************************************/
+void mlacp_neigh_hash_init(struct CSM *csm)
+{
+    int i;
+
+    if (!csm)
+        return;
+
+    for (i = 0; i < NEIGH_HASH_SIZE; ++i)
+    {
+        LIST_INIT(&(MLACP(csm).arp_hash[i]));
+        LIST_INIT(&(MLACP(csm).ndisc_hash[i]));
     }
 
     return;
@@ -625,13 +724,14 @@ void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg)
 * ***************************************/
 int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
 {
-    struct Msg* msg = NULL;
+    struct Msg* msg = NULL, *msg_next = NULL;
     struct ARPMsg *arp_msg = NULL, arp_data;
     struct LocalInterface *local_if = NULL;
     struct LocalInterface *vlan_if = NULL;
     struct LocalInterface *peer_link_if = NULL;
     struct LocalInterface *local_vlan_if = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vlan_member = 0;
     int set_arp_flag = 0;
     int my_ip_arp_flag = 0;
     int vlan_count = 0;
@@ -639,8 +739,8 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     int err = 0, ln = 0;
     int permanent_neigh = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
     int vid_intf_present = 0;
+    int neigh_changed = 0;
 
     if (!csm || !arp_entry)
         return MCLAG_ERROR;
@@ -665,8 +765,7 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
 
     if (vlan_id)
     {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
+        vlan_itf = local_if_find_vlan_itf(vlan_id);
 
         peer_link_if = local_if_find_by_name(csm->peer_itf_name);
 
@@ -674,26 +773,26 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
         {
             ln = __LINE__;
             /* Is peer-linlk itf belong to a vlan the same as peer?*/
-            vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+            vlan_member = local_if_is_vlan_member(peer_link_if, vlan_id);
 
-            if (vlan_id_list)
+            if (vlan_member)
             {
                 vlan_count++;
-                if (vlan_id_list->vlan_itf) {
-                    if (strcmp(vlan_id_list->vlan_itf->name, arp_entry->ifname) == 0) {
+                if (vlan_itf) {
+                    if (strcmp(vlan_itf->name, arp_entry->ifname) == 0) {
                         ln = __LINE__;
                         vid_intf_present = 1;
                     }
 
-                    if (vid_intf_present && local_if_is_l3_mode(vlan_id_list->vlan_itf)) {
-                        if (arp_entry->ipv4_addr == vlan_id_list->vlan_itf->ipv4_addr) {
+                    if (vid_intf_present && local_if_is_l3_mode(vlan_itf)) {
+                        if (arp_entry->ipv4_addr == vlan_itf->ipv4_addr) {
                             my_ip_arp_flag = 1;
                         }
                     }
 
                     ICCPD_LOG_DEBUG(__FUNCTION__,
                             "ARP is learnt from intf %s, peer-link %s is the member of this vlan",
-                            vlan_id_list->vlan_itf->name, peer_link_if->name);
+                            vlan_itf->name, peer_link_if->name);
 
                     /* Peer-link belong to L3 vlan is alive, set the ARP info*/
                     set_arp_flag = 1;
@@ -733,21 +832,21 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
                 {
                     /* Is the L2 MLAG itf belong to a vlan the same as peer?*/
                     if (vlan_id) {
-                        vlan_id_list = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), &vlan_key);
-                        if (vlan_id_list && vlan_id_list->vlan_itf) {
-                            if (arp_entry->ipv4_addr == vlan_id_list->vlan_itf->ipv4_addr) {
+                        vlan_member = local_if_is_vlan_member(local_if, vlan_id);
+                        if (vlan_member && vlan_itf) {
+                            if (arp_entry->ipv4_addr == vlan_itf->ipv4_addr) {
                                 my_ip_arp_flag = 1;
                             }
 
                             ICCPD_LOG_DEBUG(__FUNCTION__,
                                 "ARP is learnt from intf %s, mclag %s is the member of this vlan",
-                                vlan_id_list->vlan_itf->name, local_if->name);
+                                vlan_itf->name, local_if->name);
                         }
                     }
 
                     ICCPD_LOG_DEBUG(__FUNCTION__, "ARP received PO %s, active %d, my_ip %d, ln %d",
                             local_if->name, local_if->po_active, my_ip_arp_flag, ln);
-                    if (vlan_id_list && local_if->po_active == 1)
+                    if (vlan_member && local_if->po_active == 1)
                     {
                         /* Any po of L3 vlan is alive, set the ARP info*/
                         set_arp_flag = 1;
@@ -841,12 +940,14 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     }
 
     /* update ARP list*/
-    TAILQ_FOREACH(msg, &(MLACP(csm).arp_list), tail)
+    LIST_FOREACH(msg, ARP_HASH_HEAD(csm, arp_entry->ipv4_addr), hash_next)
     {
         arp_msg = (struct ARPMsg*)msg->buf;
         if (arp_msg->ipv4_addr == arp_entry->ipv4_addr)
         {
             /*arp_msg->op_type = tlv->type;*/
+            neigh_changed = strcmp(arp_msg->ifname, arp_entry->ifname) != 0
+                || memcmp(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN) != 0;
             sprintf(arp_msg->ifname, "%s", arp_entry->ifname);
             memcpy(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN);
             break;
@@ -856,11 +957,14 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     /* delete/add ARP list*/
     if (msg && arp_entry->op_type == NEIGH_SYNC_DEL)
     {
-        TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        mlacp_dequeue_arp(csm, msg);
+        iccp_csm_free_msg(msg);
         /*ICCPD_LOG_INFO(__FUNCTION__, "Del arp queue successfully");*/
     }
+    else if (msg && neigh_changed)
+    {
+        mclagd_ctl_watch_arp(csm, arp_msg, MCLAGD_WATCH_OP_ADD);
+    }
     else if (!msg && arp_entry->op_type == NEIGH_SYNC_ADD)
     {
         arp_msg = (struct ARPMsg*)&arp_data;
@@ -878,25 +982,17 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     }
 
     /* remove all ARP msg queue, when receive peer's ARP list at the same time*/
-    TAILQ_FOREACH(msg, &(MLACP(csm).arp_msg_list), tail)
-    {
-        arp_msg = (struct ARPMsg*)msg->buf;
-        if (arp_msg->ipv4_addr == arp_entry->ipv4_addr)
-            break;
-    }
-
+    msg = TAILQ_FIRST(&(MLACP(csm).arp_msg_list));
     while (msg)
     {
+        msg_next = TAILQ_NEXT(msg, tail);
         arp_msg = (struct ARPMsg*)msg->buf;
-        TAILQ_REMOVE(&(MLACP(csm).arp_msg_list), msg, tail);
-        free(msg->buf);
-        free(msg);
-        TAILQ_FOREACH(msg, &(MLACP(csm).arp_msg_list), tail)
+        if (arp_msg->ipv4_addr == arp_entry->ipv4_addr)
         {
-            arp_msg = (struct ARPMsg*)msg->buf;
-            if (arp_msg->ipv4_addr == arp_entry->ipv4_addr)
-                break;
+            TAILQ_REMOVE(&(MLACP(csm).arp_msg_list), msg, tail);
+            iccp_csm_free_msg(msg);
         }
+        msg = msg_next;
     }
 
     return 0;
@@ -914,8 +1010,11 @@ int mlacp_fsm_update_arp_info(struct CSM* csm, struct mLACPARPInfoTLV* tlv)
 
     for (i = 0; i < count; i++)
     {
+        tlv->ArpEntry[i].ifname[MAX_L_PORT_NAME - 1] = '\0';
         mlacp_fsm_update_arp_entry(csm, &(tlv->ArpEntry[i]));
     }
+
+    return 0;
 }
 
 /*****************************************
@@ -923,13 +1022,14 @@ int mlacp_fsm_update_arp_info(struct CSM* csm, struct mLACPARPInfoTLV* tlv)
 * ***************************************/
 int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
 {
-    struct Msg *msg = NULL;
+    struct Msg *msg = NULL, *msg_next = NULL;
     struct NDISCMsg *ndisc_msg = NULL, ndisc_data;
     struct LocalInterface *local_if;
     struct LocalInterface *vlan_if = NULL;
     struct LocalInterface *peer_link_if = NULL;
     struct LocalInterface *local_vlan_if = NULL;
-    struct VLAN_ID *vlan_id_list = NULL;
+    struct LocalInterface *vlan_itf = NULL;
+    int vlan_member = 0;
     int set_ndisc_flag = 0;
     char mac_str[18] = "";
     int my_ip_nd_flag = 0;
@@ -938,8 +1038,8 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     int permanent_neigh = 0;
     int is_ack_ll = 0;
     int is_link_local = 0;
+    int neigh_changed = 0;
     uint16_t vlan_id = 0;
-    struct VLAN_ID vlan_key = { 0 };
     int vid_intf_present = 0;
 
     if (!csm || !ndisc_entry)
@@ -964,8 +1064,7 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
 
     if (vlan_id)
     {
-        memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-        vlan_key.vid = vlan_id;
+        vlan_itf = local_if_find_vlan_itf(vlan_id);
 
         peer_link_if = local_if_find_by_name(csm->peer_itf_name);
 
@@ -973,26 +1072,26 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
         {
             ln = __LINE__;
             /* Is peer-linlk itf belong to a vlan the same as peer? */
-            vlan_id_list = RB_FIND(vlan_rb_tree, &(peer_link_if->vlan_tree), &vlan_key);
+            vlan_member = local_if_is_vlan_member(peer_link_if, vlan_id);
 
-            if (vlan_id_list)
+            if (vlan_member)
             {
                 vlan_count++;
-                if (vlan_id_list->vlan_itf) {
-                    if (strcmp(vlan_id_list->vlan_itf->name, ndisc_entry->ifname) == 0) {
+                if (vlan_itf) {
+                    if (strcmp(vlan_itf->name, ndisc_entry->ifname) == 0) {
                         ln = __LINE__;
                         vid_intf_present = 1;
                     }
 
-                    if (vid_intf_present && local_if_is_l3_mode(vlan_id_list->vlan_itf)) {
-                        if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_addr, 16) == 0)
+                    if (vid_intf_present && local_if_is_l3_mode(vlan_itf)) {
+                        if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_itf->ipv6_addr, 16) == 0)
                         {
                             my_ip_nd_flag = 1;
                         }
 
                         if ((my_ip_nd_flag == 0) && is_link_local)
                         {
-                            if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_ll_addr, 16) == 0)
+                            if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_itf->ipv6_ll_addr, 16) == 0)
                             {
                                 my_ip_nd_flag = 1;
                             }
@@ -1001,7 +1100,7 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
 
                     ICCPD_LOG_DEBUG(__FUNCTION__,
                             "ND is learnt from intf %s, peer-link %s is the member of this vlan",
-                            vlan_id_list->vlan_itf->name, peer_link_if->name);
+                            vlan_itf->name, peer_link_if->name);
 
                     /* Peer-link belong to L3 vlan is alive, set the NDISC info */
                     set_ndisc_flag = 1;
@@ -1051,22 +1150,22 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
                     ln = __LINE__;
                     /* Is the L2 MLAG itf belong to a vlan the same as peer? */
                     if (vlan_id) {
-                        vlan_id_list = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), &vlan_key);
-                        if (vlan_id_list && vlan_id_list->vlan_itf) {
+                        vlan_member = local_if_is_vlan_member(local_if, vlan_id);
+                        if (vlan_member && vlan_itf) {
 
-                            if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_id_list->vlan_itf->ipv6_addr, 16) == 0)
+                            if (memcmp((char *)ndisc_entry->ipv6_addr, (char *)vlan_itf->ipv6_addr, 16) == 0)
                             {
                                 my_ip_nd_flag = 1;
                             }
 
                             ICCPD_LOG_DEBUG(__FUNCTION__, "ND is learnt from intf %s, %s is the member of this vlan, my_ip %d",
-                                    vlan_id_list->vlan_itf->name, local_if->name, my_ip_nd_flag);
+                                    vlan_itf->name, local_if->name, my_ip_nd_flag);
                         }
                     }
 
                     ICCPD_LOG_DEBUG(__FUNCTION__, "ND received PO %s, active %d, ln %d",
                             local_if->name, local_if->po_active, ln);
-                    if (vlan_id_list && local_if->po_active == 1)
+                    if (vlan_member && local_if->po_active == 1)
                     {
                         /* Any po of L3 vlan is alive, set the NDISC info */
                         set_ndisc_flag = 1;
@@ -1163,12 +1262,14 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     }
 
     /* update NDISC list */
-    TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_list), tail)
+    LIST_FOREACH(msg, NDISC_HASH_HEAD(csm, ndisc_entry->ipv6_addr), hash_next)
     {
         ndisc_msg = (struct NDISCMsg *)msg->buf;
         if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)ndisc_entry->ipv6_addr, 16) == 0)
         {
             /* ndisc_msg->op_type = tlv->type; */
+            neigh_changed = strcmp(ndisc_msg->ifname, ndisc_entry->ifname) != 0
+                || memcmp(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN) != 0;
             sprintf(ndisc_msg->ifname, "%s", ndisc_entry->ifname);
             memcpy(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN);
             break;
@@ -1178,11 +1279,14 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     /* delete/add NDISC list */
     if (msg && ndisc_entry->op_type == NEIGH_SYNC_DEL)
     {
-        TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        mlacp_dequeue_ndisc(csm, msg);
+        iccp_csm_free_msg(msg);
         /* ICCPD_LOG_INFO(__FUNCTION__, "Del ndisc queue successfully"); */
     }
+    else if (msg && neigh_changed)
+    {
+        mclagd_ctl_watch_ndisc(csm, ndisc_msg, MCLAGD_WATCH_OP_ADD);
+    }
     else if (!msg && ndisc_entry->op_type == NEIGH_SYNC_ADD)
     {
         ndisc_msg = (struct NDISCMsg *)&ndisc_data;
@@ -1200,25 +1304,17 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     }
 
     /* remove all NDISC msg queue, when receive peer's NDISC list at the same time */
-    TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_msg_list), tail)
-    {
-        ndisc_msg = (struct NDISCMsg *)msg->buf;
-        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)ndisc_entry->ipv6_addr, 16) == 0)
-            break;
-    }
-
+    msg = TAILQ_FIRST(&(MLACP(csm).ndisc_msg_list));
     while (msg)
     {
+        msg_next = TAILQ_NEXT(msg, tail);
         ndisc_msg = (struct NDISCMsg *)msg->buf;
-        TAILQ_REMOVE(&(MLACP(csm).ndisc_msg_list), msg, tail);
-        free(msg->buf);
-        free(msg);
-        TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_msg_list), tail)
+        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)ndisc_entry->ipv6_addr, 16) == 0)
         {
-            ndisc_msg = (struct NDISCMsg *)msg->buf;
-            if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)ndisc_entry->ipv6_addr, 16) == 0)
-                break;
+            TAILQ_REMOVE(&(MLACP(csm).ndisc_msg_list), msg, tail);
+            iccp_csm_free_msg(msg);
         }
+        msg = msg_next;
     }
 
     return 0;
@@ -1236,8 +1332,11 @@ int mlacp_fsm_update_ndisc_info(struct CSM *csm, struct mLACPNDISCInfoTLV *tlv)
 
     for (i = 0; i < count; i++)
     {
+        tlv->NdiscEntry[i].ifname[MAX_L_PORT_NAME - 1] = '\0';
         mlacp_fsm_update_ndisc_entry(csm, &(tlv->NdiscEntry[i]));
     }
+
+    return 0;
 }
 
 /*****************************************
@@ -1247,7 +1346,6 @@ int mlacp_fsm_update_port_channel_info(struct CSM* csm,
                                        struct mLACPPortChannelInfoTLV* tlv)
 {
     struct PeerInterface* peer_if = NULL;
-    struct VLAN_ID* peer_vlan_id = NULL;
     int i = 0;
 
     if (csm == NULL || tlv == NULL )
@@ -1261,10 +1359,7 @@ int mlacp_fsm_update_port_channel_info(struct CSM* csm,
         if (peer_if->po_id != ntohs(tlv->agg_id))
             continue;
 
-        RB_FOREACH(peer_vlan_id, vlan_rb_tree, &(peer_if->vlan_tree))
-        {
-            peer_vlan_id->vlan_removed = 1;
-        }
+        peer_if_mark_all_vlan_removed(peer_if);
 
         /* Record peer info*/
         peer_if->ipv4_addr = ntohl(tlv->ipv4_addr);
@@ -1319,7 +1414,7 @@ int mlacp_fsm_update_heartbeat(struct CSM* csm, struct mLACPHeartbeatTLV* tlv)
     if (!csm || !tlv)
         return MCLAG_ERROR;
 
-    time(&csm->heartbeat_update_time);
+    csm->heartbeat_update_msec = iccp_timer_now_msec();
 
     return 0;
 }
@@ -33,18 +33,152 @@
 #include "../include/iccp_netlink.h"
 #include "../include/iccp_ifm.h"
 
+static uint32_t if_vlan_gen_seq = 0;
+#define IF_VLAN_GEN_BUMP(ifp)   ((ifp)->vlan_gen = ++if_vlan_gen_seq)
 
-static int vlan_node_compare(const struct VLAN_ID *p_vlan_node1, const struct VLAN_ID *p_vlan_node2)
+/* First vid >= vid set in bm, VLAN_ID_MAX if none */
+int vlan_bitmap_next(const struct VlanBitmap* bm, int vid)
 {
-    if (p_vlan_node1->vid < p_vlan_node2->vid)
+    int i;
+    uint64_t word;
+
+    if (vid >= VLAN_ID_MAX)
+        return VLAN_ID_MAX;
+
+    i = VLAN_BITMAP_WORD(vid);
+    word = bm->word[i] & (~0ULL << (vid % 64));
+
+    while (1)
+    {
+        if (word)
+            return i * 64 + __builtin_ctzll(word);
+
+        if (++i >= VLAN_BITMAP_WORDS)
+            return VLAN_ID_MAX;
+
+        word = bm->word[i];
+    }
+}
+
+int vlan_bitmap_count(const struct VlanBitmap* bm)
+{
+    int i, count = 0;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; ++i)
+        count += __builtin_popcountll(bm->word[i]);
+
+    return count;
+}
+
+int vlan_bitmap_is_empty(const struct VlanBitmap* bm)
+{
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; ++i)
+    {
+        if (bm->word[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Every VLAN in a is in b too */
+int vlan_bitmap_is_subset(const struct VlanBitmap* a, const struct VlanBitmap* b)
+{
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; ++i)
+    {
+        if (a->word[i] & ~b->word[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+/* res = a & ~b, res may be a or b */
+void vlan_bitmap_diff(struct VlanBitmap* res, const struct VlanBitmap* a, const struct VlanBitmap* b)
+{
+    int i;
+
+    for (i = 0; i < VLAN_BITMAP_WORDS; ++i)
+        res->word[i] = a->word[i] & ~b->word[i];
+
+    return;
+}
+
+static int vlan_itf_vid(const char* ifname)
+{
+    int vid = 0;
+
+    if (sscanf(ifname, "Vlan%d", &vid) != 1 || vid <= 0 || vid >= VLAN_ID_MAX)
         return -1;
 
-    if (p_vlan_node1->vid > p_vlan_node2->vid)
-        return 1;
+    return vid;
+}
 
-    return 0;
+int local_if_is_vlan_member(struct LocalInterface* lif, uint16_t vid)
+{
+    return vid < VLAN_ID_MAX && VLAN_BITMAP_TEST(&lif->vlan_bitmap, vid);
+}
+
+struct LocalInterface* local_if_find_vlan_itf(uint16_t vid)
+{
+    struct System* sys = NULL;
+
+    if (vid >= VLAN_ID_MAX || (sys = system_get_instance()) == NULL)
+        return NULL;
+
+    return sys->vlan_itf[vid];
+}
+
+uint32_t if_name_hash(const char* ifname)
+{
+    uint32_t hash = 5381;
+
+    while (*ifname)
+        hash = ((hash << 5) + hash) + (uint8_t)*ifname++;
+
+    return hash;
+}
+
+static void local_if_hash_add(struct System* sys, struct LocalInterface* lif)
+{
+    LIST_INSERT_HEAD(&(sys->lif_name_hash[IF_HASH_BUCKET(if_name_hash(lif->name), LIF_HASH_SIZE)]),
+        lif, name_hash_next);
+    LIST_INSERT_HEAD(&(sys->lif_ifindex_hash[IF_HASH_BUCKET((uint32_t)lif->ifindex, LIF_HASH_SIZE)]),
+        lif, ifindex_hash_next);
+
+    if (lif->type == IF_T_PORT_CHANNEL)
+        LIST_INSERT_HEAD(&(sys->lif_po_id_hash[IF_HASH_BUCKET((uint32_t)lif->po_id, LIF_HASH_SIZE)]),
+            lif, po_id_hash_next);
+
+    return;
+}
+
+static void local_if_hash_del(struct LocalInterface* lif)
+{
+    if (IF_IN_HASH(lif, name_hash_next))
+    {
+        LIST_REMOVE(lif, name_hash_next);
+        lif->name_hash_next.le_prev = NULL;
+    }
+
+    if (IF_IN_HASH(lif, ifindex_hash_next))
+    {
+        LIST_REMOVE(lif, ifindex_hash_next);
+        lif->ifindex_hash_next.le_prev = NULL;
+    }
+
+    if (IF_IN_HASH(lif, po_id_hash_next))
+    {
+        LIST_REMOVE(lif, po_id_hash_next);
+        lif->po_id_hash_next.le_prev = NULL;
+    }
+
+    return;
 }
-RB_GENERATE(vlan_rb_tree, VLAN_ID, vlan_entry, vlan_node_compare);
 
 void local_if_init(struct LocalInterface* local_if)
 {
@@ -68,16 +202,8 @@ void local_if_init(struct LocalInterface* local_if)
     local_if->isolate_to_peer_link = 0;
     local_if->is_l3_proto_enabled = false;
     local_if->vlan_count = 0;
-    RB_INIT(vlan_rb_tree, &local_if->vlan_tree);
-
-    return;
-}
-
-void vlan_info_init(struct VLAN_ID* vlan)
-{
-    vlan->vid = -1;
-    vlan->vlan_removed = 0;
-    vlan->vlan_itf = NULL;
+    VLAN_BITMAP_ZERO(&local_if->vlan_bitmap);
+    IF_VLAN_GEN_BUMP(local_if);
 
     return;
 }
@@ -88,6 +214,7 @@ struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint
     struct LocalInterface* local_if = NULL;
     struct CSM* csm;
     struct If_info * cif = NULL;
+    int vid;
 
     if (!ifname)
         return NULL;
@@ -165,6 +292,10 @@ struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint
                    local_if->mac_addr[3], local_if->mac_addr[4], local_if->mac_addr[5], local_if->state ? "down" : "up");
 
     LIST_INSERT_HEAD(&(sys->lif_list), local_if, system_next);
+    local_if_hash_add(sys, local_if);
+
+    if (type == IF_T_VLAN && (vid = vlan_itf_vid(local_if->name)) > 0)
+        sys->vlan_itf[vid] = local_if;
 
     //if there is pending vlan membership for this interface move to system lif
     move_pending_vlan_mbr_to_lif(sys, local_if);
@@ -202,7 +333,7 @@ struct LocalInterface* local_if_find_by_name(const char* ifname)
     if (!(sys = system_get_instance()))
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_name_hash[IF_HASH_BUCKET(if_name_hash(ifname), LIF_HASH_SIZE)]), name_hash_next)
     {
         if (strcmp(local_if->name, ifname) == 0)
             return local_if;
@@ -219,7 +350,7 @@ struct LocalInterface* local_if_find_by_ifindex(int ifindex)
     if ((sys = system_get_instance()) == NULL)
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_ifindex_hash[IF_HASH_BUCKET((uint32_t)ifindex, LIF_HASH_SIZE)]), ifindex_hash_next)
     {
         if (local_if->ifindex == ifindex)
             return local_if;
@@ -236,7 +367,7 @@ struct LocalInterface* local_if_find_by_po_id(int po_id)
     if ((sys = system_get_instance()) == NULL)
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
+    LIST_FOREACH(local_if, &(sys->lif_po_id_hash[IF_HASH_BUCKET((uint32_t)po_id, LIF_HASH_SIZE)]), po_id_hash_next)
     {
         if (local_if->type == IF_T_PORT_CHANNEL && local_if->po_id == po_id)
             return local_if;
@@ -245,41 +376,43 @@ struct LocalInterface* local_if_find_by_po_id(int po_id)
     return NULL;
 }
 
+/* Interface ifindex is part of the lookup key, always update it here */
+void local_if_set_ifindex(struct LocalInterface* local_if, int ifindex)
+{
+    struct System* sys = NULL;
+
+    if (!local_if || local_if->ifindex == ifindex)
+        return;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    if (IF_IN_HASH(local_if, ifindex_hash_next))
+        LIST_REMOVE(local_if, ifindex_hash_next);
+
+    local_if->ifindex = ifindex;
+    LIST_INSERT_HEAD(&(sys->lif_ifindex_hash[IF_HASH_BUCKET((uint32_t)ifindex, LIF_HASH_SIZE)]),
+        local_if, ifindex_hash_next);
+
+    return;
+}
+
  void local_if_vlan_remove(struct LocalInterface *lif_vlan)
 {
     struct System *sys = NULL;
-    struct LocalInterface *lif = NULL;
-    struct VLAN_ID *vlan = NULL;
     int vid = 0;
-    struct VLAN_ID vlan_key = { 0 };
 
     if (!lif_vlan || lif_vlan->type != IF_T_VLAN)
     {
         return;
     }
 
-    sscanf(lif_vlan->name, "Vlan%d", &vid);
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
-
-    if ((sys = system_get_instance()) != NULL)
-    {
-        LIST_FOREACH(lif, &(sys->lif_list), system_next)
-        {
-            if (lif->type == IF_T_VLAN)
-                continue;
-
-            //delink this vlan (lif_vlan) interface from all associated lifs
-            //in scenario where vlan membership delete comes later when compared
-            //to vlan interface delete from kernel
-            vlan = RB_FIND(vlan_rb_tree, &(lif->vlan_tree), &vlan_key);
-            if (vlan)
-            {
-                vlan->vlan_itf = NULL;
-            }
-       }
-    }
+    //delink this vlan (lif_vlan) interface from all associated lifs
+    //in scenario where vlan membership delete comes later when compared
+    //to vlan interface delete from kernel
+    vid = vlan_itf_vid(lif_vlan->name);
+    if (vid > 0 && (sys = system_get_instance()) != NULL && sys->vlan_itf[vid] == lif_vlan)
+        sys->vlan_itf[vid] = NULL;
 
     return;
 }
@@ -364,6 +497,8 @@ void local_if_destroy(char *ifname)
 
 to_sys_purge:
     /* sys purge */
+    local_if_hash_del(lif);
+    local_if_clear_dirty(lif);
     LIST_REMOVE(lif, system_next);
     if (lif->csm)
         LIST_REMOVE(lif, mlacp_next);
@@ -372,6 +507,8 @@ to_sys_purge:
 
 to_mlacp_purge:
     /* sys & mlacp purge */
+    local_if_hash_del(lif);
+    local_if_clear_dirty(lif);
     LIST_REMOVE(lif, system_next);
     LIST_REMOVE(lif, mlacp_next);
     LIST_INSERT_HEAD(&(sys->lif_purge_list), lif, system_purge_next);
@@ -396,6 +533,29 @@ int local_if_is_l3_mode(struct LocalInterface* local_if)
     return ret;
 }
 
+/* Queue lif for the next exchange pass of its CSM */
+void local_if_set_dirty(struct LocalInterface* lif)
+{
+    if (lif == NULL || lif->csm == NULL || LIF_IN_DIRTY_LIST(lif))
+        return;
+
+    LIST_INSERT_HEAD(&(MLACP(lif->csm).lif_dirty_list), lif, mlacp_dirty_next);
+
+    return;
+}
+
+void local_if_clear_dirty(struct LocalInterface* lif)
+{
+    if (lif == NULL || !LIF_IN_DIRTY_LIST(lif))
+        return;
+
+    LIST_REMOVE(lif, mlacp_dirty_next);
+    lif->mlacp_dirty_next.le_next = NULL;
+    lif->mlacp_dirty_next.le_prev = NULL;
+
+    return;
+}
+
 void local_if_change_flag_clear(void)
 {
     struct System* sys = NULL;
@@ -502,6 +662,7 @@ struct PeerInterface* peer_if_create(struct CSM* csm,
         return NULL;
     }
     memset(peer_if, 0, sizeof(struct PeerInterface));
+    IF_VLAN_GEN_BUMP(peer_if);
 
     if (type == IF_T_PORT)
     {
@@ -513,6 +674,7 @@ struct PeerInterface* peer_if_create(struct CSM* csm,
     {
         peer_if->ifindex = peer_if_number;
         peer_if->type = IF_T_PORT_CHANNEL;
+        peer_if->csm = csm;
     }
 
     LIST_INSERT_HEAD(&(MLACP(csm).pif_list), peer_if, mlacp_next);
@@ -531,7 +693,7 @@ struct PeerInterface* peer_if_find_by_name(struct CSM* csm, char* name)
     if (csm == NULL)
         return NULL;
 
-    LIST_FOREACH(peer_if, &(csm->app_csm.mlacp.pif_list), mlacp_next)
+    LIST_FOREACH(peer_if, &(MLACP(csm).pif_name_hash[IF_HASH_BUCKET(if_name_hash(name), PIF_HASH_SIZE)]), name_hash_next)
     {
         if (strcmp(peer_if->name, name) == 0)
             return peer_if;
@@ -540,17 +702,45 @@ struct PeerInterface* peer_if_find_by_name(struct CSM* csm, char* name)
     return NULL;
 }
 
-void peer_if_del_all_vlan(struct PeerInterface* pif)
+/* Peer interface name is learned after create, keep the name hash in sync */
+void peer_if_set_name(struct PeerInterface* pif, const char* name, size_t len)
+{
+    if (!pif || !pif->csm || !name)
+        return;
+
+    if (len >= MAX_L_PORT_NAME)
+        len = MAX_L_PORT_NAME - 1;
+
+    if (IF_IN_HASH(pif, name_hash_next))
+        LIST_REMOVE(pif, name_hash_next);
+
+    memset(pif->name, 0, MAX_L_PORT_NAME);
+    memcpy(pif->name, name, len);
+    LIST_INSERT_HEAD(&(MLACP(pif->csm).pif_name_hash[IF_HASH_BUCKET(if_name_hash(pif->name), PIF_HASH_SIZE)]),
+        pif, name_hash_next);
+
+    return;
+}
+
+void peer_if_hash_init(struct CSM* csm)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
+    int i;
+
+    if (csm == NULL)
+        return;
+
+    for (i = 0; i < PIF_HASH_SIZE; ++i)
+        LIST_INIT(&(MLACP(csm).pif_name_hash[i]));
+
+    return;
+}
 
+void peer_if_del_all_vlan(struct PeerInterface* pif)
+{
     ICCPD_LOG_NOTICE(__FUNCTION__, "Remove all VLANs from peer intf %s", pif->name);
-    RB_FOREACH_SAFE(vlan, vlan_rb_tree, &(pif->vlan_tree), vlan_temp)
-    {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(pif->vlan_tree), vlan);
-        free(vlan);
-    }
+    VLAN_BITMAP_ZERO(&pif->vlan_bitmap);
+    VLAN_BITMAP_ZERO(&pif->vlan_removed);
+    IF_VLAN_GEN_BUMP(pif);
     return;
 }
 
@@ -561,6 +751,8 @@ void peer_if_destroy(struct PeerInterface* pif)
 
     /* destroy if*/
     LIST_REMOVE(pif, mlacp_next);
+    if (IF_IN_HASH(pif, name_hash_next))
+        LIST_REMOVE(pif, name_hash_next);
     peer_if_del_all_vlan(pif);
 
     free(pif);
@@ -569,44 +761,32 @@ void peer_if_destroy(struct PeerInterface* pif)
 
 int local_if_add_vlan(struct LocalInterface* local_if,  uint16_t vid)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-    char vlan_name[16] = "";
-
-    sprintf(vlan_name, "Vlan%d", vid);
+    struct LocalInterface* vlan_itf = NULL;
 
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
+    if (vid >= VLAN_ID_MAX)
+        return MCLAG_ERROR;
 
-    vlan = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), &vlan_key);
+    vlan_itf = local_if_find_vlan_itf(vid);
 
-    if (!vlan)
+    if (!VLAN_BITMAP_TEST(&local_if->vlan_bitmap, vid))
     {
-        vlan = (struct VLAN_ID*)malloc(sizeof(struct VLAN_ID));
-        if (!vlan)
-            return MCLAG_ERROR;
-
-        vlan_info_init(vlan);
-        vlan->vid = vid;
-        vlan->vlan_itf = local_if_find_by_name(vlan_name);
-
-        if (vlan->vlan_itf == NULL) {
-            ICCPD_LOG_DEBUG(__FUNCTION__, "vlan_itf %s not present", vlan_name);
+        if (vlan_itf == NULL) {
+            ICCPD_LOG_DEBUG(__FUNCTION__, "vlan_itf Vlan%d not present", vid);
         }
+        VLAN_BITMAP_SET(&local_if->vlan_bitmap, vid);
+        IF_VLAN_GEN_BUMP(local_if);
         local_if->vlan_count +=1;
         ICCPD_LOG_DEBUG(__FUNCTION__, "Add %s to VLAN %d vlan count %d", local_if->name, vid, local_if->vlan_count);
         local_if->port_config_sync = 1;
-        RB_INSERT(vlan_rb_tree, &(local_if->vlan_tree), vlan);
+        local_if_set_dirty(local_if);
     }
 
-    vlan->vlan_removed = 0;
-
 //    update_if_ipmac_on_standby(local_if, 5);
-    if (vlan->vlan_itf)
+    if (vlan_itf)
     {
         if (local_if->is_peer_link)
         {
-            update_vlan_if_mac_on_standby(vlan->vlan_itf, 1);
+            update_vlan_if_mac_on_standby(vlan_itf, 1);
         }
     }
     else
@@ -618,19 +798,15 @@ int local_if_add_vlan(struct LocalInterface* local_if,  uint16_t vid)
 
 void local_if_del_vlan(struct LocalInterface* local_if, uint16_t vid)
 {
-    struct VLAN_ID *vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vid;
-
-    vlan = RB_FIND(vlan_rb_tree, &(local_if->vlan_tree), &vlan_key);
+    if (vid >= VLAN_ID_MAX)
+        return;
 
-    if (vlan != NULL)
+    if (VLAN_BITMAP_TEST(&local_if->vlan_bitmap, vid))
     {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(local_if->vlan_tree), vlan);
-        free(vlan);
+        VLAN_BITMAP_CLR(&local_if->vlan_bitmap, vid);
+        IF_VLAN_GEN_BUMP(local_if);
         local_if->port_config_sync = 1;
+        local_if_set_dirty(local_if);
         local_if->vlan_count -=1;
         ICCPD_LOG_DEBUG(__FUNCTION__, "Remove %s from VLAN %d, count %d", local_if->name, vid, local_if->vlan_count);
     }
@@ -639,16 +815,10 @@ void local_if_del_vlan(struct LocalInterface* local_if, uint16_t vid)
 
 void local_if_del_all_vlan(struct LocalInterface* lif)
 {
-    struct VLAN_ID* vlan = NULL;
-    struct VLAN_ID* vlan_temp = NULL;
-
     ICCPD_LOG_NOTICE(__FUNCTION__, "Remove all VLANs from %s", lif->name);
-    RB_FOREACH_SAFE(vlan, vlan_rb_tree, &(lif->vlan_tree), vlan_temp)
-    {
-        VLAN_RB_REMOVE(vlan_rb_tree, &(lif->vlan_tree), vlan);
-        lif->vlan_count -=1;
-        free(vlan);
-    }
+    VLAN_BITMAP_ZERO(&lif->vlan_bitmap);
+    IF_VLAN_GEN_BUMP(lif);
+    lif->vlan_count = 0;
 
     return;
 }
@@ -656,62 +826,49 @@ void local_if_del_all_vlan(struct LocalInterface* lif)
 /* Add VLAN from peer-link*/
 int peer_if_add_vlan(struct PeerInterface* peer_if, uint16_t vlan_id)
 {
-    struct VLAN_ID *peer_vlan = NULL;
-    struct VLAN_ID vlan_key = { 0 };
-    char vlan_name[16] = "";
-
-    sprintf(vlan_name, "Vlan%d", vlan_id);
+    if (vlan_id >= VLAN_ID_MAX)
+        return MCLAG_ERROR;
 
-    memset(&vlan_key, 0, sizeof(struct VLAN_ID));
-    vlan_key.vid = vlan_id;
-
-    peer_vlan = RB_FIND(vlan_rb_tree, &(peer_if->vlan_tree), &vlan_key);
-
-    if (!peer_vlan)
+    if (!VLAN_BITMAP_TEST(&peer_if->vlan_bitmap, vlan_id))
     {
-        peer_vlan = (struct VLAN_ID*)malloc(sizeof(struct VLAN_ID));
-        if (!peer_vlan)
-            return MCLAG_ERROR;
-
-        vlan_info_init(peer_vlan);
-        peer_vlan->vid = vlan_id;
-
         ICCPD_LOG_DEBUG(__FUNCTION__, "add VLAN ID = %d from peer's %s", vlan_id, peer_if->name);
-        RB_INSERT(vlan_rb_tree, &(peer_if->vlan_tree), peer_vlan);
+        VLAN_BITMAP_SET(&peer_if->vlan_bitmap, vlan_id);
+        IF_VLAN_GEN_BUMP(peer_if);
     }
 
-    peer_vlan->vlan_removed = 0;
+    VLAN_BITMAP_CLR(&peer_if->vlan_removed, vlan_id);
     return 0;
 }
 
+/* Used by sync update, VLANs not re-added by the peer afterwards are
+ * dropped by peer_if_clean_unused_vlan()
+ */
+void peer_if_mark_all_vlan_removed(struct PeerInterface* peer_if)
+{
+    memcpy(&peer_if->vlan_removed, &peer_if->vlan_bitmap, sizeof(struct VlanBitmap));
+
+    return;
+}
+
 /* Used by sync update*/
 int peer_if_clean_unused_vlan(struct PeerInterface* peer_if)
 {
-    struct VLAN_ID *peer_vlan = NULL;
-    struct VLAN_ID *peer_vlan_next = NULL;
-    struct VLAN_ID *vlan_temp = NULL;
+    int vid;
 
-    /* traverse 1 time */
-    RB_FOREACH_SAFE(peer_vlan_next, vlan_rb_tree, &(peer_if->vlan_tree), vlan_temp)
+    if (ICCPD_LOG_ENABLED(DEBUG_LOG_LEVEL))
     {
-        if (peer_vlan != NULL)
+        VLAN_BITMAP_FOREACH(vid, &peer_if->vlan_removed)
         {
-            ICCPD_LOG_DEBUG(__FUNCTION__, "Remove peer intf %s from VLAN %d", peer_if->name, peer_vlan->vid);
-            VLAN_RB_REMOVE(vlan_rb_tree, &(peer_if->vlan_tree), peer_vlan);
-            free(peer_vlan);
-            peer_vlan = NULL;
-
+            ICCPD_LOG_DEBUG(__FUNCTION__, "Remove peer intf %s from VLAN %d", peer_if->name, vid);
         }
-        if (peer_vlan_next->vlan_removed == 1)
-            peer_vlan = peer_vlan_next;
     }
 
-    if (peer_vlan != NULL)
-    {
-        ICCPD_LOG_DEBUG(__FUNCTION__, "Remove peer intf %s from VLAN %d", peer_if->name, peer_vlan->vid);
-        VLAN_RB_REMOVE(vlan_rb_tree, &(peer_if->vlan_tree), peer_vlan);
-        free(peer_vlan);
-    }
+    if (vlan_bitmap_is_empty(&peer_if->vlan_removed))
+        return 0;
+
+    vlan_bitmap_diff(&peer_if->vlan_bitmap, &peer_if->vlan_bitmap, &peer_if->vlan_removed);
+    VLAN_BITMAP_ZERO(&peer_if->vlan_removed);
+    IF_VLAN_GEN_BUMP(peer_if);
 
     return 0;
 }
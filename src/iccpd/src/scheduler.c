@@ -32,6 +32,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/epoll.h>
+#include <fcntl.h>
 
 #include "../include/logger.h"
 #include "../include/system.h"
@@ -41,6 +42,7 @@
 #include "../include/iccp_cmd.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/iccp_netlink.h"
+#include "../include/iccp_warm_snapshot.h"
 
 /******************************************************
 *
@@ -51,8 +53,8 @@
 //this needs to be fine tuned
 #define PEER_SOCK_SND_BUF_LEN  (6 * 1024 * 1024)
 #define PEER_SOCK_RCV_BUF_LEN  (6 * 1024 * 1024)
-#define RECV_RETRY_INTERVAL_USEC    100000
-#define RECV_RETRY_MAX              10
+/* Socket reads per EPOLLIN, level triggered epoll calls back for the rest */
+#define RECV_READ_MAX               16
 
 extern int mlacp_prepare_for_warm_reboot(struct CSM* csm, char* buf, size_t max_buf_size);
 
@@ -71,29 +73,39 @@ static int session_conn_thread_unlock(pthread_mutex_t *conn_mutex)
     return 1;/* pthread_mutex_unlock(conn_mutex);*/
 }
 
-static void heartbeat_check(struct CSM *csm)
+/* Session timer expired, heartbeats only refresh heartbeat_update_msec so
+ * check how long the peer has really been silent before tearing down.
+ */
+void scheduler_session_timer_handler(void* arg)
 {
-    if (csm->heartbeat_update_time == 0)
-    {
-        time(&csm->heartbeat_update_time);
+    struct CSM* csm = (struct CSM*)arg;
+    uint64_t timeout = (uint64_t)csm->session_timeout * 1000;
+    uint64_t elapsed;
+
+    if (csm->sock_fd <= 0)
         return;
-    }
 
-    if ( (time(NULL) - csm->heartbeat_update_time) > csm->session_timeout)
+    elapsed = iccp_timer_now_msec() - csm->heartbeat_update_msec;
+    if (elapsed < timeout)
     {
-        /* hearbeat timeout*/
-        ICCPD_LOG_WARN("ICCP_FSM", "iccpd connection timeout (heartbeat)");
-        scheduler_session_disconnect_handler(csm);
+        iccp_timer_start(&csm->session_timer, timeout - elapsed);
+        return;
     }
 
+    /* hearbeat timeout*/
+    ICCPD_LOG_WARN("ICCP_FSM", "iccpd connection timeout (heartbeat)");
+    scheduler_session_disconnect_handler(csm);
+
     return;
 }
 
 static void heartbeat_update(struct CSM *csm)
 {
-    if (csm->sock_fd > 0)
+    if (csm->sock_fd > 0 && !ICCP_TIMER_PENDING(&csm->session_timer))
     {
-        heartbeat_check(csm);
+        if (csm->heartbeat_update_msec == 0)
+            csm->heartbeat_update_msec = iccp_timer_now_msec();
+        iccp_timer_start(&csm->session_timer, (uint64_t)csm->session_timeout * 1000);
     }
 
     return;
@@ -127,128 +139,119 @@ static int scheduler_transit_fsm()
 }
 
 /* Receive packets call back function */
-int scheduler_csm_read_callback(struct CSM* csm)
+/* Hand every complete message in the receive buffer to the CSM,
+ * a partial one stays at the front of the buffer.
+ */
+static int scheduler_csm_parse_rx_buf(struct CSM* csm)
 {
+    struct CsmRxBuf* rxb = &csm->rx_buf;
     struct Msg* msg = NULL;
-    /*peer message*/
-    char *peer_msg = g_csm_buf;
-    LDPHdr* ldp_hdr = (LDPHdr*)peer_msg;
-    char* data = &peer_msg[sizeof(LDPHdr)];
-    size_t data_len = 0;
+    LDPHdr* ldp_hdr = NULL;
     size_t pos = 0;
-    int recv_len = 0, len = 0, retval;
-    int num_retry = 0;
-    int total_retry_time = 0;
-    int total_data_len = 0;
+    size_t msg_len;
+    int retval;
+    uint64_t rx_usec = iccp_timer_now_usec();
 
-    if (csm->sock_fd <= 0)
-        return MCLAG_ERROR;
-
-    memset(peer_msg, 0, CSM_BUFFER_SIZE);
-
-    recv_len = 0;
-    errno = 0;
-
-    while (recv_len != sizeof(LDPHdr))
+    while (rxb->len - pos >= sizeof(LDPHdr))
     {
-        len = recv(csm->sock_fd, peer_msg + recv_len, sizeof(LDPHdr) - recv_len, 0);
-        if (len == -1)
+        ldp_hdr = (LDPHdr*)&rxb->buf[pos];
+        if (ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS < sizeof(LDPHdr)
+            || ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS > CSM_BUFFER_SIZE)
         {
-            perror("recv(). Error");
-            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for header read error[%s] len = -1 till now received len  = %d ", strerror(errno), recv_len);
-            SYSTEM_INCR_HDR_READ_SOCK_ERR_COUNTER(system_get_instance());
-            goto recv_err;
+            ICCPD_LOG_ERR("ICCP_FSM", "Peer disconnect for invalid data error; length[%d] msg_type[0x%x] ", ntohs(ldp_hdr->msg_len),  ntohs(ldp_hdr->msg_type));
+            SYSTEM_INCR_INVALID_PEER_MSG_COUNTER(system_get_instance());
+            return MCLAG_ERROR;
         }
-        else if (len == 0)
+
+        msg_len = ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
+        if (rxb->len - pos < msg_len)
+            break;
+
+        retval = iccp_csm_init_msg(&msg, &rxb->buf[pos], msg_len);
+        if (retval == 0)
         {
-            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for header read error[%s] len = 0, till now received len = %d ",strerror(errno), recv_len);
-            SYSTEM_INCR_HDR_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
-            goto recv_err;
+            msg->lat_stamp = rx_usec;
+            iccp_csm_enqueue_msg(csm, msg);
+            ++csm->icc_msg_in_count;
         }
-        recv_len += len;
-        /*usleep(100);*/
+        else
+            ++csm->i_msg_in_count;
+
+        pos += msg_len;
     }
 
-    if (ntohs(ldp_hdr->msg_len) >= MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS)
+    if (pos > 0)
     {
-        data_len = ntohs(ldp_hdr->msg_len) - MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS;
+        rxb->len -= pos;
+        if (rxb->len > 0)
+            memmove(rxb->buf, &rxb->buf[pos], rxb->len);
     }
-    else
+
+    return 0;
+}
+
+/* Read what the socket has, never wait for the rest of a message */
+int scheduler_csm_read_callback(struct CSM* csm)
+{
+    struct CsmRxBuf* rxb = &csm->rx_buf;
+    ssize_t recv_len = 0;
+    int num_read = 0;
+
+    if (csm->sock_fd <= 0)
+        return MCLAG_ERROR;
+
+    if (rxb->buf == NULL)
     {
-        ICCPD_LOG_ERR("ICCP_FSM", "Peer disconnect for invalid data error; length[%d] msg_type[0x%x] ", ntohs(ldp_hdr->msg_len),  ntohs(ldp_hdr->msg_type));
-        SYSTEM_INCR_INVALID_PEER_MSG_COUNTER(system_get_instance());
-        goto recv_err;
+        rxb->buf = (char*)malloc(CSM_RX_BUF_SIZE);
+        if (rxb->buf == NULL)
+        {
+            ICCPD_LOG_ERR("ICCP_FSM", "Failed to allocate receive buffer for peer %s", csm->peer_ip);
+            goto recv_err;
+        }
+        rxb->len = 0;
     }
-    total_data_len = data_len;
-    pos = 0;
 
-    while (data_len > 0)
+    while (num_read++ < RECV_READ_MAX)
     {
-        /* When consecutive CCP session flaps happen, recv() call got stuck.
-         * Change recv() to non-blocking with retry mechanism. If max
-         * retry reaches, attempt one more retry after waiting for one KA
-         * interval before bringing down the session.
-         */
-        recv_len = recv(csm->sock_fd, &data[pos], data_len, MSG_DONTWAIT);
+        recv_len = recv(csm->sock_fd, &rxb->buf[rxb->len], CSM_RX_BUF_SIZE - rxb->len, MSG_DONTWAIT);
         if (recv_len == -1)
         {
+            if (errno == EINTR)
+                continue;
             if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                break;
+
+            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for read error[%s], pending len %zu",
+                           strerror(errno), rxb->len);
+            if (rxb->len < sizeof(LDPHdr))
             {
-                ICCPD_LOG_NOTICE(
-                    "ICCP_FSM", "Non-blocking recv total/pending len %d/%d, errno %d, num_retry %d",
-                    total_data_len, data_len, errno, num_retry);
-                ++num_retry;
-                if (num_retry > RECV_RETRY_MAX)
-                {
-                    ICCPD_LOG_ERR(
-                        "ICCP_FSM", "Non-blocking recv() retry failed, total/pending len %d/%d",
-                        total_data_len, data_len);
-                    SYSTEM_INCR_RX_RETRY_FAIL_COUNTER(system_get_instance());
-                    goto recv_err;
-                }
-                else
-                {
-                    if (num_retry == RECV_RETRY_MAX)
-                        usleep((csm->session_timeout * 1000000) - total_retry_time);
-                    else
-                    {
-                        total_retry_time += (num_retry * RECV_RETRY_INTERVAL_USEC);
-                        usleep(num_retry * RECV_RETRY_INTERVAL_USEC);
-                    }
-                    recv_len = 0;
-                }
+                SYSTEM_INCR_HDR_READ_SOCK_ERR_COUNTER(system_get_instance());
             }
             else
             {
-                perror("continue recv() Error");
-                ICCPD_LOG_WARN("ICCP_FSM", "Peer data read error; recv_len:%d data_len:%d, errno %d",
-                               recv_len, data_len, errno);
                 SYSTEM_INCR_TLV_READ_SOCK_ERR_COUNTER(system_get_instance());
-                goto recv_err;
             }
+            goto recv_err;
         }
         else if (recv_len == 0)
         {
-            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for data read error; recv_len:%d data_len:%d ", recv_len, data_len);
-            SYSTEM_INCR_TLV_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
+            ICCPD_LOG_WARN("ICCP_FSM", "Peer disconnect for read error, len = 0, pending len %zu",
+                           rxb->len);
+            if (rxb->len < sizeof(LDPHdr))
+            {
+                SYSTEM_INCR_HDR_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
+            }
+            else
+            {
+                SYSTEM_INCR_TLV_READ_SOCK_ZERO_LEN_COUNTER(system_get_instance());
+            }
             goto recv_err;
         }
-        data_len -= recv_len;
-        pos += recv_len;
-        /*usleep(100);*/
-    }
-    if (num_retry > 0)
-    {
-        SYSTEM_SET_RETRY_COUNTER(system_get_instance(), num_retry);
-    }
-    retval = iccp_csm_init_msg(&msg, peer_msg, ntohs(ldp_hdr->msg_len) + MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS);
-    if (retval == 0)
-    {
-        iccp_csm_enqueue_msg(csm, msg);
-        ++csm->icc_msg_in_count;
+
+        rxb->len += recv_len;
+        if (scheduler_csm_parse_rx_buf(csm) < 0)
+            goto recv_err;
     }
-    else
-        ++csm->i_msg_in_count;
 
     return 1;
 
@@ -319,6 +322,9 @@ int scheduler_server_accept()
     session_conn_thread_lock(&csm->conn_mutex);
     ICCPD_LOG_INFO(__FUNCTION__, "Server Accept, SocketFD [%d], %p", new_fd, csm);
 
+    /* Both sides connecting at once, our pending connect loses */
+    session_client_conn_abort(csm);
+
     struct epoll_event event;
     int err;
     int send_buf_len = PEER_SOCK_SND_BUF_LEN;
@@ -333,6 +339,7 @@ int scheduler_server_accept()
     }
 
     csm->sock_fd = new_fd;
+    system_set_csm_fd(csm, new_fd);
     if (setsockopt(csm->sock_fd, SOL_SOCKET, SO_SNDBUF, &send_buf_len, sizeof(send_buf_len)) == -1)
     {
         ICCPD_LOG_ERR(__FUNCTION__, "Set socket send buf option failed. Error");
@@ -373,6 +380,18 @@ void iccp_get_start_type(struct System* sys)
 }
 
 /* scheduler initialization */
+/* The state machines still check some second granularity deadlines
+ * (warm reboot, peer link learning, po down), wake up for them.
+ */
+static void scheduler_housekeeping_timer_handler(void* arg)
+{
+    struct System* sys = (struct System*)arg;
+
+    iccp_timer_start(&sys->housekeeping_timer, TRANSIT_INTERVAL_SEC * 1000);
+
+    return;
+}
+
 void scheduler_init()
 {
     struct System* sys = NULL;
@@ -381,6 +400,7 @@ void scheduler_init()
         return;
 
     iccp_get_start_type(sys);
+    iccp_warm_snapshot_load(sys);
     /*Get kernel interface and port */
     iccp_sys_local_if_list_get_init();
     iccp_sys_local_if_list_get_addr();
@@ -399,6 +419,7 @@ void scheduler_init()
     else
     {
         ICCPD_LOG_DEBUG(__FUNCTION__, "Syncd info socket connect success");
+        iccp_warm_snapshot_syncd_connected(sys);
     }
 
     if (mclagd_ctl_sock_create() < 0)
@@ -406,6 +427,9 @@ void scheduler_init()
         ICCPD_LOG_WARN(__FUNCTION__, "Mclagd ctl info socket connect fail");
     }
 
+    iccp_timer_init(&sys->housekeeping_timer, scheduler_housekeeping_timer_handler, sys);
+    iccp_timer_start(&sys->housekeeping_timer, TRANSIT_INTERVAL_SEC * 1000);
+
     return;
 }
 
@@ -448,6 +472,7 @@ int iccp_receive_signal_handler(struct System* sys)
         case 'w':
             /*send packet to peer*/
             mlacp_sync_send_warmboot_flag();
+            iccp_warm_snapshot_save(sys);
             sys->warmboot_exit = WARM_REBOOT;
             break;
 
@@ -458,6 +483,62 @@ int iccp_receive_signal_handler(struct System* sys)
     return 0;
 }
 
+/* While the syncd link or a peer session is being brought up, the state
+ * machines advance one step per loop, keep polling. Once settled, sleep
+ * until a socket or the timer wheel has something to do. Peer messages
+ * left queued by MLACP_RX_MSG_BUDGET are handled without sleeping.
+ */
+static int scheduler_epoll_timeout(struct System* sys)
+{
+    struct CSM* csm = NULL;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        /* Left over from the per-domain message budget */
+        if (csm->sock_fd > 0 && csm->app_csm.current_state == APP_OPERATIONAL
+            && !TAILQ_EMPTY(&(MLACP(csm).mlacp_msg_list)))
+            return 0;
+    }
+
+    if (sys->sync_fd <= 0)
+        return EPOLL_TIMEOUT_MSEC;
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        if (csm->sock_fd > 0 && MLACP(csm).current_state != MLACP_STATE_EXCHANGE)
+            return EPOLL_TIMEOUT_MSEC;
+    }
+
+    return -1;
+}
+
+/* One pass of the main loop. Waits at most max_wait_msec for an event,
+ * -1 leaves the wait to scheduler_epoll_timeout.
+ */
+void scheduler_loop_once(struct System* sys, int max_wait_msec)
+{
+    int timeout;
+
+    if (sys->sync_fd <= 0)
+    {
+        if (iccp_connect_syncd() == 0 && sys->sync_fd > 0)
+            iccp_warm_snapshot_syncd_connected(sys);
+    }
+
+    timeout = scheduler_epoll_timeout(sys);
+    if (max_wait_msec >= 0 && (timeout < 0 || timeout > max_wait_msec))
+        timeout = max_wait_msec;
+
+    /*handle socket slelect event ,If no message received, it will block until next timer*/
+    iccp_handle_events(sys, timeout);
+    /*csm, app state machine transit */
+    scheduler_transit_fsm();
+    /*FDB changes batched during this loop */
+    iccp_send_fdb_batch_to_syncd();
+
+    return;
+}
+
 /* Thread fetch to call */
 void scheduler_loop()
 {
@@ -468,15 +549,7 @@ void scheduler_loop()
 
     while (1)
     {
-        if (sys->sync_fd <= 0)
-        {
-            iccp_connect_syncd();
-        }
-
-        /*handle socket slelect event ,If no message received, it will block 0.1s*/
-        iccp_handle_events(sys);
-        /*csm, app state machine transit */
-        scheduler_transit_fsm();
+        scheduler_loop_once(sys, -1);
 
         if (sys->warmboot_exit == WARM_REBOOT)
         {
@@ -553,14 +626,148 @@ void scheduler_finalize()
     return;
 }
 
+/* Next connect attempt after a failure, doubling up to CONNECT_BACKOFF_MAX_SEC.
+ * Half of the delay is random so peers and domains don't retry in lockstep.
+ */
+static void session_client_conn_backoff(struct CSM *csm)
+{
+    static unsigned int seed = 0;
+    uint32_t delay;
+
+    if (seed == 0)
+        seed = time(NULL) ^ getpid();
+
+    if (csm->conn_backoff_msec == 0)
+        csm->conn_backoff_msec = CONNECT_INTERVAL_SEC * 1000;
+    else if (csm->conn_backoff_msec < CONNECT_BACKOFF_MAX_SEC * 1000)
+        csm->conn_backoff_msec *= 2;
+    if (csm->conn_backoff_msec > CONNECT_BACKOFF_MAX_SEC * 1000)
+        csm->conn_backoff_msec = CONNECT_BACKOFF_MAX_SEC * 1000;
+
+    delay = csm->conn_backoff_msec / 2 + rand_r(&seed) % (csm->conn_backoff_msec / 2 + 1);
+    iccp_timer_start(&csm->conn_timer, delay);
+
+    return;
+}
+
+/* Drop a connect still in progress */
+void session_client_conn_abort(struct CSM *csm)
+{
+    if (csm->conn_fd < 0)
+        return;
+
+    /* Closing the fd removes it from the epoll set */
+    system_clear_csm_fd(csm->conn_fd);
+    close(csm->conn_fd);
+    csm->conn_fd = -1;
+
+    return;
+}
+
+static void session_client_conn_fail(struct CSM *csm)
+{
+    session_client_conn_abort(csm);
+    session_client_conn_backoff(csm);
+
+    return;
+}
+
+/* Connection to peer is up, hand the socket to the CSM */
+static void session_client_conn_established(struct CSM *csm, int connFd)
+{
+    struct System* sys = NULL;
+    struct epoll_event event;
+    int flags;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    /* The peer's connect was accepted while ours was pending, keep that one */
+    if (csm->sock_fd > 0)
+    {
+        ICCPD_LOG_INFO(__FUNCTION__, "Peer %s already connected on fd %d, drop connect fd %d",
+                       csm->peer_ip, csm->sock_fd, connFd);
+        session_client_conn_abort(csm);
+        csm->conn_backoff_msec = 0;
+        return;
+    }
+
+    /* Peer socket I/O uses MSG_DONTWAIT, keep the fd like an accepted one */
+    flags = fcntl(connFd, F_GETFL, 0);
+    if (flags != -1)
+        fcntl(connFd, F_SETFL, flags & ~O_NONBLOCK);
+
+    event.data.fd = connFd;
+    event.events = EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, connFd, &event) != 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Peer socket %d epoll mod error %d", connFd, errno);
+        session_client_conn_fail(csm);
+        return;
+    }
+
+    csm->conn_fd = -1;
+    csm->conn_backoff_msec = 0;
+    csm->sock_fd = connFd;
+    system_set_csm_fd(csm, connFd);
+    FD_SET(connFd, &(sys->readfd));
+    sys->readfd_count++;
+    iccp_timer_start(&csm->conn_timer, CONNECT_INTERVAL_SEC * 1000);
+    ICCPD_LOG_INFO(__FUNCTION__, "Connect to server %s sucess .", csm->peer_ip);
+
+    return;
+}
+
+/* EPOLLOUT on a connecting socket, the connect finished one way or the other */
+void session_client_conn_complete(struct CSM *csm)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+
+    session_conn_thread_lock(&csm->conn_mutex);
+
+    if (getsockopt(csm->conn_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
+        err = errno;
+
+    if (err != 0)
+    {
+        ICCPD_LOG_INFO(__FUNCTION__, "Connect to server %s failed, error %d",
+                       csm->peer_ip, err);
+        session_client_conn_fail(csm);
+    }
+    else
+    {
+        session_client_conn_established(csm, csm->conn_fd);
+    }
+
+    session_conn_thread_unlock(&csm->conn_mutex);
+    return;
+}
+
+/* Connect timer expired, give up on a connect still in progress */
+void scheduler_conn_timer_handler(void* arg)
+{
+    struct CSM* csm = (struct CSM*)arg;
+
+    if (csm->conn_fd < 0)
+        return;
+
+    ICCPD_LOG_INFO(__FUNCTION__, "Connect to server %s timeout", csm->peer_ip);
+    session_client_conn_fail(csm);
+
+    return;
+}
+
+/* Start a non-blocking connect, completion is reported through EPOLLOUT */
 void session_client_conn_handler(struct CSM *csm)
 {
     struct System* sys = NULL;
     struct sockaddr_in peer_addr;
-    int connFd = -1, connStat = -1;
-    struct timeval con_tv;
-    socklen_t len = sizeof(con_tv);
+    struct epoll_event event;
+    int connFd = -1, connStat = -1, connErr = 0;
     int err = 0;
+    int send_buf_len = PEER_SOCK_SND_BUF_LEN;
+    int recv_buf_len = PEER_SOCK_RCV_BUF_LEN;
 
     struct sockaddr_in src_addr;
     bzero(&(src_addr), sizeof(src_addr));
@@ -568,6 +775,10 @@ void session_client_conn_handler(struct CSM *csm)
     src_addr.sin_port = 0;
     src_addr.sin_addr.s_addr = inet_addr(csm->sender_ip);
 
+    /* Already connecting*/
+    if (csm->conn_fd >= 0)
+        return;
+
     /* Lock the thread*/
     session_conn_thread_lock(&csm->conn_mutex);
 
@@ -576,7 +787,7 @@ void session_client_conn_handler(struct CSM *csm)
         goto conn_fail;
 
     /* Create sock*/
-    connFd = socket(PF_INET, SOCK_STREAM, 0);
+    connFd = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
     bzero(&peer_addr, sizeof(peer_addr));
     peer_addr.sin_family = PF_INET;
     peer_addr.sin_port = htons(ICCP_TCP_PORT);
@@ -588,12 +799,14 @@ void session_client_conn_handler(struct CSM *csm)
         goto conn_fail;
     }
 
-    /* Set connect timeout secs*/
-    con_tv.tv_sec = 0;
-    con_tv.tv_usec = CONNECT_TIMEOUT_MSEC * 1000;
-    if (setsockopt(connFd, SOL_SOCKET, SO_SNDTIMEO, &con_tv, len) == -1)
+    /* Buffer sizes before connect, the receive window scale is set by the SYN */
+    if (setsockopt(connFd, SOL_SOCKET, SO_SNDBUF, &send_buf_len, sizeof(send_buf_len)) == -1)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Set socket send buf option failed. Error");
+    }
+    if (setsockopt(connFd, SOL_SOCKET, SO_RCVBUF, &recv_buf_len, sizeof(recv_buf_len)) == -1)
     {
-        ICCPD_LOG_INFO(__FUNCTION__, "Set socket timeout fail");
+        ICCPD_LOG_ERR(__FUNCTION__, "Set socket recv buf option failed. Error");
     }
 
     err = bind(connFd, (struct sockaddr*)&(src_addr), sizeof(src_addr));
@@ -603,53 +816,44 @@ void session_client_conn_handler(struct CSM *csm)
         goto conn_fail;
     }
 
+    /* Watch for EPOLLOUT, it is switched to EPOLLIN once connected */
+    event.data.fd = connFd;
+    event.events = EPOLLOUT;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, connFd, &event) != 0)
+        goto conn_fail;
+
     /* Try conn*/
     ICCPD_LOG_INFO(__FUNCTION__, "Connecting. peer ip = [%s], %p", csm->peer_ip, csm);
     connStat = connect(connFd, (struct sockaddr*)&(peer_addr), sizeof(peer_addr));
+    connErr = errno;
     ICCPD_LOG_INFO(__FUNCTION__, "Connection. fd = [%d], status = [%d], %p",
                    connFd, connStat, csm);
 
-    if (connStat != 0)
+    csm->conn_fd = connFd;
+    system_set_csm_fd(csm, connFd);
+    if (connStat == 0)
     {
-        /* Conn Fail*/
-        goto conn_fail;
+        /* Conn OK*/
+        session_client_conn_established(csm, connFd);
+    }
+    else if (connErr == EINPROGRESS)
+    {
+        /* Conn pending, bounded by the connect timer*/
+        iccp_timer_start(&csm->conn_timer, CONNECT_TIMEOUT_MSEC);
     }
     else
     {
-        /* Conn OK*/
-        struct epoll_event event;
-        int err;
-        int send_buf_len = PEER_SOCK_SND_BUF_LEN;
-        int recv_buf_len = PEER_SOCK_RCV_BUF_LEN;
-        event.data.fd = connFd;
-        event.events = EPOLLIN;
-        err = epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, connFd, &event);
-        if (err)
-            goto conn_fail;
-        csm->sock_fd = connFd;
-        if (setsockopt(csm->sock_fd, SOL_SOCKET, SO_SNDBUF, &send_buf_len, sizeof(send_buf_len)) == -1)
-        {
-            ICCPD_LOG_ERR(__FUNCTION__, "Set socket send buf option failed. Error");
-        }
-        if (setsockopt(csm->sock_fd, SOL_SOCKET, SO_RCVBUF, &recv_buf_len, sizeof(recv_buf_len)) == -1)
-        {
-            ICCPD_LOG_ERR(__FUNCTION__, "Set socket recv buf option failed. Error");
-        }
-
-        FD_SET(connFd, &(sys->readfd));
-        sys->readfd_count++;
-        ICCPD_LOG_INFO(__FUNCTION__, "Connect to server %s sucess .", csm->peer_ip);
-        goto conn_ok;
+        /* Conn Fail*/
+        session_client_conn_fail(csm);
     }
 
+    session_conn_thread_unlock(&csm->conn_mutex);
+    return;
+
  conn_fail:
     if (connFd >= 0)
-    {
-        csm->sock_fd = -1;
         close(connFd);
-    }
- conn_ok:
-    time(&csm->connTimePrev);
+    session_client_conn_backoff(csm);
     session_conn_thread_unlock(&csm->conn_mutex);
     return;
 }
@@ -661,14 +865,8 @@ int scheduler_prepare_session(struct CSM* csm)
     uint32_t local_ip = 0;
     uint32_t peer_ip = 0;
 
-    /* Init time_t*/
-    if (csm->connTimePrev == 0)
-    {
-        time(&csm->connTimePrev);
-    }
-
     /* Don't conn to svr continously*/
-    if ((time(NULL) - csm->connTimePrev) < CONNECT_INTERVAL_SEC)
+    if (ICCP_TIMER_PENDING(&csm->conn_timer))
     {
         goto no_time_update;
     }
@@ -679,6 +877,12 @@ int scheduler_prepare_session(struct CSM* csm)
         goto time_update;
     }
 
+    /* Connecting?*/
+    if (csm->conn_fd >= 0)
+    {
+        goto no_time_update;
+    }
+
     if ((ret = scheduler_check_csm_config(csm)) < 0)
         goto time_update;
 
@@ -697,12 +901,14 @@ int scheduler_prepare_session(struct CSM* csm)
 
     if (session_conn_thread_trylock(&csm->conn_mutex) == 0)
     {
+        /* Connect handler arms the conn timer itself */
         session_client_conn_handler(csm);
         session_conn_thread_unlock(&csm->conn_mutex);
+        goto no_time_update;
     }
 
  time_update:
-    time(&csm->connTimePrev);
+    iccp_timer_start(&csm->conn_timer, CONNECT_INTERVAL_SEC * 1000);
     return 0;
 
  no_time_update:
@@ -842,6 +1048,7 @@ void scheduler_session_disconnect_handler(struct CSM* csm)
     ICCPD_LOG_NOTICE("ICCP_FSM", "scheduler session disconnect handler");
 
     session_conn_thread_lock(&csm->conn_mutex);
+    session_client_conn_abort(csm);
     scheduler_unregister_sock_read_event_callback(csm);
     if (csm->sock_fd > 0)
     {
@@ -852,7 +1059,7 @@ void scheduler_session_disconnect_handler(struct CSM* csm)
     MLACP(csm).current_state = MLACP_STATE_INIT;
     iccp_csm_status_reset(csm, 0);
 
-    time(&csm->connTimePrev);
+    iccp_timer_start(&csm->conn_timer, CONNECT_INTERVAL_SEC * 1000);
     session_conn_thread_unlock(&csm->conn_mutex);
 
     return;
@@ -891,6 +1098,9 @@ void scheduler_csm_socket_cleanup(struct CSM* csm, int location)
         ICCPD_LOG_NOTICE("ICCP_FSM", "CSM socket %d close, location %d",
                          csm->sock_fd, location);
     }
+    system_clear_csm_fd(csm->sock_fd);
     csm->sock_fd = -1;
+    iccp_csm_tx_queue_free(csm);
+    iccp_csm_rx_buf_free(csm);
 }
 
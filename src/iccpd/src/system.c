@@ -30,9 +30,11 @@
 #include "../include/scheduler.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/iccp_ifm.h"
+#include "../include/iccp_nl_worker.h"
+#include "../include/iccp_warm_snapshot.h"
+#include "../include/iccp_mem_pool.h"
 
 #define ETHER_ADDR_LEN 6
-char mac_print_str[ETHER_ADDR_STR_LEN];
 
 /* Singleton */
 struct System* system_get_instance()
@@ -56,6 +58,8 @@ struct System* system_get_instance()
 /* System instance initialization */
 void system_init(struct System* sys)
 {
+    int i;
+
     if (sys == NULL )
         return;
 
@@ -66,6 +70,7 @@ void system_init(struct System* sys)
     sys->arp_receive_fd = -1;
     sys->ndisc_receive_fd = -1;
     sys->epoll_fd = -1;
+    sys->timer_fd = -1;
     sys->family = -1;
     sys->warmboot_start = 0;
     sys->warmboot_exit = 0;
@@ -74,21 +79,35 @@ void system_init(struct System* sys)
     LIST_INIT(&(sys->lif_purge_list));
     LIST_INIT(&(sys->unq_ip_if_list));
     LIST_INIT(&(sys->pending_vlan_mbr_if_list));
+    for (i = 0; i < LIF_HASH_SIZE; ++i)
+    {
+        LIST_INIT(&(sys->lif_name_hash[i]));
+        LIST_INIT(&(sys->lif_ifindex_hash[i]));
+        LIST_INIT(&(sys->lif_po_id_hash[i]));
+    }
 
     sys->log_file_path = strdup("/var/log/iccpd.log");
     sys->cmd_file_path = strdup("/var/run/iccpd/iccpd.vty");
     sys->config_file_path = strdup("/etc/iccpd/iccpd.conf");
     sys->mclagdctl_file_path = strdup("/var/run/iccpd/mclagdctl.sock");
+    sys->warm_snapshot_path = strdup(ICCP_WARM_SNAPSHOT_FILE);
     sys->pid_file_fd = 0;
     sys->telnet_port = 2015;
+    sys->netlink_rcvbuf_size = NETLINK_SOCKET_BUFFER_SIZE;
     FD_ZERO(&(sys->readfd));
     sys->readfd_count = 0;
     sys->csm_trans_time = 0;
     sys->need_sync_team_again = 0;
     sys->need_sync_netlink_again = 0;
+    sys->need_sync_neigh_again = 0;
+    sys->lif_sync_gen = 0;
+    sys->neigh_sync_gen = 0;
     scheduler_server_sock_init();
     iccp_system_init_netlink_socket();
+    iccp_timer_wheel_init(sys);
+    iccp_nl_worker_init(sys);
     iccp_init_netlink_event_fd(sys);
+    iccp_nl_worker_start(sys);
 }
 
 /* System instance tear down */
@@ -140,7 +159,12 @@ void system_finalize()
         free(unq_ip_if);
     }
 
+    iccp_nl_worker_stop(sys);
     iccp_system_dinit_netlink_socket();
+    iccp_timer_wheel_finalize(sys);
+
+    /* All sessions and their queues are gone, return the slabs */
+    mem_pool_finalize();
 
     if (sys->log_file_path != NULL )
         free(sys->log_file_path);
@@ -148,6 +172,10 @@ void system_finalize()
         free(sys->cmd_file_path);
     if (sys->config_file_path != NULL )
         free(sys->config_file_path);
+    if (sys->warm_snapshot_path != NULL )
+        free(sys->warm_snapshot_path);
+    if (sys->mclagdctl_file_path != NULL )
+        free(sys->mclagdctl_file_path);
     if (sys->pid_file_fd > 0)
         close(sys->pid_file_fd);
     if (sys->server_fd > 0)
@@ -255,6 +283,42 @@ struct CSM* system_get_csm_by_mlacp_id(int id)
     return NULL;
 }
 
+/* Peer socket and connecting fds are mapped to their CSM so that the
+ * event loop does not scan csm_list for every ready fd */
+struct CSM* system_get_csm_by_fd(int fd)
+{
+    struct System* sys = NULL;
+
+    if ((sys = system_get_instance()) == NULL )
+        return NULL;
+
+    if (fd < 0 || fd >= FD_SETSIZE)
+        return NULL;
+
+    return sys->fd_csm[fd];
+}
+
+void system_set_csm_fd(struct CSM* csm, int fd)
+{
+    struct System* sys = NULL;
+
+    if ((sys = system_get_instance()) == NULL )
+        return;
+
+    if (fd < 0 || fd >= FD_SETSIZE)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "fd %d out of range, not mapped to a CSM", fd);
+        return;
+    }
+
+    sys->fd_csm[fd] = csm;
+}
+
+void system_clear_csm_fd(int fd)
+{
+    system_set_csm_fd(NULL, fd);
+}
+
 struct CSM* system_get_first_csm()
 {
     struct System* sys = NULL;
@@ -339,61 +403,77 @@ SYNCD_RX_DBG_CNTR_MSG_e system_syncdrx_to_dbg_msg_type(uint32_t msg_type)
             return SYNCD_RX_DBG_CNTR_MSG_CFG_MCLAG_UNIQUE_IP;
         case MCLAG_SYNCD_MSG_TYPE_VLAN_MBR_UPDATES:
             return SYNCD_RX_DBG_CNTR_MSG_VLAN_MBR_UPDATES;
+        case MCLAG_SYNCD_MSG_TYPE_CAPABILITY:
+            return SYNCD_RX_DBG_CNTR_MSG_CAPABILITY;
         default:
             return SYNCD_RX_DBG_CNTR_MSG_MAX;
     }
 }
 
+char *mac_addr_to_str_r(uint8_t mac_addr[ETHER_ADDR_LEN], char buf[ETHER_ADDR_STR_LEN])
+{
+    static const char hex[] = "0123456789abcdef";
+    char *p = buf;
+    int i;
+
+    for (i = 0; i < ETHER_ADDR_LEN; ++i)
+    {
+        *p++ = hex[mac_addr[i] >> 4];
+        *p++ = hex[mac_addr[i] & 0xf];
+        *p++ = ':';
+    }
+    buf[ETHER_ADDR_STR_LEN - 1] = '\0';
+
+    return buf;
+}
+
+/* Per thread, the netlink worker logs too. A caller needing the string
+ * past ADDR_STR_RING_SIZE more calls must copy it or use the _r version.
+ */
 char *mac_addr_to_str(uint8_t mac_addr[ETHER_ADDR_LEN])
 {
-    memset(mac_print_str, 0, sizeof(mac_print_str));
-    snprintf(mac_print_str, sizeof(mac_print_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-        mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
+    static __thread char mac_str[ADDR_STR_RING_SIZE][ETHER_ADDR_STR_LEN];
+    static __thread unsigned int idx;
 
-    return mac_print_str;
+    return mac_addr_to_str_r(mac_addr, mac_str[idx++ % ADDR_STR_RING_SIZE]);
 }
 
-void system_update_netlink_counters(
-    uint16_t netlink_msg_type,
-    struct nlmsghdr *nlh)
+void system_latency_add(SYSTEM_LATENCY_TYPE_e type, uint64_t usec)
 {
-    struct System *sys;
-    struct ndmsg *ndm = NLMSG_DATA(nlh);
+    struct System* sys = NULL;
+    system_latency_hist_t* hist = NULL;
+    int bucket = 0;
 
-    sys = system_get_instance();
-    if (!sys)
+    if (type >= LATENCY_TYPE_MAX || (sys = system_get_instance()) == NULL)
         return;
 
-    switch (netlink_msg_type)
-    {
-        case RTM_NEWLINK:
-            ++sys->dbg_counters.newlink_count;
-            break;
-        case RTM_DELLINK:
-            ++sys->dbg_counters.dellink_count;
-            break;
-        case RTM_NEWNEIGH:
-            ++sys->dbg_counters.newnbr_count;
-            if (ndm->ndm_family == AF_BRIDGE)
-                ++sys->dbg_counters.newmac_count;
-            break;
-        case RTM_DELNEIGH:
-            ++sys->dbg_counters.delnbr_count;
-            if (ndm->ndm_family == AF_BRIDGE)
-                ++sys->dbg_counters.delmac_count;
-            break;
-        case RTM_NEWADDR:
-            ++sys->dbg_counters.newaddr_count;
-            break;
-        case RTM_DELADDR:
-            ++sys->dbg_counters.deladdr_count;
-            break;
-        default:
-            ++sys->dbg_counters.unknown_type_count;
-            if (sys->dbg_counters.unknown_type_count < 5)
-            {
-                ICCPD_LOG_NOTICE(__FUNCTION__, "NETLINK_COUNTER: Unknown type %d", netlink_msg_type);
-            }
-            break;
-    }
+    if (usec)
+        bucket = 64 - __builtin_clzll(usec);
+    if (bucket >= LATENCY_HIST_BUCKET_NUM)
+        bucket = LATENCY_HIST_BUCKET_NUM - 1;
+
+    hist = &sys->latency.hist[type];
+    ++hist->count;
+    hist->sum_usec += usec;
+    if (usec > hist->max_usec)
+        hist->max_usec = usec;
+    ++hist->buckets[bucket];
+
+    return;
+}
+
+/* Account the time since *stamp was taken and clear it, so an entry
+ * that is sent twice is only counted once. A zero stamp is ignored*/
+void system_latency_record(SYSTEM_LATENCY_TYPE_e type, uint64_t* stamp)
+{
+    uint64_t now;
+
+    if (*stamp == 0)
+        return;
+
+    now = iccp_timer_now_usec();
+    system_latency_add(type, now > *stamp ? now - *stamp : 0);
+    *stamp = 0;
+
+    return;
 }
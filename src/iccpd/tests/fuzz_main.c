@@ -0,0 +1,162 @@
+/*
+ * fuzz_main.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* Driver for the fuzz targets when the compiler has no libFuzzer
+ * (configure without --enable-fuzz). With file arguments it replays them,
+ * e.g. a crash found by libFuzzer; otherwise it runs ICCP_FUZZ_RUNS
+ * (default 20000) deterministic mutations of the target's seed input.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_MAX_INPUT  4096
+
+int LLVMFuzzerInitialize(int* argc, char*** argv);
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+size_t iccp_fuzz_seed(uint8_t* buf, size_t max);
+
+static uint64_t fuzz_rand_state = 0x9e3779b97f4a7c15ULL;
+
+static uint32_t fuzz_rand(void)
+{
+    fuzz_rand_state ^= fuzz_rand_state << 13;
+    fuzz_rand_state ^= fuzz_rand_state >> 7;
+    fuzz_rand_state ^= fuzz_rand_state << 17;
+
+    return (uint32_t)(fuzz_rand_state >> 16);
+}
+
+/* A few byte level edits, biased to the front where headers and counts are */
+static size_t fuzz_mutate(uint8_t* buf, size_t len, size_t max)
+{
+    static const uint8_t interesting[] = { 0x00, 0x01, 0x7f, 0x80, 0xff };
+    int edits = 1 + fuzz_rand() % 4;
+    size_t pos;
+    int i;
+
+    for (i = 0; i < edits; ++i)
+    {
+        if (len == 0)
+            return len;
+        pos = (fuzz_rand() % 2) ? fuzz_rand() % (len < 32 ? len : 32) : fuzz_rand() % len;
+
+        switch (fuzz_rand() % 6)
+        {
+            case 0:
+                buf[pos] ^= 1 << (fuzz_rand() % 8);
+                break;
+
+            case 1:
+                buf[pos] = fuzz_rand();
+                break;
+
+            case 2:
+                buf[pos] = interesting[fuzz_rand() % sizeof(interesting)];
+                break;
+
+            case 3:
+                /* truncate */
+                len = pos + 1;
+                break;
+
+            case 4:
+                /* grow with random bytes */
+                while (len < max && fuzz_rand() % 8)
+                    buf[len++] = fuzz_rand();
+                break;
+
+            default:
+                /* 16 bit length or count field */
+                if (pos + 1 < len)
+                {
+                    uint16_t v = (fuzz_rand() % 2) ? 0xffff : fuzz_rand() % 512;
+                    buf[pos] = v >> 8;
+                    buf[pos + 1] = v & 0xff;
+                }
+                break;
+        }
+    }
+
+    return len;
+}
+
+static int fuzz_replay(const char* path)
+{
+    uint8_t buf[FUZZ_MAX_INPUT];
+    FILE* fp = NULL;
+    size_t len;
+
+    if ((fp = fopen(path, "rb")) == NULL)
+    {
+        fprintf(stderr, "fuzz: can not open %s\n", path);
+        return 1;
+    }
+    len = fread(buf, 1, sizeof(buf), fp);
+    fclose(fp);
+
+    LLVMFuzzerTestOneInput(buf, len);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    uint8_t seed[FUZZ_MAX_INPUT];
+    uint8_t buf[FUZZ_MAX_INPUT];
+    const char* env = getenv("ICCP_FUZZ_RUNS");
+    long runs = env ? atol(env) : 20000;
+    size_t seed_len, len;
+    long i;
+    int ret = 0;
+
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    if (argc > 1)
+    {
+        for (i = 1; i < argc; ++i)
+            ret |= fuzz_replay(argv[i]);
+        return ret;
+    }
+
+    seed_len = iccp_fuzz_seed(seed, sizeof(seed));
+    LLVMFuzzerTestOneInput(seed, seed_len);
+
+    for (i = 0; i < runs; ++i)
+    {
+        /* Start over from the seed now and then, edits pile up otherwise */
+        if (i % 16 == 0)
+        {
+            memcpy(buf, seed, seed_len);
+            len = seed_len;
+        }
+        len = fuzz_mutate(buf, len, sizeof(buf));
+        LLVMFuzzerTestOneInput(buf, len);
+    }
+
+    printf("%ld inputs\n", runs + 1);
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * fuzz_tlv.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* Fuzz targets for what iccpd reads from its peer and from mclagsyncd.
+ * The input reaches the daemon through the same sockets and event loop as
+ * in production, see iccp_test_node.c.
+ *
+ *  -DICCP_FUZZ_TLV=<type>  one mLACP TLV decoder. The first input byte picks
+ *                          the mLACP state, the rest is the TLV behind a valid
+ *                          ICC header, with the TLV type pinned.
+ *  -DICCP_FUZZ_SYNCD       mclagsyncd messages, first byte is the type.
+ *  neither                 raw bytes on the peer session socket.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "../include/system.h"
+#include "../include/scheduler.h"
+#include "../include/iccp_csm.h"
+#include "../include/mlacp_fsm.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_sync_prepare.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/msg_format.h"
+
+#include "iccp_test.h"
+
+int LLVMFuzzerInitialize(int* argc, char*** argv);
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+size_t iccp_fuzz_seed(uint8_t* buf, size_t max);
+
+static struct iccp_test_topo fuzz_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.1",
+    .peer_ip = "127.0.0.2",
+    .num_po = 2,
+    .vlan_base = 100,
+    .vlan_count = 2,
+    .node_id = 1,
+};
+
+/* Harness end of the peer session */
+static int fuzz_fd = -1;
+
+/* NOTIFICATION handling and netlink retries sleep */
+unsigned int __wrap_sleep(unsigned int seconds)
+{
+    return 0;
+}
+
+/* Session attached and up to the mLACP state picked by state_sel */
+static struct CSM* iccp_fuzz_session(uint8_t state_sel)
+{
+    struct CSM* csm = iccp_test_csm(fuzz_topo.domain_id);
+
+    if (fuzz_fd >= 0 && iccp_test_drain(fuzz_fd) < 0)
+    {
+        close(fuzz_fd);
+        fuzz_fd = -1;
+    }
+    if (csm->sock_fd <= 0 || fuzz_fd < 0)
+    {
+        iccp_test_session_close(fuzz_topo.domain_id);
+        if (fuzz_fd >= 0)
+            close(fuzz_fd);
+        if ((fuzz_fd = iccp_test_session_fake(fuzz_topo.domain_id)) < 0)
+        {
+            fprintf(stderr, "fuzz: session attach failed\n");
+            abort();
+        }
+    }
+
+    iccp_test_session_force(fuzz_topo.domain_id,
+                            MLACP_STATE_STAGE1 + state_sel % (MLACP_STATE_EXCHANGE - MLACP_STATE_STAGE1 + 1));
+
+    return csm;
+}
+
+static void iccp_fuzz_input(const void* buf, size_t len)
+{
+    iccp_test_send(fuzz_fd, buf, len);
+    scheduler_loop_once(iccp_test_sys(), 0);
+    iccp_test_drain(fuzz_fd);
+
+    return;
+}
+
+int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+    if (iccp_test_node_init() < 0 || iccp_test_topo_setup(&fuzz_topo) < 0)
+    {
+        fprintf(stderr, "fuzz: node set up failed\n");
+        abort();
+    }
+    iccp_fuzz_session(0);
+
+    return 0;
+}
+
+#if defined(ICCP_FUZZ_SYNCD)
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size < 1 || size - 1 > MCLAG_MAX_MSG_LEN)
+        return 0;
+
+    iccp_test_syncd_send(data[0], data + 1, size - 1);
+    scheduler_loop_once(iccp_test_sys(), 0);
+
+    return 0;
+}
+
+size_t iccp_fuzz_seed(uint8_t* buf, size_t max)
+{
+    struct mclag_vlan_mbr_info mbr;
+
+    memset(&mbr, 0, sizeof(mbr));
+    mbr.op_type = MCLAG_CFG_OPER_ADD;
+    mbr.vid = fuzz_topo.vlan_base;
+    snprintf(mbr.mclag_iface, sizeof(mbr.mclag_iface), "PortChannel1");
+
+    buf[0] = MCLAG_SYNCD_MSG_TYPE_VLAN_MBR_UPDATES;
+    memcpy(&buf[1], &mbr, sizeof(mbr));
+
+    return 1 + sizeof(mbr);
+}
+
+#elif defined(ICCP_FUZZ_TLV)
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    char buf[CSM_BUFFER_SIZE];
+    ICCHdr* icc_hdr = (ICCHdr*)buf;
+    struct CSM* csm = NULL;
+    size_t len;
+
+    if (size < 1 + sizeof(ICCParameter) || size - 1 > CSM_BUFFER_SIZE - sizeof(ICCHdr))
+        return 0;
+
+    csm = iccp_fuzz_session(data[0]);
+
+    len = sizeof(ICCHdr) + size - 1;
+    memset(icc_hdr, 0, sizeof(ICCHdr));
+    icc_hdr->ldp_hdr.u_bit = 0;
+    icc_hdr->ldp_hdr.msg_type = htons(MSG_T_RG_APP_DATA);
+    icc_hdr->ldp_hdr.msg_len = htons(len - MSG_L_INCLUD_U_BIT_MSG_T_L_FIELDS);
+    icc_hdr->ldp_hdr.msg_id = htonl(1);
+    iccp_csm_fill_icc_rg_id_tlv(csm, icc_hdr);
+    memcpy(&buf[sizeof(ICCHdr)], data + 1, size - 1);
+    *(uint16_t*)&buf[sizeof(ICCHdr)] = htons(ICCP_FUZZ_TLV);
+
+    iccp_fuzz_input(buf, len);
+
+    return 0;
+}
+
+/* An encoded TLV of the fuzzed type, without the ICC header */
+size_t iccp_fuzz_seed(uint8_t* buf, size_t max)
+{
+    char msg[CSM_BUFFER_SIZE];
+    struct CSM* csm = iccp_fuzz_session(0);
+    struct LocalInterface* po = local_if_find_by_name("PortChannel1");
+    struct LocalInterface* peer_link = local_if_find_by_name(ICCP_TEST_PEER_LINK);
+    struct MACMsg mac_msg;
+    struct ARPMsg arp_msg;
+    struct NDISCMsg ndisc_msg;
+    int len = -1;
+
+    memset(msg, 0, sizeof(msg));
+    switch (ICCP_FUZZ_TLV)
+    {
+        case TLV_T_MLACP_SYSTEM_CONFIG:
+            len = mlacp_prepare_for_sys_config(csm, msg, sizeof(msg));
+            break;
+
+        case TLV_T_MLACP_AGGREGATOR_CONFIG:
+            len = mlacp_prepare_for_Aggport_config(csm, msg, sizeof(msg), po, 0);
+            break;
+
+        case TLV_T_MLACP_AGGREGATOR_STATE:
+            len = mlacp_prepare_for_Aggport_state(csm, msg, sizeof(msg), po);
+            break;
+
+        case TLV_T_MLACP_SYNC_REQUEST:
+            len = mlacp_prepare_for_sync_request_tlv(csm, msg, sizeof(msg));
+            break;
+
+        case TLV_T_MLACP_SYNC_DATA:
+            len = mlacp_prepare_for_sync_data_tlv(csm, msg, sizeof(msg), 1);
+            break;
+
+        case TLV_T_MLACP_HEARTBEAT:
+            len = mlacp_prepare_for_heartbeat(csm, msg, sizeof(msg));
+            break;
+
+        case TLV_T_MLACP_PORT_CHANNEL_INFO:
+            len = mlacp_prepare_for_port_channel_info(csm, msg, sizeof(msg), po);
+            break;
+
+        case TLV_T_MLACP_PEERLINK_INFO:
+            len = mlacp_prepare_for_port_peerlink_info(csm, msg, sizeof(msg), peer_link);
+            break;
+
+        case TLV_T_MLACP_MAC_INFO:
+            memset(&mac_msg, 0, sizeof(mac_msg));
+            iccp_test_mac(2, 1, mac_msg.mac_addr);
+            mac_msg.vid = fuzz_topo.vlan_base;
+            mac_msg.op_type = MAC_SYNC_ADD;
+            mac_msg.fdb_type = MAC_TYPE_DYNAMIC;
+            snprintf(mac_msg.origin_ifname, sizeof(mac_msg.origin_ifname), "PortChannel1");
+            len = mlacp_prepare_for_mac_info_to_peer(csm, msg, sizeof(msg), &mac_msg, 0);
+            iccp_test_mac(2, 2, mac_msg.mac_addr);
+            len = mlacp_prepare_for_mac_info_to_peer(csm, msg, sizeof(msg), &mac_msg, 1);
+            break;
+
+        case TLV_T_MLACP_ARP_INFO:
+            memset(&arp_msg, 0, sizeof(arp_msg));
+            arp_msg.op_type = NEIGH_SYNC_ADD;
+            snprintf(arp_msg.ifname, sizeof(arp_msg.ifname), "Vlan%d", fuzz_topo.vlan_base);
+            iccp_test_vlan_ip(&fuzz_topo, fuzz_topo.vlan_base, 10, &arp_msg.ipv4_addr, NULL);
+            iccp_test_mac(2, 1, arp_msg.mac_addr);
+            len = mlacp_prepare_for_arp_info(csm, msg, sizeof(msg), &arp_msg, 0, 0);
+            break;
+
+        case TLV_T_MLACP_NDISC_INFO:
+            memset(&ndisc_msg, 0, sizeof(ndisc_msg));
+            ndisc_msg.op_type = NEIGH_SYNC_ADD;
+            snprintf(ndisc_msg.ifname, sizeof(ndisc_msg.ifname), "Vlan%d", fuzz_topo.vlan_base);
+            iccp_test_vlan_ip(&fuzz_topo, fuzz_topo.vlan_base, 10, NULL, (uint8_t*)ndisc_msg.ipv6_addr);
+            iccp_test_mac(2, 1, ndisc_msg.mac_addr);
+            len = mlacp_prepare_for_ndisc_info(csm, msg, sizeof(msg), &ndisc_msg, 0, 0);
+            break;
+
+        case TLV_T_MLACP_IF_UP_ACK:
+            len = mlacp_prepare_for_if_up_ack(csm, msg, sizeof(msg), IF_T_PORT_CHANNEL, po->po_id, 1);
+            break;
+
+        case TLV_T_MLACP_SYNC_RESUME:
+            len = mlacp_prepare_for_sync_resume(csm, msg, sizeof(msg), SYNC_RESUME_TYPE_REQUEST, 1, 1);
+            break;
+
+        default:
+            break;
+    }
+
+    buf[0] = MLACP_STATE_EXCHANGE - MLACP_STATE_STAGE1;
+    if (len <= (int)sizeof(ICCHdr))
+    {
+        /* No encoder, a TLV of the minimum size the decoder accepts */
+        struct mLACPWarmbootTLV* tlv = (struct mLACPWarmbootTLV*)&buf[1];
+
+        memset(tlv, 0, sizeof(*tlv));
+        tlv->icc_parameter.type = htons(ICCP_FUZZ_TLV);
+        tlv->icc_parameter.len = htons(sizeof(*tlv) - sizeof(ICCParameter));
+        tlv->warmboot = 1;
+        return 1 + sizeof(*tlv);
+    }
+
+    len -= sizeof(ICCHdr);
+    if ((size_t)len + 1 > max)
+        len = max - 1;
+    memcpy(&buf[1], &msg[sizeof(ICCHdr)], len);
+
+    return 1 + len;
+}
+
+#else
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size < 1)
+        return 0;
+
+    iccp_fuzz_session(data[0]);
+    iccp_fuzz_input(data + 1, size - 1);
+
+    return 0;
+}
+
+/* A heartbeat and a sync request, as they arrive on the session */
+size_t iccp_fuzz_seed(uint8_t* buf, size_t max)
+{
+    char msg[CSM_BUFFER_SIZE];
+    struct CSM* csm = iccp_fuzz_session(0);
+    size_t pos = 1;
+    int len;
+
+    buf[0] = MLACP_STATE_EXCHANGE - MLACP_STATE_STAGE1;
+    if ((len = mlacp_prepare_for_heartbeat(csm, msg, sizeof(msg))) > 0 && pos + len <= max)
+    {
+        memcpy(&buf[pos], msg, len);
+        pos += len;
+    }
+    if ((len = mlacp_prepare_for_sync_request_tlv(csm, msg, sizeof(msg))) > 0 && pos + len <= max)
+    {
+        memcpy(&buf[pos], msg, len);
+        pos += len;
+    }
+
+    return pos;
+}
+
+#endif
@@ -0,0 +1,1376 @@
+/*
+ * iccp_bench.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* Benchmarks on the loopback harness. Each case runs in its own process,
+ * iccpd state is a singleton.
+ *
+ *   iccp_bench            run all cases
+ *   iccp_bench <name>..   run the named cases
+ *   iccp_bench -l         list the cases
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/wait.h>
+
+#include "../include/system.h"
+#include "../include/scheduler.h"
+#include "../include/iccp_csm.h"
+#include "../include/mlacp_fsm.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_sync_prepare.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/iccp_consistency_check.h"
+#include "../include/port.h"
+#include "../include/logger.h"
+#include "../include/cmd_option.h"
+
+#include "iccp_test.h"
+
+#define BENCH_WAIT_MSEC     60000
+
+struct iccp_bench_case
+{
+    const char* name;
+    const char* desc;
+    void (*run)(void);
+};
+
+static struct iccp_test_topo bench_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.1",
+    .peer_ip = "127.0.0.2",
+    .num_po = 2,
+    .vlan_base = 100,
+    .vlan_count = 2,
+    .node_id = 1,
+};
+
+static void bench_result(const char* name, const char* what, uint64_t usec, uint64_t count)
+{
+    printf("%-24s %-28s %10.1f ms %10.1f ns/entry  (%llu entries)\n", name, what,
+           usec / 1000.0, count ? usec * 1000.0 / count : 0.0, (unsigned long long)count);
+    fflush(stdout);
+
+    return;
+}
+
+/* Single node with a fake peer session in EXCHANGE, returns the peer end */
+static int bench_node_fake_peer(const struct iccp_test_topo* topo)
+{
+    int fd;
+
+    ICCP_TEST_CHECK(iccp_test_node_init() == 0);
+    ICCP_TEST_CHECK(iccp_test_topo_setup(topo) == 0);
+    ICCP_TEST_CHECK((fd = iccp_test_session_fake(topo->domain_id)) >= 0);
+    iccp_test_session_force(topo->domain_id, MLACP_STATE_EXCHANGE);
+
+    return fd;
+}
+
+/******************************************************
+*
+*    MAC/ARP/ND TLV encode and decode
+*
+******************************************************/
+
+#define BENCH_CODEC_MACS    100000
+#define BENCH_CODEC_NEIGHS  20000
+
+enum bench_codec_kind
+{
+    BENCH_CODEC_MAC,
+    BENCH_CODEC_ARP,
+    BENCH_CODEC_ND,
+};
+
+struct bench_codec_wait
+{
+    int kind;
+    uint32_t count;
+};
+
+static int bench_codec_reached(void* arg)
+{
+    struct bench_codec_wait* w = (struct bench_codec_wait*)arg;
+    struct iccp_test_stats stats;
+
+    iccp_test_stats_get(bench_topo.domain_id, &stats);
+    switch (w->kind)
+    {
+        case BENCH_CODEC_MAC:
+            return stats.mac_count == w->count;
+        case BENCH_CODEC_ARP:
+            return stats.arp_count == w->count;
+        default:
+            return stats.ndisc_count == w->count;
+    }
+}
+
+/* Encode one entry as entry count of the message in msg, 0 when full */
+static int bench_codec_encode(struct CSM* csm, int kind, char* msg, uint32_t index, int count, uint8_t op)
+{
+    struct MACMsg mac_msg;
+    struct ARPMsg arp_msg;
+    struct NDISCMsg ndisc_msg;
+    int len;
+
+    switch (kind)
+    {
+        case BENCH_CODEC_MAC:
+            memset(&mac_msg, 0, sizeof(mac_msg));
+            iccp_test_mac(2, index, mac_msg.mac_addr);
+            mac_msg.vid = bench_topo.vlan_base;
+            mac_msg.op_type = op;
+            mac_msg.fdb_type = MAC_TYPE_DYNAMIC;
+            snprintf(mac_msg.origin_ifname, sizeof(mac_msg.origin_ifname), "PortChannel1");
+            len = mlacp_prepare_for_mac_info_to_peer(csm, msg, CSM_BUFFER_SIZE, &mac_msg, count);
+            break;
+
+        case BENCH_CODEC_ARP:
+            memset(&arp_msg, 0, sizeof(arp_msg));
+            arp_msg.op_type = op;
+            snprintf(arp_msg.ifname, sizeof(arp_msg.ifname), "Vlan%d", bench_topo.vlan_base);
+            arp_msg.ipv4_addr = htonl(0x0a000000 + index);
+            iccp_test_mac(2, index, arp_msg.mac_addr);
+            len = mlacp_prepare_for_arp_info(csm, msg, CSM_BUFFER_SIZE, &arp_msg, count, 0);
+            break;
+
+        default:
+            memset(&ndisc_msg, 0, sizeof(ndisc_msg));
+            ndisc_msg.op_type = op;
+            snprintf(ndisc_msg.ifname, sizeof(ndisc_msg.ifname), "Vlan%d", bench_topo.vlan_base);
+            ndisc_msg.ipv6_addr[0] = htonl(0xfc000000);
+            ndisc_msg.ipv6_addr[3] = htonl(index);
+            iccp_test_mac(2, index, ndisc_msg.mac_addr);
+            len = mlacp_prepare_for_ndisc_info(csm, msg, CSM_BUFFER_SIZE, &ndisc_msg, count, 0);
+            break;
+    }
+
+    return len > 0 ? len : 0;
+}
+
+/* Encode num entries into messages of per_msg entries at out, 0 fills each
+ * message up. Returns the bytes used.
+ */
+static size_t bench_codec_encode_all(struct CSM* csm, int kind, char* out, uint32_t num, uint8_t op,
+                                     int per_msg)
+{
+    size_t pos = 0;
+    uint32_t i = 0;
+    int count = 0;
+    int len = 0;
+    int next;
+
+    while (i < num)
+    {
+        next = (per_msg && count == per_msg) ? 0 : bench_codec_encode(csm, kind, &out[pos], i + 1, count, op);
+        if (next == 0)
+        {
+            /* Message full, start the next one with this entry */
+            pos += len;
+            count = 0;
+            len = 0;
+            continue;
+        }
+        len = next;
+        ++count;
+        ++i;
+    }
+
+    return pos + len;
+}
+
+static void bench_codec(const char* name, int kind, uint32_t num, uint8_t op_add, uint8_t op_del)
+{
+    struct bench_codec_wait w;
+    struct CSM* csm = NULL;
+    char* out = NULL;
+    size_t len;
+    uint64_t start;
+    int fd;
+
+    fd = bench_node_fake_peer(&bench_topo);
+    csm = iccp_test_csm(bench_topo.domain_id);
+    ICCP_TEST_CHECK((out = (char*)malloc((size_t)num * 128 + CSM_BUFFER_SIZE)) != NULL);
+
+    start = iccp_test_now_usec();
+    len = bench_codec_encode_all(csm, kind, out, num, op_add, 0);
+    bench_result(name, "encode", iccp_test_now_usec() - start, num);
+
+    /* Receive, decode and apply, until the table holds all of them */
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_send(fd, out, len) == 0);
+    w.kind = kind;
+    w.count = num;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_codec_reached, &w, BENCH_WAIT_MSEC));
+    bench_result(name, "decode add", iccp_test_now_usec() - start, num);
+    iccp_test_drain(fd);
+
+    len = bench_codec_encode_all(csm, kind, out, num, op_del, 0);
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_send(fd, out, len) == 0);
+    w.count = 0;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_codec_reached, &w, BENCH_WAIT_MSEC));
+    bench_result(name, "decode del", iccp_test_now_usec() - start, num);
+
+    free(out);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+static void bench_mac_codec(void)
+{
+    bench_codec("mac_codec", BENCH_CODEC_MAC, BENCH_CODEC_MACS, MAC_SYNC_ADD, MAC_SYNC_DEL);
+}
+
+static void bench_arp_codec(void)
+{
+    bench_codec("arp_codec", BENCH_CODEC_ARP, BENCH_CODEC_NEIGHS, NEIGH_SYNC_ADD, NEIGH_SYNC_DEL);
+}
+
+static void bench_nd_codec(void)
+{
+    bench_codec("nd_codec", BENCH_CODEC_ND, BENCH_CODEC_NEIGHS, NEIGH_SYNC_ADD, NEIGH_SYNC_DEL);
+}
+
+/******************************************************
+*
+*    Neighbor storm on a large interface table
+*
+******************************************************/
+
+#define BENCH_STORM_PO          256
+#define BENCH_STORM_VLANS       256
+#define BENCH_STORM_HOSTS       200
+#define BENCH_STORM_LOOKUPS     200
+
+static struct iccp_test_topo storm_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.1",
+    .peer_ip = "127.0.0.2",
+    .num_po = BENCH_STORM_PO,
+    .vlan_base = 100,
+    .vlan_count = BENCH_STORM_VLANS,
+    .node_id = 1,
+};
+
+struct bench_storm_wait
+{
+    int fd;
+    uint32_t count;
+};
+
+static int bench_storm_reached(void* arg)
+{
+    struct bench_storm_wait* w = (struct bench_storm_wait*)arg;
+    struct iccp_test_stats stats;
+
+    /* Keep the peer side from filling up with the ARP info sent to it */
+    iccp_test_drain(w->fd);
+    iccp_test_stats_get(storm_topo.domain_id, &stats);
+
+    return stats.arp_count == w->count;
+}
+
+/* The walk local_if_find_by_name() did before the name index */
+static struct LocalInterface* bench_lif_walk_by_name(const char* ifname)
+{
+    struct LocalInterface* lif = NULL;
+
+    LIST_FOREACH(lif, &(system_get_instance()->lif_list), system_next)
+    {
+        if (strcmp(lif->name, ifname) == 0)
+            return lif;
+    }
+
+    return NULL;
+}
+
+static void bench_neigh_storm(void)
+{
+    struct bench_storm_wait w;
+    struct LocalInterface* lif = NULL;
+    char (*names)[IFNAMSIZ] = NULL;
+    uint8_t mac[ETHER_ADDR_LEN];
+    uint8_t ipv6[16];
+    uint32_t ipv4;
+    uint64_t start;
+    uint64_t found = 0;
+    int num_names = 0;
+    int i, v, h;
+
+    w.fd = bench_node_fake_peer(&storm_topo);
+
+    /* Kernel ARP adds spread over every VLAN interface */
+    start = iccp_test_now_usec();
+    for (h = 0; h < BENCH_STORM_HOSTS; ++h)
+    {
+        for (v = 0; v < BENCH_STORM_VLANS; ++v)
+        {
+            iccp_test_mac(2, h * BENCH_STORM_VLANS + v + 1, mac);
+            iccp_test_vlan_ip(&storm_topo, storm_topo.vlan_base + v, 10 + h, &ipv4, ipv6);
+            ICCP_TEST_CHECK(iccp_test_neigh(ICCP_TEST_VLAN_IFINDEX_BASE + storm_topo.vlan_base + v,
+                                            AF_INET, &ipv4, mac, 1) == 0);
+        }
+    }
+    w.count = BENCH_STORM_HOSTS * BENCH_STORM_VLANS;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_storm_reached, &w, BENCH_WAIT_MSEC));
+    bench_result("neigh_storm", "kernel ARP add, learned", iccp_test_now_usec() - start, w.count);
+
+    /* Lookups the neighbor and MAC paths make, over every interface name */
+    ICCP_TEST_CHECK((names = calloc(BENCH_STORM_PO + BENCH_STORM_VLANS + 1, IFNAMSIZ)) != NULL);
+    LIST_FOREACH(lif, &(system_get_instance()->lif_list), system_next)
+    {
+        if (num_names < BENCH_STORM_PO + BENCH_STORM_VLANS + 1)
+            snprintf(names[num_names++], IFNAMSIZ, "%s", lif->name);
+    }
+
+    start = iccp_test_now_usec();
+    for (i = 0; i < BENCH_STORM_LOOKUPS; ++i)
+        for (h = 0; h < num_names; ++h)
+            found += local_if_find_by_name(names[h]) != NULL;
+    bench_result("neigh_storm", "find_by_name, hash", iccp_test_now_usec() - start, found);
+
+    found = 0;
+    start = iccp_test_now_usec();
+    for (i = 0; i < BENCH_STORM_LOOKUPS; ++i)
+        for (h = 0; h < num_names; ++h)
+            found += bench_lif_walk_by_name(names[h]) != NULL;
+    bench_result("neigh_storm", "find_by_name, list walk", iccp_test_now_usec() - start, found);
+
+    found = 0;
+    start = iccp_test_now_usec();
+    for (i = 0; i < BENCH_STORM_LOOKUPS; ++i)
+        for (v = 0; v < BENCH_STORM_VLANS; ++v)
+            found += local_if_find_by_ifindex(ICCP_TEST_VLAN_IFINDEX_BASE + storm_topo.vlan_base + v) != NULL;
+    bench_result("neigh_storm", "find_by_ifindex, hash", iccp_test_now_usec() - start, found);
+
+    free(names);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+/******************************************************
+*
+*    MAC sync batching to the peer
+*
+******************************************************/
+
+#define BENCH_SYNC_MACS         65536
+#define BENCH_SYNC_OLD_BATCH    30  /* entries per message before size batching */
+
+static struct iccp_test_topo sync_local_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.1",
+    .peer_ip = "127.0.0.2",
+    .num_po = 2,
+    .vlan_base = 100,
+    .vlan_count = 2,
+    .node_id = 1,
+};
+
+static struct iccp_test_topo sync_remote_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.2",
+    .peer_ip = "127.0.0.1",
+    .num_po = 2,
+    .vlan_base = 100,
+    .vlan_count = 2,
+    .node_id = 2,
+};
+
+static struct iccp_test_peer sync_peer;
+
+struct bench_sync_wait
+{
+    uint32_t mac_count;
+    uint64_t tx_base;   /* local MAC info sent and peer received at the start */
+    uint64_t rx_base;
+};
+
+/* Peer holds mac_count MACs and got every MAC info message sent since */
+static int bench_sync_peer_reached(void* arg)
+{
+    struct bench_sync_wait* w = (struct bench_sync_wait*)arg;
+    struct iccp_test_stats local, peer;
+
+    iccp_test_stats_get(sync_local_topo.domain_id, &local);
+    iccp_test_peer_stats(&sync_peer, &peer);
+
+    return peer.mac_count == w->mac_count && local.mac_info_tx > w->tx_base
+           && peer.mac_info_rx - w->rx_base == local.mac_info_tx - w->tx_base;
+}
+
+static void bench_sync_wait_init(struct bench_sync_wait* w, uint32_t mac_count)
+{
+    struct iccp_test_stats stats;
+
+    w->mac_count = mac_count;
+    iccp_test_stats_get(sync_local_topo.domain_id, &stats);
+    w->tx_base = stats.mac_info_tx;
+    iccp_test_peer_stats(&sync_peer, &stats);
+    w->rx_base = stats.mac_info_rx;
+
+    return;
+}
+
+/* Two nodes, MACs learned on one are synced to the other, then the session
+ * is dropped and the full resync is timed.
+ */
+static void bench_mac_resync(void)
+{
+    struct bench_sync_wait w;
+    struct iccp_test_stats stats;
+    uint64_t start;
+
+    ICCP_TEST_CHECK(iccp_test_peer_start(&sync_peer, &sync_local_topo, &sync_remote_topo) == 0);
+    ICCP_TEST_CHECK(iccp_test_peer_wait_up(&sync_peer, BENCH_WAIT_MSEC));
+
+    bench_sync_wait_init(&w, BENCH_SYNC_MACS);
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(sync_local_topo.node_id, 1, BENCH_SYNC_MACS,
+                                             sync_local_topo.vlan_base, "PortChannel1", 1) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_sync_peer_reached, &w, BENCH_WAIT_MSEC));
+    bench_result("mac_resync", "learn, synced to peer", iccp_test_now_usec() - start, BENCH_SYNC_MACS);
+    iccp_test_stats_get(sync_local_topo.domain_id, &stats);
+    printf("%-24s %-28s %10llu msgs\n", "mac_resync", "MAC info sent",
+           (unsigned long long)(stats.mac_info_tx - w.tx_base));
+
+    bench_sync_wait_init(&w, BENCH_SYNC_MACS);
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_peer_reconnect(&sync_peer) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_sync_peer_reached, &w, BENCH_WAIT_MSEC));
+    bench_result("mac_resync", "reconnect, peer resynced", iccp_test_now_usec() - start, BENCH_SYNC_MACS);
+    iccp_test_stats_get(sync_local_topo.domain_id, &stats);
+    printf("%-24s %-28s %10llu msgs, %d before size batching\n", "mac_resync", "MAC info sent",
+           (unsigned long long)(stats.mac_info_tx - w.tx_base),
+           (BENCH_SYNC_MACS + BENCH_SYNC_OLD_BATCH - 1) / BENCH_SYNC_OLD_BATCH);
+    fflush(stdout);
+
+    iccp_test_peer_stop(&sync_peer);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+/* Full resync after a plain reconnect against a delta resync when the peer
+ * kept our entries, the way it does over a warm reboot. The same number of
+ * MACs changes while the session is down each time.
+ */
+#define BENCH_RESYNC_CHANGES    1000
+
+static int64_t bench_peer_sync_seq_fn(void* arg)
+{
+    struct CSM* csm = iccp_test_csm(sync_remote_topo.domain_id);
+
+    return csm ? (int64_t)MLACP(csm).peer_sync_seq : -1;
+}
+
+static int64_t bench_peer_warm_fn(void* arg)
+{
+    iccp_test_sys()->warmboot_exit = *(int*)arg;
+    return 0;
+}
+
+/* The peer got our mark for everything sent so far, and something was
+ * sent after seq *arg. Marks follow the entries on the session, so the
+ * peer has applied the whole resync when it holds the last one.
+ */
+static int bench_resync_marked(void* arg)
+{
+    struct CSM* csm = iccp_test_csm(sync_local_topo.domain_id);
+
+    return MLACP(csm).sync_seq > *(uint64_t*)arg
+           && iccp_test_peer_call(&sync_peer, bench_peer_sync_seq_fn, NULL, 0) == (int64_t)MLACP(csm).sync_seq;
+}
+
+static int bench_resync_local_count(void* arg)
+{
+    struct iccp_test_stats stats;
+
+    iccp_test_stats_get(sync_local_topo.domain_id, &stats);
+
+    return stats.mac_count == *(uint32_t*)arg;
+}
+
+static void bench_resync_round(const char* what, int warm, uint32_t del_first, uint32_t add_first)
+{
+    struct CSM* csm = iccp_test_csm(sync_local_topo.domain_id);
+    struct iccp_test_stats before, after;
+    uint64_t seq = 0;
+    uint64_t start;
+    uint32_t count;
+    int flag;
+
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_resync_marked, &seq, BENCH_WAIT_MSEC));
+
+    /* A warm rebooting peer keeps our entries over the disconnect */
+    flag = warm ? WARM_REBOOT : 0;
+    iccp_test_peer_call(&sync_peer, bench_peer_warm_fn, &flag, sizeof(flag));
+    ICCP_TEST_CHECK(iccp_test_peer_disconnect(&sync_peer) == 0);
+    flag = 0;
+    iccp_test_peer_call(&sync_peer, bench_peer_warm_fn, &flag, sizeof(flag));
+
+    /* The table also holds what the peer kept from earlier rounds and
+     * announced back as its own, count relative to it.
+     */
+    iccp_test_stats_get(sync_local_topo.domain_id, &before);
+    ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(sync_local_topo.node_id, del_first, BENCH_RESYNC_CHANGES,
+                                             sync_local_topo.vlan_base, "PortChannel1", 0) == 0);
+    count = before.mac_count - BENCH_RESYNC_CHANGES;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_resync_local_count, &count, BENCH_WAIT_MSEC));
+    ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(sync_local_topo.node_id, add_first, BENCH_RESYNC_CHANGES,
+                                             sync_local_topo.vlan_base, "PortChannel1", 1) == 0);
+    count = before.mac_count;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_resync_local_count, &count, BENCH_WAIT_MSEC));
+
+    iccp_test_stats_get(sync_local_topo.domain_id, &before);
+    seq = MLACP(csm).sync_seq;
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_peer_connect(&sync_peer) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_resync_marked, &seq, BENCH_WAIT_MSEC));
+    bench_result("resync_delta", what, iccp_test_now_usec() - start, BENCH_SYNC_MACS);
+
+    iccp_test_stats_get(sync_local_topo.domain_id, &after);
+    printf("%-24s %-28s %10llu msgs, %llu entries tagged, resync full %u delta %u\n", "resync_delta",
+           "MAC info sent", (unsigned long long)(after.mac_info_tx - before.mac_info_tx),
+           (unsigned long long)(MLACP(csm).sync_seq - seq),
+           after.resync_full - before.resync_full, after.resync_delta - before.resync_delta);
+    fflush(stdout);
+    ICCP_TEST_CHECK(warm ? after.resync_delta > before.resync_delta : after.resync_full > before.resync_full);
+
+    return;
+}
+
+static void bench_resync_delta(void)
+{
+    struct bench_sync_wait w;
+
+    ICCP_TEST_CHECK(iccp_test_peer_start(&sync_peer, &sync_local_topo, &sync_remote_topo) == 0);
+    ICCP_TEST_CHECK(iccp_test_peer_wait_up(&sync_peer, BENCH_WAIT_MSEC));
+
+    bench_sync_wait_init(&w, BENCH_SYNC_MACS);
+    ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(sync_local_topo.node_id, 1, BENCH_SYNC_MACS,
+                                             sync_local_topo.vlan_base, "PortChannel1", 1) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_sync_peer_reached, &w, BENCH_WAIT_MSEC));
+
+    /* Each round replaces the lowest BENCH_RESYNC_CHANGES MACs with new ones */
+    bench_resync_round("reconnect, full resync", 0,
+                       1, BENCH_SYNC_MACS + 1);
+    bench_resync_round("warm reconnect, delta", 1,
+                       1 + BENCH_RESYNC_CHANGES, BENCH_SYNC_MACS + BENCH_RESYNC_CHANGES + 1);
+
+    iccp_test_peer_stop(&sync_peer);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+/* Peer side cost of the same MACs in old sized and in full messages */
+static void bench_mac_batch(void)
+{
+    struct bench_codec_wait w;
+    struct CSM* csm = NULL;
+    char* out = NULL;
+    size_t len;
+    uint64_t start;
+    int fd;
+
+    fd = bench_node_fake_peer(&bench_topo);
+    csm = iccp_test_csm(bench_topo.domain_id);
+    ICCP_TEST_CHECK((out = (char*)malloc((size_t)BENCH_SYNC_MACS * 128 + CSM_BUFFER_SIZE)) != NULL);
+    w.kind = BENCH_CODEC_MAC;
+
+    len = bench_codec_encode_all(csm, BENCH_CODEC_MAC, out, BENCH_SYNC_MACS, MAC_SYNC_ADD, BENCH_SYNC_OLD_BATCH);
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_send(fd, out, len) == 0);
+    w.count = BENCH_SYNC_MACS;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_codec_reached, &w, BENCH_WAIT_MSEC));
+    bench_result("mac_batch", "add, 30 per message", iccp_test_now_usec() - start, BENCH_SYNC_MACS);
+    iccp_test_drain(fd);
+
+    len = bench_codec_encode_all(csm, BENCH_CODEC_MAC, out, BENCH_SYNC_MACS, MAC_SYNC_DEL, BENCH_SYNC_OLD_BATCH);
+    ICCP_TEST_CHECK(iccp_test_send(fd, out, len) == 0);
+    w.count = 0;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_codec_reached, &w, BENCH_WAIT_MSEC));
+    iccp_test_drain(fd);
+
+    len = bench_codec_encode_all(csm, BENCH_CODEC_MAC, out, BENCH_SYNC_MACS, MAC_SYNC_ADD, 0);
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_send(fd, out, len) == 0);
+    w.count = BENCH_SYNC_MACS;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_codec_reached, &w, BENCH_WAIT_MSEC));
+    bench_result("mac_batch", "add, full messages", iccp_test_now_usec() - start, BENCH_SYNC_MACS);
+
+    free(out);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+/******************************************************
+*
+*    Bulk MAC flush
+*
+******************************************************/
+
+/* Nothing changed on either node for this long */
+#define BENCH_FLUSH_QUIET_MSEC  200
+
+/* What either node did toward the peer, mclagsyncd and its MAC table */
+static void bench_flush_snap(uint64_t* v)
+{
+    struct iccp_test_stats local, peer;
+
+    iccp_test_stats_get(sync_local_topo.domain_id, &local);
+    iccp_test_peer_stats(&sync_peer, &peer);
+    v[0] = local.mac_count;
+    v[1] = local.mac_info_tx;
+    v[2] = local.cnt.syncd_fdb_add + local.cnt.syncd_fdb_del;
+    v[3] = peer.mac_count;
+    v[4] = peer.mac_info_rx;
+    v[5] = peer.cnt.syncd_fdb_add + peer.cnt.syncd_fdb_del;
+
+    return;
+}
+
+/* Runs both nodes until they are quiet, returns when the last change was seen */
+static uint64_t bench_flush_quiesce(void)
+{
+    uint64_t start = iccp_test_now_usec();
+    uint64_t last = start;
+    uint64_t prev[6], cur[6];
+
+    bench_flush_snap(prev);
+    while (iccp_test_now_usec() - last < BENCH_FLUSH_QUIET_MSEC * 1000)
+    {
+        ICCP_TEST_CHECK(iccp_test_now_usec() - start < (uint64_t)BENCH_WAIT_MSEC * 1000);
+        iccp_test_run(5);
+        bench_flush_snap(cur);
+        if (memcmp(cur, prev, sizeof(cur)) != 0)
+        {
+            memcpy(prev, cur, sizeof(prev));
+            last = iccp_test_now_usec();
+        }
+    }
+
+    return last;
+}
+
+static void bench_flush_report(const char* what, uint64_t usec, const struct iccp_test_stats* lb,
+                               const struct iccp_test_stats* pb)
+{
+    struct iccp_test_stats la, pa;
+
+    iccp_test_stats_get(sync_local_topo.domain_id, &la);
+    iccp_test_peer_stats(&sync_peer, &pa);
+
+    bench_result("mac_flush", what, usec, BENCH_SYNC_MACS);
+    printf("%-24s %-28s %10llu msgs to peer, MACs left %u local %u peer\n", "mac_flush", "quiet",
+           (unsigned long long)(la.mac_info_tx - lb->mac_info_tx), la.mac_count, pa.mac_count);
+    printf("%-24s %-28s %10llu FDB add %llu del in %llu batches, %u coalesced\n", "mac_flush", "local syncd",
+           (unsigned long long)(la.cnt.syncd_fdb_add - lb->cnt.syncd_fdb_add),
+           (unsigned long long)(la.cnt.syncd_fdb_del - lb->cnt.syncd_fdb_del),
+           (unsigned long long)(la.cnt.syncd_msgs[MCLAG_MSG_TYPE_SET_FDB] - lb->cnt.syncd_msgs[MCLAG_MSG_TYPE_SET_FDB]),
+           la.fdb_coalesce - lb->fdb_coalesce);
+    printf("%-24s %-28s %10llu FDB add %llu del in %llu batches, %u coalesced\n", "mac_flush", "peer syncd",
+           (unsigned long long)(pa.cnt.syncd_fdb_add - pb->cnt.syncd_fdb_add),
+           (unsigned long long)(pa.cnt.syncd_fdb_del - pb->cnt.syncd_fdb_del),
+           (unsigned long long)(pa.cnt.syncd_msgs[MCLAG_MSG_TYPE_SET_FDB] - pb->cnt.syncd_msgs[MCLAG_MSG_TYPE_SET_FDB]),
+           pa.fdb_coalesce - pb->fdb_coalesce);
+    fflush(stdout);
+
+    return;
+}
+
+/* 64K MACs synced to the peer, flushed by mclagsyncd and then lost with
+ * their port-channel. Timed until neither node sends anything more.
+ */
+static void bench_mac_flush(void)
+{
+    struct bench_sync_wait w;
+    struct iccp_test_stats local, peer;
+    uint8_t mac[ETHER_ADDR_LEN];
+    uint64_t start;
+
+    ICCP_TEST_CHECK(iccp_test_peer_start(&sync_peer, &sync_local_topo, &sync_remote_topo) == 0);
+    ICCP_TEST_CHECK(iccp_test_peer_wait_up(&sync_peer, BENCH_WAIT_MSEC));
+
+    bench_sync_wait_init(&w, BENCH_SYNC_MACS);
+    ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(sync_local_topo.node_id, 1, BENCH_SYNC_MACS,
+                                             sync_local_topo.vlan_base, "PortChannel1", 1) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_sync_peer_reached, &w, BENCH_WAIT_MSEC));
+    bench_flush_quiesce();
+
+    iccp_test_stats_get(sync_local_topo.domain_id, &local);
+    iccp_test_peer_stats(&sync_peer, &peer);
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(sync_local_topo.node_id, 1, BENCH_SYNC_MACS,
+                                             sync_local_topo.vlan_base, "PortChannel1", 0) == 0);
+    bench_flush_report("syncd flush, both quiet", bench_flush_quiesce() - start, &local, &peer);
+
+    bench_sync_wait_init(&w, BENCH_SYNC_MACS);
+    ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(sync_local_topo.node_id, 1, BENCH_SYNC_MACS,
+                                             sync_local_topo.vlan_base, "PortChannel1", 1) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_sync_peer_reached, &w, BENCH_WAIT_MSEC));
+    bench_flush_quiesce();
+
+    iccp_test_stats_get(sync_local_topo.domain_id, &local);
+    iccp_test_peer_stats(&sync_peer, &peer);
+    iccp_test_mac(sync_local_topo.node_id, 0, mac);
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_link("PortChannel1", ICCP_TEST_PO_IFINDEX_BASE + 1, mac, 0) == 0);
+    bench_flush_report("PortChannel1 down, quiet", bench_flush_quiesce() - start, &local, &peer);
+
+    iccp_test_peer_stop(&sync_peer);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+/******************************************************
+*
+*    Port-channel failover on a large MAC table
+*
+******************************************************/
+
+#define BENCH_FAILOVER_PO       48
+#define BENCH_FAILOVER_PER_PO   4167    /* 48 * 4167 = 200016 MACs */
+#define BENCH_FAILOVER_DOWN     8       /* port-channels taken down, one at a time */
+
+static struct iccp_test_topo failover_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.1",
+    .peer_ip = "127.0.0.2",
+    .num_po = BENCH_FAILOVER_PO,
+    .vlan_base = 100,
+    .vlan_count = 1,
+    .node_id = 1,
+};
+
+struct bench_failover_wait
+{
+    int fd;
+    uint32_t count;
+};
+
+static int bench_failover_reached(void* arg)
+{
+    struct bench_failover_wait* w = (struct bench_failover_wait*)arg;
+    struct iccp_test_stats stats;
+
+    iccp_test_drain(w->fd);
+    iccp_test_stats_get(failover_topo.domain_id, &stats);
+
+    return stats.mac_count == w->count;
+}
+
+/* The scan update_l2_mac_state() made before the interface index, the
+ * filter alone without acting on the matches
+ */
+static uint32_t bench_mac_walk_by_origin(struct CSM* csm, const char* ifname)
+{
+    struct MACMsg* mac_msg = NULL;
+    uint32_t found = 0;
+
+    RB_FOREACH(mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+    {
+        if (strcmp(mac_msg->origin_ifname, ifname) == 0)
+            ++found;
+    }
+
+    return found;
+}
+
+static uint32_t bench_mac_bucket_len(struct CSM* csm, const char* ifname)
+{
+    struct MACMsg* mac_msg = NULL;
+    uint32_t len = 0;
+
+    LIST_FOREACH(mac_msg, MAC_ORIGIN_HASH_HEAD(csm, ifname), origin_hash_next)
+        ++len;
+
+    return len;
+}
+
+/* 200K MACs over 48 port-channels. Port-channels go down one at a time
+ * through the handler the netlink path calls, against a walk of the whole
+ * tree. Losing the peer session still sweeps every entry.
+ */
+static void bench_failover(void)
+{
+    struct bench_failover_wait w;
+    struct CSM* csm = NULL;
+    struct LocalInterface* lif = NULL;
+    char name[IFNAMSIZ];
+    uint64_t start, t_index = 0, t_walk = 0;
+    uint32_t visited = 0, walked = 0, found = 0;
+    int i;
+
+    w.fd = bench_node_fake_peer(&failover_topo);
+    csm = iccp_test_csm(failover_topo.domain_id);
+
+    start = iccp_test_now_usec();
+    for (i = 1; i <= BENCH_FAILOVER_PO; ++i)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", i);
+        ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(failover_topo.node_id, (i - 1) * BENCH_FAILOVER_PER_PO + 1,
+                                                 BENCH_FAILOVER_PER_PO, failover_topo.vlan_base, name, 1) == 0);
+    }
+    w.count = BENCH_FAILOVER_PO * BENCH_FAILOVER_PER_PO;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_failover_reached, &w, BENCH_WAIT_MSEC));
+    bench_result("failover", "learn", iccp_test_now_usec() - start, w.count);
+
+    for (i = 1; i <= BENCH_FAILOVER_DOWN; ++i)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", i);
+        ICCP_TEST_CHECK((lif = local_if_find_by_name(name)) != NULL);
+
+        start = iccp_test_now_usec();
+        found += bench_mac_walk_by_origin(csm, name);
+        t_walk += iccp_test_now_usec() - start;
+        walked += w.count;
+
+        visited += bench_mac_bucket_len(csm, name);
+        start = iccp_test_now_usec();
+        mlacp_portchannel_state_handler(csm, lif, 0);
+        t_index += iccp_test_now_usec() - start;
+
+        /* No peer port-channel to redirect to, the MACs are removed */
+        w.count -= BENCH_FAILOVER_PER_PO;
+        ICCP_TEST_CHECK(iccp_test_run_until(bench_failover_reached, &w, BENCH_WAIT_MSEC));
+    }
+    ICCP_TEST_CHECK(found == BENCH_FAILOVER_DOWN * BENCH_FAILOVER_PER_PO);
+    bench_result("failover", "PO down, indexed handler", t_index, found);
+    bench_result("failover", "PO down, full walk filter", t_walk, found);
+    printf("%-24s %-28s %10u entries visited indexed, %u walked\n", "failover", "PO down",
+           visited, walked);
+
+    start = iccp_test_now_usec();
+    iccp_test_session_close(failover_topo.domain_id);
+    bench_result("failover", "session loss, full sweep", iccp_test_now_usec() - start, w.count);
+    fflush(stdout);
+
+    iccp_test_node_finalize();
+
+    return;
+}
+
+/******************************************************
+*
+*    Many MCLAG domains in one iccpd
+*
+******************************************************/
+
+#define BENCH_DOMAINS           16
+#define BENCH_DOMAIN_LOOKUPS    1000000
+#define BENCH_DOMAIN_MACS       65536
+
+static struct iccp_test_topo domains_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.1",
+    .peer_ip = "127.0.1.1",
+    .num_po = 1,
+    .vlan_base = 100,
+    .vlan_count = 1,
+    .node_id = 1,
+};
+
+/* Domain d owns PortChannel<d>, domain 1 is set up by the topology */
+static int bench_domains_bound(void* arg)
+{
+    struct LocalInterface* lif = NULL;
+    struct CSM* csm = NULL;
+    char name[IFNAMSIZ];
+    int d;
+
+    for (d = 1; d <= BENCH_DOMAINS; ++d)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", d);
+        if (!(csm = iccp_test_csm(d)) || !(lif = local_if_find_by_name(name)) || lif->csm != csm)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* The csm_list scan iccp_handle_events() made before the fd table */
+static struct CSM* bench_csm_walk_by_fd(int fd)
+{
+    struct CSM* csm = NULL;
+
+    LIST_FOREACH(csm, &(system_get_instance()->csm_list), next)
+    {
+        if (csm->sock_fd == fd)
+            return csm;
+    }
+
+    return NULL;
+}
+
+static uint64_t bench_domain_mac_rx(int domain_id)
+{
+    struct CSM* csm = iccp_test_csm(domain_id);
+
+    return MLACP(csm).dbg_counters.iccp_counters[ICCP_DBG_CNTR_MSG_MAC_INFO][ICCP_DBG_CNTR_DIR_RX][ICCP_DBG_CNTR_STS_OK]
+           + MLACP(csm).dbg_counters.iccp_counters[ICCP_DBG_CNTR_MSG_MAC_INFO][ICCP_DBG_CNTR_DIR_RX][ICCP_DBG_CNTR_STS_ERR];
+}
+
+static int bench_domain_mac_handled(void* arg)
+{
+    return bench_domain_mac_rx(BENCH_DOMAINS) > *(uint64_t*)arg;
+}
+
+/* 16 domains, each with a port-channel and a peer session. Times the
+ * fd-to-CSM lookup of the event loop, and how long a message for the last
+ * domain waits behind a bulk MAC sync on the first.
+ */
+static void bench_domains(void)
+{
+    struct bench_codec_wait w;
+    struct iccp_test_stats stats;
+    struct MACMsg mac_msg;
+    struct CSM* csm = NULL;
+    uint8_t mac[ETHER_ADDR_LEN];
+    char name[IFNAMSIZ];
+    char ip[INET_ADDRSTRLEN];
+    char small[CSM_BUFFER_SIZE];
+    char* out = NULL;
+    int fds[BENCH_DOMAINS + 1];
+    int sock_fds[BENCH_DOMAINS];
+    uint64_t start, rx, found = 0;
+    size_t len;
+    int small_len;
+    int i, d;
+
+    ICCP_TEST_CHECK(iccp_test_node_init() == 0);
+    ICCP_TEST_CHECK(iccp_test_topo_setup(&domains_topo) == 0);
+    iccp_test_mac(domains_topo.node_id, 0, mac);
+    for (d = 2; d <= BENCH_DOMAINS; ++d)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", d);
+        snprintf(ip, sizeof(ip), "127.0.1.%d", d);
+        ICCP_TEST_CHECK(iccp_test_link(name, ICCP_TEST_PO_IFINDEX_BASE + d, mac, 1) == 0);
+        iccp_test_run(10);
+        ICCP_TEST_CHECK(iccp_test_syncd_domain(d, domains_topo.local_ip, ip, ICCP_TEST_PEER_LINK, mac) == 0);
+        ICCP_TEST_CHECK(iccp_test_syncd_iface(d, name, 1) == 0);
+        ICCP_TEST_CHECK(iccp_test_syncd_vlan_mbr(domains_topo.vlan_base, name, 1) == 0);
+    }
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_domains_bound, NULL, BENCH_WAIT_MSEC));
+    for (d = 1; d <= BENCH_DOMAINS; ++d)
+    {
+        ICCP_TEST_CHECK((fds[d] = iccp_test_session_fake(d)) >= 0);
+        iccp_test_session_force(d, MLACP_STATE_EXCHANGE);
+    }
+    iccp_test_run(100);
+    for (d = 1; d <= BENCH_DOMAINS; ++d)
+        iccp_test_drain(fds[d]);
+
+    /* Owner of each ready peer socket, as iccp_handle_events() looks it up */
+    for (d = 1; d <= BENCH_DOMAINS; ++d)
+        sock_fds[d - 1] = iccp_test_csm(d)->sock_fd;
+
+    start = iccp_test_now_usec();
+    for (i = 0; i < BENCH_DOMAIN_LOOKUPS; ++i)
+        found += system_get_csm_by_fd(sock_fds[i % BENCH_DOMAINS]) != NULL;
+    bench_result("domains", "fd to CSM, table", iccp_test_now_usec() - start, found);
+
+    found = 0;
+    start = iccp_test_now_usec();
+    for (i = 0; i < BENCH_DOMAIN_LOOKUPS; ++i)
+        found += bench_csm_walk_by_fd(sock_fds[i % BENCH_DOMAINS]) != NULL;
+    bench_result("domains", "fd to CSM, csm_list scan", iccp_test_now_usec() - start, found);
+
+    /* The bulk sync in 30 entry messages, several loops worth of the
+     * per-domain budget. One MAC for the last domain right behind it.
+     */
+    csm = iccp_test_csm(1);
+    ICCP_TEST_CHECK((out = (char*)malloc((size_t)BENCH_DOMAIN_MACS * 128 + CSM_BUFFER_SIZE)) != NULL);
+    len = bench_codec_encode_all(csm, BENCH_CODEC_MAC, out, BENCH_DOMAIN_MACS, MAC_SYNC_ADD, BENCH_SYNC_OLD_BATCH);
+
+    memset(&mac_msg, 0, sizeof(mac_msg));
+    iccp_test_mac(2, BENCH_DOMAIN_MACS + 1, mac_msg.mac_addr);
+    mac_msg.vid = domains_topo.vlan_base;
+    mac_msg.op_type = MAC_SYNC_ADD;
+    mac_msg.fdb_type = MAC_TYPE_DYNAMIC;
+    snprintf(mac_msg.origin_ifname, sizeof(mac_msg.origin_ifname), "PortChannel%d", BENCH_DOMAINS);
+    ICCP_TEST_CHECK((small_len = mlacp_prepare_for_mac_info_to_peer(iccp_test_csm(BENCH_DOMAINS), small,
+                                                                     sizeof(small), &mac_msg, 0)) > 0);
+
+    rx = bench_domain_mac_rx(BENCH_DOMAINS);
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_send(fds[1], out, len) == 0);
+    ICCP_TEST_CHECK(iccp_test_send(fds[BENCH_DOMAINS], small, small_len) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_domain_mac_handled, &rx, BENCH_WAIT_MSEC));
+    bench_result("domains", "last domain MAC, handled", iccp_test_now_usec() - start, 1);
+    iccp_test_stats_get(1, &stats);
+    printf("%-24s %-28s %10u of %u MACs applied by then\n", "domains", "first domain bulk",
+           stats.mac_count, BENCH_DOMAIN_MACS);
+
+    w.kind = BENCH_CODEC_MAC;
+    w.count = BENCH_DOMAIN_MACS;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_codec_reached, &w, BENCH_WAIT_MSEC));
+    bench_result("domains", "first domain bulk, applied", iccp_test_now_usec() - start, BENCH_DOMAIN_MACS);
+    fflush(stdout);
+
+    free(out);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+/******************************************************
+*
+*    Consistency check on a large topology
+*
+******************************************************/
+
+#define BENCH_CC_PO         256
+#define BENCH_CC_VLANS      4094    /* VLAN 1..4094 on every port-channel */
+#define BENCH_CC_ROUNDS     100
+
+static struct iccp_test_topo cc_local_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.1",
+    .peer_ip = "127.0.0.2",
+    .num_po = BENCH_CC_PO,
+    .vlan_base = 100,
+    .vlan_count = 1,
+    .node_id = 1,
+};
+
+static struct iccp_test_topo cc_remote_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.2",
+    .peer_ip = "127.0.0.1",
+    .num_po = BENCH_CC_PO,
+    .vlan_base = 100,
+    .vlan_count = 1,
+    .node_id = 2,
+};
+
+static struct iccp_test_peer cc_peer;
+
+static int64_t bench_cc_vlans_fn(void* arg)
+{
+    char name[IFNAMSIZ];
+    int i;
+
+    for (i = 1; i <= BENCH_CC_PO; ++i)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", i);
+        if (iccp_test_syncd_vlan_mbr_many(1, BENCH_CC_VLANS, name, 1) < 0)
+            return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
+static int64_t bench_cc_vlan_del_fn(void* arg)
+{
+    return iccp_test_syncd_vlan_mbr(BENCH_CC_VLANS, "PortChannel1", 0);
+}
+
+static struct LocalInterface* bench_cc_lif(int po)
+{
+    char name[IFNAMSIZ];
+
+    snprintf(name, sizeof(name), "PortChannel%d", po);
+    return local_if_find_by_name(name);
+}
+
+/* Every port-channel and its peer carry all VLANs and agree */
+static int bench_cc_converged(void* arg)
+{
+    struct CSM* csm = iccp_test_csm(cc_local_topo.domain_id);
+    struct LocalInterface* lif = NULL;
+    struct PeerInterface* pif = NULL;
+    int i;
+
+    for (i = 1; i <= BENCH_CC_PO; ++i)
+    {
+        if (!(lif = bench_cc_lif(i)) || lif->vlan_count != BENCH_CC_VLANS
+            || !(pif = peer_if_find_by_name(csm, lif->name))
+            || vlan_bitmap_count(&pif->vlan_bitmap) != BENCH_CC_VLANS
+            || iccp_consistency_check_if(lif) != REASON_NONE)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int bench_cc_vlan_mismatch(void* arg)
+{
+    struct LocalInterface* lif = bench_cc_lif(1);
+
+    return lif->consistency.valid && lif->consistency.reason == REASON_PEER_IF_VLAN_IS_ASYNC;
+}
+
+/* Both nodes with 256 port-channels in 4094 VLANs. Times a check of every
+ * port-channel with the cached results and with each result recomputed,
+ * then a peer VLAN change on one port-channel.
+ */
+static void bench_consistency(void)
+{
+    struct CSM* csm = NULL;
+    struct LocalInterface* lifs[BENCH_CC_PO];
+    struct PeerInterface* pif = NULL;
+    uint64_t start;
+    uint64_t checks = 0;
+    uint32_t cached = 0;
+    int r, i;
+
+    ICCP_TEST_CHECK(iccp_test_peer_start(&cc_peer, &cc_local_topo, &cc_remote_topo) == 0);
+    ICCP_TEST_CHECK(iccp_test_peer_wait_up(&cc_peer, BENCH_WAIT_MSEC));
+    csm = iccp_test_csm(cc_local_topo.domain_id);
+
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(bench_cc_vlans_fn(NULL) == 0);
+    ICCP_TEST_CHECK(iccp_test_peer_call(&cc_peer, bench_cc_vlans_fn, NULL, 0) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_cc_converged, NULL, BENCH_WAIT_MSEC));
+    bench_result("consistency", "VLANs set up, consistent", iccp_test_now_usec() - start,
+                 (uint64_t)BENCH_CC_PO * BENCH_CC_VLANS);
+
+    for (i = 0; i < BENCH_CC_PO; ++i)
+        lifs[i] = bench_cc_lif(i + 1);
+
+    start = iccp_test_now_usec();
+    for (r = 0; r < BENCH_CC_ROUNDS; ++r)
+        for (i = 0; i < BENCH_CC_PO; ++i)
+            checks += iccp_consistency_check_if(lifs[i]) == REASON_NONE;
+    bench_result("consistency", "check all POs, cached", iccp_test_now_usec() - start, checks);
+
+    /* What every check cost before the cache */
+    checks = 0;
+    start = iccp_test_now_usec();
+    for (r = 0; r < BENCH_CC_ROUNDS; ++r)
+    {
+        for (i = 0; i < BENCH_CC_PO; ++i)
+        {
+            lifs[i]->consistency.valid = 0;
+            checks += iccp_consistency_check_if(lifs[i]) == REASON_NONE;
+        }
+    }
+    bench_result("consistency", "check all POs, recomputed", iccp_test_now_usec() - start, checks);
+    ICCP_TEST_CHECK(checks == (uint64_t)BENCH_CC_ROUNDS * BENCH_CC_PO);
+
+    /* The peer drops one VLAN on PortChannel1, its next port-channel info
+     * re-checks that port-channel only
+     */
+    start = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_peer_call(&cc_peer, bench_cc_vlan_del_fn, NULL, 0) == 0);
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_cc_vlan_mismatch, NULL, BENCH_WAIT_MSEC));
+    bench_result("consistency", "peer VLAN del, mismatch seen", iccp_test_now_usec() - start, 1);
+
+    for (i = 1; i < BENCH_CC_PO; ++i)
+    {
+        pif = peer_if_find_by_name(csm, lifs[i]->name);
+        cached += pif && lifs[i]->consistency.valid && lifs[i]->consistency.peer_vlan_gen == pif->vlan_gen
+                  && lifs[i]->consistency.vlan_gen == lifs[i]->vlan_gen;
+    }
+    printf("%-24s %-28s %10u of %d other POs still cached, change time %ld\n", "consistency",
+           "after peer VLAN del", cached, BENCH_CC_PO - 1, (long)lifs[0]->consistency.change_time);
+    fflush(stdout);
+
+    iccp_test_peer_stop(&cc_peer);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+/******************************************************
+*
+*    Logging cost in the MAC path
+*
+******************************************************/
+
+#define BENCH_LOG_MACS      65536
+#define BENCH_LOG_LOOPS     1000000
+
+/* Peer MAC adds then deletes, returns the usec the adds took */
+static uint64_t bench_log_mac_round(int fd, const char* add, size_t add_len, const char* del, size_t del_len)
+{
+    struct bench_codec_wait w;
+    uint64_t usec;
+
+    w.kind = BENCH_CODEC_MAC;
+    usec = iccp_test_now_usec();
+    ICCP_TEST_CHECK(iccp_test_send(fd, add, add_len) == 0);
+    w.count = BENCH_LOG_MACS;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_codec_reached, &w, BENCH_WAIT_MSEC));
+    usec = iccp_test_now_usec() - usec;
+    iccp_test_drain(fd);
+
+    ICCP_TEST_CHECK(iccp_test_send(fd, del, del_len) == 0);
+    w.count = 0;
+    ICCP_TEST_CHECK(iccp_test_run_until(bench_codec_reached, &w, BENCH_WAIT_MSEC));
+    iccp_test_drain(fd);
+
+    return usec;
+}
+
+static void bench_mac_log(void)
+{
+    struct CmdOptionParser parser;
+    struct iccp_test_counters cnt;
+    struct CSM* csm = NULL;
+    char* add = NULL;
+    char* del = NULL;
+    size_t add_len, del_len;
+    uint8_t mac[ETHER_ADDR_LEN];
+    uint64_t start, usec, lines;
+    int fd;
+    int i;
+
+    fd = bench_node_fake_peer(&bench_topo);
+    csm = iccp_test_csm(bench_topo.domain_id);
+    ICCP_TEST_CHECK((add = (char*)malloc((size_t)BENCH_LOG_MACS * 128 + CSM_BUFFER_SIZE)) != NULL);
+    ICCP_TEST_CHECK((del = (char*)malloc((size_t)BENCH_LOG_MACS * 128 + CSM_BUFFER_SIZE)) != NULL);
+    add_len = bench_codec_encode_all(csm, BENCH_CODEC_MAC, add, BENCH_LOG_MACS, MAC_SYNC_ADD, 0);
+    del_len = bench_codec_encode_all(csm, BENCH_CODEC_MAC, del, BENCH_LOG_MACS, MAC_SYNC_DEL, 0);
+    iccp_test_log_discard(1);
+
+    /* Per MAC "Received MAC Info" lines are INFO */
+    logger_set_configuration(NOTICE_LOG_LEVEL);
+    usec = bench_log_mac_round(fd, add, add_len, del, del_len);
+    bench_result("mac_log", "peer MAC add, INFO off", usec, BENCH_LOG_MACS);
+
+    logger_set_configuration(INFO_LOG_LEVEL);
+    iccp_test_counters_get(&cnt);
+    lines = cnt.log_lines;
+    usec = bench_log_mac_round(fd, add, add_len, del, del_len);
+    iccp_test_counters_get(&cnt);
+    bench_result("mac_log", "peer MAC add, INFO inline", usec, BENCH_LOG_MACS);
+    printf("%-24s %-28s %10llu lines\n", "mac_log", "syslog, add and del",
+           (unsigned long long)(cnt.log_lines - lines));
+
+    /* Same with the writer thread draining the log ring */
+    memset(&parser, 0, sizeof(parser));
+    log_init(&parser);
+    iccp_test_counters_get(&cnt);
+    lines = cnt.log_lines;
+    usec = bench_log_mac_round(fd, add, add_len, del, del_len);
+    log_finalize();
+    iccp_test_counters_get(&cnt);
+    bench_result("mac_log", "peer MAC add, INFO ring", usec, BENCH_LOG_MACS);
+    printf("%-24s %-28s %10llu lines\n", "mac_log", "syslog, add and del",
+           (unsigned long long)(cnt.log_lines - lines));
+
+    /* A filtered DEBUG line with a MAC argument, and the formatter itself */
+    logger_set_configuration(INFO_LOG_LEVEL);
+    memset(mac, 0, sizeof(mac));
+    start = iccp_test_now_usec();
+    for (i = 0; i < BENCH_LOG_LOOPS; ++i)
+    {
+        mac[5] = i;
+        ICCPD_LOG_DEBUG("ICCP_FDB", "MAC %s vid %d", mac_addr_to_str(mac), i);
+        __asm__ __volatile__ ("" ::: "memory");
+    }
+    bench_result("mac_log", "DEBUG line, filtered", iccp_test_now_usec() - start, BENCH_LOG_LOOPS);
+
+    start = iccp_test_now_usec();
+    for (i = 0; i < BENCH_LOG_LOOPS; ++i)
+    {
+        mac[5] = i;
+        mac_addr_to_str(mac);
+        __asm__ __volatile__ ("" ::: "memory");
+    }
+    bench_result("mac_log", "mac_addr_to_str", iccp_test_now_usec() - start, BENCH_LOG_LOOPS);
+
+    free(add);
+    free(del);
+    iccp_test_node_finalize();
+
+    return;
+}
+
+static const struct iccp_bench_case bench_cases[] = {
+    { "mac_codec", "MAC info TLV encode, peer receive/decode/apply", bench_mac_codec },
+    { "arp_codec", "ARP info TLV encode, peer receive/decode/apply", bench_arp_codec },
+    { "nd_codec", "ND info TLV encode, peer receive/decode/apply", bench_nd_codec },
+    { "neigh_storm", "kernel ARP storm over 256 POs/VLANs, interface lookups", bench_neigh_storm },
+    { "mac_resync", "64K MACs synced to a peer iccpd and resynced after reconnect", bench_mac_resync },
+    { "resync_delta", "64K MACs, 1K changed while down: full vs delta resync", bench_resync_delta },
+    { "mac_batch", "peer receive of 64K MACs, 30 per message vs full messages", bench_mac_batch },
+    { "mac_flush", "64K MACs flushed by syncd and by a port-channel down, time to quiet", bench_mac_flush },
+    { "failover", "200K MACs over 48 POs: PO down indexed vs full walk, session loss", bench_failover },
+    { "domains", "16 domains: fd to CSM lookup, last domain behind a bulk sync", bench_domains },
+    { "consistency", "256 POs in 4094 VLANs: cached vs recomputed checks, peer VLAN change", bench_consistency },
+    { "mac_log", "per MAC logging cost at INFO, inline and through the log ring", bench_mac_log },
+    { NULL, NULL, NULL }
+};
+
+static int bench_run(const struct iccp_bench_case* bc)
+{
+    pid_t pid;
+    int status;
+
+    fflush(NULL);
+    if ((pid = fork()) == 0)
+    {
+        bc->run();
+        exit(0);
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) < 0)
+        return 1;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "%s failed\n", bc->name);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const struct iccp_bench_case* bc = NULL;
+    int ret = 0;
+    int i;
+
+    if (argc > 1 && strcmp(argv[1], "-l") == 0)
+    {
+        for (bc = bench_cases; bc->name; ++bc)
+            printf("%-24s %s\n", bc->name, bc->desc);
+        return 0;
+    }
+
+    for (bc = bench_cases; bc->name; ++bc)
+    {
+        if (argc > 1)
+        {
+            for (i = 1; i < argc; ++i)
+                if (strcmp(argv[i], bc->name) == 0)
+                    break;
+            if (i == argc)
+                continue;
+        }
+        ret |= bench_run(bc);
+    }
+
+    return ret;
+}
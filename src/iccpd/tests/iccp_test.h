@@ -0,0 +1,176 @@
+/*
+ * iccp_test.h
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* Loopback harness for iccpd. Each process runs one real System and event
+ * loop; the kernel (netlink events, neighbor programming, shell commands),
+ * mclagsyncd and the peer TCP session are replaced by socketpairs the test
+ * drives. The peer iccpd is a forked process, see iccp_test_peer.c.
+ */
+
+#ifndef ICCP_TEST_H_
+#define ICCP_TEST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "../include/system.h"
+
+struct CSM;
+struct mclagd_watch_event;
+
+#define ICCP_TEST_DOMAIN_ID     1
+#define ICCP_TEST_PEER_LINK     "Ethernet0"
+#define ICCP_TEST_PEER_LINK_IFINDEX     10
+#define ICCP_TEST_PO_IFINDEX_BASE       100
+#define ICCP_TEST_VLAN_IFINDEX_BASE     10000
+#define ICCP_TEST_ARG_SIZE      4096
+
+/* Exit code automake takes as a skipped test */
+#define ICCP_TEST_SKIP          77
+
+#define ICCP_TEST_CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+/* What iccpd did to the stand-ins, counted by the harness */
+struct iccp_test_counters
+{
+    uint64_t system_cmds;       /* system() calls */
+    uint64_t neigh_add;         /* rtnl_neigh_add() */
+    uint64_t neigh_del;         /* rtnl_neigh_delete() */
+    uint64_t syncd_msgs[16];    /* frames sent to mclagsyncd, by MCLAG_MSG_TYPE_* */
+    uint64_t syncd_fdb_add;     /* SET_FDB entries */
+    uint64_t syncd_fdb_del;
+    uint64_t log_lines;         /* syslog() lines */
+};
+
+/* One node's view, filled in the process that owns the System */
+struct iccp_test_stats
+{
+    int mlacp_state;
+    int sock_fd;
+    uint32_t mac_count;
+    uint32_t arp_count;
+    uint32_t ndisc_count;
+    uint64_t mac_info_tx;       /* MAC info messages sent to/received from the peer */
+    uint64_t mac_info_rx;
+    uint32_t resync_full;       /* resync replies sent, full and delta */
+    uint32_t resync_delta;
+    uint32_t fdb_coalesce;      /* syncd FDB ops folded into a later op on the same MAC */
+    struct iccp_test_counters cnt;
+    system_latency_info_t latency;
+};
+
+/* MC-LAG set up the way mclagsyncd and the kernel announce it: the peer
+ * link, PortChannel1..num_po and, with vlan_count, Vlan<vlan_base>.. with
+ * every port-channel a member and an IPv4/IPv6 address on each VLAN.
+ */
+struct iccp_test_topo
+{
+    int domain_id;
+    const char* local_ip;
+    const char* peer_ip;
+    int num_po;
+    int vlan_base;
+    int vlan_count;
+    uint8_t node_id;    /* last byte of interface MACs and VLAN addresses */
+};
+
+/* Harness process, iccp_test_node.c */
+int iccp_test_node_init(void);
+void iccp_test_node_finalize(void);
+struct System* iccp_test_sys(void);
+struct CSM* iccp_test_csm(int domain_id);
+void iccp_test_counters_get(struct iccp_test_counters* cnt);
+void iccp_test_stats_get(int domain_id, struct iccp_test_stats* stats);
+uint64_t iccp_test_now_usec(void);
+void iccp_test_run(int msec);
+int iccp_test_run_until(int (*cond)(void* arg), void* arg, int max_msec);
+void iccp_test_log_discard(int discard);
+uint64_t iccp_test_latency_pct(const system_latency_hist_t* hist, int percent);
+
+/* Kernel stand-in, netlink events delivered through the netlink worker */
+int iccp_test_link(const char* name, int ifindex, const uint8_t* mac, int up);
+int iccp_test_link_del(const char* name, int ifindex);
+int iccp_test_addr(int ifindex, int family, const void* addr, int prefix_len);
+int iccp_test_neigh(int ifindex, int family, const void* ip, const uint8_t* mac, int add);
+
+/* mclagsyncd stand-in */
+int iccp_test_syncd_send(uint8_t type, const void* data, size_t len);
+int iccp_test_syncd_domain(int domain_id, const char* local_ip, const char* peer_ip,
+                           const char* peer_ifname, const uint8_t* system_mac);
+int iccp_test_syncd_iface(int domain_id, const char* ifname, int add);
+int iccp_test_syncd_vlan_mbr(unsigned int vid, const char* ifname, int add);
+int iccp_test_syncd_vlan_mbr_many(unsigned int first_vid, unsigned int count, const char* ifname, int add);
+int iccp_test_syncd_fdb(const uint8_t* mac, unsigned int vid, const char* port, int add);
+int iccp_test_syncd_fdb_many(uint8_t node_id, uint32_t first, uint32_t count,
+                             unsigned int vid, const char* port, int add);
+int iccp_test_syncd_capability(uint32_t flags);
+
+/* mclagdctl stand-in, a client on the control socket */
+int iccp_test_ctl_connect(void);
+int iccp_test_ctl_watch(int fd, int mclag_id);
+int iccp_test_ctl_watch_next(int fd, struct mclagd_watch_event* ev, int max_msec);
+
+/* Peer session stand-in, attached the way an accepted connection is */
+int iccp_test_session_attach(int domain_id, int fd);
+void iccp_test_session_close(int domain_id);
+int iccp_test_session_up(void* domain_id);
+int iccp_test_session_fake(int domain_id);
+void iccp_test_session_force(int domain_id, int mlacp_state);
+int iccp_test_send(int fd, const void* buf, size_t len);
+int iccp_test_drain(int fd);
+
+int iccp_test_topo_setup(const struct iccp_test_topo* topo);
+void iccp_test_mac(uint8_t node_id, uint32_t index, uint8_t* mac);
+void iccp_test_vlan_ip(const struct iccp_test_topo* topo, int vid, uint8_t host, uint32_t* ipv4, uint8_t* ipv6);
+
+/* Peer process, iccp_test_peer.c. Functions called in the peer run on a
+ * copy of arg (up to ICCP_TEST_ARG_SIZE bytes) that is copied back.
+ */
+typedef int64_t (*iccp_test_peer_fn)(void* arg);
+
+struct iccp_test_peer
+{
+    pid_t pid;
+    int ctl_fd;
+    int domain_id;
+};
+
+int iccp_test_peer_start(struct iccp_test_peer* peer, const struct iccp_test_topo* local,
+                         const struct iccp_test_topo* remote);
+int64_t iccp_test_peer_call(struct iccp_test_peer* peer, iccp_test_peer_fn fn, void* arg, size_t len);
+void iccp_test_peer_stats(struct iccp_test_peer* peer, struct iccp_test_stats* stats);
+int iccp_test_peer_disconnect(struct iccp_test_peer* peer);
+int iccp_test_peer_connect(struct iccp_test_peer* peer);
+int iccp_test_peer_reconnect(struct iccp_test_peer* peer);
+int iccp_test_peer_wait_up(struct iccp_test_peer* peer, int max_msec);
+void iccp_test_peer_stop(struct iccp_test_peer* peer);
+
+#endif /* ICCP_TEST_H_ */
@@ -0,0 +1,1177 @@
+/*
+ * iccp_test_node.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* Stand-ins for everything outside iccpd. The functions that open kernel,
+ * mclagsyncd or TCP sockets are replaced at link time (-Wl,--wrap, see
+ * Makefile.am) so the daemon runs its real event loop on socketpairs.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/if.h>
+#include <linux/if_addr.h>
+#include <linux/neighbour.h>
+#include <linux/rtnetlink.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <netlink/socket.h>
+#include <netlink/route/neighbour.h>
+
+#include "../include/logger.h"
+#include "../include/system.h"
+#include "../include/scheduler.h"
+#include "../include/iccp_csm.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/msg_format.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/port.h"
+#include "../src/mclagdctl/mclagdctl.h"
+
+#include "iccp_test.h"
+
+#define ICCP_TEST_SOCK_BUF_LEN      (8 * 1024 * 1024)
+#define ICCP_TEST_SYNCD_BUF_SIZE    (256 * 1024)
+
+struct iccp_test_node
+{
+    int syncd_fd;           /* mclagsyncd side */
+    int syncd_iccpd_fd;     /* handed to iccpd by iccp_connect_syncd */
+    int link_fd[2];         /* [0] read by the netlink worker, [1] kernel side */
+    int neigh_fd[2];
+    int genl_event_fd;
+    struct nl_sock* route_event_sock;
+    struct nl_sock* neigh_event_sock;
+    struct nl_sock* genric_event_sock;
+    pthread_t syncd_thread;
+    int syncd_thread_started;
+    int log_discard;        /* count syslog lines without printing them */
+    struct iccp_test_counters cnt;
+};
+
+static struct iccp_test_node g_iccp_test_node = {
+    .syncd_fd = -1,
+    .syncd_iccpd_fd = -1,
+    .link_fd = { -1, -1 },
+    .neigh_fd = { -1, -1 },
+    .genl_event_fd = -1,
+};
+
+#define ICCP_TEST_CNT_ADD(field, n) __atomic_add_fetch(&g_iccp_test_node.cnt.field, (n), __ATOMIC_RELAXED)
+
+/******************************************************
+*
+*    Link time replacements
+*
+******************************************************/
+
+int __real_nl_socket_get_fd(const struct nl_sock* sk);
+
+/* No TCP listener, the peer session is attached by iccp_test_session_attach */
+void __wrap_scheduler_server_sock_init()
+{
+    struct System* sys = system_get_instance();
+
+    if (sys)
+        sys->server_fd = eventfd(0, EFD_NONBLOCK);
+
+    return;
+}
+
+/* Event sockets become socketpairs, the request sockets stay unconnected */
+int __wrap_iccp_system_init_netlink_socket()
+{
+    struct iccp_test_node* node = &g_iccp_test_node;
+    struct System* sys = NULL;
+    int bufsize = ICCP_TEST_SOCK_BUF_LEN;
+    int fds[2];
+
+    if ((sys = system_get_instance()) == NULL)
+        return MCLAG_ERROR;
+
+    sys->genric_sock = nl_socket_alloc();
+    sys->genric_event_sock = nl_socket_alloc();
+    sys->route_sock = nl_socket_alloc();
+    sys->route_event_sock = nl_socket_alloc();
+    sys->neigh_event_sock = nl_socket_alloc();
+    if (!sys->genric_sock || !sys->genric_event_sock || !sys->route_sock
+        || !sys->route_event_sock || !sys->neigh_event_sock)
+        return MCLAG_ERROR;
+
+    node->route_event_sock = sys->route_event_sock;
+    node->neigh_event_sock = sys->neigh_event_sock;
+    node->genric_event_sock = sys->genric_event_sock;
+    node->genl_event_fd = eventfd(0, EFD_NONBLOCK);
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, node->link_fd) < 0
+        || socketpair(AF_UNIX, SOCK_DGRAM, 0, node->neigh_fd) < 0)
+        return MCLAG_ERROR;
+    setsockopt(node->link_fd[0], SOL_SOCKET, SO_RCVBUFFORCE, &bufsize, sizeof(bufsize));
+    setsockopt(node->neigh_fd[0], SOL_SOCKET, SO_RCVBUFFORCE, &bufsize, sizeof(bufsize));
+
+    /* Nothing is ever sent on the packet sockets */
+    if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds) < 0)
+        return MCLAG_ERROR;
+    sys->arp_receive_fd = fds[0];
+    close(fds[1]);
+    if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds) < 0)
+        return MCLAG_ERROR;
+    sys->ndisc_receive_fd = fds[0];
+    close(fds[1]);
+
+    return 0;
+}
+
+int __wrap_nl_socket_get_fd(const struct nl_sock* sk)
+{
+    struct iccp_test_node* node = &g_iccp_test_node;
+
+    if (sk && sk == node->route_event_sock)
+        return node->link_fd[0];
+    if (sk && sk == node->neigh_event_sock)
+        return node->neigh_fd[0];
+    if (sk && sk == node->genric_event_sock)
+        return node->genl_event_fd;
+
+    return __real_nl_socket_get_fd(sk);
+}
+
+int __wrap_iccp_connect_syncd()
+{
+    struct iccp_test_node* node = &g_iccp_test_node;
+    struct System* sys = NULL;
+    struct epoll_event event;
+
+    if ((sys = system_get_instance()) == NULL)
+        return MCLAG_ERROR;
+    if (sys->sync_fd >= 0)
+        return 0;
+    if (node->syncd_iccpd_fd < 0)
+        return MCLAG_ERROR;
+
+    sys->sync_fd = node->syncd_iccpd_fd;
+    node->syncd_iccpd_fd = -1;
+
+    event.data.fd = sys->sync_fd;
+    event.events = EPOLLIN;
+    epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, sys->sync_fd, &event);
+
+    return 0;
+}
+
+/* Kernel dumps at start up, the harness announces interfaces as events */
+int __wrap_iccp_sys_local_if_list_get_init()
+{
+    return 0;
+}
+
+int __wrap_iccp_sys_local_if_list_get_addr()
+{
+    return 0;
+}
+
+int __wrap_iccp_neigh_get_init()
+{
+    return 0;
+}
+
+int __wrap_iccp_config_from_file(char* config_default_dir)
+{
+    return 0;
+}
+
+int __wrap_mclagd_ctl_sock_create()
+{
+    return 0;
+}
+
+/* teamd is not part of the harness */
+int __wrap_iccp_get_port_member_list(struct LocalInterface* lif)
+{
+    return 0;
+}
+
+int __wrap_system(const char* cmd)
+{
+    ICCP_TEST_CNT_ADD(system_cmds, 1);
+    return 0;
+}
+
+int __wrap_rtnl_neigh_add(struct nl_sock* sk, struct rtnl_neigh* neigh, int flags)
+{
+    ICCP_TEST_CNT_ADD(neigh_add, 1);
+    return 0;
+}
+
+int __wrap_rtnl_neigh_delete(struct nl_sock* sk, struct rtnl_neigh* neigh, int flags)
+{
+    ICCP_TEST_CNT_ADD(neigh_del, 1);
+    return 0;
+}
+
+/* Benchmarks that log on purpose still pay for the formatting */
+void iccp_test_log_discard(int discard)
+{
+    __atomic_store_n(&g_iccp_test_node.log_discard, discard, __ATOMIC_RELAXED);
+    return;
+}
+
+/* iccpd logs to stderr, tagged with the process */
+static void iccp_test_vlog(const char* format, va_list args)
+{
+    char buf[1024];
+
+    ICCP_TEST_CNT_ADD(log_lines, 1);
+    vsnprintf(buf, sizeof(buf), format, args);
+    if (__atomic_load_n(&g_iccp_test_node.log_discard, __ATOMIC_RELAXED))
+        return;
+
+    fprintf(stderr, "[%d] %s\n", (int)getpid(), buf);
+
+    return;
+}
+
+void __wrap_syslog(int priority, const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    iccp_test_vlog(format, args);
+    va_end(args);
+
+    return;
+}
+
+/* syslog() with _FORTIFY_SOURCE */
+void __wrap___syslog_chk(int priority, int flag, const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    iccp_test_vlog(format, args);
+    va_end(args);
+
+    return;
+}
+
+/******************************************************
+*
+*    mclagsyncd stand-in
+*
+******************************************************/
+
+static void iccp_test_syncd_account(struct IccpSyncdHDr* hdr)
+{
+    struct mclag_fdb_info* fdb = NULL;
+    size_t num, i;
+
+    if (hdr->type < sizeof(g_iccp_test_node.cnt.syncd_msgs) / sizeof(g_iccp_test_node.cnt.syncd_msgs[0]))
+        ICCP_TEST_CNT_ADD(syncd_msgs[hdr->type], 1);
+
+    if (hdr->type != MCLAG_MSG_TYPE_SET_FDB)
+        return;
+
+    num = (hdr->len - sizeof(struct IccpSyncdHDr)) / sizeof(struct mclag_fdb_info);
+    fdb = (struct mclag_fdb_info*)(hdr + 1);
+    for (i = 0; i < num; ++i)
+    {
+        if (fdb[i].op_type == MAC_SYNC_ADD)
+            ICCP_TEST_CNT_ADD(syncd_fdb_add, 1);
+        else
+            ICCP_TEST_CNT_ADD(syncd_fdb_del, 1);
+    }
+
+    return;
+}
+
+/* Reads whatever iccpd sends, iccpd would stall on a full socket */
+static void* iccp_test_syncd_reader(void* arg)
+{
+    struct iccp_test_node* node = (struct iccp_test_node*)arg;
+    struct IccpSyncdHDr* hdr = NULL;
+    char* buf = NULL;
+    size_t len = 0;
+    size_t pos;
+    ssize_t n;
+
+    if ((buf = (char*)malloc(ICCP_TEST_SYNCD_BUF_SIZE)) == NULL)
+        return NULL;
+
+    while (1)
+    {
+        n = recv(node->syncd_fd, buf + len, ICCP_TEST_SYNCD_BUF_SIZE - len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+
+        len += n;
+        pos = 0;
+        while (len - pos >= sizeof(struct IccpSyncdHDr))
+        {
+            hdr = (struct IccpSyncdHDr*)&buf[pos];
+            if (hdr->len < sizeof(struct IccpSyncdHDr))
+            {
+                fprintf(stderr, "iccp_test: bad frame to mclagsyncd, type %u len %u\n", hdr->type, hdr->len);
+                goto out;
+            }
+            if (len - pos < hdr->len)
+                break;
+            iccp_test_syncd_account(hdr);
+            pos += hdr->len;
+        }
+
+        len -= pos;
+        if (len > 0 && pos > 0)
+            memmove(buf, &buf[pos], len);
+    }
+
+ out:
+    free(buf);
+    return NULL;
+}
+
+/* Write all of buf, running the event loop while the socket is full */
+static int iccp_test_send_all(int fd, const void* buf, size_t len, int dgram)
+{
+    size_t off = 0;
+    ssize_t n;
+
+    while (off < len)
+    {
+        n = send(fd, (const char*)buf + off, len - off, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return MCLAG_ERROR;
+            scheduler_loop_once(system_get_instance(), 1);
+            continue;
+        }
+        if (dgram)
+            return 0;
+        off += n;
+    }
+
+    return 0;
+}
+
+int iccp_test_send(int fd, const void* buf, size_t len)
+{
+    return iccp_test_send_all(fd, buf, len, 0);
+}
+
+int iccp_test_syncd_send(uint8_t type, const void* data, size_t len)
+{
+    char buf[sizeof(struct IccpSyncdHDr) + MCLAG_MAX_MSG_LEN];
+    struct IccpSyncdHDr* hdr = (struct IccpSyncdHDr*)buf;
+
+    if (len > MCLAG_MAX_MSG_LEN)
+        return MCLAG_ERROR;
+
+    hdr->ver = 1;
+    hdr->type = type;
+    hdr->len = sizeof(struct IccpSyncdHDr) + len;
+    memcpy(hdr + 1, data, len);
+
+    return iccp_test_send_all(g_iccp_test_node.syncd_fd, buf, hdr->len, 0);
+}
+
+int iccp_test_syncd_domain(int domain_id, const char* local_ip, const char* peer_ip,
+                           const char* peer_ifname, const uint8_t* system_mac)
+{
+    struct mclag_domain_cfg_info cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.op_type = MCLAG_CFG_OPER_ADD;
+    cfg.domain_id = domain_id;
+    cfg.keepalive_time = -1;
+    cfg.session_timeout = -1;
+    snprintf(cfg.local_ip, sizeof(cfg.local_ip), "%s", local_ip);
+    snprintf(cfg.peer_ip, sizeof(cfg.peer_ip), "%s", peer_ip);
+    cfg.attr_bmap = MCLAG_CFG_ATTR_SRC_ADDR | MCLAG_CFG_ATTR_PEER_ADDR;
+    if (peer_ifname)
+    {
+        snprintf(cfg.peer_ifname, sizeof(cfg.peer_ifname), "%s", peer_ifname);
+        cfg.attr_bmap |= MCLAG_CFG_ATTR_PEER_LINK;
+    }
+    memcpy(cfg.system_mac, system_mac, ETHER_ADDR_LEN);
+
+    return iccp_test_syncd_send(MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_DOMAIN, &cfg, sizeof(cfg));
+}
+
+int iccp_test_syncd_iface(int domain_id, const char* ifname, int add)
+{
+    struct mclag_iface_cfg_info cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.op_type = add ? MCLAG_CFG_OPER_ADD : MCLAG_CFG_OPER_DEL;
+    cfg.domain_id = domain_id;
+    snprintf(cfg.mclag_iface, sizeof(cfg.mclag_iface), "%s", ifname);
+
+    return iccp_test_syncd_send(MCLAG_SYNCD_MSG_TYPE_CFG_MCLAG_IFACE, &cfg, sizeof(cfg));
+}
+
+int iccp_test_syncd_vlan_mbr(unsigned int vid, const char* ifname, int add)
+{
+    struct mclag_vlan_mbr_info mbr;
+
+    memset(&mbr, 0, sizeof(mbr));
+    mbr.op_type = add ? MCLAG_CFG_OPER_ADD : MCLAG_CFG_OPER_DEL;
+    mbr.vid = vid;
+    snprintf(mbr.mclag_iface, sizeof(mbr.mclag_iface), "%s", ifname);
+
+    return iccp_test_syncd_send(MCLAG_SYNCD_MSG_TYPE_VLAN_MBR_UPDATES, &mbr, sizeof(mbr));
+}
+
+/* VLANs first_vid.. on ifname, packed into as few messages as fit */
+int iccp_test_syncd_vlan_mbr_many(unsigned int first_vid, unsigned int count, const char* ifname, int add)
+{
+    struct mclag_vlan_mbr_info mbr[MCLAG_MAX_MSG_LEN / sizeof(struct mclag_vlan_mbr_info)];
+    unsigned int max = sizeof(mbr) / sizeof(mbr[0]);
+    unsigned int i, n;
+
+    while (count > 0)
+    {
+        n = count < max ? count : max;
+        memset(mbr, 0, n * sizeof(mbr[0]));
+        for (i = 0; i < n; ++i)
+        {
+            mbr[i].op_type = add ? MCLAG_CFG_OPER_ADD : MCLAG_CFG_OPER_DEL;
+            mbr[i].vid = first_vid + i;
+            snprintf(mbr[i].mclag_iface, sizeof(mbr[i].mclag_iface), "%s", ifname);
+        }
+        if (iccp_test_syncd_send(MCLAG_SYNCD_MSG_TYPE_VLAN_MBR_UPDATES, mbr, n * sizeof(mbr[0])) < 0)
+            return MCLAG_ERROR;
+        first_vid += n;
+        count -= n;
+    }
+
+    return 0;
+}
+
+int iccp_test_syncd_fdb(const uint8_t* mac, unsigned int vid, const char* port, int add)
+{
+    struct mclag_fdb_info fdb;
+
+    memset(&fdb, 0, sizeof(fdb));
+    memcpy(fdb.mac, mac, ETHER_ADDR_LEN);
+    fdb.vid = vid;
+    snprintf(fdb.port_name, sizeof(fdb.port_name), "%s", port);
+    fdb.type = MAC_TYPE_DYNAMIC;
+    fdb.op_type = add ? MAC_SYNC_ADD : MAC_SYNC_DEL;
+
+    return iccp_test_syncd_send(MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION, &fdb, sizeof(fdb));
+}
+
+/* count MACs iccp_test_mac(node_id, first..) in frames as full as mclagsyncd sends */
+int iccp_test_syncd_fdb_many(uint8_t node_id, uint32_t first, uint32_t count,
+                             unsigned int vid, const char* port, int add)
+{
+    struct mclag_fdb_info fdb[MCLAG_MAX_MSG_LEN / sizeof(struct mclag_fdb_info)];
+    uint32_t max = sizeof(fdb) / sizeof(fdb[0]);
+    uint32_t i, n;
+
+    while (count > 0)
+    {
+        n = count < max ? count : max;
+        memset(fdb, 0, n * sizeof(fdb[0]));
+        for (i = 0; i < n; ++i)
+        {
+            iccp_test_mac(node_id, first + i, fdb[i].mac);
+            fdb[i].vid = vid;
+            snprintf(fdb[i].port_name, sizeof(fdb[i].port_name), "%s", port);
+            fdb[i].type = MAC_TYPE_DYNAMIC;
+            fdb[i].op_type = add ? MAC_SYNC_ADD : MAC_SYNC_DEL;
+        }
+        if (iccp_test_syncd_send(MCLAG_SYNCD_MSG_TYPE_FDB_OPERATION, fdb, n * sizeof(fdb[0])) < 0)
+            return MCLAG_ERROR;
+        first += n;
+        count -= n;
+    }
+
+    return 0;
+}
+
+int iccp_test_syncd_capability(uint32_t flags)
+{
+    struct mclag_syncd_capability_info cap;
+
+    cap.flags = flags;
+
+    return iccp_test_syncd_send(MCLAG_SYNCD_MSG_TYPE_CAPABILITY, &cap, sizeof(cap));
+}
+
+/******************************************************
+*
+*    Kernel stand-in
+*
+******************************************************/
+
+static int iccp_test_nl_send(int fd, struct nl_msg* msg)
+{
+    struct nlmsghdr* nlh = nlmsg_hdr(msg);
+    int ret;
+
+    ret = iccp_test_send_all(fd, nlh, nlh->nlmsg_len, 1);
+    nlmsg_free(msg);
+
+    return ret;
+}
+
+int iccp_test_link(const char* name, int ifindex, const uint8_t* mac, int up)
+{
+    struct ifinfomsg ifi;
+    struct nl_msg* msg = NULL;
+
+    if ((msg = nlmsg_alloc_simple(RTM_NEWLINK, 0)) == NULL)
+        return MCLAG_ERROR;
+
+    memset(&ifi, 0, sizeof(ifi));
+    ifi.ifi_family = AF_UNSPEC;
+    ifi.ifi_index = ifindex;
+    ifi.ifi_flags = up ? (IFF_UP | IFF_RUNNING | IFF_LOWER_UP) : 0;
+    ifi.ifi_change = 0xffffffff;
+
+    if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0
+        || nla_put_string(msg, IFLA_IFNAME, name) < 0
+        || (mac && nla_put(msg, IFLA_ADDRESS, ETHER_ADDR_LEN, mac) < 0)
+        || nla_put_u32(msg, IFLA_MTU, 9100) < 0
+        || nla_put_u8(msg, IFLA_OPERSTATE, up ? IF_OPER_UP : IF_OPER_DOWN) < 0)
+    {
+        nlmsg_free(msg);
+        return MCLAG_ERROR;
+    }
+
+    return iccp_test_nl_send(g_iccp_test_node.link_fd[1], msg);
+}
+
+int iccp_test_link_del(const char* name, int ifindex)
+{
+    struct ifinfomsg ifi;
+    struct nl_msg* msg = NULL;
+
+    if ((msg = nlmsg_alloc_simple(RTM_DELLINK, 0)) == NULL)
+        return MCLAG_ERROR;
+
+    memset(&ifi, 0, sizeof(ifi));
+    ifi.ifi_family = AF_UNSPEC;
+    ifi.ifi_index = ifindex;
+
+    if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0
+        || nla_put_string(msg, IFLA_IFNAME, name) < 0)
+    {
+        nlmsg_free(msg);
+        return MCLAG_ERROR;
+    }
+
+    return iccp_test_nl_send(g_iccp_test_node.link_fd[1], msg);
+}
+
+int iccp_test_addr(int ifindex, int family, const void* addr, int prefix_len)
+{
+    struct ifaddrmsg ifa;
+    struct nl_msg* msg = NULL;
+    int addr_len = (family == AF_INET) ? 4 : 16;
+
+    if ((msg = nlmsg_alloc_simple(RTM_NEWADDR, 0)) == NULL)
+        return MCLAG_ERROR;
+
+    memset(&ifa, 0, sizeof(ifa));
+    ifa.ifa_family = family;
+    ifa.ifa_prefixlen = prefix_len;
+    ifa.ifa_scope = RT_SCOPE_UNIVERSE;
+    ifa.ifa_index = ifindex;
+
+    if (nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO) < 0
+        || nla_put(msg, IFA_LOCAL, addr_len, addr) < 0
+        || nla_put(msg, IFA_ADDRESS, addr_len, addr) < 0)
+    {
+        nlmsg_free(msg);
+        return MCLAG_ERROR;
+    }
+
+    return iccp_test_nl_send(g_iccp_test_node.link_fd[1], msg);
+}
+
+int iccp_test_neigh(int ifindex, int family, const void* ip, const uint8_t* mac, int add)
+{
+    struct ndmsg ndm;
+    struct nl_msg* msg = NULL;
+
+    if ((msg = nlmsg_alloc_simple(add ? RTM_NEWNEIGH : RTM_DELNEIGH, 0)) == NULL)
+        return MCLAG_ERROR;
+
+    memset(&ndm, 0, sizeof(ndm));
+    ndm.ndm_family = family;
+    ndm.ndm_ifindex = ifindex;
+    ndm.ndm_state = NUD_REACHABLE;
+    ndm.ndm_type = RTN_UNICAST;
+
+    if (nlmsg_append(msg, &ndm, sizeof(ndm), NLMSG_ALIGNTO) < 0
+        || nla_put(msg, NDA_DST, (family == AF_INET) ? 4 : 16, ip) < 0
+        || (mac && nla_put(msg, NDA_LLADDR, ETHER_ADDR_LEN, mac) < 0))
+    {
+        nlmsg_free(msg);
+        return MCLAG_ERROR;
+    }
+
+    return iccp_test_nl_send(g_iccp_test_node.neigh_fd[1], msg);
+}
+
+/******************************************************
+*
+*    Node
+*
+******************************************************/
+
+uint64_t iccp_test_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int iccp_test_node_init(void)
+{
+    struct iccp_test_node* node = &g_iccp_test_node;
+    struct System* sys = NULL;
+    /* ICCP_TEST_LOG_LEVEL=5 prints iccpd debug logs */
+    const char* level = getenv("ICCP_TEST_LOG_LEVEL");
+    int bufsize = ICCP_TEST_SOCK_BUF_LEN;
+    int fds[2];
+
+    logger_set_configuration(level ? atoi(level) : CRITICAL_LOG_LEVEL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return MCLAG_ERROR;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUFFORCE, &bufsize, sizeof(bufsize));
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUFFORCE, &bufsize, sizeof(bufsize));
+    node->syncd_iccpd_fd = fds[0];
+    node->syncd_fd = fds[1];
+
+    if ((sys = system_get_instance()) == NULL)
+        return MCLAG_ERROR;
+    if (sys->epoll_fd < 0 || node->link_fd[0] < 0)
+        return MCLAG_ERROR;
+
+    free(sys->warm_snapshot_path);
+    sys->warm_snapshot_path = strdup("/nonexistent/iccpd_test_warm_snapshot");
+
+    if (pthread_create(&node->syncd_thread, NULL, iccp_test_syncd_reader, node) != 0)
+        return MCLAG_ERROR;
+    node->syncd_thread_started = 1;
+
+    scheduler_init();
+
+    return iccp_test_syncd_capability(MCLAG_SYNCD_CAP_FDB_BATCH);
+}
+
+void iccp_test_node_finalize(void)
+{
+    struct iccp_test_node* node = &g_iccp_test_node;
+    struct System* sys = system_get_instance();
+
+    if (sys && sys->sync_ctrl_fd > 0)
+        unlink(sys->mclagdctl_file_path);
+    system_finalize();
+
+    if (node->syncd_fd >= 0)
+        shutdown(node->syncd_fd, SHUT_RDWR);
+    if (node->syncd_thread_started)
+        pthread_join(node->syncd_thread, NULL);
+    node->syncd_thread_started = 0;
+    if (node->syncd_fd >= 0)
+        close(node->syncd_fd);
+    node->syncd_fd = -1;
+    close(node->link_fd[0]);
+    close(node->link_fd[1]);
+    close(node->neigh_fd[0]);
+    close(node->neigh_fd[1]);
+    close(node->genl_event_fd);
+
+    return;
+}
+
+struct System* iccp_test_sys(void)
+{
+    return system_get_instance();
+}
+
+struct CSM* iccp_test_csm(int domain_id)
+{
+    return system_get_csm_by_mlacp_id(domain_id);
+}
+
+void iccp_test_counters_get(struct iccp_test_counters* cnt)
+{
+    const uint64_t* src = (const uint64_t*)&g_iccp_test_node.cnt;
+    uint64_t* dst = (uint64_t*)cnt;
+    size_t i;
+
+    for (i = 0; i < sizeof(*cnt) / sizeof(uint64_t); ++i)
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+
+    return;
+}
+
+void iccp_test_stats_get(int domain_id, struct iccp_test_stats* stats)
+{
+    struct CSM* csm = iccp_test_csm(domain_id);
+    struct MACMsg* mac_msg = NULL;
+    struct Msg* msg = NULL;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->sock_fd = -1;
+    iccp_test_counters_get(&stats->cnt);
+    memcpy(&stats->latency, &system_get_instance()->latency, sizeof(stats->latency));
+    stats->fdb_coalesce = system_get_instance()->dbg_counters.syncd_fdb_coalesce_counter;
+    if (csm == NULL)
+        return;
+
+    stats->mlacp_state = MLACP(csm).current_state;
+    stats->sock_fd = csm->sock_fd;
+    stats->mac_info_tx = MLACP(csm).dbg_counters.iccp_counters[ICCP_DBG_CNTR_MSG_MAC_INFO]
+                         [ICCP_DBG_CNTR_DIR_TX][ICCP_DBG_CNTR_STS_OK];
+    stats->mac_info_rx = MLACP(csm).dbg_counters.iccp_counters[ICCP_DBG_CNTR_MSG_MAC_INFO]
+                         [ICCP_DBG_CNTR_DIR_RX][ICCP_DBG_CNTR_STS_OK];
+    stats->resync_full = MLACP(csm).dbg_counters.resync_full_count;
+    stats->resync_delta = MLACP(csm).dbg_counters.resync_delta_count;
+    RB_FOREACH(mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+        ++stats->mac_count;
+    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+        ++stats->arp_count;
+    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+        ++stats->ndisc_count;
+
+    return;
+}
+
+/* Upper bound of the bucket holding the percentile, as mclagdctl reports it */
+uint64_t iccp_test_latency_pct(const system_latency_hist_t* hist, int percent)
+{
+    uint64_t rank, sum = 0;
+    uint64_t bound;
+    int i;
+
+    if (hist->count == 0)
+        return 0;
+
+    rank = (hist->count * percent + 99) / 100;
+    for (i = 0; i < LATENCY_HIST_BUCKET_NUM - 1; ++i)
+    {
+        sum += hist->buckets[i];
+        if (sum >= rank)
+            break;
+    }
+
+    bound = (i == LATENCY_HIST_BUCKET_NUM - 1) ? hist->max_usec : ((uint64_t)1 << i);
+    return (bound < hist->max_usec) ? bound : hist->max_usec;
+}
+
+void iccp_test_run(int msec)
+{
+    struct System* sys = system_get_instance();
+    uint64_t end = iccp_test_now_usec() + (uint64_t)msec * 1000;
+    uint64_t now;
+
+    while ((now = iccp_test_now_usec()) < end)
+        scheduler_loop_once(sys, (end - now) / 1000 < 10 ? (end - now) / 1000 : 10);
+
+    return;
+}
+
+/* 1 once cond holds, 0 if max_msec passed first */
+int iccp_test_run_until(int (*cond)(void* arg), void* arg, int max_msec)
+{
+    struct System* sys = system_get_instance();
+    uint64_t end = iccp_test_now_usec() + (uint64_t)max_msec * 1000;
+
+    while (!cond(arg))
+    {
+        if (iccp_test_now_usec() >= end)
+            return 0;
+        scheduler_loop_once(sys, 5);
+    }
+
+    return 1;
+}
+
+/* Attach fd as the peer session, the way scheduler_server_accept does */
+int iccp_test_session_attach(int domain_id, int fd)
+{
+    struct System* sys = system_get_instance();
+    struct CSM* csm = iccp_test_csm(domain_id);
+    struct epoll_event event;
+    int bufsize = ICCP_TEST_SOCK_BUF_LEN;
+
+    if (csm == NULL || csm->sock_fd > 0 || scheduler_check_csm_config(csm) < 0)
+        return MCLAG_ERROR;
+
+    pthread_mutex_lock(&csm->conn_mutex);
+    session_client_conn_abort(csm);
+
+    event.data.fd = fd;
+    event.events = EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        pthread_mutex_unlock(&csm->conn_mutex);
+        return MCLAG_ERROR;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUFFORCE, &bufsize, sizeof(bufsize));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &bufsize, sizeof(bufsize));
+    csm->sock_fd = fd;
+    system_set_csm_fd(csm, fd);
+    csm->current_state = ICCP_NONEXISTENT;
+    FD_SET(fd, &(sys->readfd));
+    sys->readfd_count++;
+    pthread_mutex_unlock(&csm->conn_mutex);
+
+    /* An accept is followed by the FSM pass before the socket is read, the
+     * peer's capability may already be waiting
+     */
+    iccp_csm_transit(csm);
+
+    return 0;
+}
+
+void iccp_test_session_close(int domain_id)
+{
+    struct CSM* csm = iccp_test_csm(domain_id);
+
+    if (csm && csm->sock_fd > 0)
+        scheduler_session_disconnect_handler(csm);
+
+    return;
+}
+
+/* A session with no iccpd behind it, returns the harness end. Used with
+ * iccp_test_session_force to feed the daemon hand made peer messages.
+ */
+int iccp_test_session_fake(int domain_id)
+{
+    int bufsize = ICCP_TEST_SOCK_BUF_LEN;
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return MCLAG_ERROR;
+    if (iccp_test_session_attach(domain_id, fds[0]) < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return MCLAG_ERROR;
+    }
+    /* Large writes land whole instead of running the loop in between */
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUFFORCE, &bufsize, sizeof(bufsize));
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+
+    return fds[1];
+}
+
+/* Put the FSMs where a completed handshake leaves them */
+void iccp_test_session_force(int domain_id, int mlacp_state)
+{
+    struct CSM* csm = iccp_test_csm(domain_id);
+
+    if (csm == NULL)
+        return;
+
+    csm->iccp_info.sender_capability_flag = 1;
+    csm->iccp_info.peer_capability_flag = 1;
+    csm->iccp_info.sender_rg_connect_flag = 1;
+    csm->iccp_info.peer_rg_connect_flag = 1;
+    csm->current_state = ICCP_OPERATIONAL;
+    csm->app_csm.current_state = APP_OPERATIONAL;
+    MLACP(csm).current_state = mlacp_state;
+    MLACP(csm).prev_state = mlacp_state;
+
+    return;
+}
+
+/* Read what iccpd sent on a fake session, MCLAG_ERROR once it closed it */
+int iccp_test_drain(int fd)
+{
+    char buf[65536];
+    ssize_t n;
+
+    while (1)
+    {
+        n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0)
+            continue;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        return MCLAG_ERROR;
+    }
+}
+
+int iccp_test_session_up(void* domain_id)
+{
+    struct CSM* csm = iccp_test_csm((int)(intptr_t)domain_id);
+
+    return csm && csm->sock_fd > 0 && MLACP(csm).current_state == MLACP_STATE_EXCHANGE;
+}
+
+/******************************************************
+*
+*    mclagdctl
+*
+******************************************************/
+
+int __real_mclagd_ctl_sock_create();
+
+/* A client on iccpd's control socket, bound under /tmp on first use */
+int iccp_test_ctl_connect(void)
+{
+    struct System* sys = system_get_instance();
+    struct sockaddr_un addr;
+    char path[64];
+    int fd;
+
+    if (sys == NULL)
+        return MCLAG_ERROR;
+
+    if (sys->sync_ctrl_fd <= 0)
+    {
+        snprintf(path, sizeof(path), "/tmp/iccpd_test_%d.sock", (int)getpid());
+        free(sys->mclagdctl_file_path);
+        sys->mclagdctl_file_path = strdup(path);
+        if (__real_mclagd_ctl_sock_create() < 0)
+            return MCLAG_ERROR;
+    }
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return MCLAG_ERROR;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sys->mclagdctl_file_path);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        close(fd);
+        return MCLAG_ERROR;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    return fd;
+}
+
+int iccp_test_ctl_watch(int fd, int mclag_id)
+{
+    struct mclagdctl_req_hdr req;
+
+    memset(&req, 0, sizeof(req));
+    req.info_type = INFO_TYPE_WATCH;
+    req.mclag_id = mclag_id;
+
+    return iccp_test_send(fd, &req, sizeof(req));
+}
+
+/* Next watch record, runs the loop until one is in. 0 on timeout,
+ * MCLAG_ERROR once iccpd closed the stream.
+ */
+int iccp_test_ctl_watch_next(int fd, struct mclagd_watch_event* ev, int max_msec)
+{
+    char buf[MCLAGD_REPLY_INFO_HDR + sizeof(struct mclagd_watch_event)];
+    struct mclagd_reply_hdr* hd = (struct mclagd_reply_hdr*)(buf + sizeof(int));
+    uint64_t end = iccp_test_now_usec() + (uint64_t)max_msec * 1000;
+    ssize_t n;
+
+    while (1)
+    {
+        n = recv(fd, buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            return MCLAG_ERROR;
+
+        /* A reply without a record is the refusal of the request */
+        if (n >= (ssize_t)MCLAGD_REPLY_INFO_HDR && hd->data_len != sizeof(struct mclagd_watch_event))
+            return MCLAG_ERROR;
+        if (n == (ssize_t)sizeof(buf))
+        {
+            recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+            memcpy(ev, buf + MCLAGD_REPLY_INFO_HDR, sizeof(struct mclagd_watch_event));
+            return 1;
+        }
+
+        if (iccp_test_now_usec() >= end)
+            return 0;
+        iccp_test_run(1);
+    }
+}
+
+/******************************************************
+*
+*    Topology
+*
+******************************************************/
+
+/* Locally administered, unique per node and index */
+void iccp_test_mac(uint8_t node_id, uint32_t index, uint8_t* mac)
+{
+    mac[0] = 0x02;
+    mac[1] = node_id;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+
+    return;
+}
+
+void iccp_test_vlan_ip(const struct iccp_test_topo* topo, int vid, uint8_t host, uint32_t* ipv4, uint8_t* ipv6)
+{
+    uint8_t v4[4] = { 10, (vid >> 8) & 0xff, vid & 0xff, host };
+    uint8_t v6[16] = { 0xfc, 0x00, 0, 0, 0, 0, (vid >> 8) & 0xff, vid & 0xff, 0, 0, 0, 0, 0, 0, 0, host };
+
+    if (ipv4)
+        memcpy(ipv4, v4, sizeof(v4));
+    if (ipv6)
+        memcpy(ipv6, v6, sizeof(v6));
+
+    return;
+}
+
+static int iccp_test_topo_lif_ready(void* arg)
+{
+    const struct iccp_test_topo* topo = (const struct iccp_test_topo*)arg;
+    struct LocalInterface* lif = NULL;
+    char name[IFNAMSIZ];
+    int i;
+
+    if (!local_if_find_by_name(ICCP_TEST_PEER_LINK))
+        return 0;
+    for (i = 1; i <= topo->num_po; ++i)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", i);
+        if (!local_if_find_by_name(name))
+            return 0;
+    }
+    for (i = 0; i < topo->vlan_count; ++i)
+    {
+        snprintf(name, sizeof(name), "Vlan%d", topo->vlan_base + i);
+        if (!(lif = local_if_find_by_name(name)) || lif->ipv4_addr == 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int iccp_test_topo_bound(void* arg)
+{
+    const struct iccp_test_topo* topo = (const struct iccp_test_topo*)arg;
+    struct LocalInterface* lif = NULL;
+    struct CSM* csm = iccp_test_csm(topo->domain_id);
+    char name[IFNAMSIZ];
+    int i;
+
+    if (csm == NULL)
+        return 0;
+    for (i = 1; i <= topo->num_po; ++i)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", i);
+        if (!(lif = local_if_find_by_name(name)) || lif->csm != csm)
+            return 0;
+        if (topo->vlan_count > 0 && !local_if_is_vlan_member(lif, topo->vlan_base + topo->vlan_count - 1))
+            return 0;
+    }
+
+    return 1;
+}
+
+int iccp_test_topo_setup(const struct iccp_test_topo* topo)
+{
+    uint8_t mac[ETHER_ADDR_LEN];
+    uint8_t ipv6[16];
+    uint32_t ipv4;
+    char name[IFNAMSIZ];
+    int i, v;
+
+    iccp_test_mac(topo->node_id, 0, mac);
+    if (iccp_test_link(ICCP_TEST_PEER_LINK, ICCP_TEST_PEER_LINK_IFINDEX, mac, 1) < 0)
+        return MCLAG_ERROR;
+
+    for (i = 1; i <= topo->num_po; ++i)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", i);
+        if (iccp_test_link(name, ICCP_TEST_PO_IFINDEX_BASE + i, mac, 1) < 0)
+            return MCLAG_ERROR;
+    }
+
+    for (i = 0; i < topo->vlan_count; ++i)
+    {
+        v = topo->vlan_base + i;
+        snprintf(name, sizeof(name), "Vlan%d", v);
+        if (iccp_test_link(name, ICCP_TEST_VLAN_IFINDEX_BASE + v, mac, 1) < 0)
+            return MCLAG_ERROR;
+        iccp_test_vlan_ip(topo, v, topo->node_id, &ipv4, ipv6);
+        if (iccp_test_addr(ICCP_TEST_VLAN_IFINDEX_BASE + v, AF_INET, &ipv4, 24) < 0
+            || iccp_test_addr(ICCP_TEST_VLAN_IFINDEX_BASE + v, AF_INET6, ipv6, 64) < 0)
+            return MCLAG_ERROR;
+    }
+
+    if (!iccp_test_run_until(iccp_test_topo_lif_ready, (void*)topo, 5000))
+        return MCLAG_ERROR;
+
+    if (iccp_test_syncd_domain(topo->domain_id, topo->local_ip, topo->peer_ip, ICCP_TEST_PEER_LINK, mac) < 0)
+        return MCLAG_ERROR;
+
+    for (i = 1; i <= topo->num_po; ++i)
+    {
+        snprintf(name, sizeof(name), "PortChannel%d", i);
+        if (iccp_test_syncd_iface(topo->domain_id, name, 1) < 0)
+            return MCLAG_ERROR;
+    }
+
+    for (v = topo->vlan_base; v < topo->vlan_base + topo->vlan_count; ++v)
+    {
+        if (iccp_test_syncd_vlan_mbr(v, ICCP_TEST_PEER_LINK, 1) < 0)
+            return MCLAG_ERROR;
+        for (i = 1; i <= topo->num_po; ++i)
+        {
+            snprintf(name, sizeof(name), "PortChannel%d", i);
+            if (iccp_test_syncd_vlan_mbr(v, name, 1) < 0)
+                return MCLAG_ERROR;
+        }
+    }
+
+    if (!iccp_test_run_until(iccp_test_topo_bound, (void*)topo, 5000))
+        return MCLAG_ERROR;
+
+    return 0;
+}
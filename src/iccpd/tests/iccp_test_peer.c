@@ -0,0 +1,376 @@
+/*
+ * iccp_test_peer.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* The peer iccpd. It is forked before either side creates its System, so
+ * each process has its own daemon state and threads. The parent drives it
+ * over a SOCK_SEQPACKET control channel carrying function pointers (valid
+ * in both processes, there is no exec) and the session socket on reconnect.
+ * Both event loops keep running while a call is outstanding.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "../include/system.h"
+#include "../include/scheduler.h"
+#include "../include/iccp_csm.h"
+
+#include "iccp_test.h"
+
+struct iccp_test_ctl_msg
+{
+    iccp_test_peer_fn fn;
+    int64_t ret;
+    uint32_t len;
+    char arg[ICCP_TEST_ARG_SIZE];
+};
+
+static int iccp_test_ctl_send(int fd, struct iccp_test_ctl_msg* msg, int pass_fd)
+{
+    struct msghdr mh;
+    struct iovec iov;
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr* cmsg = NULL;
+
+    memset(&mh, 0, sizeof(mh));
+    iov.iov_base = msg;
+    iov.iov_len = offsetof(struct iccp_test_ctl_msg, arg) + msg->len;
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+
+    if (pass_fd >= 0)
+    {
+        memset(cbuf, 0, sizeof(cbuf));
+        mh.msg_control = cbuf;
+        mh.msg_controllen = sizeof(cbuf);
+        cmsg = CMSG_FIRSTHDR(&mh);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof(int));
+    }
+
+    while (sendmsg(fd, &mh, MSG_NOSIGNAL) < 0)
+    {
+        if (errno != EINTR)
+            return MCLAG_ERROR;
+    }
+
+    return 0;
+}
+
+/* 0 on EOF, the received fd (or -1) in *recv_fd */
+static ssize_t iccp_test_ctl_recv(int fd, struct iccp_test_ctl_msg* msg, int* recv_fd)
+{
+    struct msghdr mh;
+    struct iovec iov;
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr* cmsg = NULL;
+    ssize_t n;
+
+    memset(&mh, 0, sizeof(mh));
+    iov.iov_base = msg;
+    iov.iov_len = sizeof(*msg);
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = cbuf;
+    mh.msg_controllen = sizeof(cbuf);
+
+    while ((n = recvmsg(fd, &mh, 0)) < 0 && errno == EINTR)
+        ;
+
+    if (recv_fd)
+        *recv_fd = -1;
+    cmsg = CMSG_FIRSTHDR(&mh);
+    if (n > 0 && recv_fd && cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        memcpy(recv_fd, CMSG_DATA(cmsg), sizeof(int));
+
+    return n;
+}
+
+/******************************************************
+*
+*    Child side
+*
+******************************************************/
+
+static int g_iccp_test_peer_domain;
+
+static int64_t iccp_test_peer_stats_fn(void* arg)
+{
+    iccp_test_stats_get(g_iccp_test_peer_domain, (struct iccp_test_stats*)arg);
+    return 0;
+}
+
+static int64_t iccp_test_peer_close_fn(void* arg)
+{
+    iccp_test_session_close(g_iccp_test_peer_domain);
+    return 0;
+}
+
+/* Replaced with the fd that came with the call */
+static int64_t iccp_test_peer_attach_fn(void* arg)
+{
+    return iccp_test_session_attach(g_iccp_test_peer_domain, *(int*)arg);
+}
+
+static void iccp_test_peer_main(int ctl_fd, int sess_fd, const struct iccp_test_topo* topo)
+{
+    struct iccp_test_ctl_msg msg;
+    struct pollfd pfd;
+    int recv_fd;
+    ssize_t n;
+
+    g_iccp_test_peer_domain = topo->domain_id;
+
+    if (iccp_test_node_init() < 0 || iccp_test_topo_setup(topo) < 0
+        || iccp_test_session_attach(topo->domain_id, sess_fd) < 0)
+    {
+        fprintf(stderr, "iccp_test: peer set up failed\n");
+        _exit(1);
+    }
+
+    /* Tell the parent the peer is ready */
+    msg.fn = NULL;
+    msg.ret = 0;
+    msg.len = 0;
+    iccp_test_ctl_send(ctl_fd, &msg, -1);
+
+    while (1)
+    {
+        scheduler_loop_once(iccp_test_sys(), 2);
+
+        pfd.fd = ctl_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 0) <= 0)
+            continue;
+
+        n = iccp_test_ctl_recv(ctl_fd, &msg, &recv_fd);
+        if (n <= 0 || msg.fn == NULL)
+            break;
+
+        if (recv_fd >= 0)
+        {
+            memcpy(msg.arg, &recv_fd, sizeof(recv_fd));
+            msg.len = sizeof(recv_fd);
+        }
+        msg.ret = msg.fn(msg.arg);
+        iccp_test_ctl_send(ctl_fd, &msg, -1);
+    }
+
+    iccp_test_node_finalize();
+    _exit(0);
+}
+
+/******************************************************
+*
+*    Parent side
+*
+******************************************************/
+
+int iccp_test_peer_start(struct iccp_test_peer* peer, const struct iccp_test_topo* local,
+                         const struct iccp_test_topo* remote)
+{
+    int ctl[2], sess[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, ctl) < 0)
+        return MCLAG_ERROR;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sess) < 0)
+        return MCLAG_ERROR;
+
+    fflush(NULL);
+    peer->pid = fork();
+    if (peer->pid < 0)
+        return MCLAG_ERROR;
+    if (peer->pid == 0)
+    {
+        close(ctl[0]);
+        close(sess[0]);
+        iccp_test_peer_main(ctl[1], sess[1], remote);
+    }
+
+    close(ctl[1]);
+    close(sess[1]);
+    peer->ctl_fd = ctl[0];
+    peer->domain_id = local->domain_id;
+
+    if (iccp_test_node_init() < 0 || iccp_test_topo_setup(local) < 0
+        || iccp_test_session_attach(local->domain_id, sess[0]) < 0)
+        return MCLAG_ERROR;
+
+    /* Wait for the peer's ready message, serving the session meanwhile */
+    if (iccp_test_peer_call(peer, NULL, NULL, 0) < 0)
+        return MCLAG_ERROR;
+
+    return 0;
+}
+
+static int64_t iccp_test_peer_call_fd(struct iccp_test_peer* peer, iccp_test_peer_fn fn, void* arg,
+                                      size_t len, int pass_fd)
+{
+    struct iccp_test_ctl_msg msg;
+    struct pollfd pfd;
+
+    if (len > ICCP_TEST_ARG_SIZE)
+        return MCLAG_ERROR;
+
+    /* fn == NULL only collects the start up message */
+    if (fn)
+    {
+        msg.fn = fn;
+        msg.ret = 0;
+        msg.len = len;
+        if (len)
+            memcpy(msg.arg, arg, len);
+        if (iccp_test_ctl_send(peer->ctl_fd, &msg, pass_fd) < 0)
+            return MCLAG_ERROR;
+    }
+
+    while (1)
+    {
+        pfd.fd = peer->ctl_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 0) > 0)
+            break;
+        scheduler_loop_once(iccp_test_sys(), 2);
+    }
+
+    if (iccp_test_ctl_recv(peer->ctl_fd, &msg, NULL) <= 0)
+    {
+        fprintf(stderr, "iccp_test: peer exited\n");
+        return MCLAG_ERROR;
+    }
+
+    if (fn && len)
+        memcpy(arg, msg.arg, len);
+
+    return msg.ret;
+}
+
+int64_t iccp_test_peer_call(struct iccp_test_peer* peer, iccp_test_peer_fn fn, void* arg, size_t len)
+{
+    return iccp_test_peer_call_fd(peer, fn, arg, len, -1);
+}
+
+void iccp_test_peer_stats(struct iccp_test_peer* peer, struct iccp_test_stats* stats)
+{
+    iccp_test_peer_call(peer, iccp_test_peer_stats_fn, stats, sizeof(*stats));
+    return;
+}
+
+struct iccp_test_wait_up
+{
+    struct iccp_test_peer* peer;
+    int peer_up;
+};
+
+static int iccp_test_both_up(void* arg)
+{
+    struct iccp_test_wait_up* w = (struct iccp_test_wait_up*)arg;
+    struct iccp_test_stats stats;
+
+    if (!iccp_test_session_up((void*)(intptr_t)w->peer->domain_id))
+        return 0;
+
+    iccp_test_peer_stats(w->peer, &stats);
+    return stats.sock_fd > 0 && stats.mlacp_state == MLACP_STATE_EXCHANGE;
+}
+
+/* Session up and in EXCHANGE on both sides */
+int iccp_test_peer_wait_up(struct iccp_test_peer* peer, int max_msec)
+{
+    struct iccp_test_wait_up w = { peer, 0 };
+
+    return iccp_test_run_until(iccp_test_both_up, &w, max_msec);
+}
+
+/* Drop the session on this side and wait for the peer to see the close */
+int iccp_test_peer_disconnect(struct iccp_test_peer* peer)
+{
+    struct iccp_test_stats stats;
+    uint64_t end;
+
+    iccp_test_session_close(peer->domain_id);
+
+    end = iccp_test_now_usec() + 5000 * 1000;
+    do
+    {
+        iccp_test_peer_stats(peer, &stats);
+        if (stats.sock_fd <= 0)
+            break;
+        iccp_test_run(5);
+    } while (iccp_test_now_usec() < end);
+    if (stats.sock_fd > 0)
+        iccp_test_peer_call(peer, iccp_test_peer_close_fn, NULL, 0);
+
+    return 0;
+}
+
+/* Hand both sides a new socketpair */
+int iccp_test_peer_connect(struct iccp_test_peer* peer)
+{
+    int sess[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sess) < 0)
+        return MCLAG_ERROR;
+    if (iccp_test_session_attach(peer->domain_id, sess[0]) < 0)
+        return MCLAG_ERROR;
+    if (iccp_test_peer_call_fd(peer, iccp_test_peer_attach_fn, NULL, 0, sess[1]) < 0)
+        return MCLAG_ERROR;
+    close(sess[1]);
+
+    return 0;
+}
+
+int iccp_test_peer_reconnect(struct iccp_test_peer* peer)
+{
+    if (iccp_test_peer_disconnect(peer) < 0)
+        return MCLAG_ERROR;
+
+    return iccp_test_peer_connect(peer);
+}
+
+void iccp_test_peer_stop(struct iccp_test_peer* peer)
+{
+    struct iccp_test_ctl_msg msg;
+    int status;
+
+    if (peer->pid <= 0)
+        return;
+
+    msg.fn = NULL;
+    msg.ret = 0;
+    msg.len = 0;
+    iccp_test_ctl_send(peer->ctl_fd, &msg, -1);
+    close(peer->ctl_fd);
+    waitpid(peer->pid, &status, 0);
+    peer->pid = 0;
+
+    return;
+}
@@ -0,0 +1,276 @@
+/*
+ * test_loopback.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ *  Maintainer: jianjun, grace Li from nephos
+ */
+
+/* Two iccpd instances over the loopback harness: session bring up, MAC,
+ * ARP and ND sync to the peer with bounded p99 latency, watch records for
+ * changed neighbors, and resync after a session flap.
+ */
+
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "../include/iccp_csm.h"
+#include "../src/mclagdctl/mclagdctl.h"
+
+#include "iccp_test.h"
+
+#define TEST_NUM_PO         4
+#define TEST_VLAN_BASE      100
+#define TEST_VLAN_COUNT     4
+#define TEST_NUM_MAC        2000
+#define TEST_NUM_NEIGH      200
+#define TEST_WAIT_MSEC      20000
+/* Far above what loopback needs, catches a stuck queue not a slow host */
+#define TEST_LAT_P99_USEC   500000
+
+static struct iccp_test_topo local_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.1",
+    .peer_ip = "127.0.0.2",
+    .num_po = TEST_NUM_PO,
+    .vlan_base = TEST_VLAN_BASE,
+    .vlan_count = TEST_VLAN_COUNT,
+    .node_id = 1,
+};
+
+static struct iccp_test_topo remote_topo = {
+    .domain_id = ICCP_TEST_DOMAIN_ID,
+    .local_ip = "127.0.0.2",
+    .peer_ip = "127.0.0.1",
+    .num_po = TEST_NUM_PO,
+    .vlan_base = TEST_VLAN_BASE,
+    .vlan_count = TEST_VLAN_COUNT,
+    .node_id = 2,
+};
+
+static struct iccp_test_peer peer;
+
+struct peer_wait
+{
+    uint32_t mac_count;
+    uint32_t arp_count;
+    uint32_t ndisc_count;
+    uint64_t fdb_add;
+    uint64_t neigh_add;
+};
+
+/* Peer caught up with at least what w asks for */
+static int peer_reached(void* arg)
+{
+    struct peer_wait* w = (struct peer_wait*)arg;
+    struct iccp_test_stats stats;
+
+    iccp_test_peer_stats(&peer, &stats);
+
+    return stats.mac_count >= w->mac_count
+           && stats.arp_count >= w->arp_count
+           && stats.ndisc_count >= w->ndisc_count
+           && stats.cnt.syncd_fdb_add >= w->fdb_add
+           && stats.cnt.neigh_add >= w->neigh_add;
+}
+
+static void test_session_up(void)
+{
+    uint64_t start = iccp_test_now_usec();
+
+    ICCP_TEST_CHECK(iccp_test_peer_wait_up(&peer, TEST_WAIT_MSEC));
+    printf("session up: %.1f ms\n", (iccp_test_now_usec() - start) / 1000.0);
+
+    return;
+}
+
+static void test_mac_sync(void)
+{
+    struct peer_wait w;
+    struct iccp_test_stats stats;
+    uint64_t start = iccp_test_now_usec();
+
+    ICCP_TEST_CHECK(iccp_test_syncd_fdb_many(local_topo.node_id, 1, TEST_NUM_MAC, TEST_VLAN_BASE,
+                                             "PortChannel1", 1) == 0);
+
+    memset(&w, 0, sizeof(w));
+    w.mac_count = TEST_NUM_MAC;
+    w.fdb_add = TEST_NUM_MAC;
+    ICCP_TEST_CHECK(iccp_test_run_until(peer_reached, &w, TEST_WAIT_MSEC));
+    printf("mac sync: %d MACs on the peer and in its FDB in %.1f ms\n",
+           TEST_NUM_MAC, (iccp_test_now_usec() - start) / 1000.0);
+
+    iccp_test_stats_get(ICCP_TEST_DOMAIN_ID, &stats);
+    ICCP_TEST_CHECK(stats.mac_count == TEST_NUM_MAC);
+
+    return;
+}
+
+static void test_neigh_sync(int family)
+{
+    struct peer_wait w;
+    struct iccp_test_stats stats, before;
+    uint8_t mac[ETHER_ADDR_LEN];
+    uint8_t ipv6[16];
+    uint32_t ipv4;
+    uint64_t start = iccp_test_now_usec();
+    int i;
+
+    iccp_test_peer_stats(&peer, &before);
+
+    for (i = 0; i < TEST_NUM_NEIGH; ++i)
+    {
+        iccp_test_mac(local_topo.node_id, 1 + i, mac);
+        iccp_test_vlan_ip(&local_topo, TEST_VLAN_BASE, 10 + i, &ipv4, ipv6);
+        ICCP_TEST_CHECK(iccp_test_neigh(ICCP_TEST_VLAN_IFINDEX_BASE + TEST_VLAN_BASE, family,
+                                        family == AF_INET ? (void*)&ipv4 : (void*)ipv6, mac, 1) == 0);
+    }
+
+    memset(&w, 0, sizeof(w));
+    if (family == AF_INET)
+        w.arp_count = TEST_NUM_NEIGH;
+    else
+        w.ndisc_count = TEST_NUM_NEIGH;
+    w.neigh_add = before.cnt.neigh_add + TEST_NUM_NEIGH;
+    ICCP_TEST_CHECK(iccp_test_run_until(peer_reached, &w, TEST_WAIT_MSEC));
+    printf("%s sync: %d entries on the peer and in its kernel in %.1f ms\n",
+           family == AF_INET ? "arp" : "nd", TEST_NUM_NEIGH, (iccp_test_now_usec() - start) / 1000.0);
+
+    iccp_test_stats_get(ICCP_TEST_DOMAIN_ID, &stats);
+    ICCP_TEST_CHECK((family == AF_INET ? stats.arp_count : stats.ndisc_count) == TEST_NUM_NEIGH);
+
+    return;
+}
+
+static void test_latency_one(const char* node, const system_latency_info_t* latency,
+                             SYSTEM_LATENCY_TYPE_e type, const char* name, uint64_t min_count)
+{
+    const system_latency_hist_t* hist = &latency->hist[type];
+    uint64_t p99 = iccp_test_latency_pct(hist, 99);
+
+    printf("latency %s %s: %llu samples, p50 %llu us, p99 %llu us, max %llu us\n", node, name,
+           (unsigned long long)hist->count, (unsigned long long)iccp_test_latency_pct(hist, 50),
+           (unsigned long long)p99, (unsigned long long)hist->max_usec);
+    ICCP_TEST_CHECK(hist->count >= min_count);
+    ICCP_TEST_CHECK(p99 <= TEST_LAT_P99_USEC);
+
+    return;
+}
+
+/* Histograms filled by the syncs above, p99 bounded on both nodes */
+static void test_latency(void)
+{
+    struct iccp_test_stats local, remote;
+
+    iccp_test_stats_get(ICCP_TEST_DOMAIN_ID, &local);
+    iccp_test_peer_stats(&peer, &remote);
+
+    test_latency_one("local", &local.latency, LATENCY_MAC_TO_PEER, "mac to peer", TEST_NUM_MAC);
+    test_latency_one("local", &local.latency, LATENCY_ARP_TO_PEER, "arp to peer", TEST_NUM_NEIGH);
+    test_latency_one("local", &local.latency, LATENCY_ND_TO_PEER, "nd to peer", TEST_NUM_NEIGH);
+    test_latency_one("peer", &remote.latency, LATENCY_MAC_TO_SYNCD, "mac to syncd", TEST_NUM_MAC);
+
+    return;
+}
+
+/* Wait for a record of type and op carrying mac, skipping the others */
+static int watch_wait_mac(int fd, uint8_t type, uint8_t op, const uint8_t* mac)
+{
+    struct mclagd_watch_event ev;
+    uint64_t end = iccp_test_now_usec() + (uint64_t)TEST_WAIT_MSEC * 1000;
+
+    while (iccp_test_now_usec() < end)
+    {
+        if (iccp_test_ctl_watch_next(fd, &ev, TEST_WAIT_MSEC) <= 0)
+            return 0;
+        if (ev.type == type && ev.op == op
+            && (!mac || memcmp(ev.mac_addr, mac, ETHER_ADDR_LEN) == 0))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* A neighbor that moves to another MAC is updated in place, the watcher
+ * must still hear about it
+ */
+static void test_watch_update(void)
+{
+    uint8_t mac[ETHER_ADDR_LEN];
+    uint8_t ipv6[16];
+    uint32_t ipv4;
+    int fd;
+
+    ICCP_TEST_CHECK((fd = iccp_test_ctl_connect()) >= 0);
+    ICCP_TEST_CHECK(iccp_test_ctl_watch(fd, ICCP_TEST_DOMAIN_ID) == 0);
+    ICCP_TEST_CHECK(watch_wait_mac(fd, MCLAGD_WATCH_SYNCED, 0, NULL));
+
+    iccp_test_mac(local_topo.node_id, 1 + TEST_NUM_NEIGH, mac);
+    iccp_test_vlan_ip(&local_topo, TEST_VLAN_BASE, 10, &ipv4, ipv6);
+    ICCP_TEST_CHECK(iccp_test_neigh(ICCP_TEST_VLAN_IFINDEX_BASE + TEST_VLAN_BASE, AF_INET, &ipv4, mac, 1) == 0);
+    ICCP_TEST_CHECK(watch_wait_mac(fd, MCLAGD_WATCH_ARP, MCLAGD_WATCH_OP_ADD, mac));
+
+    ICCP_TEST_CHECK(iccp_test_neigh(ICCP_TEST_VLAN_IFINDEX_BASE + TEST_VLAN_BASE, AF_INET6, ipv6, mac, 1) == 0);
+    ICCP_TEST_CHECK(watch_wait_mac(fd, MCLAGD_WATCH_NDISC, MCLAGD_WATCH_OP_ADD, mac));
+    printf("watch: in place ARP and ND updates reported\n");
+
+    close(fd);
+
+    return;
+}
+
+static void test_flap_resync(void)
+{
+    struct peer_wait w;
+    struct iccp_test_stats stats;
+    uint64_t start = iccp_test_now_usec();
+
+    ICCP_TEST_CHECK(iccp_test_peer_reconnect(&peer) == 0);
+    ICCP_TEST_CHECK(iccp_test_peer_wait_up(&peer, TEST_WAIT_MSEC));
+
+    memset(&w, 0, sizeof(w));
+    w.mac_count = TEST_NUM_MAC;
+    w.arp_count = TEST_NUM_NEIGH;
+    w.ndisc_count = TEST_NUM_NEIGH;
+    ICCP_TEST_CHECK(iccp_test_run_until(peer_reached, &w, TEST_WAIT_MSEC));
+    printf("flap: session back and peer resynced in %.1f ms\n", (iccp_test_now_usec() - start) / 1000.0);
+
+    iccp_test_peer_stats(&peer, &stats);
+    ICCP_TEST_CHECK(stats.mac_count == TEST_NUM_MAC);
+
+    return;
+}
+
+int main(int argc, char* argv[])
+{
+    ICCP_TEST_CHECK(iccp_test_peer_start(&peer, &local_topo, &remote_topo) == 0);
+
+    test_session_up();
+    test_mac_sync();
+    test_neigh_sync(AF_INET);
+    test_neigh_sync(AF_INET6);
+    test_latency();
+    test_watch_update();
+    test_flap_resync();
+
+    iccp_test_peer_stop(&peer);
+    iccp_test_node_finalize();
+
+    return 0;
+}